@@ -319,6 +319,102 @@ TRAMPOLINE_EXIT:
 Trampoline_ASM_x64 ENDP
 
 
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;	
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;; TrampolineFast_ASM_x64
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;
+; Used for hooks installed with EASYHOOK_HOOK_FAST_TRAMPOLINE. There is
+; no thread barrier, so the handler is entered directly with the original
+; return address. The execution counter only covers the trampoline itself
+; and is released before the handler is entered, because nothing runs after
+; the handler returns. Such hooks are pinned in LhAllocateHook(), so the
+; relocated entry point stays valid for a handler calling the original method
+; after the hook was removed.
+; RAX and R11 are volatile and never used for parameters.
+; The fixed fields have the same layout as in Trampoline_ASM_x64.
+public TrampolineFast_ASM_x64
+TrampolineFast_ASM_x64 PROC
+
+FastNETIntro:
+	;void*			NETEntry; // fixed 0 (0) 
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+FastOldProc:
+	;BYTE*			OldProc; // fixed 4 (8)  
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+FastNewProc:
+	;BYTE*			NewProc; // fixed 8 (16) 
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+FastNETOutro:
+	;void*			NETOutro; // fixed 12 (24) 
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+FastIsExecutedPtr:
+	;size_t*		IsExecutedPtr; // fixed 16 (32) 
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+	db 0
+
+	mov r11, qword ptr [FastIsExecutedPtr]
+	db 0F0h ; interlocked increment execution counter
+	inc qword ptr [r11]
+
+; is a user handler available?
+	mov rax, qword ptr [FastNewProc]
+	test rax, rax
+	db 3Eh ; branch usually taken
+	jne FAST_TRAMPOLINE_EXIT
+
+	; call original method
+	mov rax, qword ptr [FastOldProc]
+
+FAST_TRAMPOLINE_EXIT:
+	db 0F0h ; interlocked decrement execution counter
+	dec qword ptr [r11]
+
+	jmp rax
+
+; outro signature, to automatically determine code size
+	db 78h
+	db 56h
+	db 34h
+	db 12h
+
+TrampolineFast_ASM_x64 ENDP
+
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;	
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;; HookInjectionCode_ASM_x64
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
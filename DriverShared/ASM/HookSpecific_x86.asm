@@ -195,6 +195,58 @@ TRAMPOLINE_EXIT:
 
 Trampoline_ASM_x86@0 ENDP
 
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;	
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;; TrampolineFast_ASM_x86
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;
+; Used for hooks installed with EASYHOOK_HOOK_FAST_TRAMPOLINE. There is
+; no thread barrier, so the handler is entered directly with the original
+; return address. The execution counter only covers the trampoline itself
+; and is released before the handler is entered, because nothing runs after
+; the handler returns. Such hooks are pinned in LhAllocateHook(), so the
+; relocated entry point stays valid for a handler calling the original method
+; after the hook was removed.
+public TrampolineFast_ASM_x86@0
+
+TrampolineFast_ASM_x86@0 PROC
+
+; OldProc:		1A2B3C01h
+; IsExecuted:	1A2B3C02h
+; Ptr:NewProc:	1A2B3C07h
+
+	mov eax, 1A2B3C02h
+	db 0F0h ; interlocked increment execution counter
+	inc dword ptr [eax]
+
+; is a user handler available?
+	mov eax, 1A2B3C07h
+	mov eax, dword ptr [eax]
+	test eax, eax
+
+	db 3Eh ; branch usually taken
+	jne FAST_TRAMPOLINE_EXIT
+
+	; call original method
+	mov eax, 1A2B3C01h
+
+FAST_TRAMPOLINE_EXIT:
+	push eax
+	mov eax, 1A2B3C02h
+	db 0F0h ; interlocked decrement execution counter
+	dec dword ptr [eax]
+	pop eax
+
+	jmp eax
+
+; outro signature, to automatically determine code size
+	db 78h
+	db 56h
+	db 34h
+	db 12h
+
+TrampolineFast_ASM_x86@0 ENDP
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;	
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;; HookInjectionCode_ASM_x86
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
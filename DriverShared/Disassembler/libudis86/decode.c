@@ -743,12 +743,12 @@ decode_operand(struct ud           *u,
       break;
     case OP_F:
       u->br_far  = 1;
-      /* intended fall through */
+      /* fall through */
     case OP_M:
       if (MODRM_MOD(modrm(u)) == 3) {
         UDERR(u, "expected modrm.mod != 3\n");
       }
-      /* intended fall through */
+      /* fall through */
     case OP_E:
       decode_modrm_rm(u, operand, REGCLASS_GPR, size);
       break;
@@ -767,7 +767,7 @@ decode_operand(struct ud           *u,
       if (MODRM_MOD(modrm(u)) != 3) {
         UDERR(u, "expected modrm.mod == 3\n");
       }
-      /* intended fall through */
+      /* fall through */
     case OP_Q:
       decode_modrm_rm(u, operand, REGCLASS_MMX, size);
       break;
@@ -778,7 +778,7 @@ decode_operand(struct ud           *u,
       if (MODRM_MOD(modrm(u)) != 3) {
         UDERR(u, "expected modrm.mod == 3\n");
       }
-      /* intended fall through */
+      /* fall through */
     case OP_W:
       decode_modrm_rm(u, operand, REGCLASS_XMM, size);
       break;
@@ -885,6 +885,160 @@ decode_operand(struct ud           *u,
 }
 
 
+/*
+ * skip_modrm_rm
+ *
+ *    Length decoder counterpart of decode_modrm_rm, consumes SIB
+ *    and displacement bytes of a mod/rm memory operand.
+ */
+static void
+skip_modrm_rm(struct ud *u)
+{
+  unsigned int offset = 0;
+  unsigned char mod, rm, sib;
+
+  mod = MODRM_MOD(modrm(u));
+  rm  = (REX_B(u->_rex) << 3) | MODRM_RM(modrm(u));
+
+  if (mod == 3) {
+    return;
+  }
+
+  if (u->adr_mode == 64) {
+    if (mod == 1) {
+      offset = 8;
+    } else if (mod == 2 || (rm & 7) == 5) {
+      offset = 32;
+    }
+    if ((rm & 7) == 4) {
+      sib = inp_next(u);
+      /* rbp or r13 base */
+      if (SIB_B(sib) == 5) {
+        offset = (mod == 1) ? 8 : 32;
+      }
+    }
+  } else if (u->adr_mode == 32) {
+    if (mod == 1) {
+      offset = 8;
+    } else if (mod == 2 || rm == 5) {
+      offset = 32;
+    }
+    if ((rm & 7) == 4) {
+      sib = inp_next(u);
+      /* ebp base */
+      if ((SIB_B(sib) | (REX_B(u->pfx_rex) << 3)) == 5) {
+        offset = (mod == 1) ? 8 : 32;
+      }
+    }
+  } else {
+    if (mod == 0 && rm == 6) {
+      offset = 16;
+    } else if (mod == 1) {
+      offset = 8;
+    } else if (mod == 2) { 
+      offset = 16;
+    }
+  }
+
+  for (offset /= 8; offset > 0; offset--) {
+    inp_next(u);
+  }
+}
+
+
+/*
+ * skip_operand
+ *
+ *    Length decoder counterpart of decode_operand, only consumes the
+ *    bytes of a single operand. Returns 0 if the following operands
+ *    would not be decoded by decode_operands.
+ */
+static int
+skip_operand(struct ud *u, enum ud_operand_code type, unsigned int size)
+{
+  unsigned int bytes = 0;
+
+  switch (type) {
+    case OP_NONE:
+      return 0;
+    case OP_A:
+      bytes = (u->opr_mode == 16) ? 4 : 6;
+      break;
+    case OP_F:
+      u->br_far = 1;
+      /* fall through */
+    case OP_MR:
+    case OP_M:
+    case OP_E:
+    case OP_N:
+    case OP_Q:
+    case OP_U:
+    case OP_W:
+    case OP_MU:
+    case OP_R:
+      skip_modrm_rm(u);
+      break;
+    case OP_S:
+      /* decode_reg rejects invalid segment registers */
+      if ((MODRM_REG(modrm(u)) & 7) > 5) {
+        UDERR(u, "invalid segment register value\n");
+        return 0;
+      }
+      break;
+    case OP_G:
+    case OP_P:
+    case OP_V:
+    case OP_C:
+    case OP_D:
+      modrm(u);
+      break;
+    case OP_sI:
+    case OP_I:
+    case OP_J:
+      switch (resolve_operand_size(u, (ud_operand_size_t)size)) {
+        case  8: bytes = 1; break;
+        case 16: bytes = 2; break;
+        case 32: bytes = 4; break;
+        case 64: bytes = 8; break;
+      }
+      break;
+    case OP_O:
+      bytes = u->adr_mode / 8;
+      break;
+    case OP_L:
+      bytes = 1;
+      break;
+    default:
+      /* implicit registers and constants */
+      break;
+  }
+
+  for (; bytes > 0; bytes--) {
+    inp_next(u);
+  }
+  return 1;
+}
+
+
+/*
+ * skip_operands
+ *
+ *    Length decoder counterpart of decode_operands.
+ */
+static int
+skip_operands(struct ud* u)
+{
+  const struct ud_itab_entry *e = u->itab_entry;
+
+  if (skip_operand(u, e->operand1.type, e->operand1.size) &&
+      skip_operand(u, e->operand2.type, e->operand2.size) &&
+      skip_operand(u, e->operand3.type, e->operand3.size)) {
+    skip_operand(u, e->operand4.type, e->operand4.size);
+  }
+  return 0;
+}
+
+
 /* 
  * decode_operands
  *
@@ -1033,6 +1187,10 @@ decode_insn(struct ud *u, uint16_t ptr)
   UD_ASSERT((ptr & 0x8000) == 0);
   u->itab_entry = &ud_itab[ ptr ];
   u->mnemonic = u->itab_entry->mnemonic;
+  if (u->len_only) {
+    return (resolve_mode(u)  == 0 &&
+            skip_operands(u) == 0) ? 0 : -1;
+  }
   return (resolve_pfx_str(u)  == 0 &&
           resolve_mode(u)     == 0 &&
           decode_operands(u)  == 0 &&
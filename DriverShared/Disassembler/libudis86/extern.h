@@ -86,6 +86,8 @@ extern LIBUDIS86_DLLEXTERN const char* ud_insn_hex(struct ud*);
 
 extern LIBUDIS86_DLLEXTERN unsigned int ud_insn_len(const struct ud* u);
 
+extern LIBUDIS86_DLLEXTERN unsigned int ud_insn_length(const uint8_t* buf, size_t len, uint8_t mode);
+
 extern LIBUDIS86_DLLEXTERN const struct ud_operand* ud_insn_opr(const struct ud *u, unsigned int n);
 
 extern LIBUDIS86_DLLEXTERN int ud_opr_is_sreg(const struct ud_operand *opr);
@@ -229,6 +229,7 @@ struct ud
   uint8_t   vex_b1;
   uint8_t   vex_b2;
   uint8_t   primary_opcode;
+  uint8_t   len_only;   /* only compute the length, see ud_insn_length() */
   void *    user_opaque_data;
   struct ud_itab_entry * itab_entry;
   struct ud_lookup_table_list_entry *le;
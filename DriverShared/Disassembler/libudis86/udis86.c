@@ -205,6 +205,36 @@ ud_insn_len(const struct ud* u)
 }
 
 
+/* =============================================================================
+ * ud_insn_length
+ *    Returns the length of the instruction at the given buffer, like
+ *    ud_decode() would. Operands are skipped instead of decoded and
+ *    the mnemonic is not resolved. The decoder state lives on the stack
+ *    and only the fields used by the decoder are initialized, so this
+ *    is re-entrant and much cheaper than ud_init() + ud_disassemble().
+ * =============================================================================
+ */
+extern unsigned int
+ud_insn_length(const uint8_t* buf, size_t len, uint8_t mode)
+{
+  struct ud u;
+
+  u.inp_hook      = NULL;
+  u.inp_buf       = buf;
+  u.inp_buf_size  = len;
+  u.inp_buf_index = 0;
+  u.inp_curr      = 0;
+  u.inp_end       = 0;
+  u.inp_peek      = UD_EOI;
+  u.pc            = 0;
+  u.vendor        = UD_VENDOR_AMD;
+  u.len_only      = 1;
+  ud_set_mode(&u, mode);
+
+  return ud_decode(&u);
+}
+
+
 /* =============================================================================
  * ud_insn_get_opr
  *    Return the operand struct representing the nth operand of
@@ -51,11 +51,25 @@ typedef struct _NOTIFICATION_REQUEST_
 	ULONG				Entries[0];
 }NOTIFICATION_REQUEST, *PNOTIFICATION_REQUEST;
 
-typedef struct _HOOK_ACL_
+/*
+    An ACL refers to an immutable table of sorted, unique IDs. Updates publish
+    a new table, see LhUpdateACL(). A NULL table is an empty inclusive ACL.
+*/
+#define LH_MAX_ACL_COUNT                0x00100000
+
+typedef struct _HOOK_ACL_TABLE_
 {
-	ULONG                   Count;
+	struct _HOOK_ACL_TABLE_* Next; // only used while retired
 	BOOL                    IsExclusive;
-	ULONG                   Entries[MAX_ACE_COUNT];
+	ULONG                   Count;
+	ULONG                   Entries[1];
+}HOOK_ACL_TABLE;
+
+typedef struct _HOOK_ACL_
+{
+	HOOK_ACL_TABLE* volatile Table;
+	// incremented after each update, see RuntimeIsIntercepted()
+	volatile LONG           Generation;
 }HOOK_ACL;
 
 #define LOCAL_HOOK_SIGNATURE            ((ULONG)0x6A910BE2)
@@ -63,6 +77,7 @@ typedef struct _HOOK_ACL_
 typedef struct _LOCAL_HOOK_INFO_
 {
     PLOCAL_HOOK_INFO        Next;
+    PLOCAL_HOOK_INFO        Prev; // only valid while in GlobalHookListHead
     ULONG					NativeSize;
 	UCHAR*					TargetProc;
 	ULONGLONG				TargetBackup;
@@ -76,6 +91,12 @@ typedef struct _LOCAL_HOOK_INFO_
 	HOOK_ACL				LocalACL;
     ULONG                   Signature;
     TRACED_HOOK_HANDLE      Tracking;
+    void*                   Slab;
+    BOOL                    IsQuiescent;
+    ULONG                   QuiescentSince;
+    BOOL                    IsPinned; // memory is only released on unload, see LhReclaimRetiredHooks()
+    ULONG                   Flags; // EASYHOOK_HOOK_*
+    void*                   Statistics; // only with EASYHOOK_HOOK_STATISTICS
 
 	void*					RandomValue; // fixed
 	void*					HookIntro; // fixed
@@ -88,8 +109,10 @@ typedef struct _LOCAL_HOOK_INFO_
 
 extern LOCAL_HOOK_INFO          GlobalHookListHead;
 extern LOCAL_HOOK_INFO          GlobalRemovalListHead;
+extern LOCAL_HOOK_INFO          GlobalRetiredListHead;
 extern RTL_SPIN_LOCK            GlobalHookLock;
-extern ULONG                    GlobalSlotList[];
+// hooks with IsPinned set, limited to MAX_PINNED_HOOK_COUNT
+extern volatile LONG            GlobalPinnedHookCount;
 
 EASYHOOK_BOOL_INTERNAL LhIsValidHandle(
             TRACED_HOOK_HANDLE InTracedHandle,
@@ -97,18 +120,91 @@ EASYHOOK_BOOL_INTERNAL LhIsValidHandle(
 
 void LhCriticalInitialize();
 
+void LhSlotListFinalize();
+
+void LhReleaseHookSlot(LOCAL_HOOK_INFO* InHook);
+
+void LhLinkHook(LOCAL_HOOK_INFO* InHook);
+
+void LhUnlinkHook(LOCAL_HOOK_INFO* InHook);
+
+ULONG LhReclaimRetiredHooks();
+
 void LhModuleInfoFinalize();
 
 void LhCriticalFinalize();
 
-void* LhAllocateMemory(void* InEntryPoint);
+// The maximum number of bytes that can be used for a trampoline jump
+// Under most circumstance the max is 8 bytes, for X64_DRIVER this
+// increases to 16 bytes to support jumping to absolute addresses
+#define MAX_JMP_SIZE 16
+
+// The space reserved for the relocated entry point within a hook block
+#define LH_MAX_RELOC_SIZE               128
+
+#define LH_CACHE_LINE_SIZE              64
+
+/*
+    Hook statistics are split into stripes on separate cache lines. A thread
+    only updates the stripe selected by its storage slot and LhGetHookStatistics()
+    sums all of them.
+*/
+#define LH_STATISTICS_STRIPE_COUNT      8
+#define LH_STATISTICS_STRIPE_SIZE       ((sizeof(HOOK_STATISTICS) + LH_CACHE_LINE_SIZE - 1) & ~(LH_CACHE_LINE_SIZE - 1))
+#define LH_STATISTICS_SIZE              (LH_STATISTICS_STRIPE_COUNT * LH_STATISTICS_STRIPE_SIZE + LH_CACHE_LINE_SIZE)
+#define LhStatisticsStripe(Statistics, Index) \
+    ((HOOK_STATISTICS*)((((ULONG_PTR)(Statistics) + LH_CACHE_LINE_SIZE - 1) & ~(ULONG_PTR)(LH_CACHE_LINE_SIZE - 1)) + (Index) * LH_STATISTICS_STRIPE_SIZE))
+
+/*
+    Protects objects published by pointer from being released while
+    readers might still refer to them, see gate.c.
+*/
+#define LH_READER_STRIPE_COUNT          8
 
-void* LhAllocateMemoryEx(void* InEntryPoint, ULONG* OutPageSize);
+typedef struct _LH_READER_STRIPE_
+{
+    volatile LONG           Count;
+    UCHAR                   Padding[LH_CACHE_LINE_SIZE - sizeof(LONG)];
+}LH_READER_STRIPE;
+
+typedef struct _LH_READER_GATE_
+{
+    volatile LONG           Epoch;
+    UCHAR                   Padding[LH_CACHE_LINE_SIZE - sizeof(LONG)];
+    LH_READER_STRIPE        Readers[2][LH_READER_STRIPE_COUNT];
+}LH_READER_GATE;
+
+// the retired list a writer adds replaced objects to
+#define LH_READER_GATE_PARITY(Gate)     ((ULONG)(Gate)->Epoch & 1)
+
+ULONG LhEnterReaderGate(LH_READER_GATE* InGate);
+
+void LhLeaveReaderGate(
+            LH_READER_GATE* InGate,
+            ULONG InToken);
+
+ULONG LhAdvanceReaderGate(LH_READER_GATE* InGate);
+
+void LhAllocatorInitialize();
+
+void LhAllocatorFinalize();
+
+LOCAL_HOOK_INFO* LhAllocateMemory(
+            void* InEntryPoint,
+            ULONG* OutBlockSize);
 
 void LhFreeMemory(PLOCAL_HOOK_INFO* RefHandle);
 
 HOOK_ACL* LhBarrierGetAcl();
 
+LONG LhUpdateACL(
+            HOOK_ACL* InAcl,
+            BOOL InIsExclusive,
+            ULONG* InIdList,
+            ULONG InCount);
+
+void LhReleaseACL(HOOK_ACL* InAcl);
+
 ULONGLONG LhBarrierIntro(LOCAL_HOOK_INFO* InHandle, void* InRetAddr, void** InAddrOfRetAddr);
 
 void* __stdcall LhBarrierOutro(LOCAL_HOOK_INFO* InHandle, void** InAddrOfRetAddr);
@@ -117,6 +213,7 @@ EASYHOOK_NT_INTERNAL LhAllocateHook(
             void* InEntryPoint,
             void* InHookProc,
             void* InCallback,
+            ULONG InFlags,
             LOCAL_HOOK_INFO** Hook,
             ULONG* RelocSize);
 
@@ -138,6 +235,48 @@ EASYHOOK_NT_INTERNAL LhRelocateEntryPoint(
 				UCHAR* Buffer,
 				ULONG* OutRelocSize);
 
+/*
+    A decoded entry point, so the instructions are only decoded once
+    per hook, see LhDecodePrologue().
+*/
+#define LH_MAX_PROLOGUE_INSTRUCTIONS    20
+
+#define LH_BRANCH_NONE                  0
+#define LH_BRANCH_CALL                  1
+#define LH_BRANCH_JMP                   2
+#define LH_BRANCH_JCC                   3
+#define LH_BRANCH_LOOP                  4 // loop, loope, loopne and jcxz
+
+typedef struct _LH_PROLOGUE_INSTRUCTION_
+{
+    UCHAR               Offset;
+    UCHAR               Length;
+    BOOLEAN             IsRIPRelative;
+    UCHAR               DispOffset; // offset of the RIP displacement, zero if unknown
+    UCHAR               BranchType; // one of LH_BRANCH_*
+    UCHAR               BranchDispSize; // the branch displacement ends the instruction
+    BOOLEAN             HasAddressPrefix;
+    BOOLEAN             IsCall; // any call, also indirect ones
+}LH_PROLOGUE_INSTRUCTION;
+
+typedef struct _LH_DECODED_PROLOGUE_
+{
+    UCHAR*                      EntryPoint;
+    ULONG                       Size;
+    ULONG                       Count;
+    LH_PROLOGUE_INSTRUCTION     Instructions[LH_MAX_PROLOGUE_INSTRUCTIONS];
+}LH_DECODED_PROLOGUE;
+
+EASYHOOK_NT_INTERNAL LhDecodePrologue(
+            void* InEntryPoint,
+            ULONG InMinSize,
+            LH_DECODED_PROLOGUE* OutPrologue);
+
+EASYHOOK_NT_INTERNAL LhRelocatePrologue(
+				LH_DECODED_PROLOGUE* InPrologue,
+				UCHAR* Buffer,
+				ULONG* OutRelocSize);
+
 EASYHOOK_NT_INTERNAL LhRoundToNextInstruction(
 			void* InCodePtr,
 			ULONG InCodeSize);
@@ -25,39 +25,322 @@
 
 #include "stdafx.h"
 
-void LhFreeMemory(PLOCAL_HOOK_INFO* RefHandle)
+/*
+    Hook memory is organized in slabs of LH_SLAB_SIZE bytes. Each slab consists of
+    a header, followed by one cache line per hook block holding its execution counter,
+    followed by the hook blocks themselves, starting at a page boundary. This way the
+    counters written by the trampolines never share a cache line with executed code.
+
+    Hook blocks have a fixed, cache line aligned size, large enough for the
+    LOCAL_HOOK_INFO, the trampoline and the relocated entry point. Released blocks are
+    kept in a per slab free list and a slab is only returned to the system if all of its
+    blocks are free. Full slabs are kept in a list of their own, so allocations only
+    walk slabs with free blocks. One empty slab is kept instead of being released,
+    so installing and removing a few hooks in a loop doesn't allocate and release
+    a slab each time.
+
+    In 64-Bit user mode, a slab can only serve entry points within a 31-bit boundary
+    around the whole slab...
+*/
+#define LH_SLAB_SIZE            0x10000
+#define LH_SLAB_PAGE_SIZE       0x1000
+#define LH_MAX_REL_DISTANCE     ((LONGLONG)0x7FFFFF00)
+// other threads may keep allocating right where the rebuilt map found free space
+#define LH_SLAB_ALLOC_ATTEMPTS  16
+
+typedef struct _LH_SLAB_
+{
+    struct _LH_SLAB_*       Next;
+    struct _LH_SLAB_*       Prev;
+    LOCAL_HOOK_INFO*        FreeList;
+    ULONG                   FreeCount;
+    ULONG                   BlockCount;
+    UCHAR*                  Blocks;
+}LH_SLAB;
+
+C_ASSERT(sizeof(LH_SLAB) <= LH_CACHE_LINE_SIZE);
+
+ULONG GetTrampolineSize();
+
+static void LhFreeSlabMemory(void* InSlab);
+
+static LH_SLAB*             SlabListHead = NULL;
+static LH_SLAB*             FullSlabListHead = NULL;
+static LH_SLAB*             EmptySlab = NULL;
+static RTL_SPIN_LOCK        SlabLock;
+static ULONG                HookBlockSize = 0;
+
+#define LhSlabCounter(Slab, Index)      ((int*)((UCHAR*)(Slab) + LH_CACHE_LINE_SIZE * (1 + (Index))))
+#define LhRoundUp(Value, Alignment)     (((Value) + (Alignment) - 1) & ~((Alignment) - 1))
+
+#if defined(_M_X64) && !defined(DRIVER)
+
+/*
+    Instead of probing the address space around an entry point with VirtualAlloc(),
+    a sorted map of all free address ranges is built once with VirtualQuery(). A slab
+    is then placed at the nearest suitable granule in one step. The map is
+    not kept up to date with foreign allocations; if VirtualAlloc() fails at the chosen
+    address, the map is considered stale and is rebuilt...
+*/
+typedef struct _LH_FREE_REGION_
+{
+    ULONGLONG               Base;
+    ULONGLONG               End;
+}LH_FREE_REGION;
+
+static LH_FREE_REGION*      FreeRegionMap = NULL;
+static ULONG                FreeRegionCount = 0;
+static ULONG                FreeRegionMaxCount = 0;
+static BOOL                 IsFreeRegionMapValid = FALSE;
+
+static BOOL LhReserveFreeRegion()
 {
 /*
 Description:
 
-    Will release the memory for a given hook.
+    Ensures that the free region map can take one more entry.
+*/
+    LH_FREE_REGION*             NewMap;
 
-Parameters:
+    if(FreeRegionCount < FreeRegionMaxCount)
+        return TRUE;
 
-    - RefHandle
+    if((NewMap = (LH_FREE_REGION*)RtlAllocateMemory(FALSE, sizeof(LH_FREE_REGION) * (FreeRegionMaxCount + 256))) == NULL)
+        return FALSE;
 
-        A pointer to a valid hook handle. It will be set to NULL
-        by this method!
+    if(FreeRegionMap != NULL)
+    {
+        RtlCopyMemory(NewMap, FreeRegionMap, sizeof(LH_FREE_REGION) * FreeRegionCount);
+
+        RtlFreeMemory(FreeRegionMap);
+    }
+
+    FreeRegionMap = NewMap;
+    FreeRegionMaxCount += 256;
+
+    return TRUE;
+}
+
+
+
+
+static void LhRemoveFreeRange(
+            ULONG InRegion,
+            ULONGLONG InAddress)
+{
+/*
+Description:
+
+    Cuts a slab at the given address out of the given free region.
+    If the region has to be split and the map can't grow, the map
+    is just invalidated.
 */
+    LH_FREE_REGION*     Region = &FreeRegionMap[InRegion];
+    ULONG               Index;
+
+    if(InAddress == Region->Base)
+        Region->Base += LH_SLAB_SIZE;
+    else if(InAddress + LH_SLAB_SIZE == Region->End)
+        Region->End = InAddress;
+    else if(LhReserveFreeRegion())
+    {
+        // insert the upper part as a new region...
+        Region = &FreeRegionMap[InRegion];
+
+        for(Index = FreeRegionCount; Index > InRegion + 1; Index--)
+        {
+            FreeRegionMap[Index] = FreeRegionMap[Index - 1];
+        }
+
+        FreeRegionMap[InRegion + 1].Base = InAddress + LH_SLAB_SIZE;
+        FreeRegionMap[InRegion + 1].End = Region->End;
+        FreeRegionCount++;
+
+        Region->End = InAddress;
+    }
+    else
+        IsFreeRegionMapValid = FALSE;
+}
+
+
+
+
+static BOOL LhBuildFreeRegionMap(SYSTEM_INFO* InSysInfo)
+{
+/*
+Description:
+
+    Walks the whole user mode address space and records all free
+    regions, trimmed to the allocation granularity, that are large
+    enough for a slab.
+
+Returns:
+
+    FALSE if not enough memory is available, TRUE otherwise.
+*/
+    MEMORY_BASIC_INFORMATION    Info;
+    ULONGLONG                   Address = (ULONGLONG)InSysInfo->lpMinimumApplicationAddress;
+    ULONGLONG                   Granularity = InSysInfo->dwAllocationGranularity;
+    ULONGLONG                   Base;
+    ULONGLONG                   End;
+
+    FreeRegionCount = 0;
+    IsFreeRegionMapValid = FALSE;
+
+    while((Address < (ULONGLONG)InSysInfo->lpMaximumApplicationAddress) && (VirtualQuery((void*)Address, &Info, sizeof(Info)) != 0))
+    {
+        Address = (ULONGLONG)Info.BaseAddress + Info.RegionSize;
+
+        if(Info.State != MEM_FREE)
+            continue;
+
+        Base = LhRoundUp((ULONGLONG)Info.BaseAddress, Granularity);
+        End = Address & ~(Granularity - 1);
+
+        if((End <= Base) || (End - Base < LH_SLAB_SIZE))
+            continue;
+
+        if(!LhReserveFreeRegion())
+            return FALSE;
+
+        FreeRegionMap[FreeRegionCount].Base = Base;
+        FreeRegionMap[FreeRegionCount].End = End;
+
+        FreeRegionCount++;
+    }
+
+    IsFreeRegionMapValid = TRUE;
+
+    return TRUE;
+}
+
+
+
+
+static BOOL LhFindNearestFreeRegion(
+            LH_FREE_REGION* InRegions,
+            ULONG InCount,
+            ULONGLONG InTarget,
+            ULONGLONG InLowest,
+            ULONGLONG InHighest,
+            ULONGLONG InGranularity,
+            ULONG* OutRegion,
+            ULONGLONG* OutAddress)
+{
+/*
+Description:
+
+    Selects the granule aligned address nearest to InTarget at which LH_SLAB_SIZE 
+    bytes fit into one of the given free regions, completely located within
+    [InLowest, InHighest). The regions are expected to be sorted and granule aligned.
+
+    This method does not depend on the current address space and
+    only evaluates the given regions.
+
+Returns:
+
+    FALSE if no such address exists, TRUE otherwise.
+*/
+    ULONG               Index;
+    ULONGLONG           Base;
+    ULONGLONG           End;
+    ULONGLONG           Candidate;
+    ULONGLONG           Distance;
+    ULONGLONG           BestDistance = ~((ULONGLONG)0);
+
+    for(Index = 0; Index < InCount; Index++)
+    {
+        Base = (InRegions[Index].Base < InLowest)?LhRoundUp(InLowest, InGranularity):InRegions[Index].Base;
+        End = (InRegions[Index].End > InHighest)?(InHighest & ~(InGranularity - 1)):InRegions[Index].End;
+
+        if((End <= Base) || (End - Base < LH_SLAB_SIZE))
+            continue;
+
+        // the candidate is the granule nearest to the target within the region
+        if(InTarget <= Base)
+            Candidate = Base;
+        else if(InTarget >= End - LH_SLAB_SIZE)
+            Candidate = End - LH_SLAB_SIZE;
+        else
+            Candidate = InTarget & ~(InGranularity - 1);
+
+        Distance = (Candidate > InTarget)?Candidate - InTarget:InTarget - Candidate;
+
+        if(Distance < BestDistance)
+        {
+            BestDistance = Distance;
+
+            *OutRegion = Index;
+            *OutAddress = Candidate;
+        }
+
+        // regions are sorted, so all following ones are even further away
+        if(Base > InTarget)
+            break;
+    }
+
+    return BestDistance != ~((ULONGLONG)0);
+}
 
-#if defined(_M_X64) && !defined(DRIVER)
-    VirtualFree(*RefHandle, 0, MEM_RELEASE);
-#else
-    RtlFreeMemory(*RefHandle);
 #endif
 
-    *RefHandle = NULL;
+
+
+
+void LhAllocatorInitialize()
+{
+/*
+Description:
+    
+    Initializes the hook memory allocator. Is called by LhCriticalInitialize().
+*/
+    SlabListHead = NULL;
+    FullSlabListHead = NULL;
+    EmptySlab = NULL;
+    HookBlockSize = LhRoundUp(sizeof(LOCAL_HOOK_INFO) + GetTrampolineSize() + LH_MAX_RELOC_SIZE + MAX_JMP_SIZE, LH_CACHE_LINE_SIZE);
+
+    RtlInitializeLock(&SlabLock);
 }
 
-///////////////////////////////////////////////////////////////////////////////////
-/////////////////////// LhAllocateMemory
-///////////////////////////////////////////////////////////////////////////////////
-void* LhAllocateMemory(void* InEntryPoint)
+
+
+
+void LhAllocatorFinalize()
 {
 /*
 Description:
+    
+    Is called by LhCriticalFinalize(). Slabs still containing hooks, which
+    could not be released, are leaked intentionally because they might
+    still be executed.
+*/
+    if(EmptySlab != NULL)
+        LhFreeSlabMemory(EmptySlab);
+
+    EmptySlab = NULL;
+
+    RtlDeleteLock(&SlabLock);
+
+#if defined(_M_X64) && !defined(DRIVER)
+    if(FreeRegionMap != NULL)
+        RtlFreeMemory(FreeRegionMap);
+
+    FreeRegionMap = NULL;
+    FreeRegionCount = 0;
+    FreeRegionMaxCount = 0;
+    IsFreeRegionMapValid = FALSE;
+#endif
+}
+
 
-    Allocates one page of hook specific memory.
+
+
+static void* LhAllocateSlabMemory(void* InEntryPoint)
+{
+/*
+Description:
+
+    Allocates LH_SLAB_SIZE bytes of executable memory.
 
 Parameters:
 
@@ -71,21 +354,259 @@ Parameters:
 Returns:
 
     NULL if no memory could be allocated, a valid pointer otherwise.
+*/
+    UCHAR*			    Res = NULL;
+
+#if defined(_M_X64) && !defined(DRIVER)
+    SYSTEM_INFO		    SysInfo;
+    LONGLONG		    iStart;
+    LONGLONG		    iEnd;
+    ULONGLONG           Address;
+    ULONG               Region;
+    ULONG               Attempt;
+
+    GetSystemInfo(&SysInfo);
+
+    // the whole slab has to be in reach, see LhIsSlabInRange()
+    iStart = ((LONGLONG)InEntryPoint) - LH_MAX_REL_DISTANCE + 1;
+    iEnd = ((LONGLONG)InEntryPoint) + LH_MAX_REL_DISTANCE - 1;
+
+    if(iStart < (LONGLONG)SysInfo.lpMinimumApplicationAddress)
+        iStart = (LONGLONG)SysInfo.lpMinimumApplicationAddress; // shall not be null, because then VirtualAlloc() will not work as expected
+
+    if(iEnd > (LONGLONG)SysInfo.lpMaximumApplicationAddress)
+        iEnd = (LONGLONG)SysInfo.lpMaximumApplicationAddress;
+
+    RtlAcquireLock(&SlabLock);
+    {
+        // we are trying to get memory as near as possible to relocate most RIP-relative instructions
+        for(Attempt = 0; (Res == NULL) && (Attempt < LH_SLAB_ALLOC_ATTEMPTS); Attempt++)
+        {
+            if(!IsFreeRegionMapValid || (Attempt > 0))
+            {
+                if(!LhBuildFreeRegionMap(&SysInfo))
+                    break;
+            }
+
+            if(!LhFindNearestFreeRegion(FreeRegionMap, FreeRegionCount, (ULONGLONG)InEntryPoint, (ULONGLONG)iStart, (ULONGLONG)iEnd,
+                    SysInfo.dwAllocationGranularity, &Region, &Address))
+                continue;
+
+            if((Res = (UCHAR*)VirtualAlloc((void*)Address, LH_SLAB_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE)) != NULL)
+                LhRemoveFreeRange(Region, Address);
+            else
+                IsFreeRegionMapValid = FALSE; // the map is stale...
+        }
+    }
+    RtlReleaseLock(&SlabLock);
+#elif !defined(DRIVER)
+	// in 32-bit mode the trampoline will always be reachable
+    Res = (UCHAR*)VirtualAlloc(NULL, LH_SLAB_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+	// In 64-bit driver mode we use an absolute address so the trampoline will always be reachable
+    Res = (UCHAR*)RtlAllocateMemory(TRUE, LH_SLAB_SIZE);
+#endif
+
+    return Res;
+}
+
 
+
+
+static void LhFreeSlabMemory(void* InSlab)
+{
+#ifndef DRIVER
+    VirtualFree(InSlab, 0, MEM_RELEASE);
+
+    #ifdef _M_X64
+        // the released range is not recorded in the free region map...
+        IsFreeRegionMapValid = FALSE;
+    #endif
+#else
+    RtlFreeMemory(InSlab);
+#endif
+}
+
+
+
+
+static LH_SLAB* LhCreateSlab(void* InEntryPoint)
+{
+/*
+Description:
+
+    Allocates a new slab and pushes all of its blocks onto the free list.
+    The slab is not yet linked into the slab list.
 */
-	ULONG pageSize;
-	return LhAllocateMemoryEx(InEntryPoint, &pageSize);
+    LH_SLAB*            Slab;
+    ULONG               Count;
+    ULONG               Index;
+    LOCAL_HOOK_INFO*    Block;
+
+    if((Slab = (LH_SLAB*)LhAllocateSlabMemory(InEntryPoint)) == NULL)
+        return NULL;
+
+    // find the largest count of blocks fitting behind the counter area...
+    for(Count = LH_SLAB_SIZE / HookBlockSize; Count > 0; Count--)
+    {
+        if(LhRoundUp(LH_CACHE_LINE_SIZE * (1 + Count), LH_SLAB_PAGE_SIZE) + Count * HookBlockSize <= LH_SLAB_SIZE)
+            break;
+    }
+
+    ASSERT(Count > 0, L"alloc.c - Count > 0");
+
+    Slab->Next = NULL;
+    Slab->Prev = NULL;
+    Slab->FreeList = NULL;
+    Slab->FreeCount = Count;
+    Slab->BlockCount = Count;
+    Slab->Blocks = (UCHAR*)Slab + LhRoundUp(LH_CACHE_LINE_SIZE * (1 + Count), LH_SLAB_PAGE_SIZE);
+
+    for(Index = Count; Index > 0; Index--)
+    {
+        Block = (LOCAL_HOOK_INFO*)(Slab->Blocks + (Index - 1) * HookBlockSize);
+
+        Block->Next = Slab->FreeList;
+        Slab->FreeList = Block;
+    }
+
+    return Slab;
+}
+
+
+
+
+static void LhLinkSlab(
+            LH_SLAB** RefListHead,
+            LH_SLAB* InSlab)
+{
+    InSlab->Prev = NULL;
+    InSlab->Next = *RefListHead;
+
+    if(*RefListHead != NULL)
+        (*RefListHead)->Prev = InSlab;
+
+    *RefListHead = InSlab;
+}
+
+
+
+
+static void LhUnlinkSlab(
+            LH_SLAB** RefListHead,
+            LH_SLAB* InSlab)
+{
+    if(InSlab->Prev != NULL)
+        InSlab->Prev->Next = InSlab->Next;
+    else
+        *RefListHead = InSlab->Next;
+
+    if(InSlab->Next != NULL)
+        InSlab->Next->Prev = InSlab->Prev;
+}
+
+
+
+
+static BOOL LhIsSlabInRange(
+            LH_SLAB* InSlab,
+            void* InEntryPoint)
+{
+#if defined(_M_X64) && !defined(DRIVER)
+    LONGLONG            Distance = (LONGLONG)InSlab - (LONGLONG)InEntryPoint;
+
+    return (Distance > -LH_MAX_REL_DISTANCE) && (Distance + LH_SLAB_SIZE < LH_MAX_REL_DISTANCE);
+#else
+    return TRUE;
+#endif
+}
+
+
+
+
+static LONGLONG LhSlabDistance(
+            LH_SLAB* InSlab,
+            void* InEntryPoint)
+{
+    LONGLONG            Distance = (LONGLONG)InSlab - (LONGLONG)InEntryPoint;
+
+    return (Distance < 0)?-Distance:Distance;
+}
+
+
+
+
+void LhFreeMemory(PLOCAL_HOOK_INFO* RefHandle)
+{
+/*
+Description:
+
+    Will release the memory for a given hook.
+
+Parameters:
+
+    - RefHandle
+
+        A pointer to a valid hook handle. It will be set to NULL
+        by this method!
+*/
+    LOCAL_HOOK_INFO*    Hook = *RefHandle;
+    LH_SLAB*            Slab = (LH_SLAB*)Hook->Slab;
+
+    if(Hook->IsPinned)
+        InterlockedDecrement(&GlobalPinnedHookCount);
+
+    if(Hook->Statistics != NULL)
+        RtlFreeMemory(Hook->Statistics);
+
+    LhReleaseACL(&Hook->LocalACL);
+
+    RtlAcquireLock(&SlabLock);
+    {
+        Hook->Signature = 0;
+        Hook->Next = Slab->FreeList;
+        Slab->FreeList = Hook;
+
+        if(Slab->FreeCount++ == 0)
+        {
+            LhUnlinkSlab(&FullSlabListHead, Slab);
+            LhLinkSlab(&SlabListHead, Slab);
+        }
+
+        if(Slab->FreeCount != Slab->BlockCount)
+            Slab = NULL;
+        else if(EmptySlab == NULL)
+        {
+            EmptySlab = Slab;
+            Slab = NULL;
+        }
+        else
+        {
+            // the slab is empty now and can be returned to the system
+            LhUnlinkSlab(&SlabListHead, Slab);
+        }
+    }
+    RtlReleaseLock(&SlabLock);
+
+    if(Slab != NULL)
+        LhFreeSlabMemory(Slab);
+
+    *RefHandle = NULL;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////
-/////////////////////// LhAllocateMemoryEx
+/////////////////////// LhAllocateMemory
 ///////////////////////////////////////////////////////////////////////////////////
-void* LhAllocateMemoryEx(void* InEntryPoint, ULONG* OutPageSize)
+LOCAL_HOOK_INFO* LhAllocateMemory(
+            void* InEntryPoint,
+            ULONG* OutBlockSize)
 {
 /*
 Description:
 
-    Allocates one page of hook specific memory. The page size is returned in OutPageSize
+    Allocates a zeroed block of hook specific memory. The block is taken from
+    the nearest slab with free blocks, or from a new one.
+    Hook->Slab and Hook->IsExecutedPtr are already initialized on return.
 
 Parameters:
 
@@ -96,85 +617,76 @@ Parameters:
         a relative jumper can still be placed instead of having to consume much more entry
         point bytes for an absolute jump!
 
-    - OutPageSize
+    - OutBlockSize
 
-        Will be updated to contain the page size.
+        Will be updated to contain the size of the block.
 
 Returns:
 
     NULL if no memory could be allocated, a valid pointer otherwise.
 
 */
+    LH_SLAB*            Slab;
+    LH_SLAB*            Best = NULL;
+    LH_SLAB*            NewSlab = NULL;
+    LOCAL_HOOK_INFO*    Hook = NULL;
 
-    UCHAR*			    Res = NULL;
+    *OutBlockSize = HookBlockSize;
 
-#if defined(_M_X64) && !defined(DRIVER)
-    LONGLONG            Base;
-    LONGLONG		    iStart;
-    LONGLONG		    iEnd;
-    LONGLONG            Index;
+    while(TRUE)
+    {
+        RtlAcquireLock(&SlabLock);
+        {
+            if(NewSlab != NULL)
+                LhLinkSlab(&SlabListHead, NewSlab);
 
-#endif
-	
-#if !defined(DRIVER)
-    SYSTEM_INFO		    SysInfo;
-    ULONG               PAGE_SIZE;
+            for(Slab = SlabListHead; Slab != NULL; Slab = Slab->Next)
+            {
+                if(!LhIsSlabInRange(Slab, InEntryPoint))
+                    continue;
 
-    GetSystemInfo(&SysInfo);
+                if((Best == NULL) || (LhSlabDistance(Slab, InEntryPoint) < LhSlabDistance(Best, InEntryPoint)))
+                    Best = Slab;
 
-    PAGE_SIZE = SysInfo.dwPageSize;
-    *OutPageSize = PAGE_SIZE;
+#if !defined(_M_X64) || defined(DRIVER)
+                // there is no such thing like a "near" slab...
+                break;
 #endif
+            }
 
+            if(Best != NULL)
+            {
+                if(Best == EmptySlab)
+                    EmptySlab = NULL;
 
-    // reserve page with execution privileges
-#if defined(_M_X64) && !defined(DRIVER)
+                Hook = Best->FreeList;
 
-    /*
-        Reserve memory around entry point...
-    */
-    iStart = ((LONGLONG)InEntryPoint) - ((LONGLONG)0x7FFFFF00);
-    iEnd = ((LONGLONG)InEntryPoint) + ((LONGLONG)0x7FFFFF00);
+                Best->FreeList = Hook->Next;
 
-    if(iStart < (LONGLONG)SysInfo.lpMinimumApplicationAddress)
-        iStart = (LONGLONG)SysInfo.lpMinimumApplicationAddress; // shall not be null, because then VirtualAlloc() will not work as expected
-
-    if(iEnd > (LONGLONG)SysInfo.lpMaximumApplicationAddress)
-        iEnd = (LONGLONG)SysInfo.lpMaximumApplicationAddress;
-
-    // we are trying to get memory as near as possible to relocate most RIP-relative instructions
-    for(Base = (LONGLONG)InEntryPoint, Index = 0; ; Index += PAGE_SIZE)
-    {
-		BOOLEAN end = TRUE;
-		if(Base + Index < iEnd)
-		{
-			if((Res = (UCHAR*)VirtualAlloc((void*)(Base + Index), PAGE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE)) != NULL)
-				break;
-			end = FALSE;
-		}
-
-        if(Base - Index > iStart)
-        {
-	        if((Res = (BYTE*)VirtualAlloc((void*)(Base - Index), PAGE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE)) != NULL)
-		        break;
-			end = FALSE;
+                if(--Best->FreeCount == 0)
+                {
+                    LhUnlinkSlab(&SlabListHead, Best);
+                    LhLinkSlab(&FullSlabListHead, Best);
+                }
+            }
         }
+        RtlReleaseLock(&SlabLock);
+
+        if((Hook != NULL) || (NewSlab != NULL))
+            break;
 
-		if (end)
-			break;
+        // the slab is allocated outside of the lock, which is raising the IRQL in drivers
+        if((NewSlab = LhCreateSlab(InEntryPoint)) == NULL)
+            return NULL;
     }
 
-    if(Res == NULL)
-	    return NULL;
-#else
-    
-	*OutPageSize = PAGE_SIZE;
-	// in 32-bit mode the trampoline will always be reachable
-	// In 64-bit driver mode we use an absolute address so the trampoline will always be reachable
-    if((Res = (UCHAR*)RtlAllocateMemory(TRUE, PAGE_SIZE)) == NULL)
+    if(Hook == NULL)
         return NULL;
 
-#endif
+    RtlZeroMemory(Hook, HookBlockSize);
 
-    return Res;
-}
\ No newline at end of file
+    Hook->Slab = Best;
+    Hook->IsExecutedPtr = LhSlabCounter(Best, ((UCHAR*)Hook - Best->Blocks) / HookBlockSize);
+
+    return Hook;
+}
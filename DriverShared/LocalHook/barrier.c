@@ -39,25 +39,68 @@ typedef struct _RUNTIME_INFO_
 	BOOL            IsExecuting;
 	// the hook this information entry belongs to... This allows a per thread and hook storage!
 	DWORD           HLSIdent;
+	// the hook slot this entry is stored for; only valid if HLSIdent is non-zero
+	ULONG           HLSIndex;
 	// the return address of the current thread's hook handler...
 	void*           RetAddress;
     // the address of the return address of the current thread's hook handler...
 	void**          AddrOfRetAddr;
+	// time stamp of handler entry; only set for hooks with statistics
+	ULONGLONG       EnterTime;
+	// the cached ACL verdict and the ACL generations it was computed for
+	BOOL            HasVerdict;
+	BOOL            IsIntercepted;
+	LONG            GlobalGeneration;
+	LONG            LocalGeneration;
 }RUNTIME_INFO;
 
+/*
+    Most threads only ever enter a few hooks. Their runtime information is kept
+    in a small inline array and only threads entering more hooks allocate
+    an open addressed hash table keyed by HLSIndex, growing with the count of
+    hooks actually entered. Entries are never removed until thread termination.
+*/
+#define RUNTIME_INLINE_COUNT        4
+#define RUNTIME_TABLE_MIN_SIZE      16
+
 typedef struct _THREAD_RUNTIME_INFO_
 {
+	RUNTIME_INFO		InlineEntries[RUNTIME_INLINE_COUNT];
 	RUNTIME_INFO*		Entries;
+	ULONG				EntryMask;
+	ULONG				EntryCount;
 	RUNTIME_INFO*		Current;
 	void*				Callback;
 	BOOL				IsProtected;
 }THREAD_RUNTIME_INFO, *LPTHREAD_RUNTIME_INFO;
 
+/*
+    The thread local storage is a chain of open addressed hash tables keyed
+    by thread ID. This way the lookup performed on every hooked call does not
+    depend on the count of registered threads.
+
+    Threads register themselves by claiming an empty or released ID slot with
+    a compare exchange. If all slots within the probe window of a thread are
+    taken, the thread continues with the next segment, which is allocated and
+    published on demand. Slots never become empty again once they were used,
+    so a lookup may stop at the first empty slot and segments never move...
+*/
+#define TLS_HASH_BITS           8
+#define TLS_HASH_SIZE           (1 << TLS_HASH_BITS)
+#define TLS_HASH_MASK           (TLS_HASH_SIZE - 1)
+#define TLS_PROBE_LIMIT         16
+// marks a slot released by an exited thread; it may be claimed again
+#define TLS_ID_REMOVED          ((LONG)-1)
+
+C_ASSERT(TLS_HASH_SIZE >= 2 * MAX_THREAD_COUNT);
+
 typedef struct _THREAD_LOCAL_STORAGE_
 {
-    THREAD_RUNTIME_INFO		Entries[MAX_THREAD_COUNT];
-    DWORD					IdList[MAX_THREAD_COUNT];
-    RTL_SPIN_LOCK			ThreadSafe;
+    THREAD_RUNTIME_INFO		Entries[TLS_HASH_SIZE];
+    volatile LONG			IdList[TLS_HASH_SIZE];
+    struct _THREAD_LOCAL_STORAGE_* volatile Next;
+    // only used in the first segment; set while a new segment is allocated
+    volatile LONG           IsGrowing;
 }THREAD_LOCAL_STORAGE;
 
 typedef struct _BARRIER_UNIT_
@@ -74,6 +117,60 @@ HOOK_ACL* LhBarrierGetAcl(){ return &Unit.GlobalACL; }
 
 
 
+static ULONG TlsHashThreadId(ULONG InThreadId)
+{
+/*
+Description:
+
+    Returns the preferred hash table slot for the given thread ID.
+    Thread IDs are multiples of four, so the low bits are dropped before
+    applying a multiplicative (Fibonacci) hash.
+*/
+    return ((InThreadId >> 2) * 0x9E3779B1) >> (32 - TLS_HASH_BITS);
+}
+
+
+
+
+static BOOL TlsGrowStorage(
+            THREAD_LOCAL_STORAGE* InTls,
+            THREAD_LOCAL_STORAGE* InLastSegment)
+{
+/*
+Description:
+
+    Appends a new segment to InLastSegment if no other thread did so.
+
+    The allocator itself might be hooked. Therefore only one thread at a time
+    is allowed to grow the storage and any hooked call made meanwhile, including
+    recursive ones of the growing thread, is just not intercepted.
+
+Returns:
+
+    TRUE if InLastSegment has a successor now, FALSE otherwise.
+*/
+    THREAD_LOCAL_STORAGE*       Segment;
+
+    if(InterlockedCompareExchange(&InTls->IsGrowing, 1, 0) != 0)
+        return FALSE;
+
+    if(InLastSegment->Next == NULL)
+    {
+        if((Segment = (THREAD_LOCAL_STORAGE*)RtlAllocateMemory(TRUE, sizeof(THREAD_LOCAL_STORAGE))) != NULL)
+        {
+            if(InterlockedCompareExchangePointer((PVOID volatile*)&InLastSegment->Next, Segment, NULL) != NULL)
+                RtlFreeMemory(Segment);
+        }
+    }
+
+    InterlockedExchange(&InTls->IsGrowing, 0);
+
+    return InLastSegment->Next != NULL;
+}
+
+
+
+
 BOOL TlsAddCurrentThread(THREAD_LOCAL_STORAGE* InTls)
 {
 /*
@@ -86,10 +183,11 @@ Description:
     This is a replacement for the Windows Thread Local Storage which seems
     to cause trouble when using it in Explorer.EXE for example.
 
+    No lock is taken; the storage grows if required.
+
     No parameter validation (for performance reasons).
 
-    This method will raise an assertion if the thread was already added
-    to the storage!
+    The caller must not already be registered in the storage!
 
 Parameters:
     - InTls
@@ -105,33 +203,37 @@ Returns:
 #else
 	ULONG		CurrentId = (ULONG)PsGetCurrentThreadId();
 #endif
-	LONG		Index = -1;
-    LONG		i;
+    THREAD_LOCAL_STORAGE*   Segment = InTls;
+    LONG        Id;
+    ULONG		Slot;
+    ULONG		i;
 
-    RtlAcquireLock(&InTls->ThreadSafe);
+    while(TRUE)
+    {
+	    for(i = 0, Slot = TlsHashThreadId(CurrentId); i < TLS_PROBE_LIMIT; i++, Slot = (Slot + 1) & TLS_HASH_MASK)
+	    {
+            Id = Segment->IdList[Slot];
 
-    // select Index AND check whether thread is already registered.
-	for(i = 0; i < MAX_THREAD_COUNT; i++)
-	{
-		if((InTls->IdList[i] == 0) && (Index == -1))
-			Index = i;
-		
-		ASSERT(InTls->IdList[i] != CurrentId,L"barrier.c - InTls->IdList[i] != CurrentId");
-	}
+		    ASSERT(Id != (LONG)CurrentId,L"barrier.c - Id != CurrentId");
 
-	if(Index == -1)
-	{
-		RtlReleaseLock(&InTls->ThreadSafe);
+            if((Id != 0) && (Id != TLS_ID_REMOVED))
+                continue;
 
-		return FALSE;
-	}
+            // if another thread is faster, the slot is taken and we just go on probing...
+            if(InterlockedCompareExchange(&Segment->IdList[Slot], (LONG)CurrentId, Id) == Id)
+            {
+                // only the owning thread will ever access this entry
+	            RtlZeroMemory(&Segment->Entries[Slot], sizeof(THREAD_RUNTIME_INFO));
 
-	InTls->IdList[Index] = CurrentId;
-	RtlZeroMemory(&InTls->Entries[Index], sizeof(THREAD_RUNTIME_INFO));
-	
-	RtlReleaseLock(&InTls->ThreadSafe);
+	            return TRUE;
+            }
+	    }
 
-	return TRUE;
+        if((Segment->Next == NULL) && !TlsGrowStorage(InTls, Segment))
+            return FALSE;
+
+        Segment = Segment->Next;
+    }
 }
 
 
@@ -169,17 +271,37 @@ Returns:
 #else
 	ULONG		CurrentId = (ULONG)PsGetCurrentThreadId();
 #endif
-    LONG        Index;
-
-	for(Index = 0; Index < MAX_THREAD_COUNT; Index++)
-	{
-		if(InTls->IdList[Index] == CurrentId)
-		{
-			*OutValue = &InTls->Entries[Index];
-
-			return TRUE;
-		}
-	}
+    THREAD_LOCAL_STORAGE*   Segment;
+    LONG        Id;
+    ULONG       Slot;
+    ULONG       i;
+
+    /*
+        No lock required: only the calling thread can add or remove its own ID,
+        and neither slots nor segments ever move...
+
+        Released slots are skipped, because an entry might have been added
+        behind them. An empty slot ends the whole lookup: it was already empty
+        when the caller registered, so the caller would have claimed it instead
+        of any slot behind it or in a later segment.
+    */
+    for(Segment = InTls; Segment != NULL; Segment = Segment->Next)
+    {
+	    for(i = 0, Slot = TlsHashThreadId(CurrentId); i < TLS_PROBE_LIMIT; i++, Slot = (Slot + 1) & TLS_HASH_MASK)
+	    {
+            Id = Segment->IdList[Slot];
+
+		    if(Id == (LONG)CurrentId)
+		    {
+			    *OutValue = &Segment->Entries[Slot];
+
+			    return TRUE;
+		    }
+
+		    if(Id == 0)
+			    return FALSE;
+	    }
+    }
 
 	return FALSE;
 }
@@ -202,26 +324,242 @@ Parameters:
 
         The storage from which the caller should be removed.
 */
-#ifndef DRIVER
-	ULONG		    CurrentId = (ULONG)GetCurrentThreadId();
-#else
-	ULONG		    CurrentId = (ULONG)PsGetCurrentThreadId();
-#endif
-    ULONG           Index;
+    THREAD_LOCAL_STORAGE*   Segment = InTls;
+    THREAD_RUNTIME_INFO*    Info;
+    ULONG                   Slot;
 
-    RtlAcquireLock(&InTls->ThreadSafe);
+    if(!TlsGetCurrentValue(InTls, &Info))
+        return;
 
-	for(Index = 0; Index < MAX_THREAD_COUNT; Index++)
-	{
-		if(InTls->IdList[Index] == CurrentId)
-		{
-			InTls->IdList[Index] = 0;
+    // locate the segment owning the entry...
+    while((Info < &Segment->Entries[0]) || (Info >= &Segment->Entries[TLS_HASH_SIZE]))
+    {
+        Segment = Segment->Next;
+    }
 
-			RtlZeroMemory(&InTls->Entries[Index], sizeof(THREAD_RUNTIME_INFO));
-		}
-	}
+    Slot = (ULONG)(Info - &Segment->Entries[0]);
+
+	RtlZeroMemory(Info, sizeof(THREAD_RUNTIME_INFO));
+
+    // release the slot for recycling
+    InterlockedExchange(&Segment->IdList[Slot], TLS_ID_REMOVED);
+}
+
+
+
+
+
+static ULONG RuntimeHashIndex(ULONG InHLSIndex)
+{
+    return InHLSIndex * 0x9E3779B1;
+}
+
+
+
+
+static BOOL RuntimeGrowTable(LPTHREAD_RUNTIME_INFO InInfo)
+{
+/*
+Description:
+
+    Doubles the size of the per thread hash table or allocates
+    the initial one. Must be called within the self protection, because
+    the allocator might be hooked.
+
+Returns:
+
+    FALSE if not enough memory is available, TRUE otherwise.
+*/
+    ULONG               Size = (InInfo->Entries == NULL)?RUNTIME_TABLE_MIN_SIZE:(InInfo->EntryMask + 1) * 2;
+    RUNTIME_INFO*       Table;
+    RUNTIME_INFO*       Old;
+    ULONG               Index;
+    ULONG               Slot;
+
+    if((Table = (RUNTIME_INFO*)RtlAllocateMemory(TRUE, sizeof(RUNTIME_INFO) * Size)) == NULL)
+        return FALSE;
+
+    if((Old = InInfo->Entries) != NULL)
+    {
+        // re-insert existing entries...
+        for(Index = 0; Index <= InInfo->EntryMask; Index++)
+        {
+            if(Old[Index].HLSIdent == 0)
+                continue;
+
+            for(Slot = RuntimeHashIndex(Old[Index].HLSIndex) & (Size - 1); Table[Slot].HLSIdent != 0; Slot = (Slot + 1) & (Size - 1))
+            {
+            }
+
+            Table[Slot] = Old[Index];
+        }
+
+        RtlFreeMemory(Old);
+    }
+
+    InInfo->Entries = Table;
+    InInfo->EntryMask = Size - 1;
+
+    return TRUE;
+}
+
+
+
+
+static RUNTIME_INFO* RuntimeLookup(
+            LPTHREAD_RUNTIME_INFO InInfo,
+            ULONG InHLSIndex,
+            BOOL InCanCreate)
+{
+/*
+Description:
+
+    Queries the runtime information of the given hook slot for the
+    calling thread.
+
+Parameters:
+
+    - InInfo
+
+        The caller's private storage entry.
+
+    - InHLSIndex
+
+        The slot of the hook.
+
+    - InCanCreate
+
+        Whether a new entry shall be created if none exists. Entries are
+        created with HLSIdent set to ~0, so the caller will always reset
+        them. This requires the self protection to be acquired.
+
+Returns:
+
+    NULL if no entry exists and none could be created.
+*/
+    ULONG               Index;
+    ULONG               Slot;
+    RUNTIME_INFO*       Runtime;
+
+    for(Index = 0; Index < RUNTIME_INLINE_COUNT; Index++)
+    {
+        Runtime = &InInfo->InlineEntries[Index];
+
+        if(Runtime->HLSIdent == 0)
+        {
+            if(!InCanCreate)
+                return NULL;
+
+            goto CREATE_ENTRY;
+        }
+
+        if(Runtime->HLSIndex == InHLSIndex)
+            return Runtime;
+    }
+
+    if(InInfo->Entries != NULL)
+    {
+        for(Slot = RuntimeHashIndex(InHLSIndex) & InInfo->EntryMask; ; Slot = (Slot + 1) & InInfo->EntryMask)
+        {
+            Runtime = &InInfo->Entries[Slot];
+
+            if(Runtime->HLSIdent == 0)
+                break;
+
+            if(Runtime->HLSIndex == InHLSIndex)
+                return Runtime;
+        }
+    }
+
+    if(!InCanCreate)
+        return NULL;
+
+    // keep the table at least half empty...
+    if((InInfo->Entries == NULL) || ((InInfo->EntryCount + 1) * 2 > InInfo->EntryMask + 1))
+    {
+        if(!RuntimeGrowTable(InInfo))
+            return NULL;
+    }
+
+    for(Slot = RuntimeHashIndex(InHLSIndex) & InInfo->EntryMask; InInfo->Entries[Slot].HLSIdent != 0; Slot = (Slot + 1) & InInfo->EntryMask)
+    {
+    }
+
+    Runtime = &InInfo->Entries[Slot];
+
+    InInfo->EntryCount++;
+
+CREATE_ENTRY:
+
+    Runtime->HLSIndex = InHLSIndex;
+    Runtime->HLSIdent = ~0;
+    Runtime->IsExecuting = FALSE;
 
-	RtlReleaseLock(&InTls->ThreadSafe);
+    return Runtime;
+}
+
+
+
+
+
+static HOOK_STATISTICS* StatsGetStripe(
+            LOCAL_HOOK_INFO* InHandle,
+            LPTHREAD_RUNTIME_INFO InInfo)
+{
+/*
+Description:
+
+    Returns the statistics stripe of the calling thread. The stripe is
+    derived from the thread's storage entry, so no API is called here.
+    Threads without an entry share the first stripe.
+*/
+    ULONG           Index = 0;
+
+    if(InInfo != NULL)
+        Index = (ULONG)((ULONG_PTR)InInfo / sizeof(THREAD_RUNTIME_INFO));
+
+    return LhStatisticsStripe(InHandle->Statistics, Index % LH_STATISTICS_STRIPE_COUNT);
+}
+
+
+
+
+static void StatsCountBypass(
+            LOCAL_HOOK_INFO* InHandle,
+            LPTHREAD_RUNTIME_INFO InInfo,
+            ULONG InReason)
+{
+    if(InHandle->Statistics == NULL)
+        return;
+
+    InterlockedIncrement64((LONGLONG*)&StatsGetStripe(InHandle, InInfo)->BypassCount[InReason]);
+}
+
+
+
+
+static void StatsCountLatency(
+            LOCAL_HOOK_INFO* InHandle,
+            LPTHREAD_RUNTIME_INFO InInfo,
+            ULONGLONG InTicks)
+{
+/*
+Description:
+
+    Adds a handler latency to the logarithmic histogram. Bucket N covers
+    [2^N, 2^(N+1)) ticks.
+*/
+    unsigned long       Bucket;
+
+    if(_BitScanReverse(&Bucket, (ULONG)(InTicks >> 32)))
+        Bucket += 32;
+    else if(!_BitScanReverse(&Bucket, (ULONG)InTicks))
+        Bucket = 0;
+
+    if(Bucket >= HOOK_LATENCY_BUCKET_COUNT)
+        Bucket = HOOK_LATENCY_BUCKET_COUNT - 1;
+
+    InterlockedIncrement64((LONGLONG*)&StatsGetStripe(InHandle, InInfo)->LatencyHistogram[Bucket]);
 }
 
 
@@ -233,8 +571,8 @@ BOOL IsLoaderLock()
 /*
 Returns:
 
-    TRUE if the current thread hols the OS loader lock, or the library was not initialized
-    properly. In both cases a hook handler should not be executed!
+    TRUE if the current thread hols the OS loader lock, or this can't be determined.
+    In both cases a hook handler should not be executed!
 
     FALSE if it is safe to execute the hook handler.
 
@@ -242,7 +580,7 @@ Returns:
 #ifndef DRIVER
 	BOOL     IsLoaderLock = FALSE;
 
-	return (!AuxUlibIsDLLSynchronizationHeld(&IsLoaderLock) || IsLoaderLock || !Unit.IsInitialized);
+	return (!AuxUlibIsDLLSynchronizationHeld(&IsLoaderLock) || IsLoaderLock);
 #else
 	return FALSE;
 #endif
@@ -306,21 +644,229 @@ Description:
 
 
 
+/*
+    Replaced ACL tables might still be scanned by other threads. Tables are only
+    read within AclReaders, see gate.c. Retired tables are kept on the lists of
+    both parities, protected by the GlobalHookLock, and released by a later
+    update once the gate moved on, or on unload.
+
+    Lookups use a binary search until ACL_LINEAR_SCAN_LIMIT entries are left,
+    which are scanned linearly.
+*/
+#define ACL_LINEAR_SCAN_LIMIT           8
+
+static HOOK_ACL_TABLE       AclEmptyInclusive = { NULL, FALSE, 0, { 0 } };
+static HOOK_ACL_TABLE       AclEmptyExclusive = { NULL, TRUE, 0, { 0 } };
+static HOOK_ACL_TABLE*      AclRetiredList[2] = { NULL, NULL };
+static LH_READER_GATE       AclReaders;
+
+static HOOK_ACL_TABLE* AclGetTable(HOOK_ACL* InACL)
+{
+	HOOK_ACL_TABLE*         Table = InACL->Table;
+
+	return (Table != NULL)?Table:&AclEmptyInclusive;
+}
+
+
+
+
+static BOOL AclIsStatic(HOOK_ACL_TABLE* InTable)
+{
+	return (InTable == NULL) || (InTable == &AclEmptyInclusive) || (InTable == &AclEmptyExclusive);
+}
+
+
+
+
+static void AclSort(
+            ULONG* InEntries,
+            ULONG InCount)
+{
+/*
+Description:
+
+    Shell sort, ACLs are usually small and rarely updated.
+*/
+    ULONG           Gap;
+    ULONG           Index;
+    ULONG           Pos;
+    ULONG           Value;
+
+    for(Gap = InCount / 2; Gap > 0; Gap = (Gap == 2)?1:(Gap * 5) / 11)
+    {
+        for(Index = Gap; Index < InCount; Index++)
+        {
+            Value = InEntries[Index];
+
+            for(Pos = Index; (Pos >= Gap) && (InEntries[Pos - Gap] > Value); Pos -= Gap)
+            {
+                InEntries[Pos] = InEntries[Pos - Gap];
+            }
+
+            InEntries[Pos] = Value;
+        }
+    }
+}
+
+
+
+
+LONG LhUpdateACL(
+            HOOK_ACL* InAcl,
+            BOOL InIsExclusive,
+            ULONG* InIdList,
+            ULONG InCount)
+{
+/*
+Description:
+
+    Compiles the given ID list into a new table and publishes it. Is
+    called by LhSetACL() after the parameters have been validated.
+
+Parameters:
+
+    - InAcl
+
+        The global or a hook specific ACL.
+
+    - InIsExclusive
+
+        TRUE if all listed IDs shall be excluded from interception.
+
+    - InIdList
+
+        The IDs, which may be unsorted and contain duplicates.
+
+    - InCount
+
+        The count of IDs, not more than LH_MAX_ACL_COUNT.
+*/
+    HOOK_ACL_TABLE*         Table;
+    HOOK_ACL_TABLE*         Old;
+    HOOK_ACL_TABLE*         Expired = NULL;
+    ULONG                   Index;
+    ULONG                   Count;
+    ULONG                   Parity;
+    ULONG                   ExpiredMask;
+
+    if(InCount == 0)
+    {
+        Table = InIsExclusive?&AclEmptyExclusive:&AclEmptyInclusive;
+    }
+    else
+    {
+        if((Table = (HOOK_ACL_TABLE*)RtlAllocateMemory(FALSE, sizeof(HOOK_ACL_TABLE) + (InCount - 1) * sizeof(ULONG))) == NULL)
+            return STATUS_NO_MEMORY;
+
+        RtlCopyMemory(Table->Entries, InIdList, InCount * sizeof(ULONG));
+
+        AclSort(Table->Entries, InCount);
+
+        // remove duplicates
+        for(Index = 1, Count = 1; Index < InCount; Index++)
+        {
+            if(Table->Entries[Index] != Table->Entries[Count - 1])
+                Table->Entries[Count++] = Table->Entries[Index];
+        }
+
+        Table->Next = NULL;
+        Table->IsExclusive = InIsExclusive;
+        Table->Count = Count;
+    }
+
+    Old = (HOOK_ACL_TABLE*)InterlockedExchangePointer((PVOID*)&InAcl->Table, Table);
+
+    // invalidate cached verdicts, only after the new table is visible
+    InterlockedIncrement(&InAcl->Generation);
+
+    RtlAcquireLock(&GlobalHookLock);
+    {
+        if(!AclIsStatic(Old))
+        {
+            Parity = LH_READER_GATE_PARITY(&AclReaders);
+
+            Old->Next = AclRetiredList[Parity];
+
+            AclRetiredList[Parity] = Old;
+        }
+
+        ExpiredMask = LhAdvanceReaderGate(&AclReaders);
+
+        for(Parity = 0; Parity < 2; Parity++)
+        {
+            if(!(ExpiredMask & (1 << Parity)))
+                continue;
+
+            while(AclRetiredList[Parity] != NULL)
+            {
+                Old = AclRetiredList[Parity];
+                AclRetiredList[Parity] = Old->Next;
+
+                Old->Next = Expired;
+                Expired = Old;
+            }
+        }
+    }
+    RtlReleaseLock(&GlobalHookLock);
+
+    while(Expired != NULL)
+    {
+        Old = Expired;
+        Expired = Expired->Next;
+
+        RtlFreeMemory(Old);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+void LhReleaseACL(HOOK_ACL* InAcl)
+{
+/*
+Description:
+
+    Releases the current table of an ACL that is no longer used,
+    like the one of a hook being released.
+*/
+    if(!AclIsStatic(InAcl->Table))
+        RtlFreeMemory(InAcl->Table);
+
+    InAcl->Table = NULL;
+}
+
+
+
+
 BOOL ACLContains(
-	HOOK_ACL* InACL,
+	HOOK_ACL_TABLE* InTable,
 	ULONG InCheckID)
 {
 /*
 Returns:
 
-    TRUE if the given ACL contains the given ID, FALSE otherwise.
+    TRUE if the given ACL table contains the given ID, FALSE otherwise.
 */
-    ULONG           Index;
+    ULONG           Low = 0;
+    ULONG           High = InTable->Count;
+    ULONG           Mid;
 
-	for(Index = 0; Index < InACL->Count; Index++)
+	while(High - Low > ACL_LINEAR_SCAN_LIMIT)
 	{
-		if(InACL->Entries[Index] == InCheckID)
-			return TRUE;
+		Mid = Low + (High - Low) / 2;
+
+		if(InTable->Entries[Mid] <= InCheckID)
+			Low = Mid;
+		else
+			High = Mid;
+	}
+
+	for(; Low < High; Low++)
+	{
+		if(InTable->Entries[Low] >= InCheckID)
+			return InTable->Entries[Low] == InCheckID;
 	}
 
 	return FALSE;
@@ -329,6 +875,58 @@ Returns:
 
 
 
+static BOOL AclIsIntercepted(
+	HOOK_ACL* LocalACL,
+	ULONG InCheckID)
+{
+/*
+Description:
+
+    Evaluates the global and the given local ACL, may only be called
+    within AclReaders.
+*/
+	HOOK_ACL_TABLE*		Global = AclGetTable(&Unit.GlobalACL);
+	HOOK_ACL_TABLE*		Local = AclGetTable(LocalACL);
+
+	// no ACL lists any ID, so the result doesn't depend on the caller
+	if((Global->Count == 0) && (Local->Count == 0))
+		return Global->IsExclusive && Local->IsExclusive;
+
+	if(ACLContains(Global, InCheckID))
+	{
+		if(ACLContains(Local, InCheckID))
+		{
+			if(Local->IsExclusive)
+				return FALSE;
+		}
+		else
+		{
+			if(!Local->IsExclusive)
+				return FALSE;
+		}
+
+		return !Global->IsExclusive;
+	}
+	else
+	{
+		if(ACLContains(Local, InCheckID))
+		{
+			if(Local->IsExclusive)
+				return FALSE;
+		}
+		else
+		{
+			if(!Local->IsExclusive)
+				return FALSE;
+		}
+
+		return Global->IsExclusive;
+	}
+}
+
+
+
+
 #ifndef DRIVER
 BOOL IsThreadIntercepted(
 	HOOK_ACL* LocalACL, 
@@ -350,6 +948,8 @@ Returns:
     FALSE otherwise.
 */
 	ULONG				CheckID;
+	ULONG				Token;
+	BOOL				Result;
 
 #ifndef DRIVER
 	if(InThreadID == 0)
@@ -363,37 +963,52 @@ Returns:
 		CheckID = InProcessID;
 #endif
 
-	if(ACLContains(&Unit.GlobalACL, CheckID))
-	{
-		if(ACLContains(LocalACL, CheckID))
-		{
-			if(LocalACL->IsExclusive)
-				return FALSE;
-		}
-		else
-		{
-			if(!LocalACL->IsExclusive)
-				return FALSE;
-		}
+	// keeps the tables from being released, see LhUpdateACL()
+	Token = LhEnterReaderGate(&AclReaders);
 
-		return !Unit.GlobalACL.IsExclusive;
-	}
-	else
-	{
-		if(ACLContains(LocalACL, CheckID))
-		{
-			if(LocalACL->IsExclusive)
-				return FALSE;
-		}
-		else
-		{
-			if(!LocalACL->IsExclusive)
-				return FALSE;
-		}
+	Result = AclIsIntercepted(LocalACL, CheckID);
 
-		return Unit.GlobalACL.IsExclusive;
-	}
+	LhLeaveReaderGate(&AclReaders, Token);
+
+	return Result;
+}
+
+
+
+
+
+#ifndef DRIVER
+static BOOL RuntimeIsIntercepted(
+	RUNTIME_INFO* InRuntime,
+	LOCAL_HOOK_INFO* InHandle)
+{
+/*
+Description:
+
+    Returns whether the calling thread is intercepted by the given hook,
+    reusing the verdict cached in the thread's runtime entry as long as
+    neither the global nor the local ACL was updated.
+
+    LhUpdateACL() increments the generation after publishing the new table
+    and the generations are read before the tables, so a verdict can only
+    be cached for an outdated generation, never for an outdated table.
+*/
+	LONG				GlobalGeneration = Unit.GlobalACL.Generation;
+	LONG				LocalGeneration = InHandle->LocalACL.Generation;
+
+	if(InRuntime->HasVerdict &&
+		(InRuntime->GlobalGeneration == GlobalGeneration) &&
+		(InRuntime->LocalGeneration == LocalGeneration))
+		return InRuntime->IsIntercepted;
+
+	InRuntime->IsIntercepted = IsThreadIntercepted(&InHandle->LocalACL, GetCurrentThreadId());
+	InRuntime->GlobalGeneration = GlobalGeneration;
+	InRuntime->LocalGeneration = LocalGeneration;
+	InRuntime->HasVerdict = TRUE;
+
+	return InRuntime->IsIntercepted;
 }
+#endif
 
 
 
@@ -446,6 +1061,74 @@ FINALLY_OUTRO:
 
 
 
+EASYHOOK_NT_EXPORT LhGetHookStatistics(
+            TRACED_HOOK_HANDLE InHandle,
+            HOOK_STATISTICS* OutStatistics)
+{
+/*
+Description:
+
+    Sums up the statistics of a hook installed with EASYHOOK_HOOK_STATISTICS.
+    The counters are read while other threads might update them, so
+    the result is a snapshot and not necessarily consistent.
+
+Parameters:
+
+    - InHandle
+
+        The hook handle.
+
+    - OutStatistics
+
+        Receives the statistics.
+
+Returns:
+
+    STATUS_NOT_SUPPORTED
+
+        The hook does not maintain statistics.
+*/
+    NTSTATUS            NtStatus;
+    PLOCAL_HOOK_INFO    Handle;
+    ULONGLONG*          Sum;
+    ULONGLONG*          Value;
+    ULONG               Stripe;
+    ULONG               Index;
+
+    if(!LhIsValidHandle(InHandle, &Handle))
+        THROW(STATUS_INVALID_PARAMETER_1, L"The given hook handle is invalid or already disposed.");
+
+    if(!IsValidPointer(OutStatistics, sizeof(HOOK_STATISTICS)))
+        THROW(STATUS_INVALID_PARAMETER_2, L"Invalid pointer for result storage.");
+
+    if(Handle->Statistics == NULL)
+        THROW(STATUS_NOT_SUPPORTED, L"The given hook was not installed with EASYHOOK_HOOK_STATISTICS.");
+
+    RtlZeroMemory(OutStatistics, sizeof(HOOK_STATISTICS));
+
+    Sum = (ULONGLONG*)OutStatistics;
+
+    for(Stripe = 0; Stripe < LH_STATISTICS_STRIPE_COUNT; Stripe++)
+    {
+        Value = (ULONGLONG*)LhStatisticsStripe(Handle->Statistics, Stripe);
+
+        for(Index = 0; Index < sizeof(HOOK_STATISTICS) / sizeof(ULONGLONG); Index++)
+        {
+            Sum[Index] += Value[Index];
+        }
+    }
+
+    RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    return NtStatus;
+}
+
+
+
+
+
 EASYHOOK_NT_EXPORT LhBarrierGetCallback(PVOID* OutValue)
 {
 /*
@@ -678,10 +1361,7 @@ Description:
 	RtlZeroMemory(&Unit, sizeof(Unit));
 
 	// globally accept all threads...
-	Unit.GlobalACL.IsExclusive = TRUE;
-
-	// allocate private heap
-    RtlInitializeLock(&Unit.TLS.ThreadSafe);
+	Unit.GlobalACL.Table = &AclEmptyExclusive;
 
 #ifndef DRIVER
 
@@ -706,21 +1386,44 @@ Description:
 
     Will be called on DLL unload.
 */
-	ULONG			Index;
+	ULONG			        Index;
+    THREAD_LOCAL_STORAGE*   Segment;
+    THREAD_LOCAL_STORAGE*   Next;
+    HOOK_ACL_TABLE*         Table;
 
 #ifdef DRIVER
 	PsRemoveCreateThreadNotifyRoutine(OnThreadDetach);
 #endif
 
-	RtlDeleteLock(&Unit.TLS.ThreadSafe);
+	// release ACL tables, no hook is executed anymore
+	LhReleaseACL(&Unit.GlobalACL);
 
-	// release thread specific resources
-	for(Index = 0; Index < MAX_THREAD_COUNT; Index++)
+	for(Index = 0; Index < 2; Index++)
 	{
-		if(Unit.TLS.Entries[Index].Entries != NULL)
-			RtlFreeMemory(Unit.TLS.Entries[Index].Entries);
+		while(AclRetiredList[Index] != NULL)
+		{
+			Table = AclRetiredList[Index];
+			AclRetiredList[Index] = Table->Next;
+
+			RtlFreeMemory(Table);
+		}
 	}
 
+	// release thread specific resources
+    for(Segment = &Unit.TLS; Segment != NULL; Segment = Next)
+    {
+	    for(Index = 0; Index < TLS_HASH_SIZE; Index++)
+	    {
+		    if(Segment->Entries[Index].Entries != NULL)
+			    RtlFreeMemory(Segment->Entries[Index].Entries);
+	    }
+
+        Next = Segment->Next;
+
+        if(Segment != &Unit.TLS)
+            RtlFreeMemory(Segment);
+    }
+
 	RtlZeroMemory(&Unit, sizeof(Unit));
 }
 
@@ -735,35 +1438,62 @@ Description:
     Will be called from assembler code and enters the 
     thread deadlock barrier.
 */
-    LPTHREAD_RUNTIME_INFO		Info;
-    RUNTIME_INFO*		        Runtime;
+    LPTHREAD_RUNTIME_INFO		Info = NULL;
+    RUNTIME_INFO*		        Runtime = NULL;
 	BOOL						Exists;
+	BOOL						CheckLoaderLock;
+	ULONG						Bypass = HOOK_BYPASS_RESOURCES;
 
 	#ifdef _M_X64
 		InHandle -= 1;
 	#endif
 
-	// are we in OS loader lock?
-	if(IsLoaderLock())
+	// the barrier is not available, like during shutdown
+	if(!Unit.IsInitialized)
 	{
-		/*
-			Execution of managed code or even any other code within any loader lock
-			may lead into unpredictable application behavior and therefore we just
-			execute without intercepting the call...
-		*/
-
 		/*  !!Note that the assembler code does not invoke LhBarrierOutro() in this case!! */
 
+		StatsCountBypass(InHandle, NULL, HOOK_BYPASS_RESOURCES);
+
 		return FALSE;
 	}
 
 	// open pointer table
 	Exists = TlsGetCurrentValue(&Unit.TLS, &Info);
 
+	if(Exists)
+		Runtime = RuntimeLookup(Info, InHandle->HLSIndex, FALSE);
+
+	/*
+		Are we in OS loader lock? Registering the thread or creating its runtime info
+		might allocate memory, so this is checked first if one of them is missing.
+		Otherwise it is only checked for calls that would be intercepted, see below.
+		Hooks installed with EASYHOOK_HOOK_NO_LOADER_LOCK_CHECK are never checked.
+	*/
+	CheckLoaderLock = !(InHandle->Flags & EASYHOOK_HOOK_NO_LOADER_LOCK_CHECK);
+
+	if(CheckLoaderLock && (Runtime == NULL))
+	{
+		if(IsLoaderLock())
+		{
+			/*  !!Note that the assembler code does not invoke LhBarrierOutro() in this case!! */
+
+			StatsCountBypass(InHandle, Exists?Info:NULL, HOOK_BYPASS_LOADER_LOCK);
+
+			return FALSE;
+		}
+
+		CheckLoaderLock = FALSE;
+	}
+
 	if(!Exists)
 	{
 		if(!TlsAddCurrentThread(&Unit.TLS))
+		{
+			StatsCountBypass(InHandle, NULL, HOOK_BYPASS_RESOURCES);
+
 			return FALSE;
+		}
 	}
 
 	/*
@@ -778,29 +1508,24 @@ Description:
 	{
 		/*  !!Note that the assembler code does not invoke LhBarrierOutro() in this case!! */
 
+		StatsCountBypass(InHandle, Info, HOOK_BYPASS_SELF_PROTECTION);
+
 		return FALSE;
 	}
 
-	ASSERT(InHandle->HLSIndex < MAX_HOOK_COUNT,L"barrier.c - InHandle->HLSIndex < MAX_HOOK_COUNT");
-
 	if(!Exists)
-	{
 		TlsGetCurrentValue(&Unit.TLS, &Info);
 
-		Info->Entries = (RUNTIME_INFO*)RtlAllocateMemory(TRUE, sizeof(RUNTIME_INFO) * MAX_HOOK_COUNT);
-
-		if(Info->Entries == NULL)
-			goto DONT_INTERCEPT;
-	}
-
 	// get hook runtime info...
-	Runtime = &Info->Entries[InHandle->HLSIndex];
+	if((Runtime == NULL) && ((Runtime = RuntimeLookup(Info, InHandle->HLSIndex, TRUE)) == NULL))
+		goto DONT_INTERCEPT;
 
 	if(Runtime->HLSIdent != InHandle->HLSIdent)
 	{
 		// just reset execution information
 		Runtime->HLSIdent = InHandle->HLSIdent;
 		Runtime->IsExecuting = FALSE;
+		Runtime->HasVerdict = FALSE;
 	}
 
 	// detect loops in hook execution hiearchy.
@@ -815,6 +1540,7 @@ Description:
 
 			!!Note that the assembler code does not invoke LhBarrierOutro() in this case!!
 		*/
+		Bypass = HOOK_BYPASS_RECURSION;
 
 		goto DONT_INTERCEPT;
 	}
@@ -826,18 +1552,44 @@ Description:
 		Now we will negotiate thread/process access based on global and local ACL...
 	*/
 #ifndef DRIVER
-	Runtime->IsExecuting = IsThreadIntercepted(&InHandle->LocalACL, GetCurrentThreadId());
+	Runtime->IsExecuting = RuntimeIsIntercepted(Runtime, InHandle);
 #else
+	// a thread might attach to another process, so the verdict is not cached
 	Runtime->IsExecuting = IsProcessIntercepted(&InHandle->LocalACL, (ULONG)PsGetCurrentProcessId());
 #endif
 
 	if(!Runtime->IsExecuting)
+	{
+		Bypass = HOOK_BYPASS_ACL;
+
+		goto DONT_INTERCEPT;
+	}
+
+	// are we in OS loader lock? Only if not already checked above...
+	if(CheckLoaderLock && IsLoaderLock())
+	{
+		/*
+			Execution of managed code or even any other code within any loader lock
+			may lead into unpredictable application behavior and therefore we just
+			execute without intercepting the call...
+		*/
+		Runtime->IsExecuting = FALSE;
+		Bypass = HOOK_BYPASS_LOADER_LOCK;
+
 		goto DONT_INTERCEPT;
+	}
 
 	// save some context specific information
 	Runtime->RetAddress = InRetAddr;
 	Runtime->AddrOfRetAddr = InAddrOfRetAddr;
 
+	if(InHandle->Statistics != NULL)
+	{
+		InterlockedIncrement64((LONGLONG*)&StatsGetStripe(InHandle, Info)->CallCount);
+
+		Runtime->EnterTime = ReadTimeStampCounter();
+	}
+
 	ReleaseSelfProtection();
 	
 	return TRUE;
@@ -850,6 +1602,8 @@ DONT_INTERCEPT:
 		Info->Current = NULL;
 		Info->Callback = NULL;
 
+		StatsCountBypass(InHandle, Info, Bypass);
+
 		ReleaseSelfProtection();
 	}
 
@@ -882,7 +1636,7 @@ Description:
 
 	ASSERT(TlsGetCurrentValue(&Unit.TLS, &Info) && (Info != NULL),L"barrier.c - TlsGetCurrentValue(&Unit.TLS, &Info) && (Info != NULL)");
 
-	Runtime = &Info->Entries[InHandle->HLSIndex];
+	Runtime = RuntimeLookup(Info, InHandle->HLSIndex, FALSE);
 
 	// leave handler context
 	Info->Current = NULL;
@@ -894,6 +1648,9 @@ Description:
 
 	Runtime->IsExecuting = FALSE;
 
+	if(InHandle->Statistics != NULL)
+		StatsCountLatency(InHandle, Info, ReadTimeStampCounter() - Runtime->EnterTime);
+
 	ASSERT(*InAddrOfRetAddr == NULL,L"barrier.c - *InAddrOfRetAddr == NULL");
 
 	*InAddrOfRetAddr = Runtime->RetAddress;
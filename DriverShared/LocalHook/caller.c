@@ -63,31 +63,217 @@
 
 #undef CaptureStackBackTrace
 
-static MODULE_INFORMATION*					LhModuleArray = NULL;
-static ULONG								LhModuleCount = 0;
+/*
+    An immutable view of all modules. Readers look up modules without
+    any lock; LhUpdateModuleInformation() builds a new snapshot and
+    publishes it by pointer exchange. Replaced snapshots are retired
+    and released once no reader can refer to them, see gate.c.
+*/
+typedef struct _LH_MODULE_SNAPSHOT_
+{
+	struct _LH_MODULE_SNAPSHOT_*	Retired;
+	MODULE_INFORMATION*				Modules;
+	MODULE_INFORMATION**			Sorted; // by base address
+	ULONG							Count;
+	void*							NativeArray;
+	ULONG							Generation; // the first one is 1
+}LH_MODULE_SNAPSHOT;
+
+static LH_MODULE_SNAPSHOT* volatile			LhModuleSnapshot = NULL;
+static LH_MODULE_SNAPSHOT*					LhRetiredSnapshots[2] = { NULL, NULL };
+static LH_READER_GATE						LhModuleReaders;
 
 #ifndef DRIVER
 	static PROC_RtlCaptureStackBackTrace*	RtlCaptureStackBackTrace = NULL;
-	static MODULEINFO*						LhNativeModuleArray = NULL;
-	static CHAR*							LhNativePathArray = NULL;
 	static HMODULE							ProcessModules[1024];
 #else
-	static SYSTEM_MODULE_INFORMATION*		LhNativeModuleArray = NULL;
 	BOOLEAN									LhModuleListChanged = TRUE;
 #endif
 
 
-#ifdef DRIVER
+static void LhFreeModuleSnapshot(LH_MODULE_SNAPSHOT* InSnapshot)
+{
+	if(InSnapshot->NativeArray != NULL)
+		RtlFreeMemory(InSnapshot->NativeArray);
+
+	if(InSnapshot->Sorted != NULL)
+		RtlFreeMemory(InSnapshot->Sorted);
+
+	if(InSnapshot->Modules != NULL)
+		RtlFreeMemory(InSnapshot->Modules);
+
+	RtlFreeMemory(InSnapshot);
+}
+
+static LH_MODULE_SNAPSHOT* LhAcquireModuleSnapshot(ULONG* OutToken)
+{
+/*
+Description:
+
+    Registers a reader; the returned snapshot stays valid until
+    LhReleaseModuleSnapshot() is called with the returned token.
+*/
+	*OutToken = LhEnterReaderGate(&LhModuleReaders);
+
+	return LhModuleSnapshot;
+}
+
+static void LhReleaseModuleSnapshot(ULONG InToken)
+{
+	LhLeaveReaderGate(&LhModuleReaders, InToken);
+}
 
 void LhModuleInfoFinalize()
 {
-	if(LhNativeModuleArray != NULL)
-		RtlFreeMemory(LhNativeModuleArray);
+	LH_MODULE_SNAPSHOT*		Snapshot;
+	ULONG					Parity;
+
+	if(LhModuleSnapshot != NULL)
+		LhFreeModuleSnapshot(LhModuleSnapshot);
+
+	LhModuleSnapshot = NULL;
+
+	for(Parity = 0; Parity < 2; Parity++)
+	{
+		while(LhRetiredSnapshots[Parity] != NULL)
+		{
+			Snapshot = LhRetiredSnapshots[Parity];
+			LhRetiredSnapshots[Parity] = Snapshot->Retired;
+
+			LhFreeModuleSnapshot(Snapshot);
+		}
+	}
+}
+
+static NTSTATUS LhPublishModuleSnapshot(
+			MODULE_INFORMATION* InModules,
+			ULONG InCount,
+			void* InNativeArray,
+			ULONG InGeneration)
+{
+/*
+Description:
+
+    Takes ownership of the given module list, sorts it into a new
+    snapshot and replaces the current one. On failure, the given
+    memory is released.
+
+Parameters:
+
+    - InGeneration
+
+        If not zero, the snapshot is only published if the current one
+        still has this generation. Otherwise STATUS_UNSUCCESSFUL is
+        returned. Unlike the address of a snapshot, a generation is
+        never reused, so the caller doesn't need to keep the snapshot.
+*/
+	LH_MODULE_SNAPSHOT*		Snapshot = NULL;
+	LH_MODULE_SNAPSHOT*		Retired = NULL;
+	MODULE_INFORMATION*		Mod;
+	ULONG					Index;
+	ULONG					Pos;
+	ULONG					Parity;
+	ULONG					ExpiredMask;
+	NTSTATUS				NtStatus;
+
+	if((Snapshot = (LH_MODULE_SNAPSHOT*)RtlAllocateMemory(TRUE, sizeof(LH_MODULE_SNAPSHOT))) == NULL)
+		THROW(STATUS_NO_MEMORY, L"Unable to allocate memory.");
+
+	Snapshot->Modules = InModules;
+	Snapshot->Count = InCount;
+	Snapshot->NativeArray = InNativeArray;
+
+	if((Snapshot->Sorted = (MODULE_INFORMATION**)RtlAllocateMemory(FALSE, sizeof(MODULE_INFORMATION*) * (InCount + 1))) == NULL)
+		THROW(STATUS_NO_MEMORY, L"Unable to allocate memory.");
+
+	// insertion sort, module lists are short and mostly ordered
+	for(Index = 0; Index < InCount; Index++)
+	{
+		Mod = &InModules[Index];
+		Mod->Next = (Index + 1 < InCount)?&InModules[Index + 1]:NULL;
+
+		for(Pos = Index; (Pos > 0) && (Snapshot->Sorted[Pos - 1]->BaseAddress > Mod->BaseAddress); Pos--)
+		{
+			Snapshot->Sorted[Pos] = Snapshot->Sorted[Pos - 1];
+		}
+
+		Snapshot->Sorted[Pos] = Mod;
+	}
+
+	RtlAcquireLock(&GlobalHookLock);
+	{
+		if((InGeneration != 0) && ((LhModuleSnapshot == NULL) || (LhModuleSnapshot->Generation != InGeneration)))
+		{
+			// someone else was faster, the caller has to look again
+			RtlReleaseLock(&GlobalHookLock);
+
+			LhFreeModuleSnapshot(Snapshot);
+
+			return STATUS_UNSUCCESSFUL;
+		}
+
+		Snapshot->Generation = (LhModuleSnapshot != NULL)?LhModuleSnapshot->Generation + 1:1;
+		Snapshot->Retired = (LH_MODULE_SNAPSHOT*)InterlockedExchangePointer((PVOID*)&LhModuleSnapshot, Snapshot);
+
+		// chain previously retired snapshots
+		if(Snapshot->Retired != NULL)
+		{
+			Parity = LH_READER_GATE_PARITY(&LhModuleReaders);
+
+			Snapshot->Retired->Retired = LhRetiredSnapshots[Parity];
+			LhRetiredSnapshots[Parity] = Snapshot->Retired;
+		}
+
+		Snapshot->Retired = NULL;
+
+		ExpiredMask = LhAdvanceReaderGate(&LhModuleReaders);
+
+		for(Parity = 0; Parity < 2; Parity++)
+		{
+			if(!(ExpiredMask & (1 << Parity)))
+				continue;
+
+			while(LhRetiredSnapshots[Parity] != NULL)
+			{
+				Snapshot = LhRetiredSnapshots[Parity];
+				LhRetiredSnapshots[Parity] = Snapshot->Retired;
+
+				Snapshot->Retired = Retired;
+				Retired = Snapshot;
+			}
+		}
+	}
+	RtlReleaseLock(&GlobalHookLock);
+
+	while(Retired != NULL)
+	{
+		Snapshot = Retired;
+		Retired = Retired->Retired;
+
+		LhFreeModuleSnapshot(Snapshot);
+	}
+
+	RETURN;
 
-	if(LhModuleArray != NULL)
-		RtlFreeMemory(LhModuleArray);
+THROW_OUTRO:
+	{
+		if(Snapshot != NULL)
+			LhFreeModuleSnapshot(Snapshot);
+		else
+		{
+			RtlFreeMemory(InModules);
+
+			if(InNativeArray != NULL)
+				RtlFreeMemory(InNativeArray);
+		}
+	}
+FINALLY_OUTRO:
+    return NtStatus;
 }
 
+
+#ifdef DRIVER
+
 EASYHOOK_NT_INTERNAL LhUpdateModuleInformation()
 {
 	NTSTATUS						NtStatus;
@@ -130,28 +316,10 @@ EASYHOOK_NT_INTERNAL LhUpdateModuleInformation()
 		List[i].ModuleName = Mod->Name + Mod->NameOffset;
 		
 		memcpy(List[i].Path, Mod->Name, 256);
-
-		if(i + 1 < NativeList->Count)
-			List[i].Next = &List[i + 1];
-		else
-			List[i].Next = NULL;
 	}
 
-	RtlAcquireLock(&GlobalHookLock);
-	{
-		if(LhNativeModuleArray != NULL)
-			RtlFreeMemory(LhNativeModuleArray);
-
-		if(LhModuleArray != NULL)
-			RtlFreeMemory(LhModuleArray);
-
-		LhNativeModuleArray = NativeList;
-		LhModuleArray = List;
-		LhModuleCount = NativeList->Count;
-	}
-	RtlReleaseLock(&GlobalHookLock);
-
-    RETURN;
+	// the snapshot keeps the native list, module names point into it
+	return LhPublishModuleSnapshot(List, NativeList->Count, NativeList, 0);
 
 THROW_OUTRO:
 	{
@@ -161,22 +329,60 @@ THROW_OUTRO:
 		if(List != NULL)
 			RtlFreeMemory(List);
 	}
-FINALLY_OUTRO:
     return NtStatus;
 }
 
 #else
 
-void LhModuleInfoFinalize()
+static BOOL LhQueryModule(
+			HMODULE InModule,
+			MODULE_INFORMATION* OutModule)
 {
-	if(LhNativeModuleArray != NULL)
-		RtlFreeMemory(LhNativeModuleArray);
+/*
+Description:
+
+    Fills in the information for a single module. "Next" is
+    left untouched.
+*/
+    MODULEINFO				NativeInfo;
+	CHAR					PathBuffer[MAX_PATH];
+	CHAR*					ModPath = NULL;
+	LONG					iChar = 0;
+
+	// collect information
+	if(!GetModuleInformation(
+			GetCurrentProcess(),
+			InModule,
+			&NativeInfo,
+			sizeof(NativeInfo)))
+		return FALSE;
+
+	if(GetModuleFileNameA(InModule, PathBuffer, MAX_PATH) == 0)
+		return FALSE;
+
+	// truncate to the size of MODULE_INFORMATION::Path
+	PathBuffer[sizeof(OutModule->Path) - 1] = 0;
+
+	memcpy(OutModule->Path, PathBuffer, sizeof(OutModule->Path));
+
+	// normalize module information
+	OutModule->BaseAddress = (UCHAR*)NativeInfo.lpBaseOfDll;
+	OutModule->ImageSize = NativeInfo.SizeOfImage;
+	OutModule->ModuleName = NULL;
+
+	ModPath = OutModule->Path;
 
-	if(LhModuleArray != NULL)
-		RtlFreeMemory(LhModuleArray);
+	for(iChar = RtlAnsiLength(ModPath); iChar >= 0; iChar--)
+	{
+		if(ModPath[iChar] == '\\')
+		{
+			OutModule->ModuleName = &ModPath[iChar + 1];
+
+			break;
+		}
+	}
 
-	if(LhNativePathArray != NULL)
-		RtlFreeMemory(LhNativePathArray);
+	return TRUE;
 }
 
 EASYHOOK_NT_INTERNAL LhUpdateModuleInformation()
@@ -193,14 +399,8 @@ Description:
     LONG					NtStatus = STATUS_UNHANDLED_EXCEPTION;
     ULONG					Index;
     ULONG					ModIndex;
-    MODULEINFO*				NativeList = NULL;
     ULONG					ModuleCount;
-	MODULEINFO*				Mod = NULL;
 	MODULE_INFORMATION*		List = NULL;
-	CHAR*					PathList = NULL;
-	CHAR*					ModPath = NULL;
-	ULONG					ModPathSize = 0;
-	LONG					iChar = 0;
 
     // enumerate modules...
 	RtlAcquireLock(&GlobalHookLock);
@@ -220,96 +420,161 @@ Description:
 
     ModuleCount /= sizeof(HMODULE);
 
-    // retrieve module information
-    if((NativeList = (MODULEINFO*)RtlAllocateMemory(FALSE, ModuleCount * sizeof(NativeList[0]))) == NULL)
-        THROW(STATUS_NO_MEMORY, L"Unable to allocate memory for module information.");
+    if(ModuleCount > ARRAYSIZE(ProcessModules))
+        ModuleCount = ARRAYSIZE(ProcessModules);
 
+    // retrieve module information
 	if((List = (MODULE_INFORMATION*)RtlAllocateMemory(TRUE, sizeof(MODULE_INFORMATION) * ModuleCount)) == NULL)
 		THROW(STATUS_NO_MEMORY, L"Unable to allocate memory.");
 
-	if((PathList = (CHAR*)RtlAllocateMemory(TRUE, MAX_PATH * ModuleCount)) == NULL)
-		THROW(STATUS_NO_MEMORY, L"Unable to allocate memory.");
-
     for(Index = 0, ModIndex = 0; Index < ModuleCount; Index++)
     {
-		// collect information
-        if(!GetModuleInformation(
-                GetCurrentProcess(),
-                ProcessModules[Index],
-                &NativeList[ModIndex],
-                sizeof(NativeList[ModIndex])))
-            continue;
-
-		GetModuleFileNameA(
-				ProcessModules[Index],
-				&PathList[ModIndex * MAX_PATH],
-				MAX_PATH);
-
-		if(GetLastError() != ERROR_SUCCESS)
-			continue;
+		if(LhQueryModule(ProcessModules[Index], &List[ModIndex]))
+			ModIndex++;
+    }
 
-        Mod = &NativeList[ModIndex];
+    // save changes...
+	return LhPublishModuleSnapshot(List, ModIndex, NULL, 0);
 
-		// normalize module information
-		List[ModIndex].BaseAddress = (UCHAR*)Mod->lpBaseOfDll;
-		List[ModIndex].ImageSize = Mod->SizeOfImage;
+THROW_OUTRO:
+    return NtStatus;
+}
 
-		memcpy(List[ModIndex].Path, &PathList[ModIndex * MAX_PATH], MAX_PATH + 1);
+static BOOL LhIsModuleLoaded(MODULE_INFORMATION* InModule)
+{
+/*
+Returns:
 
-		ModPath = List[ModIndex].Path;
-		ModPathSize = RtlAnsiLength(ModPath);
+    FALSE if the base address of the given module is no longer the
+    allocation base of image memory, so the module was unloaded.
+*/
+	MEMORY_BASIC_INFORMATION	MemInfo;
 
-		for(iChar = ModPathSize; iChar >= 0; iChar--)
-		{
-			if(ModPath[iChar] == '\\')
-			{
-				List[ModIndex].ModuleName = &ModPath[iChar + 1];
+	if(VirtualQuery(InModule->BaseAddress, &MemInfo, sizeof(MemInfo)) != sizeof(MemInfo))
+		return FALSE;
 
-				break;
-			}
-		}
+	return (MemInfo.State == MEM_COMMIT) && (MemInfo.Type == MEM_IMAGE) &&
+			(MemInfo.AllocationBase == (PVOID)InModule->BaseAddress);
+}
 
-		if(ModIndex + 1 < ModuleCount)
-			List[ModIndex].Next = &List[ModIndex + 1];
-		else
-			List[ModIndex].Next = NULL;
+static NTSTATUS LhAddModule(HMODULE InModule)
+{
+/*
+Description:
 
-        ModIndex++;
-    }
+    Publishes a copy of the current snapshot extended by the given
+    module. Modules overlapping the new one or no longer backed by
+    image memory were obviously unloaded and are dropped.
 
-    // save changes...
-	RtlAcquireLock(&GlobalHookLock);
-	{
-		if(LhNativeModuleArray != NULL)
-			RtlFreeMemory(LhNativeModuleArray);
+Returns:
 
-		if(LhModuleArray != NULL)
-			RtlFreeMemory(LhModuleArray);
+    STATUS_NOT_FOUND if the module information can't be queried.
+*/
+	LH_MODULE_SNAPSHOT*		Snapshot;
+	MODULE_INFORMATION*		List = NULL;
+	MODULE_INFORMATION*		Mod;
+	MODULE_INFORMATION		NewModule;
+	ULONG					Index;
+	ULONG					Count = 0;
+	ULONG					Token;
+	ULONG					Generation;
+	NTSTATUS				NtStatus;
 
-		if(LhNativePathArray != NULL)
-			RtlFreeMemory(LhNativePathArray);
+	if(!LhQueryModule(InModule, &NewModule))
+		return STATUS_NOT_FOUND;
 
-		LhNativePathArray = PathList;
-		LhNativeModuleArray = NativeList;
-		LhModuleArray = List;
-		LhModuleCount = ModIndex;
+	Snapshot = LhAcquireModuleSnapshot(&Token);
+
+	if(Snapshot == NULL)
+	{
+		LhReleaseModuleSnapshot(Token);
+
+		return LhUpdateModuleInformation();
 	}
-	RtlReleaseLock(&GlobalHookLock);
 
-    RETURN;
+	if((List = (MODULE_INFORMATION*)RtlAllocateMemory(TRUE, sizeof(MODULE_INFORMATION) * (Snapshot->Count + 1))) == NULL)
+	{
+		LhReleaseModuleSnapshot(Token);
 
-THROW_OUTRO:
+		THROW(STATUS_NO_MEMORY, L"Unable to allocate memory.");
+	}
+
+	for(Index = 0; Index < Snapshot->Count; Index++)
 	{
-		if(NativeList != NULL)
-			RtlFreeMemory(NativeList);
+		Mod = &Snapshot->Modules[Index];
 
-		if(List != NULL)
-			RtlFreeMemory(List);
+		if((Mod->BaseAddress < NewModule.BaseAddress + NewModule.ImageSize) &&
+				(Mod->BaseAddress + Mod->ImageSize > NewModule.BaseAddress))
+			continue;
+
+		if(!LhIsModuleLoaded(Mod))
+			continue;
+
+		List[Count] = *Mod;
+
+		// module names point into the copied path
+		if(Mod->ModuleName != NULL)
+			List[Count].ModuleName = List[Count].Path + (Mod->ModuleName - Mod->Path);
+
+		Count++;
 	}
+
+	List[Count] = NewModule;
+
+	if(NewModule.ModuleName != NULL)
+		List[Count].ModuleName = List[Count].Path + (NewModule.ModuleName - NewModule.Path);
+
+	Count++;
+
+	Generation = Snapshot->Generation;
+
+	// the writer must not wait for itself, see LhAdvanceReaderGate()
+	LhReleaseModuleSnapshot(Token);
+
+	NtStatus = LhPublishModuleSnapshot(List, Count, NULL, Generation);
+
+	// if another thread published first, the lookup is just repeated
+	if(NtStatus == STATUS_UNSUCCESSFUL)
+		RETURN;
+
+	return NtStatus;
+
+THROW_OUTRO:
 FINALLY_OUTRO:
     return NtStatus;
 }
 
+static NTSTATUS LhResolveModuleMiss(UCHAR* InPointer)
+{
+/*
+Description:
+
+    Called if a pointer was not found in the current snapshot.
+    Instead of enumerating all modules again, only the memory
+    region of the pointer is inspected and images are added to
+    the snapshot. Memory that is no image, like JIT code, might be
+    reused for a module at any time, so misses are never cached.
+
+Returns:
+
+    STATUS_SUCCESS if the lookup should be repeated, 
+    STATUS_NOT_FOUND if the pointer does not belong to a module.
+*/
+	MEMORY_BASIC_INFORMATION	MemInfo;
+
+	if(VirtualQuery(InPointer, &MemInfo, sizeof(MemInfo)) != sizeof(MemInfo))
+		return STATUS_NOT_FOUND;
+
+	if((MemInfo.State != MEM_COMMIT) || (MemInfo.Type != MEM_IMAGE))
+		return STATUS_NOT_FOUND;
+
+	// the allocation base of an image is its module handle
+	if(LhAddModule((HMODULE)MemInfo.AllocationBase) != STATUS_NOT_FOUND)
+		return STATUS_SUCCESS;
+
+	return STATUS_NOT_FOUND;
+}
+
 #endif
 
 
@@ -343,44 +608,46 @@ Parameters:
 */
 	ULONG					ModIndex = 0;
 	NTSTATUS				NtStatus;
-	MODULE_INFORMATION*		List;
+	LH_MODULE_SNAPSHOT*		Snapshot;
+	ULONG					Count;
+	ULONG					Token;
+
+	Snapshot = LhAcquireModuleSnapshot(&Token);
+	Count = (Snapshot != NULL)?Snapshot->Count:0;
 
 	if(IsValidPointer(OutModuleArray, InMaxModuleCount * sizeof(PVOID)))
 	{
-		// loop through the module list...
-		RtlAcquireLock(&GlobalHookLock);
-		{
-			if(IsValidPointer(OutModuleCount, sizeof(ULONG)))
-				*OutModuleCount = LhModuleCount;
+		if(IsValidPointer(OutModuleCount, sizeof(ULONG)))
+			*OutModuleCount = Count;
 
-			List = LhModuleArray;
-
-			// walk through process modules
-			while(List != NULL)
+		// walk through process modules
+		for(ModIndex = 0; ModIndex < Count; ModIndex++)
+		{
+			if(ModIndex >= InMaxModuleCount)
 			{
-				if(ModIndex > InMaxModuleCount)
-				{
-					RtlReleaseLock(&GlobalHookLock);
-
-					THROW(STATUS_BUFFER_TOO_SMALL, L"The given buffer was filled but could not hold all modules.");
-				}
+				LhReleaseModuleSnapshot(Token);
 
-				OutModuleArray[ModIndex++] = (HMODULE)List->BaseAddress;
+				THROW(STATUS_BUFFER_TOO_SMALL, L"The given buffer was filled but could not hold all modules.");
+			}
 
-				List = List->Next;
-			}	
-		}	
-		RtlReleaseLock(&GlobalHookLock);
+			OutModuleArray[ModIndex] = (HMODULE)Snapshot->Modules[ModIndex].BaseAddress;
+		}
 	}
 	else
 	{
 		// return module count...
 		if(!IsValidPointer(OutModuleCount, sizeof(ULONG)))
+		{
+			LhReleaseModuleSnapshot(Token);
+
 			THROW(STATUS_INVALID_PARAMETER_3, L"If no buffer is specified you need to pass a module count storage.");
+		}
 
-		*OutModuleCount = LhModuleCount;
+		*OutModuleCount = Count;
 	}
 
+	LhReleaseModuleSnapshot(Token);
+
 	RETURN;
 
 THROW_OUTRO:
@@ -419,49 +686,70 @@ Returns:
     UCHAR*					Pointer = (UCHAR*)InPointer;
     NTSTATUS				NtStatus;
     BOOL					CanTryAgain = TRUE;
-	MODULE_INFORMATION*		List;
+	LH_MODULE_SNAPSHOT*		Snapshot;
+	MODULE_INFORMATION*		Mod;
+	ULONG					Low;
+	ULONG					High;
+	ULONG					Middle;
+	ULONG					Token;
 
 	if(!IsValidPointer(OutModule, sizeof(MODULE_INFORMATION)))
 		THROW(STATUS_INVALID_PARAMETER_2, L"The given module storage is invalid.");
 
 LABEL_TRY_AGAIN:
 
-	RtlAcquireLock(&GlobalHookLock);
+	Snapshot = LhAcquireModuleSnapshot(&Token);
 	{
-		List = LhModuleArray;
-
-		// walk through process modules
-		while(List != NULL)
+		if(Snapshot != NULL)
 		{
-			if((Pointer >= List->BaseAddress) && (Pointer <= List->BaseAddress + List->ImageSize))
-			{
-				*OutModule = *List;
+			// find the last module starting at or below the pointer
+			Low = 0;
+			High = Snapshot->Count;
 
-				RtlReleaseLock(&GlobalHookLock);
+			while(Low < High)
+			{
+				Middle = (Low + High) / 2;
 
-				RETURN;
+				if(Snapshot->Sorted[Middle]->BaseAddress <= Pointer)
+					Low = Middle + 1;
+				else
+					High = Middle;
 			}
 
-			List = List->Next;
+			if(Low > 0)
+			{
+				Mod = Snapshot->Sorted[Low - 1];
+
+				if(Pointer <= Mod->BaseAddress + Mod->ImageSize)
+				{
+					*OutModule = *Mod;
+
+					LhReleaseModuleSnapshot(Token);
+
+					RETURN;
+				}
+			}
 		}
 	}
-	RtlReleaseLock(&GlobalHookLock);
+	LhReleaseModuleSnapshot(Token);
 
     if((InPointer == NULL) || (InPointer == (PVOID)~0))
     {
         // this pointer does not belong to any module...
     }
-    else
+    else if(CanTryAgain)
     {
+        CanTryAgain = FALSE;
+
         // unable to find calling module...
+#ifndef DRIVER
+        if(LhResolveModuleMiss(Pointer) == STATUS_SUCCESS)
+            goto LABEL_TRY_AGAIN;
+#else
         FORCE(LhUpdateModuleInformation());
 
-        if(CanTryAgain)
-        {
-            CanTryAgain = FALSE;
-
-            goto LABEL_TRY_AGAIN;
-        }
+        goto LABEL_TRY_AGAIN;
+#endif
     }
 
     THROW(STATUS_NOT_FOUND, L"Unable to determine module.");
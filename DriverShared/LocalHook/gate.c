@@ -0,0 +1,160 @@
+// EasyHook (File: EasyHookDll\gate.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+#include "stdafx.h"
+
+/*
+    A reader gate protects objects published by pointer, like ACL tables and
+    module snapshots, without a counter shared by all readers.
+
+    Readers register in one of LH_READER_STRIPE_COUNT counters, each on its
+    own cache line, of the parity of the current epoch. A reader rechecks the
+    epoch after registering and only then reads the published pointer, so it
+    either is counted by a writer or sees everything published before the
+    epoch changed.
+
+    Writers are serialized by the caller. A replaced object is retired to the
+    list of the current parity. LhAdvanceReaderGate() then moves on to the next
+    epoch as soon as no reader of the other parity is left. Once the epoch
+    moved on twice, no reader can still refer to an object retired before, so
+    retired objects are released after at most two updates without readers
+    instead of waiting for a moment without any reader at all.
+*/
+
+static ULONG LhGetReaderStripe()
+{
+/*
+Description:
+
+    Spreads threads over the stripes. Windows thread IDs are
+    multiples of four, so the low bits are mixed with higher ones.
+*/
+#ifndef DRIVER
+    ULONG           Id = (ULONG)GetCurrentThreadId();
+#else
+    ULONG           Id = (ULONG)(ULONG_PTR)PsGetCurrentThreadId();
+#endif
+
+    return ((Id >> 2) ^ Id) % LH_READER_STRIPE_COUNT;
+}
+
+
+
+
+static LONG LhCountReaders(
+            LH_READER_GATE* InGate,
+            ULONG InParity)
+{
+    LONG            Count = 0;
+    ULONG           Index;
+
+    for(Index = 0; Index < LH_READER_STRIPE_COUNT; Index++)
+    {
+        Count += InGate->Readers[InParity][Index].Count;
+    }
+
+    return Count;
+}
+
+
+
+
+ULONG LhEnterReaderGate(LH_READER_GATE* InGate)
+{
+/*
+Description:
+
+    Registers the calling thread as reader. Published pointers may
+    be read until LhLeaveReaderGate() is called.
+
+Returns:
+
+    The token to pass to LhLeaveReaderGate().
+*/
+    ULONG           Stripe = LhGetReaderStripe();
+    LONG            Epoch;
+    ULONG           Token;
+
+    while(TRUE)
+    {
+        Epoch = InGate->Epoch;
+        Token = (Epoch & 1) * LH_READER_STRIPE_COUNT + Stripe;
+
+        // the interlocked increment is a full barrier
+        InterlockedIncrement(&InGate->Readers[Epoch & 1][Stripe].Count);
+
+        if(InGate->Epoch == Epoch)
+            return Token;
+
+        // a writer might have missed this reader
+        InterlockedDecrement(&InGate->Readers[Epoch & 1][Stripe].Count);
+    }
+}
+
+
+
+
+void LhLeaveReaderGate(
+            LH_READER_GATE* InGate,
+            ULONG InToken)
+{
+    InterlockedDecrement(&InGate->Readers[InToken / LH_READER_STRIPE_COUNT][InToken % LH_READER_STRIPE_COUNT].Count);
+}
+
+
+
+
+ULONG LhAdvanceReaderGate(LH_READER_GATE* InGate)
+{
+/*
+Description:
+
+    Is called by the writer after a replaced object was retired to
+    the list of the parity LH_READER_GATE_PARITY(). Moves on to the
+    next epoch at most twice, as long as no reader of the previous
+    epoch is left.
+
+Returns:
+
+    A mask of the parities whose retired objects can be released. The
+    caller has to empty their lists before it retires further objects.
+*/
+    ULONG           Expired = 0;
+    ULONG           Round;
+    ULONG           Parity;
+
+    for(Round = 0; Round < 2; Round++)
+    {
+        Parity = (InGate->Epoch & 1) ^ 1;
+
+        if(LhCountReaders(InGate, Parity) != 0)
+            break;
+
+        Expired |= 1 << Parity;
+
+        InterlockedIncrement(&InGate->Epoch);
+    }
+
+    return Expired;
+}
@@ -31,13 +31,31 @@
 
 UCHAR* GetTrampolinePtr();
 ULONG GetTrampolineSize();
+UCHAR* GetFastTrampolinePtr();
+ULONG GetFastTrampolineSize();
 
 LOCAL_HOOK_INFO             GlobalHookListHead;
 LOCAL_HOOK_INFO             GlobalRemovalListHead;
+LOCAL_HOOK_INFO             GlobalRetiredListHead;
 RTL_SPIN_LOCK               GlobalHookLock;
-ULONG                       GlobalSlotList[MAX_HOOK_COUNT];
 static LONG                 UniqueIDCounter = 0x10000000;
 
+/*
+    The HLS slot list grows on demand up to GlobalMaxHookCount entries. Free slots
+    are tracked in a bitmap, where a set bit marks a used slot, and GlobalSlotHint is the
+    first bitmap word that might contain a free slot. All of them are protected by
+    the GlobalHookLock.
+*/
+#define SLOT_BITMAP_BITS            32
+#define SLOT_LIST_MIN_SIZE          256
+
+static ULONG*               GlobalSlotList = NULL;
+static ULONG*               GlobalSlotBitmap = NULL;
+static ULONG                GlobalSlotCapacity = 0;
+static ULONG                GlobalSlotHint = 0;
+static ULONG                GlobalMaxHookCount = MAX_HOOK_COUNT;
+volatile LONG               GlobalPinnedHookCount = 0;
+
 void LhCriticalInitialize()
 {
 /*
@@ -47,8 +65,33 @@ Description:
 */
     RtlZeroMemory(&GlobalHookListHead, sizeof(GlobalHookListHead));
     RtlZeroMemory(&GlobalRemovalListHead, sizeof(GlobalRemovalListHead));
+    RtlZeroMemory(&GlobalRetiredListHead, sizeof(GlobalRetiredListHead));
 
     RtlInitializeLock(&GlobalHookLock);
+
+    LhAllocatorInitialize();
+}
+
+
+
+
+void LhSlotListFinalize()
+{
+/*
+Description:
+    
+    Releases the HLS slot list. Is called by LhCriticalFinalize().
+*/
+    if(GlobalSlotList != NULL)
+        RtlFreeMemory(GlobalSlotList);
+
+    if(GlobalSlotBitmap != NULL)
+        RtlFreeMemory(GlobalSlotBitmap);
+
+    GlobalSlotList = NULL;
+    GlobalSlotBitmap = NULL;
+    GlobalSlotCapacity = 0;
+    GlobalSlotHint = 0;
 }
 
 
@@ -89,11 +132,6 @@ Description:
 }
 
 
-// The maximum number of bytes that can be used for a trampoline jump
-// Under most circumstance the max is 8 bytes, for X64_DRIVER this
-// increases to 16 bytes to support jumping to absolute addresses
-#define MAX_JMP_SIZE 16
-
 #if X64_DRIVER
 // The size of the instructions for a jump in/out of the trampoline within a 64-bit driver
 #define X64_DRIVER_JMPSIZE 16
@@ -105,6 +143,7 @@ EASYHOOK_NT_INTERNAL LhAllocateHook(
             void* InEntryPoint,
             void* InHookProc,
             void* InCallback,
+            ULONG InFlags,
             LOCAL_HOOK_INFO** OutHook,
             ULONG* RelocSize)
 {
@@ -137,6 +176,11 @@ Parameters:
         An uninterpreted callback later available through
         LhBarrierGetCallback().
 
+    - InFlags
+
+        EASYHOOK_HOOK_FAST_TRAMPOLINE selects the barrier-free trampoline and
+        EASYHOOK_HOOK_STATISTICS allocates the hook statistics, see LhInstallHookEx().
+
     - OutHook
 
         OutHook will point to a newly allocated Hook, with completed trampoline
@@ -159,16 +203,23 @@ Returns:
     
     STATUS_INSUFFICIENT_RESOURCES
     
-        The limit of MAX_HOOK_COUNT simultaneous hooks was reached.
+        The limit of simultaneous hooks was reached, which is MAX_HOOK_COUNT
+        unless changed with LhSetMaxHookCount(), or the hook would be pinned
+        and MAX_PINNED_HOOK_COUNT pinned hooks exist.
     
 */
 
     ULONG           			EntrySize;
+    LH_DECODED_PROLOGUE         Prologue;
     LOCAL_HOOK_INFO*            Hook = NULL;
     LONGLONG          			RelAddr;
     UCHAR*                      MemoryPtr;
     LONG                        NtStatus = STATUS_INTERNAL_ERROR;
-	ULONG                       PageSize = 0;
+	ULONG                       BlockSize = 0;
+    UCHAR*                      TrampolinePtr;
+    ULONG                       TrampolineSize;
+    ULONG                       InstrIndex;
+    BOOL                        IsPinned;
 
 #if X64_DRIVER
 	// This is the ASM that will perform a JMP back out of the trampoline
@@ -197,22 +248,69 @@ Returns:
     if(!IsValidPointer(InHookProc, 1))
         THROW(STATUS_INVALID_PARAMETER_2, L"Invalid hook procedure.");
 
+    if((InFlags & ~(EASYHOOK_HOOK_FAST_TRAMPOLINE | EASYHOOK_HOOK_STATISTICS | EASYHOOK_HOOK_NO_LOADER_LOCK_CHECK)) != 0)
+        THROW(STATUS_INVALID_PARAMETER_4, L"Unknown hook flags.");
+
+    // statistics are maintained by the thread barrier
+    if((InFlags & EASYHOOK_HOOK_FAST_TRAMPOLINE) && (InFlags & EASYHOOK_HOOK_STATISTICS))
+        THROW(STATUS_INVALID_PARAMETER_4, L"Statistics are not available for fast trampolines.");
+
+    if(InFlags & EASYHOOK_HOOK_FAST_TRAMPOLINE)
+    {
+        TrampolinePtr = GetFastTrampolinePtr();
+        TrampolineSize = GetFastTrampolineSize();
+    }
+    else
+    {
+        TrampolinePtr = GetTrampolinePtr();
+        TrampolineSize = GetTrampolineSize();
+    }
+
     // allocate memory for hook, for 64-bit non-driver this will be located within a 32-bit relative jump of entry point
-    if ((*OutHook = (LOCAL_HOOK_INFO*)LhAllocateMemoryEx(InEntryPoint, &PageSize)) == NULL)
+    if ((*OutHook = LhAllocateMemory(InEntryPoint, &BlockSize)) == NULL)
         THROW(STATUS_NO_MEMORY, L"Failed to allocate memory.");
     Hook = *OutHook;
 
-    FORCE(RtlProtectMemory(Hook, PageSize, PAGE_EXECUTE_READWRITE));
-
     // Set MemoryPtr to end of LOCAL_HOOK_INFO structure where we will copy the trampoline and old proc
 	MemoryPtr = (UCHAR*)(Hook + 1);
 
-    // determine entry point size
+    // determine entry point size, the decoded instructions are reused for relocation
 #ifdef X64_DRIVER
-	FORCE(EntrySize = LhRoundToNextInstruction(InEntryPoint, X64_DRIVER_JMPSIZE));
+	FORCE(LhDecodePrologue(InEntryPoint, X64_DRIVER_JMPSIZE, &Prologue));
 #else
-    FORCE(EntrySize = LhRoundToNextInstruction(InEntryPoint, 5));
+    FORCE(LhDecodePrologue(InEntryPoint, 5, &Prologue));
 #endif
+    EntrySize = Prologue.Size;
+
+    /*
+        A call within the relocated entry point leaves a return address into
+        the hook memory on the stack of the calling thread, which can't be
+        detected by LhReclaimRetiredHooks(). The fast trampoline releases the
+        execution counter before entering the handler, so a handler might
+        still call the original method through the hook memory at any time.
+        Such hooks are kept until unload. Every install and uninstall cycle
+        keeps one block, so their count is limited.
+    */
+    IsPinned = (InFlags & EASYHOOK_HOOK_FAST_TRAMPOLINE) != 0;
+
+    for(InstrIndex = 0; InstrIndex < Prologue.Count; InstrIndex++)
+    {
+        if(Prologue.Instructions[InstrIndex].IsCall)
+            IsPinned = TRUE;
+    }
+
+    if(IsPinned)
+    {
+        if(InterlockedIncrement(&GlobalPinnedHookCount) > MAX_PINNED_HOOK_COUNT)
+        {
+            InterlockedDecrement(&GlobalPinnedHookCount);
+
+            THROW(STATUS_INSUFFICIENT_RESOURCES, L"Too many hooks are kept until unload, see MAX_PINNED_HOOK_COUNT.");
+        }
+
+        // released by LhFreeMemory()
+        Hook->IsPinned = TRUE;
+    }
 
     // create and initialize hook handle
     Hook->NativeSize = sizeof(LOCAL_HOOK_INFO);
@@ -227,25 +325,31 @@ Returns:
     Hook->HookProc = (UCHAR*)InHookProc;
     Hook->TargetProc = (UCHAR*)InEntryPoint;
     Hook->EntrySize = EntrySize;	
-    Hook->IsExecutedPtr = (int*)((UCHAR*)Hook + 2048);
     Hook->Callback = InCallback;
+    Hook->Flags = InFlags;
     *Hook->IsExecutedPtr = 0;
 
+    if(InFlags & EASYHOOK_HOOK_STATISTICS)
+    {
+        if((Hook->Statistics = RtlAllocateMemory(TRUE, LH_STATISTICS_SIZE)) == NULL)
+            THROW(STATUS_NO_MEMORY, L"Failed to allocate memory.");
+    }
+
     /*
 	    The following will be called by the trampoline before the user defined handler is invoked.
 	    It will setup a proper environment for the hook handler which includes the "fiber deadlock barrier"
-	    and user specific callback.
+	    and user specific callback. The fast trampoline never calls them.
     */
     Hook->HookIntro = (PVOID)LhBarrierIntro;
     Hook->HookOutro = (PVOID)LhBarrierOutro;
 
     // copy trampoline
     Hook->Trampoline = MemoryPtr; 
-    MemoryPtr += GetTrampolineSize();
+    MemoryPtr += TrampolineSize;
 
-    Hook->NativeSize += GetTrampolineSize();
+    Hook->NativeSize += TrampolineSize;
 
-    RtlCopyMemory(Hook->Trampoline, GetTrampolinePtr(), GetTrampolineSize());
+    RtlCopyMemory(Hook->Trampoline, TrampolinePtr, TrampolineSize);
 
     /*
 	    Relocate entry point (the same for both archs)
@@ -260,7 +364,9 @@ Returns:
     *RelocSize = 0;
     Hook->OldProc = MemoryPtr; 
 
-    FORCE(LhRelocateEntryPoint(Hook->TargetProc, EntrySize, Hook->OldProc, RelocSize));
+    FORCE(LhRelocatePrologue(&Prologue, Hook->OldProc, RelocSize));
+
+    ASSERT(*RelocSize <= LH_MAX_RELOC_SIZE,L"install.c - *RelocSize <= LH_MAX_RELOC_SIZE");
 
 	// Reserve enough room to fit worst case
 	MemoryPtr += *RelocSize + MAX_JMP_SIZE;
@@ -306,7 +412,7 @@ Returns:
     */
     Ptr = Hook->Trampoline;
 
-    for(Index = 0; Index < GetTrampolineSize(); Index++)
+    for(Index = 0; Index < TrampolineSize; Index++)
     {
     #pragma warning (disable:4311) // pointer truncation
 	    switch(*((ULONG*)(Ptr)))
@@ -325,7 +431,7 @@ Returns:
     }
 #endif
 
-    RETURN(STATUS_SUCCESS);
+    RETURN;
 
 THROW_OUTRO:
 FINALLY_OUTRO:
@@ -345,87 +451,47 @@ FINALLY_OUTRO:
 
 
 
-EASYHOOK_NT_EXPORT LhInstallHook(
+#if X64_DRIVER
+// This is the ASM that will perform a jump INTO the trampoline for X64_DRIVER
+// Note that the address 0x0 will be replaced with appropriate address.
+// 50                             push   rax
+// 48 b8 00 00 00 00 00 00 00 00  mov rax, 0x0
+// 48 87 04 24                    xchg   QWORD PTR[rsp], rax
+// c3                             ret
+static const UCHAR              TrampolineJumper_x64[X64_DRIVER_JMPSIZE] = {
+	0x50,
+	0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x48, 0x87, 0x04, 0x24,
+	0xc3
+};
+#endif
+
+static NTSTATUS LhPrepareHook(
             void* InEntryPoint,
             void* InHookProc,
             void* InCallback,
-            TRACED_HOOK_HANDLE OutHandle)
+            ULONG InFlags,
+            TRACED_HOOK_HANDLE InHandle,
+            LOCAL_HOOK_INFO** OutHook)
 {
 /*
 Description:
 
-    Installs a hook at the given entry point, redirecting all
-    calls to the given hooking method. The returned handle will
-    either be released on library unloading or explicitly through
-    LhUninstallHook() or LhUninstallAllHooks().
-
-Parameters:
-
-    - InEntryPoint
-
-        An entry point to hook. Not all entry points are hookable. In such
-        a case STATUS_NOT_SUPPORTED will be returned.
-
-    - InHookProc
-
-        The method that should be called instead of the given entry point.
-        Please note that calling convention, parameter count and return value
-        shall match EXACTLY!
-
-    - InCallback
-
-        An uninterpreted callback later available through
-        LhBarrierGetCallback().
-
-    - OutPHandle
-
-        The memory portion supplied by *OutHandle is expected to be preallocated
-        by the caller. This structure is then filled by the method on success and
-        must stay valid for hook-life time. Only if you explicitly call one of
-        the hook uninstallation APIs, you can safely release the handle memory.
-
-Returns:
+    Validates the parameters of a hook installation, allocates the hook
+    and makes sure that the jumper into the trampoline can be written.
+    Neither the entry point nor any global structure is changed.
 
-    STATUS_NO_MEMORY
-    
-        Unable to allocate memory around the target entry point.
-    
-    STATUS_NOT_SUPPORTED
-    
-        The target entry point contains unsupported instructions.
-    
-    STATUS_INSUFFICIENT_RESOURCES
-    
-        The limit of MAX_HOOK_COUNT simultaneous hooks was reached.
-    
+    On failure *OutHook is NULL.
 */
     LOCAL_HOOK_INFO*			Hook = NULL;
-    ULONG                       Index;
-    LONGLONG          			RelAddr;
     ULONG           			RelocSize;
-    // This will contain the ASM that will perform a JMP into the trampoline
-    UCHAR			            Jumper[MAX_JMP_SIZE] = { 0xE9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-    ULONGLONG                   AtomicCache;
-    BOOL                        Exists;
     LONG                        NtStatus = STATUS_INTERNAL_ERROR;
-
-#if X64_DRIVER
-	// This is the ASM that will perform a jump INTO the trampoline for X64_DRIVER
-	// Note that the address 0x0 will be replaced with appropriate address.
-	// 50                             push   rax
-	// 48 b8 00 00 00 00 00 00 00 00  mov rax, 0x0
-	// 48 87 04 24                    xchg   QWORD PTR[rsp], rax
-	// c3                             ret
-	UCHAR			            Jumper_x64[X64_DRIVER_JMPSIZE] = {
-		0x50,
-		0x48, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x48, 0x87, 0x04, 0x24,
-		0xc3
-	};
-	ULONGLONG					AtomicCache_x64;
-	KIRQL						CurrentIRQL = PASSIVE_LEVEL;
+#if !X64_DRIVER
+    LONGLONG          			RelAddr;
 #endif
 
+    *OutHook = NULL;
+
     // validate parameters
     if(!IsValidPointer(InEntryPoint, 1))
         THROW(STATUS_INVALID_PARAMETER_1, L"Invalid entry point.");
@@ -433,185 +499,984 @@ Returns:
     if(!IsValidPointer(InHookProc, 1))
         THROW(STATUS_INVALID_PARAMETER_2, L"Invalid hook procedure.");
 
-    if(!IsValidPointer(OutHandle, sizeof(HOOK_TRACE_INFO)))
-        THROW(STATUS_INVALID_PARAMETER_4, L"The hook handle storage is expected to be allocated by the caller.");
+    if(!IsValidPointer(InHandle, sizeof(HOOK_TRACE_INFO)))
+        THROW(STATUS_INVALID_PARAMETER_5, L"The hook handle storage is expected to be allocated by the caller.");
 
-    if(OutHandle->Link != NULL)
-        THROW(STATUS_INVALID_PARAMETER_4, L"The given trace handle seems to already be associated with a hook.");
+    if(InHandle->Link != NULL)
+        THROW(STATUS_INVALID_PARAMETER_5, L"The given trace handle seems to already be associated with a hook.");
 
     // allocate hook and prepare trampoline / hook stub
-    FORCE(LhAllocateHook(InEntryPoint, InHookProc, InCallback, &Hook, &RelocSize));
-    
-	// Prepare jumper from entry point to hook stub...
-#if X64_DRIVER
-
-	// absolute jumper
-	RelAddr = (ULONGLONG)Hook->Trampoline;
-
-	RtlCopyMemory(Jumper, Jumper_x64, X64_DRIVER_JMPSIZE);
-	// Set address to be copied into RAX
-	RtlCopyMemory(Jumper + X64_DRIVER_JMPADDR_OFFSET, &RelAddr, 8);
-
-#else
+    FORCE(LhAllocateHook(InEntryPoint, InHookProc, InCallback, InFlags, &Hook, &RelocSize));
 
+#if !X64_DRIVER
 	// relative jumper
     RelAddr = (LONGLONG)Hook->Trampoline - ((LONGLONG)Hook->TargetProc + 5);
 
 	if(RelAddr != (LONG)RelAddr)
 		THROW(STATUS_NOT_SUPPORTED, L"The given entry point is out of reach.");
 
-    RtlCopyMemory(Jumper + 1, &RelAddr, 4);
-
     FORCE(RtlProtectMemory(Hook->TargetProc, Hook->EntrySize, PAGE_EXECUTE_READWRITE));
 #endif
 
-    // register in global HLS list
-    RtlAcquireLock(&GlobalHookLock);
-    {
-		Hook->HLSIdent = UniqueIDCounter++;
+    *OutHook = Hook;
 
-		Exists = FALSE;
+    RETURN;
 
-        for(Index = 0; Index < MAX_HOOK_COUNT; Index++)
+THROW_OUTRO:
+FINALLY_OUTRO:
+    {
+        if(!RTL_SUCCESS(NtStatus))
         {
-	        if(GlobalSlotList[Index] == 0)
-	        {
-		        GlobalSlotList[Index] = Hook->HLSIdent;
+	        if(Hook != NULL)
+	            LhFreeMemory(&Hook);
+        }
 
-		        Hook->HLSIndex = Index;
+        return NtStatus;
+    }
+}
 
-		        Exists = TRUE;
 
-		        break;
-	        }
-        }
-    }
-    RtlReleaseLock(&GlobalHookLock);
 
-	// ATTENTION: This must be the last THROW!!!!
-    if(!Exists)
-	    THROW(STATUS_INSUFFICIENT_RESOURCES, L"Not more than MAX_HOOK_COUNT hooks are supported simultaneously.");
 
-    // from now on the unrecoverable code section starts...
-#ifdef X64_DRIVER
+static BOOL LhGrowSlotList()
+{
+/*
+Description:
 
-	AtomicCache = *((ULONGLONG*)(Hook->TargetProc + 8));
-    {
-		RtlCopyMemory(&AtomicCache_x64, Jumper, 8);
-	    // Copy the second part of the Jumper
-		RtlCopyMemory(&AtomicCache, Jumper + 8, X64_DRIVER_JMPSIZE - 8);
+    Enlarges the HLS slot list, but not beyond GlobalMaxHookCount (rounded
+    up to a full bitmap word). The caller has to own the GlobalHookLock.
 
-		// backup entry point for later comparison
-	    Hook->HookCopy = AtomicCache_x64;
-    }
-	CurrentIRQL = KeGetCurrentIrql();
-	RtlWPOff();
-	*((ULONGLONG*)(Hook->TargetProc + 0)) = AtomicCache_x64;
-    *((ULONGLONG*)(Hook->TargetProc + 8)) = AtomicCache;
-	RtlWPOn(CurrentIRQL);
+Returns:
 
-#else
+    FALSE if the limit is reached or not enough memory is available.
+*/
+    ULONG                       Capacity;
+    ULONG*                      List;
+    ULONG*                      Bitmap;
 
-    AtomicCache = *((ULONGLONG*)Hook->TargetProc);
+    Capacity = (GlobalSlotCapacity == 0)?SLOT_LIST_MIN_SIZE:GlobalSlotCapacity * 2;
+
+    if(Capacity > GlobalMaxHookCount)
+        Capacity = (GlobalMaxHookCount + SLOT_BITMAP_BITS - 1) & ~(SLOT_BITMAP_BITS - 1);
+
+    if(Capacity <= GlobalSlotCapacity)
+        return FALSE;
+
+    List = (ULONG*)RtlAllocateMemory(TRUE, Capacity * sizeof(ULONG));
+    Bitmap = (ULONG*)RtlAllocateMemory(TRUE, Capacity / 8);
+
+    if((List == NULL) || (Bitmap == NULL))
     {
-	    RtlCopyMemory(&AtomicCache, Jumper, 5);
+        if(List != NULL)
+            RtlFreeMemory(List);
 
-	    // backup entry point for later comparison
-	    Hook->HookCopy = AtomicCache;
-    }
-    *((ULONGLONG*)Hook->TargetProc) = AtomicCache;
+        if(Bitmap != NULL)
+            RtlFreeMemory(Bitmap);
 
-#endif
+        return FALSE;
+    }
 
-    /*
-        Add hook to global list and return handle...
-    */
-    RtlAcquireLock(&GlobalHookLock);
+    if(GlobalSlotList != NULL)
     {
-        Hook->Next = GlobalHookListHead.Next;
-        GlobalHookListHead.Next = Hook;
+        RtlCopyMemory(List, GlobalSlotList, GlobalSlotCapacity * sizeof(ULONG));
+        RtlCopyMemory(Bitmap, GlobalSlotBitmap, GlobalSlotCapacity / 8);
+
+        RtlFreeMemory(GlobalSlotList);
+        RtlFreeMemory(GlobalSlotBitmap);
     }
-    RtlReleaseLock(&GlobalHookLock);
 
-    Hook->Signature = LOCAL_HOOK_SIGNATURE;
-    Hook->Tracking = OutHandle;
-    OutHandle->Link = Hook;
+    GlobalSlotHint = GlobalSlotCapacity / SLOT_BITMAP_BITS;
+    GlobalSlotList = List;
+    GlobalSlotBitmap = Bitmap;
+    GlobalSlotCapacity = Capacity;
+
+    return TRUE;
+}
 
-    RETURN(STATUS_SUCCESS);
 
-THROW_OUTRO:
-FINALLY_OUTRO:
+
+
+static BOOL LhAssignHookSlot(LOCAL_HOOK_INFO* InHook)
+{
+/*
+Description:
+
+    Registers the hook in the global HLS list. The caller
+    has to own the GlobalHookLock.
+
+Returns:
+
+    FALSE if GlobalMaxHookCount hooks are already registered.
+*/
+    ULONG                       Word;
+    ULONG                       Bit;
+    ULONG                       Index;
+
+    // skip words without free slots...
+    while(TRUE)
     {
-        if(!RTL_SUCCESS(NtStatus))
+        for(Word = GlobalSlotHint; Word < GlobalSlotCapacity / SLOT_BITMAP_BITS; Word++)
         {
-	        if(Hook != NULL)
-	            LhFreeMemory(&Hook);
+            if(GlobalSlotBitmap[Word] != ~((ULONG)0))
+                break;
         }
 
-        return NtStatus;
+        GlobalSlotHint = Word;
+
+        if(Word < GlobalSlotCapacity / SLOT_BITMAP_BITS)
+            break;
+
+        if(!LhGrowSlotList())
+            return FALSE;
     }
-}
 
-/*////////////////////// GetTrampolineSize
+    _BitScanForward((unsigned long*)&Bit, ~GlobalSlotBitmap[Word]);
 
-DESCRIPTION:
+    Index = Word * SLOT_BITMAP_BITS + Bit;
 
-	Will dynamically detect the size in bytes of the assembler code stored
-	in "HookSpecifix_x##.asm".
-*/
-static ULONG ___TrampolineSize = 0;
+    // the last bitmap word might exceed the limit
+    if(Index >= GlobalMaxHookCount)
+        return FALSE;
 
-#ifdef _M_X64
-	EXTERN_C void __stdcall Trampoline_ASM_x64();
-#else
-	EXTERN_C void __stdcall Trampoline_ASM_x86();
-#endif
+    InHook->HLSIdent = UniqueIDCounter++;
+    InHook->HLSIndex = Index;
 
-UCHAR* GetTrampolinePtr()
+    GlobalSlotList[Index] = InHook->HLSIdent;
+    GlobalSlotBitmap[Word] |= 1UL << Bit;
+
+    return TRUE;
+}
+
+
+
+
+void LhReleaseHookSlot(LOCAL_HOOK_INFO* InHook)
 {
-// bypass possible Visual Studio debug jump table
-#ifdef _M_X64
-	UCHAR* Ptr = (UCHAR*)Trampoline_ASM_x64;
-#else
-	UCHAR* Ptr = (UCHAR*)Trampoline_ASM_x86;
-#endif
+/*
+Description:
 
-	if(*Ptr == 0xE9)
-		Ptr += *((int*)(Ptr + 1)) + 5;
+    Releases the HLS slot of the given hook, if it still owns one. 
+    The caller has to own the GlobalHookLock.
+*/
+    ULONG                       Index = InHook->HLSIndex;
 
-#ifdef _M_X64
-	return Ptr + 5 * 8;
-#else
-	return Ptr;
-#endif
+    if((Index >= GlobalSlotCapacity) || (GlobalSlotList[Index] != InHook->HLSIdent))
+        return;
+
+    GlobalSlotList[Index] = 0;
+    GlobalSlotBitmap[Index / SLOT_BITMAP_BITS] &= ~(1UL << (Index % SLOT_BITMAP_BITS));
+
+    if(Index / SLOT_BITMAP_BITS < GlobalSlotHint)
+        GlobalSlotHint = Index / SLOT_BITMAP_BITS;
 }
 
-ULONG GetTrampolineSize()
-{
-    UCHAR*		Ptr = GetTrampolinePtr();
-	UCHAR*		BasePtr = Ptr;
-    ULONG       Signature;
-    ULONG       Index;
 
-	if(___TrampolineSize != 0)
-		return ___TrampolineSize;
-	
-	// search for signature
-	for(Index = 0; Index < 2000 /* some always large enough value*/; Index++)
-	{
-		Signature = *((ULONG*)Ptr);
 
-		if(Signature == 0x12345678)	
-		{
-			___TrampolineSize = (ULONG)(Ptr - BasePtr);
 
-			return ___TrampolineSize;
-		}
+EASYHOOK_NT_EXPORT LhSetMaxHookCount(ULONG InMaxHookCount)
+{
+/*
+Description:
 
-		Ptr++;
-	}
+    Changes the maximum count of simultaneously installed hooks, which
+    defaults to MAX_HOOK_COUNT. The limit can only be lowered as long as
+    no installed hook uses a slot beyond the new limit. Hooks pending
+    removal still occupy their slot until LhWaitForPendingRemovals()
+    released them.
+
+Parameters:
 
-    ASSERT(FALSE,L"install.c - ULONG GetTrampolineSize()");
+    - InMaxHookCount
 
-    return 0;
-}
\ No newline at end of file
+        The new limit.
+*/
+    NTSTATUS                    NtStatus;
+    ULONG                       Index;
+    BOOL                        IsInUse = FALSE;
+
+    if(InMaxHookCount == 0)
+        THROW(STATUS_INVALID_PARAMETER_1, L"At least one hook has to be supported.");
+
+    RtlAcquireLock(&GlobalHookLock);
+    {
+        for(Index = InMaxHookCount; Index < GlobalSlotCapacity; Index++)
+        {
+            if(GlobalSlotList[Index] != 0)
+                IsInUse = TRUE;
+        }
+
+        if(!IsInUse)
+            GlobalMaxHookCount = InMaxHookCount;
+    }
+    RtlReleaseLock(&GlobalHookLock);
+
+    if(IsInUse)
+        THROW(STATUS_INVALID_PARAMETER_1, L"There are hooks installed beyond the given limit.");
+
+    RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    return NtStatus;
+}
+
+
+
+
+void LhLinkHook(LOCAL_HOOK_INFO* InHook)
+{
+/*
+Description:
+
+    Inserts the hook at the head of GlobalHookListHead.
+    Must be called with GlobalHookLock held.
+*/
+    InHook->Prev = &GlobalHookListHead;
+    InHook->Next = GlobalHookListHead.Next;
+
+    if(InHook->Next != NULL)
+        InHook->Next->Prev = InHook;
+
+    GlobalHookListHead.Next = InHook;
+}
+
+
+
+
+void LhUnlinkHook(LOCAL_HOOK_INFO* InHook)
+{
+/*
+Description:
+
+    Removes the hook from GlobalHookListHead in constant time.
+    Must be called with GlobalHookLock held.
+*/
+    InHook->Prev->Next = InHook->Next;
+
+    if(InHook->Next != NULL)
+        InHook->Next->Prev = InHook->Prev;
+
+    InHook->Next = NULL;
+    InHook->Prev = NULL;
+}
+
+
+
+
+static void LhCommitHook(
+            LOCAL_HOOK_INFO* InHook,
+            TRACED_HOOK_HANDLE OutHandle)
+{
+/*
+Description:
+
+    Writes the jumper into the entry point of a prepared hook with
+    an assigned slot and associates the hook with the given handle.
+    This can't fail and can't be undone except by uninstalling the hook.
+
+    The hook is not yet added to the global hook list!
+*/
+    // This will contain the ASM that will perform a JMP into the trampoline
+    UCHAR			            Jumper[MAX_JMP_SIZE] = { 0xE9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    LONGLONG          			RelAddr;
+    ULONGLONG                   AtomicCache;
+#if X64_DRIVER
+	ULONGLONG					AtomicCache_x64;
+	KIRQL						CurrentIRQL = PASSIVE_LEVEL;
+#endif
+
+	// Prepare jumper from entry point to hook stub...
+#if X64_DRIVER
+
+	// absolute jumper
+	RelAddr = (ULONGLONG)InHook->Trampoline;
+
+	RtlCopyMemory(Jumper, (void*)TrampolineJumper_x64, X64_DRIVER_JMPSIZE);
+	// Set address to be copied into RAX
+	RtlCopyMemory(Jumper + X64_DRIVER_JMPADDR_OFFSET, &RelAddr, 8);
+
+	AtomicCache = *((ULONGLONG*)(InHook->TargetProc + 8));
+    {
+		RtlCopyMemory(&AtomicCache_x64, Jumper, 8);
+	    // Copy the second part of the Jumper
+		RtlCopyMemory(&AtomicCache, Jumper + 8, X64_DRIVER_JMPSIZE - 8);
+
+		// backup entry point for later comparison
+	    InHook->HookCopy = AtomicCache_x64;
+    }
+	CurrentIRQL = KeGetCurrentIrql();
+	RtlWPOff();
+	*((ULONGLONG*)(InHook->TargetProc + 0)) = AtomicCache_x64;
+    *((ULONGLONG*)(InHook->TargetProc + 8)) = AtomicCache;
+	RtlWPOn(CurrentIRQL);
+
+#else
+
+	// relative jumper, the distance was already validated by LhPrepareHook()
+    RelAddr = (LONGLONG)InHook->Trampoline - ((LONGLONG)InHook->TargetProc + 5);
+
+    RtlCopyMemory(Jumper + 1, &RelAddr, 4);
+
+    AtomicCache = *((ULONGLONG*)InHook->TargetProc);
+    {
+	    RtlCopyMemory(&AtomicCache, Jumper, 5);
+
+	    // backup entry point for later comparison
+	    InHook->HookCopy = AtomicCache;
+    }
+    *((ULONGLONG*)InHook->TargetProc) = AtomicCache;
+
+#endif
+
+    InHook->Signature = LOCAL_HOOK_SIGNATURE;
+    InHook->Tracking = OutHandle;
+}
+
+
+
+
+EASYHOOK_NT_EXPORT LhInstallHook(
+            void* InEntryPoint,
+            void* InHookProc,
+            void* InCallback,
+            TRACED_HOOK_HANDLE OutHandle)
+{
+/*
+Description:
+
+    Installs a hook at the given entry point, redirecting all
+    calls to the given hooking method. See LhInstallHookEx() for
+    a description of the parameters and return values. An invalid
+    OutHandle is reported as STATUS_INVALID_PARAMETER_5 there too.
+*/
+    return LhInstallHookEx(InEntryPoint, InHookProc, InCallback, EASYHOOK_HOOK_DEFAULT, OutHandle);
+}
+
+
+
+
+EASYHOOK_NT_EXPORT LhInstallHookEx(
+            void* InEntryPoint,
+            void* InHookProc,
+            void* InCallback,
+            ULONG InFlags,
+            TRACED_HOOK_HANDLE OutHandle)
+{
+/*
+Description:
+
+    Installs a hook at the given entry point, redirecting all
+    calls to the given hooking method. The returned handle will
+    either be released on library unloading or explicitly through
+    LhUninstallHook() or LhUninstallAllHooks().
+
+    With EASYHOOK_HOOK_FAST_TRAMPOLINE the handler is entered through
+    a minimal trampoline which only maintains the execution counter.
+    There is no thread deadlock barrier, so the hook is neither
+    protected against recursion nor against being called from within
+    the loader lock or EasyHook itself. Thread ACLs are ignored and
+    the barrier APIs, like LhBarrierGetCallback(), are not available
+    within the handler. The original method is reached through
+    the relocated entry point as usual. As the execution counter
+    does not cover the handler, the memory of such a hook is only
+    released on library unloading, its slot is reused as usual.
+    Each install and uninstall cycle therefore keeps one hook block.
+    Once MAX_PINNED_HOOK_COUNT such hooks were created, installed or
+    not, further fast hooks fail with STATUS_INSUFFICIENT_RESOURCES.
+    The same applies to hooks whose entry point contains a call.
+
+Parameters:
+
+    - InEntryPoint
+
+        An entry point to hook. Not all entry points are hookable. In such
+        a case STATUS_NOT_SUPPORTED will be returned.
+
+    - InHookProc
+
+        The method that should be called instead of the given entry point.
+        Please note that calling convention, parameter count and return value
+        shall match EXACTLY!
+
+    - InCallback
+
+        An uninterpreted callback later available through
+        LhBarrierGetCallback().
+
+    - InFlags
+
+        EASYHOOK_HOOK_DEFAULT or EASYHOOK_HOOK_FAST_TRAMPOLINE. Regular
+        hooks may also specify EASYHOOK_HOOK_STATISTICS to count calls,
+        bypassed calls and handler latencies, see LhGetHookStatistics().
+        EASYHOOK_HOOK_NO_LOADER_LOCK_CHECK intercepts calls made within
+        the OS loader lock too; the handler must be safe to run there.
+        The barrier might then also allocate memory within the loader lock,
+        when a thread calls the hook for the first time.
+
+    - OutPHandle
+
+        The memory portion supplied by *OutHandle is expected to be preallocated
+        by the caller. This structure is then filled by the method on success and
+        must stay valid for hook-life time. Only if you explicitly call one of
+        the hook uninstallation APIs, you can safely release the handle memory.
+
+Returns:
+
+    STATUS_NO_MEMORY
+    
+        Unable to allocate memory around the target entry point.
+    
+    STATUS_NOT_SUPPORTED
+    
+        The target entry point contains unsupported instructions.
+
+    STATUS_INVALID_PARAMETER_4
+
+        Unknown flags were passed.
+
+    STATUS_INVALID_PARAMETER_5
+
+        The handle storage is invalid or already associated with a hook.
+    
+    STATUS_INSUFFICIENT_RESOURCES
+    
+        The limit of simultaneous hooks was reached, which is MAX_HOOK_COUNT
+        unless changed with LhSetMaxHookCount(), or MAX_PINNED_HOOK_COUNT
+        hooks are kept until unload.
+    
+*/
+    LOCAL_HOOK_INFO*			Hook = NULL;
+    BOOL                        Exists;
+    LONG                        NtStatus = STATUS_INTERNAL_ERROR;
+
+    // give back memory and slots of hooks removed asynchronously
+    LhReclaimRetiredHooks();
+
+    FORCE(LhPrepareHook(InEntryPoint, InHookProc, InCallback, InFlags, OutHandle, &Hook));
+
+    // register in global HLS list
+    RtlAcquireLock(&GlobalHookLock);
+    {
+        Exists = LhAssignHookSlot(Hook);
+    }
+    RtlReleaseLock(&GlobalHookLock);
+
+	// ATTENTION: This must be the last THROW!!!!
+    if(!Exists)
+	    THROW(STATUS_INSUFFICIENT_RESOURCES, L"The limit of simultaneously installed hooks was reached (see LhSetMaxHookCount()).");
+
+    // from now on the unrecoverable code section starts...
+    LhCommitHook(Hook, OutHandle);
+
+    /*
+        Add hook to global list and return handle...
+    */
+    RtlAcquireLock(&GlobalHookLock);
+    {
+        LhLinkHook(Hook);
+    }
+    RtlReleaseLock(&GlobalHookLock);
+
+    OutHandle->Link = Hook;
+
+    RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    {
+        if(!RTL_SUCCESS(NtStatus))
+        {
+	        if(Hook != NULL)
+	            LhFreeMemory(&Hook);
+        }
+
+        return NtStatus;
+    }
+}
+
+
+
+
+static void LhDiscardPreparedHook(
+            LOCAL_HOOK_INFO** RefHook,
+            BOOL* RefHasSlot)
+{
+/*
+Description:
+
+    Releases a prepared hook which won't be installed, including its HLS
+    slot if it owns one. The caller must not own the GlobalHookLock.
+*/
+    if(*RefHasSlot)
+    {
+        RtlAcquireLock(&GlobalHookLock);
+        {
+            LhReleaseHookSlot(*RefHook);
+        }
+        RtlReleaseLock(&GlobalHookLock);
+
+        *RefHasSlot = FALSE;
+    }
+
+    if(*RefHook != NULL)
+        LhFreeMemory(RefHook);
+}
+
+
+
+
+static ULONG_PTR LhGetEntryKey(
+            HOOK_INSTALL_ENTRY* InEntry,
+            BOOL InByHandle)
+{
+    return InByHandle?(ULONG_PTR)InEntry->Handle:(ULONG_PTR)InEntry->EntryPoint;
+}
+
+
+
+
+static void LhRejectDuplicateEntries(
+            HOOK_INSTALL_ENTRY* InEntries,
+            ULONG* InOrder,
+            ULONG InCount,
+            BOOL InByHandle,
+            NTSTATUS InStatus)
+{
+/*
+Description:
+
+    Sorts the entry indices by entry point or handle, and by index for equal
+    keys, with a shell sort like AclSort(). Every entry naming the same entry
+    point or handle as an earlier one gets the given status. Comparing each
+    pair of entries instead took longer than installing a large batch.
+*/
+    ULONG           Gap;
+    ULONG           Index;
+    ULONG           Pos;
+    ULONG           Value;
+    ULONG_PTR       Key;
+
+    for(Index = 0; Index < InCount; Index++)
+    {
+        InOrder[Index] = Index;
+    }
+
+    for(Gap = InCount / 2; Gap > 0; Gap = (Gap == 2)?1:(Gap * 5) / 11)
+    {
+        for(Index = Gap; Index < InCount; Index++)
+        {
+            Value = InOrder[Index];
+            Key = LhGetEntryKey(&InEntries[Value], InByHandle);
+
+            for(Pos = Index; Pos >= Gap; Pos -= Gap)
+            {
+                if((LhGetEntryKey(&InEntries[InOrder[Pos - Gap]], InByHandle) < Key) ||
+                        ((LhGetEntryKey(&InEntries[InOrder[Pos - Gap]], InByHandle) == Key) && (InOrder[Pos - Gap] < Value)))
+                    break;
+
+                InOrder[Pos] = InOrder[Pos - Gap];
+            }
+
+            InOrder[Pos] = Value;
+        }
+    }
+
+    for(Index = 1; Index < InCount; Index++)
+    {
+        if(LhGetEntryKey(&InEntries[InOrder[Index]], InByHandle) == LhGetEntryKey(&InEntries[InOrder[Index - 1]], InByHandle))
+            InEntries[InOrder[Index]].Status = InStatus;
+    }
+}
+
+
+
+
+#ifndef DRIVER
+
+#define LH_INSTALL_SUSPEND_ATTEMPTS         3
+
+static NTSTATUS LhSuspendForInstallation(
+            HOOK_INSTALL_ENTRY* InEntries,
+            LOCAL_HOOK_INFO** InHooks,
+            ULONG InCount,
+            LH_SUSPENDED_THREADS* OutThreads)
+{
+/*
+Description:
+
+    Suspends all other threads for writing the jumpers of a batch. A thread
+    executing within the first instructions of an entry point would continue
+    in the middle of the jumper, so suspension is retried a few times. Entries
+    still in use after the last attempt report STATUS_RETRY.
+
+    Entries without a prepared hook or with a failure status are ignored.
+*/
+    ULONG               Attempt;
+    ULONG               Index;
+    BOOL                IsBusy;
+    LOCAL_HOOK_INFO*    Hook;
+    NTSTATUS            NtStatus;
+
+    for(Attempt = 1; ; Attempt++)
+    {
+        FORCE(LhSuspendOtherThreads(OutThreads));
+
+        IsBusy = FALSE;
+
+        for(Index = 0; Index < InCount; Index++)
+        {
+            if(((Hook = InHooks[Index]) == NULL) || !RTL_SUCCESS(InEntries[Index].Status))
+                continue;
+
+            // a thread at the entry point itself will just take the jumper
+            if(!LhIsThreadWithin(OutThreads, Hook->TargetProc + 1, Hook->EntrySize - 1))
+                continue;
+
+            IsBusy = TRUE;
+
+            if(Attempt == LH_INSTALL_SUSPEND_ATTEMPTS)
+                InEntries[Index].Status = STATUS_RETRY;
+        }
+
+        if(!IsBusy || (Attempt == LH_INSTALL_SUSPEND_ATTEMPTS))
+            break;
+
+        LhResumeOtherThreads(OutThreads);
+
+        Sleep(1);
+    }
+
+    RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    return NtStatus;
+}
+
+#endif
+
+
+
+
+EASYHOOK_NT_EXPORT LhInstallHooks(
+            HOOK_INSTALL_ENTRY* InEntries,
+            ULONG InCount,
+            BOOL InAllOrNothing)
+{
+/*
+Description:
+
+    Installs a batch of hooks. In contrast to calling LhInstallHookEx() for
+    each entry, all trampolines are prepared first and HLS slots are assigned
+    in a single locked pass. Then all other threads are suspended, all jumpers
+    are written, the threads are resumed and the hooks are published together.
+    Other threads either run the original code or the hooked code of all
+    entry points, never a partially written jumper.
+
+    The driver writes the jumpers without suspending any thread, like
+    LhInstallHookEx() does.
+
+Parameters:
+
+    - InEntries
+
+        The hooks to install. EntryPoint, HookProc, Callback, Flags and Handle
+        have the same meaning as the parameters of LhInstallHookEx(). On return,
+        Status contains the result for each entry. An entry point or handle may
+        only appear once per batch.
+
+    - InCount
+
+        The count of entries.
+
+    - InAllOrNothing
+
+        If TRUE, no hook is installed if any entry fails. Entries which did not
+        fail themselves report STATUS_CANCELLED in this case. Otherwise all
+        valid entries are installed.
+
+Returns:
+
+    STATUS_SUCCESS if all hooks were installed, otherwise the status
+    of the first failing entry.
+
+    STATUS_RETRY
+
+        Another thread kept executing the first instructions of the entry
+        point, so the jumper couldn't be written safely.
+*/
+    LOCAL_HOOK_INFO**           Hooks = NULL;
+    BOOL*                       HasSlot = NULL;
+    ULONG*                      Order = NULL;
+    ULONG                       Index;
+    NTSTATUS                    FirstError = STATUS_SUCCESS;
+    LONG                        NtStatus = STATUS_INTERNAL_ERROR;
+#ifndef DRIVER
+    LH_SUSPENDED_THREADS        Threads;
+    BOOL                        IsSuspended = FALSE;
+#endif
+
+    if(!IsValidPointer(InEntries, sizeof(HOOK_INSTALL_ENTRY) * InCount))
+        THROW(STATUS_INVALID_PARAMETER_1, L"Invalid hook entry list.");
+
+    if(InCount == 0)
+        RETURN;
+
+    LhReclaimRetiredHooks();
+
+    if((Hooks = (LOCAL_HOOK_INFO**)RtlAllocateMemory(TRUE, sizeof(LOCAL_HOOK_INFO*) * InCount)) == NULL)
+        THROW(STATUS_NO_MEMORY, L"Failed to allocate memory.");
+
+    if((HasSlot = (BOOL*)RtlAllocateMemory(TRUE, sizeof(BOOL) * InCount)) == NULL)
+        THROW(STATUS_NO_MEMORY, L"Failed to allocate memory.");
+
+    if((Order = (ULONG*)RtlAllocateMemory(FALSE, sizeof(ULONG) * InCount)) == NULL)
+        THROW(STATUS_NO_MEMORY, L"Failed to allocate memory.");
+
+    for(Index = 0; Index < InCount; Index++)
+    {
+        InEntries[Index].Status = STATUS_SUCCESS;
+    }
+
+    LhRejectDuplicateEntries(InEntries, Order, InCount, FALSE, STATUS_INVALID_PARAMETER_1);
+    LhRejectDuplicateEntries(InEntries, Order, InCount, TRUE, STATUS_INVALID_PARAMETER_5);
+
+    /*
+        Prepare all trampolines...
+    */
+    for(Index = 0; Index < InCount; Index++)
+    {
+        if(RTL_SUCCESS(InEntries[Index].Status))
+        {
+            InEntries[Index].Status = LhPrepareHook(
+                InEntries[Index].EntryPoint,
+                InEntries[Index].HookProc,
+                InEntries[Index].Callback,
+                InEntries[Index].Flags,
+                InEntries[Index].Handle,
+                &Hooks[Index]);
+        }
+
+        if(!RTL_SUCCESS(InEntries[Index].Status))
+        {
+            if(RTL_SUCCESS(FirstError))
+                FirstError = InEntries[Index].Status;
+
+            if(InAllOrNothing)
+                break;
+        }
+    }
+
+    /*
+        Assign all slots in one pass...
+    */
+    RtlAcquireLock(&GlobalHookLock);
+    {
+        for(Index = 0; (Index < InCount) && (RTL_SUCCESS(FirstError) || !InAllOrNothing); Index++)
+        {
+            if(Hooks[Index] == NULL)
+                continue;
+
+            if(LhAssignHookSlot(Hooks[Index]))
+            {
+                HasSlot[Index] = TRUE;
+
+                continue;
+            }
+
+            InEntries[Index].Status = STATUS_INSUFFICIENT_RESOURCES;
+
+            if(RTL_SUCCESS(FirstError))
+                FirstError = STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+    RtlReleaseLock(&GlobalHookLock);
+
+#ifndef DRIVER
+    /*
+        Suspend all other threads... From here on until they are resumed,
+        neither locks nor the heap may be used.
+    */
+    if(RTL_SUCCESS(FirstError) || !InAllOrNothing)
+    {
+        if(RTL_SUCCESS(NtStatus = LhSuspendForInstallation(InEntries, Hooks, InCount, &Threads)))
+            IsSuspended = TRUE;
+
+        for(Index = 0; Index < InCount; Index++)
+        {
+            if(Hooks[Index] == NULL)
+                continue;
+
+            if(!IsSuspended && RTL_SUCCESS(InEntries[Index].Status))
+                InEntries[Index].Status = NtStatus;
+
+            if(!RTL_SUCCESS(InEntries[Index].Status) && RTL_SUCCESS(FirstError))
+                FirstError = InEntries[Index].Status;
+        }
+    }
+#endif
+
+    // from now on the unrecoverable code section starts...
+    if(RTL_SUCCESS(FirstError) || !InAllOrNothing)
+    {
+        for(Index = 0; Index < InCount; Index++)
+        {
+            if((Hooks[Index] == NULL) || !RTL_SUCCESS(InEntries[Index].Status))
+                continue;
+
+            LhCommitHook(Hooks[Index], InEntries[Index].Handle);
+
+#ifndef DRIVER
+            FlushInstructionCache(GetCurrentProcess(), Hooks[Index]->TargetProc, Hooks[Index]->EntrySize);
+#endif
+        }
+    }
+
+#ifndef DRIVER
+    if(IsSuspended)
+        LhResumeOtherThreads(&Threads);
+#endif
+
+    // release all hooks not installed
+    for(Index = 0; Index < InCount; Index++)
+    {
+        if(RTL_SUCCESS(InEntries[Index].Status) && (RTL_SUCCESS(FirstError) || !InAllOrNothing))
+            continue;
+
+        LhDiscardPreparedHook(&Hooks[Index], &HasSlot[Index]);
+
+        if(RTL_SUCCESS(InEntries[Index].Status))
+            InEntries[Index].Status = STATUS_CANCELLED;
+    }
+
+    if(!RTL_SUCCESS(FirstError) && InAllOrNothing)
+        THROW(FirstError, L"At least one hook could not be installed.");
+
+    /*
+        Add all hooks to global list and return handles...
+    */
+    RtlAcquireLock(&GlobalHookLock);
+    {
+        for(Index = 0; Index < InCount; Index++)
+        {
+            if(Hooks[Index] == NULL)
+                continue;
+
+            LhLinkHook(Hooks[Index]);
+        }
+    }
+    RtlReleaseLock(&GlobalHookLock);
+
+    for(Index = 0; Index < InCount; Index++)
+    {
+        if(Hooks[Index] != NULL)
+            InEntries[Index].Handle->Link = Hooks[Index];
+    }
+
+    if(!RTL_SUCCESS(FirstError))
+        THROW(FirstError, L"At least one hook could not be installed.");
+
+    RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    {
+        if(Hooks != NULL)
+            RtlFreeMemory(Hooks);
+
+        if(HasSlot != NULL)
+            RtlFreeMemory(HasSlot);
+
+        if(Order != NULL)
+            RtlFreeMemory(Order);
+
+        return NtStatus;
+    }
+}
+
+/*////////////////////// GetTrampolineSize
+
+DESCRIPTION:
+
+	Will dynamically detect the size in bytes of the assembler code stored
+	in "HookSpecifix_x##.asm".
+*/
+static ULONG ___TrampolineSize = 0;
+static ULONG ___FastTrampolineSize = 0;
+
+#ifdef _M_X64
+	EXTERN_C void __stdcall Trampoline_ASM_x64();
+	EXTERN_C void __stdcall TrampolineFast_ASM_x64();
+#else
+	EXTERN_C void __stdcall Trampoline_ASM_x86();
+	EXTERN_C void __stdcall TrampolineFast_ASM_x86();
+#endif
+
+static UCHAR* LocateTrampoline(UCHAR* Ptr)
+{
+// bypass possible Visual Studio debug jump table
+	if(*Ptr == 0xE9)
+		Ptr += *((int*)(Ptr + 1)) + 5;
+
+#ifdef _M_X64
+	return Ptr + 5 * 8;
+#else
+	return Ptr;
+#endif
+}
+
+static ULONG MeasureTrampoline(UCHAR* Ptr)
+{
+	UCHAR*		BasePtr = Ptr;
+    ULONG       Signature;
+    ULONG       Index;
+
+	// search for signature
+	for(Index = 0; Index < 2000 /* some always large enough value*/; Index++)
+	{
+		Signature = *((ULONG*)Ptr);
+
+		if(Signature == 0x12345678)	
+			return (ULONG)(Ptr - BasePtr);
+
+		Ptr++;
+	}
+
+    ASSERT(FALSE,L"install.c - ULONG MeasureTrampoline()");
+
+    return 0;
+}
+
+UCHAR* GetTrampolinePtr()
+{
+#ifdef _M_X64
+	return LocateTrampoline((UCHAR*)Trampoline_ASM_x64);
+#else
+	return LocateTrampoline((UCHAR*)Trampoline_ASM_x86);
+#endif
+}
+
+ULONG GetTrampolineSize()
+{
+	if(___TrampolineSize == 0)
+		___TrampolineSize = MeasureTrampoline(GetTrampolinePtr());
+
+	return ___TrampolineSize;
+}
+
+UCHAR* GetFastTrampolinePtr()
+{
+#ifdef _M_X64
+	return LocateTrampoline((UCHAR*)TrampolineFast_ASM_x64);
+#else
+	return LocateTrampoline((UCHAR*)TrampolineFast_ASM_x86);
+#endif
+}
+
+ULONG GetFastTrampolineSize()
+{
+	if(___FastTrampolineSize == 0)
+		___FastTrampolineSize = MeasureTrampoline(GetFastTrampolinePtr());
+
+	return ___FastTrampolineSize;
+}
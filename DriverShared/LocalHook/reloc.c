@@ -47,15 +47,12 @@ Returns:
 	// some exotic instructions might not be supported see the project
     // at https://github.com/vmt/udis86 and the forums.
 
-    ud_t ud_obj;
-    ud_init(&ud_obj);
+    // only the length is needed, so operands are skipped instead of decoded
 #ifdef _M_X64
-    ud_set_mode(&ud_obj, 64);
+    length = ud_insn_length((uint8_t *)InPtr, 32, 64); // usually only between 1 and 5
 #else
-    ud_set_mode(&ud_obj, 32);
+    length = ud_insn_length((uint8_t *)InPtr, 32, 32);
 #endif
-    ud_set_input_buffer(&ud_obj, (uint8_t *)InPtr, 32);
-    length = ud_disassemble(&ud_obj); // usually only between 1 and 5
 
 	if(length > 0)
 		return length;
@@ -96,7 +93,7 @@ Returns:
 
 	while(BasePtr + InCodeSize > Ptr)
 	{
-		FORCE(NtStatus = LhGetInstructionLength(Ptr));
+		FORCE(LhGetInstructionLength(Ptr));
 
 		Ptr += NtStatus;
 	}
@@ -143,6 +140,225 @@ Returns:
         return STATUS_INVALID_PARAMETER;
 }
 
+static NTSTATUS LhDecodeInstruction(
+            UCHAR* InPtr,
+            LH_PROLOGUE_INSTRUCTION* OutInstr)
+{
+/*
+Description:
+
+    Decodes the length of the given instruction, its relative branch
+    operand, if any, and, for 64-bit, the location of its RIP relative
+    displacement. This is the only place where prologue instructions
+    are decoded.
+
+Returns:
+
+    STATUS_INVALID_PARAMETER
+
+        The given pointer references invalid machine code.
+
+    STATUS_NOT_SUPPORTED
+
+        The instruction uses EIP-relative addressing (64-bit only) or
+        is an unknown relative branch.
+*/
+    NTSTATUS            NtStatus;
+    ud_t                ud_obj;
+    const ud_operand_t* Current;
+    const ud_operand_t* Branch = NULL;
+    ULONG               InstrLen;
+    UCHAR               Opcode;
+    ULONG               Index;
+#ifdef _M_X64
+    const ud_operand_t* Operand = NULL;
+    ULONG               ImmSize = 0;
+    ULONG               RelAddrOffset;
+#endif
+
+    OutInstr->IsRIPRelative = FALSE;
+    OutInstr->DispOffset = 0;
+    OutInstr->BranchType = LH_BRANCH_NONE;
+    OutInstr->BranchDispSize = 0;
+    OutInstr->HasAddressPrefix = FALSE;
+    OutInstr->IsCall = FALSE;
+
+    /*
+        Decode only, no syntax is set so udis86 won't format the instruction.
+        The operands already tell us whether RIP is used as base register
+        and whether this is a relative branch, whatever prefixes were used.
+    */
+    ud_init(&ud_obj);
+#ifdef _M_X64
+    ud_set_mode(&ud_obj, 64);
+#else
+    ud_set_mode(&ud_obj, 32);
+#endif
+    ud_set_input_buffer(&ud_obj, (uint8_t *)InPtr, 32);
+
+    if((InstrLen = ud_disassemble(&ud_obj)) == 0)
+        THROW(STATUS_INVALID_PARAMETER, L"Unable to disassemble entry point. ");
+
+    OutInstr->Length = (UCHAR)InstrLen;
+    OutInstr->IsCall = (ud_insn_mnemonic(&ud_obj) == UD_Icall);
+
+    for(Index = 0; (Current = ud_insn_opr(&ud_obj, Index)) != NULL; Index++)
+    {
+        if(Current->type == UD_OP_JIMM)
+            Branch = Current;
+#ifdef _M_X64
+        else if((Current->type == UD_OP_MEM) && (Current->base == UD_R_RIP))
+            Operand = Current;
+        else if(Current->type == UD_OP_IMM)
+            ImmSize += Current->size / 8;
+
+        /*
+            With an address-size prefix, mod 00 and r/m 101 select [eip+disp32]. udis86
+            only reports RIP as base for 64-bit addressing (and gets the length wrong
+            if REX.B is set), so this form is detected from the ModR/M byte itself.
+        */
+        if((Current->type == UD_OP_MEM) && ud_obj.pfx_adr && ud_obj.have_modrm && ((ud_obj.modrm & 0xC7) == 0x05))
+            THROW(STATUS_NOT_SUPPORTED, L"The given entry point contains an EIP-relative instruction, which can't be relocated.");
+#endif
+    }
+
+    if(Branch != NULL)
+    {
+        /*
+            The displacement always ends the instruction and is directly preceded
+            by the opcode byte holding the condition, e.g. 0x74 or 0x0F 0x84 for jz.
+            Branch hints, BND and segment prefixes are not part of the opcode and
+            don't change the branch, so they are dropped by the relocation.
+        */
+        OutInstr->BranchDispSize = (UCHAR)(Branch->size / 8);
+        OutInstr->HasAddressPrefix = (ud_obj.pfx_adr != 0);
+
+        if(InstrLen < (ULONG)OutInstr->BranchDispSize + 1)
+            THROW(STATUS_NOT_SUPPORTED, L"The given entry point contains an unknown relative branch.");
+
+        Opcode = InPtr[InstrLen - OutInstr->BranchDispSize - 1];
+
+        switch(ud_insn_mnemonic(&ud_obj))
+        {
+        case UD_Icall:
+            {
+                OutInstr->BranchType = LH_BRANCH_CALL;
+
+                if(Opcode != 0xE8)
+                    THROW(STATUS_NOT_SUPPORTED, L"The given entry point contains an unknown relative branch.");
+            }break;
+        case UD_Ijmp:
+            {
+                OutInstr->BranchType = LH_BRANCH_JMP;
+
+                if((Opcode != 0xE9) && (Opcode != 0xEB))
+                    THROW(STATUS_NOT_SUPPORTED, L"The given entry point contains an unknown relative branch.");
+            }break;
+        case UD_Iloop:
+        case UD_Iloope:
+        case UD_Iloopne:
+        case UD_Ijcxz:
+        case UD_Ijecxz:
+        case UD_Ijrcxz:
+            {
+                OutInstr->BranchType = LH_BRANCH_LOOP;
+
+                if((Opcode & 0xFC) != 0xE0)
+                    THROW(STATUS_NOT_SUPPORTED, L"The given entry point contains an unknown relative branch.");
+            }break;
+        default:
+            {
+                // e.g. xbegin also has a relative operand
+                OutInstr->BranchType = LH_BRANCH_JCC;
+
+                if(((Opcode & 0xF0) != 0x70) && ((Opcode & 0xF0) != 0x80))
+                    THROW(STATUS_NOT_SUPPORTED, L"The given entry point contains an unknown relative branch.");
+            }break;
+        }
+
+        return STATUS_SUCCESS;
+    }
+
+#ifdef _M_X64
+    if(Operand == NULL)
+        return STATUS_SUCCESS;
+
+    OutInstr->IsRIPRelative = TRUE;
+
+    /*
+        RIP relative addressing always uses a 32-bit displacement, which
+        is directly followed by the immediates, if any. If the location
+        can't be verified, DispOffset stays zero and relocation fails.
+
+        https://easyhook.codeplex.com/workitem/25487
+        e.g. Win8.1 64-bit OLEAUT32.dll!GetVarConversionLocaleSetting 
+            Entry Point:
+                83 3D 71 08 06 00 00    cmp dword [rip+0x60871], 0x0  IP:ffa1937
+            Relocated:
+                83 3D 09 1E 0B 00 00    cmp dword [rip+0xb1e09], 0x0  IP:ff5039f
+    */
+    if((Operand->offset != 32) || (InstrLen < ImmSize + 5))
+        return STATUS_SUCCESS;
+
+    RelAddrOffset = InstrLen - ImmSize - 4;
+
+    if(*((LONG*)(InPtr + RelAddrOffset)) == Operand->lval.sdword)
+        OutInstr->DispOffset = (UCHAR)RelAddrOffset;
+#endif
+
+    return STATUS_SUCCESS;
+
+THROW_OUTRO:
+    return NtStatus;
+}
+
+#ifdef _M_X64
+static NTSTATUS LhRelocateRIPDisplacement(
+            UCHAR* InInstr,
+            LH_PROLOGUE_INSTRUCTION* InDecoded,
+            UCHAR* InTarget)
+{
+/*
+Description:
+
+    Copies a decoded RIP relative instruction to the target and corrects
+    its displacement.
+*/
+    NTSTATUS            NtStatus;
+    LONGLONG            RelAddr;
+    LONGLONG            MemDelta = InTarget - InInstr;
+
+    ASSERT(MemDelta == (LONG)MemDelta,L"reloc.c - MemDelta == (LONG)MemDelta");
+
+    if(InDecoded->DispOffset == 0)
+        THROW(STATUS_INTERNAL_ERROR, L"The given entry point contains a RIP-relative instruction for which we can't determine the correct address offset!");
+
+	/*
+        Relocate this instruction...
+
+        Negative displacements are fine, e.g. Win8.1 64-bit OLEAUT32.dll!VarBoolFromR8
+            Entry Point:
+              66 0F 2E 05 DC 25 FC FF   ucomisd xmm0, [rip-0x3da24]   IP:ffc46d4
+            Relocated:
+              66 0F 2E 05 10 69 F6 FF   ucomisd xmm0, [rip-0x996f0]   IP:100203a0
+    */
+    RelAddr = *((LONG*)(InInstr + InDecoded->DispOffset)) - MemDelta;
+    // Ensure the RIP address can still be relocated
+    if(RelAddr != (LONG)RelAddr)
+        THROW(STATUS_NOT_SUPPORTED, L"The given entry point contains at least one RIP-Relative instruction that could not be relocated!");
+
+    // Copy instruction to target
+    RtlCopyMemory(InTarget, InInstr, InDecoded->Length);
+    // Correct the rip address
+    *((LONG*)(InTarget + InDecoded->DispOffset)) = (LONG)RelAddr;
+
+    return STATUS_SUCCESS;
+
+THROW_OUTRO:
+    return NtStatus;
+}
+#endif
+
 EASYHOOK_NT_INTERNAL LhRelocateRIPRelativeInstruction(
             ULONGLONG InOffset,
             ULONGLONG InTargetOffset,
@@ -177,118 +393,79 @@ Parameters:
 #ifndef _M_X64
     return FALSE;
 #else
-#ifndef MAX_INSTR
-#define MAX_INSTR 100
+    NTSTATUS                    NtStatus;
+    LH_PROLOGUE_INSTRUCTION     Instr;
+
+    *OutWasRelocated = FALSE;
+
+    FORCE(LhDecodeInstruction((UCHAR*)InOffset, &Instr));
+
+    if(!Instr.IsRIPRelative)
+        RETURN;
+
+    FORCE(LhRelocateRIPDisplacement((UCHAR*)InOffset, &Instr, (UCHAR*)InTargetOffset));
+
+    *OutWasRelocated = TRUE;
+
+    RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    return NtStatus;
 #endif
-    NTSTATUS            NtStatus;
-	CHAR                Buf[MAX_INSTR];
-    ULONG               AsmSize;
-    ULONG64             NextInstr;
-	CHAR                Line[MAX_INSTR];
-    LONG                Pos;
-    LONGLONG            RelAddr;
-    LONGLONG            MemDelta = InTargetOffset - InOffset;
+}
 
-	ULONGLONG           RelAddrOffset = 0;
-    LONGLONG            RelAddrSign = 1;
+EASYHOOK_NT_INTERNAL LhDecodePrologue(
+            void* InEntryPoint,
+            ULONG InMinSize,
+            LH_DECODED_PROLOGUE* OutPrologue)
+{
+/*
+Description:
 
-    ASSERT(MemDelta == (LONG)MemDelta,L"reloc.c - MemDelta == (LONG)MemDelta");
+    Decodes the instructions covering at least "InMinSize" bytes of the
+    given entry point. Like LhRoundToNextInstruction(), the resulting size
+    always ends on an instruction boundary. LhRelocatePrologue() works on
+    the result, so each instruction is decoded only once per hook.
 
-    *OutWasRelocated = FALSE;
+Parameters:
 
-    // test field...
-    /*
-    BYTE t[10] = {0x8b, 0x05, 0x12, 0x34, 0x56, 0x78};
-    // udis86 outputs: 0000000000000000 8b0512345678     mov eax, [rip+0x78563412]
+    - InEntryPoint
 
-    InOffset = (LONGLONG)t;
+        The entry point to decode.
 
-    MemDelta = InTargetOffset - InOffset;
-    */
-    // Disassemble the current instruction
-    if(!RTL_SUCCESS(LhDisassembleInstruction((void*)InOffset, &AsmSize, Buf, sizeof(Buf), &NextInstr)))
-        THROW(STATUS_INVALID_PARAMETER_1, L"Unable to disassemble entry point. ");
-    
-    // Check that the address is RIP relative (i.e. look for "[rip+")
-    Pos = RtlAnsiIndexOf(Buf, '[');
-      if(Pos < 0)
-        RETURN;
+    - InMinSize
 
-    if (Buf[Pos + 1] == 'r' && Buf[Pos + 2] == 'i' && Buf[Pos + 3] == 'p' &&  (Buf[Pos + 4] == '+' || Buf[Pos + 4] == '-'))
+        The minimum count of bytes to decode, usually the jumper size.
+
+    - OutPrologue
+
+        Receives the decoded instructions.
+
+Returns:
+
+    STATUS_INVALID_PARAMETER
+
+        The given pointer references invalid machine code.
+*/
+    LH_PROLOGUE_INSTRUCTION*    Instr;
+    NTSTATUS                    NtStatus;
+
+    OutPrologue->EntryPoint = (UCHAR*)InEntryPoint;
+    OutPrologue->Size = 0;
+    OutPrologue->Count = 0;
+
+    while(OutPrologue->Size < InMinSize)
     {
-        /*
-          Support negative relative addresses
-          
-          https://easyhook.codeplex.com/workitem/25592
-            e.g. Win8.1 64-bit OLEAUT32.dll!VarBoolFromR8
-            Entry Point:
-              66 0F 2E 05 DC 25 FC FF   ucomisd xmm0, [rip-0x3da24]   IP:ffc46d4
-            Relocated:
-              66 0F 2E 05 10 69 F6 FF   ucomisd xmm0, [rip-0x996f0]   IP:100203a0
-        */
-        if (Buf[Pos + 4] == '-')
-            RelAddrSign = -1;
-        
-        Pos += 4;
-        // parse content
-		if (RtlAnsiSubString(Buf, Pos + 1, RtlAnsiIndexOf(Buf, ']') - Pos - 1, Line, MAX_INSTR) <= 0)
-            RETURN;
-
-        // Convert HEX string to LONGLONG
-		RelAddr = RtlAnsiHexToLongLong(Line, MAX_INSTR);
-        if (!RelAddr)
-            RETURN;
-
-        // Apply correct sign
-        RelAddr *= RelAddrSign;
-
-        // Verify that we are really RIP relative (i.e. must be 32-bit)
-        if(RelAddr != (LONG)RelAddr)
-            RETURN;
-        
-        /*
-          Ensure the RelAddr is equal to the RIP address in code
-         
-          https://easyhook.codeplex.com/workitem/25487
-		  Thanks to Michal for pointing out that the operand will not always 
-          be at *(NextInstr - 4)
-		  e.g. Win8.1 64-bit OLEAUT32.dll!GetVarConversionLocaleSetting 
-              Entry Point:
-                 83 3D 71 08 06 00 00    cmp dword [rip+0x60871], 0x0  IP:ffa1937
-              Relocated:
-                 83 3D 09 1E 0B 00 00    cmp dword [rip+0xb1e09], 0x0  IP:ff5039f
-        */
-		for (Pos = 1; Pos <= NextInstr - InOffset - 4; Pos++) {
-			if (*((LONG*)(InOffset + Pos)) == RelAddr) {
-				if (RelAddrOffset != 0) {
-					// More than one offset matches the address, therefore we can't determine correct offset for operand
-                    RelAddrOffset = 0;  
-                    break;
-				}
-
-				RelAddrOffset = Pos;
-			}
-		}
+        ASSERT(OutPrologue->Count < LH_MAX_PROLOGUE_INSTRUCTIONS,L"reloc.c - OutPrologue->Count < LH_MAX_PROLOGUE_INSTRUCTIONS");
 
-		if (RelAddrOffset == 0) {
-			THROW(STATUS_INTERNAL_ERROR, L"The given entry point contains a RIP-relative instruction for which we can't determine the correct address offset!");
-		}
+        Instr = &OutPrologue->Instructions[OutPrologue->Count];
+        Instr->Offset = (UCHAR)OutPrologue->Size;
 
-		/*
-            Relocate this instruction...
-        */
-        // Adjust the relative address
-        RelAddr = RelAddr - MemDelta;
-        // Ensure the RIP address can still be relocated
-        if(RelAddr != (LONG)RelAddr)
-            THROW(STATUS_NOT_SUPPORTED, L"The given entry point contains at least one RIP-Relative instruction that could not be relocated!");
-
-        // Copy instruction to target
-        RtlCopyMemory((void*)InTargetOffset, (void*)InOffset, (ULONG)(NextInstr - InOffset));
-        // Correct the rip address
-        *((LONG*)(InTargetOffset + RelAddrOffset)) = (LONG)RelAddr;
-
-        *OutWasRelocated = TRUE;
+        FORCE(LhDecodeInstruction(OutPrologue->EntryPoint + OutPrologue->Size, Instr));
+
+        OutPrologue->Size += Instr->Length;
+        OutPrologue->Count++;
     }
 
     RETURN;
@@ -296,36 +473,96 @@ Parameters:
 THROW_OUTRO:
 FINALLY_OUTRO:
     return NtStatus;
+}
+
+/*
+    Worst case size of a single relocated instruction: a loop/jcxz with its
+    address-size prefix, a short jump over the continuation and an absolute
+    64-bit jump.
+*/
+#define LH_MAX_RELOCATED_INSTRUCTION_SIZE       24
+
+static ULONG LhFindPrologueInstruction(
+            LH_DECODED_PROLOGUE* InPrologue,
+            UCHAR* InAddress)
+{
+/*
+Description:
+
+    Returns the index of the decoded instruction starting at the given
+    address, or the instruction count if there is none.
+*/
+    ULONG       Index;
+
+    for(Index = 0; Index < InPrologue->Count; Index++)
+    {
+        if(InPrologue->EntryPoint + InPrologue->Instructions[Index].Offset == InAddress)
+            break;
+    }
+
+    return Index;
+}
+
+static UCHAR* LhWriteAbsoluteJump(
+            UCHAR* InBuffer,
+            LONGLONG InTarget)
+{
+/*
+Description:
+
+    Writes a jump to the given address without modifying any register
+    and returns the end of the written code.
+*/
+    UCHAR*      pRes = InBuffer;
+    LONGLONG    RelAddr = InTarget - (LONGLONG)(pRes + 5);
+
+#ifdef _M_X64
+    if(RelAddr != (LONG)RelAddr)
+    {
+        // jmp qword ptr [rip+0], followed by the target
+        *(pRes++) = 0xFF;
+        *(pRes++) = 0x25;
+        *((LONG*)pRes) = 0;
+        pRes += 4;
+        *((LONGLONG*)pRes) = InTarget;
+
+        return pRes + 8;
+    }
 #endif
+
+    // jmp imm32
+    *(pRes++) = 0xE9;
+    *((LONG*)pRes) = (LONG)RelAddr;
+
+    return pRes + 4;
 }
 
-EASYHOOK_NT_INTERNAL LhRelocateEntryPoint(
-				UCHAR* InEntryPoint,
-				ULONG InEPSize,
+EASYHOOK_NT_INTERNAL LhRelocatePrologue(
+				LH_DECODED_PROLOGUE* InPrologue,
 				UCHAR* Buffer,
 				ULONG* OutRelocSize)
 {
 /*
 Description:
 
-    Relocates the given entry point into the buffer and finally
+    Relocates the given decoded entry point into the buffer and finally
     stores the relocated size in OutRelocSize.
 
-Parameters:
-
-    - InEntryPoint
+    Relative calls and jumps, including conditional jumps, jcxz and loops,
+    are rewritten to reach their original target from the buffer. Branches
+    into the entry point itself are redirected to the relocated copy of
+    the target instruction.
 
-        The entry point to relocate.
+Parameters:
 
-    - InEPSize
+    - InPrologue
 
-        Size of the given entry point in bytes.
+        The entry point to relocate, as decoded by LhDecodePrologue().
 
     - Buffer
 
-        A buffer receiving the relocated entry point.
-        To ensure that there is always enough space, you should
-        reserve around 100 bytes. After completion this method will
+        A buffer of at least LH_MAX_RELOC_SIZE bytes receiving the
+        relocated entry point. After completion this method will
         store the real size in bytes in "OutRelocSize".
 		Important: all instructions using RIP relative addresses will 
 		be relative to the buffer location in memory.
@@ -336,184 +573,281 @@ Parameters:
 
 Returns:
 
+    STATUS_NOT_SUPPORTED
+
+        The entry point contains a branch that can't be relocated.
 */
 #ifdef _M_X64
     #define POINTER_TYPE    LONGLONG
 #else
     #define POINTER_TYPE    LONG
 #endif
-	UCHAR*				pRes = Buffer;
-	UCHAR*				pOld = InEntryPoint;
-    UCHAR			    b1;
-	UCHAR			    b2;
-	ULONG			    OpcodeLen;
-	POINTER_TYPE   	    AbsAddr;
-	BOOL			    a16 = FALSE;
-	BOOL			    IsRIPRelative;
-    ULONG               InstrLen;
-    NTSTATUS            NtStatus;
+    UCHAR*                      InEntryPoint = InPrologue->EntryPoint;
+    ULONG                       InEPSize = InPrologue->Size;
+    LH_PROLOGUE_INSTRUCTION*    Instr;
+	UCHAR*				        pRes = Buffer;
+	UCHAR*				        pOld;
+    UCHAR*                      pSkip;
+    UCHAR			            b1 = 0;
+	POINTER_TYPE   	            AbsAddr;
+    BOOL                        IsBranch;
+    ULONG                       Index;
+    ULONG                       Target = 0;
+    ULONG                       FixupCount = 0;
+    UCHAR*                      Fixups[LH_MAX_PROLOGUE_INSTRUCTIONS];
+    ULONG                       FixupTargets[LH_MAX_PROLOGUE_INSTRUCTIONS];
+    UCHAR*                      Relocated[LH_MAX_PROLOGUE_INSTRUCTIONS];
+    NTSTATUS                    NtStatus;
 
 	ASSERT(InEPSize < 20,L"reloc.c - InEPSize < 20");
 
-	while(pOld < InEntryPoint + InEPSize)
+	for(Index = 0; Index < InPrologue->Count; Index++)
 	{
-		b1 = *(pOld);
-		b2 = *(pOld + 1);
-		OpcodeLen = 0;
+        Instr = &InPrologue->Instructions[Index];
+        pOld = InEntryPoint + Instr->Offset;
 		AbsAddr = 0;
-		IsRIPRelative = FALSE;
+        IsBranch = FALSE;
 
-		// check for prefixes
-		switch(b1)
-		{
-            case 0x67: // address-size override prefix
-    			// TODO: this implementation does not take into consideration all scenarios
-                //       e.g. http://wiki.osdev.org/X86-64_Instruction_Encoding#Operand-size_and_address-size_override_prefix
-                a16 = TRUE; 
-                // We increment pOld to skip this prefix, pOld is then decremented 
-                // if the instruction is to be copied unchanged.
-				pOld++;
-				continue;
-            /*
-                Don't need to do anything with 0x66 (operand/data-size prefix), we only need to know when an address-size override prefix is present.
-                Instructions with 0x66 generally end up unchanged (except 64-bit rip relative addresses where we only adjust the address anyway)
-            */
-		}
+        Relocated[Index] = pRes;
+
+        if((ULONG)(pRes - Buffer) + LH_MAX_RELOCATED_INSTRUCTION_SIZE > LH_MAX_RELOC_SIZE)
+            THROW(STATUS_NOT_SUPPORTED, L"The relocated entry point would exceed the available space.");
 
 		/////////////////////////////////////////////////////////
-		// get relative address value
-		switch(b1)
+		// compute the absolute target of relative branches
+
+		if(Instr->BranchType != LH_BRANCH_NONE)
 		{
-			case 0xE9: // jmp imm16/imm32
-			{
-				/* only allowed as first instruction and only if the trampoline can be planted 
-				   within a 32-bit boundary around the original entrypoint. So the jumper will 
-				   be only 5 bytes and whereever the underlying code returns it will always
-				   be in a solid state. But this can only be guaranteed if the jump is the first
-				   instruction... */
+            // the opcode byte directly precedes the displacement, see LhDecodeInstruction()
+            b1 = pOld[Instr->Length - Instr->BranchDispSize - 1];
+
+			/* a jmp imm32 is only allowed as first instruction and only if the trampoline can be planted 
+			   within a 32-bit boundary around the original entrypoint. So the jumper will 
+			   be only 5 bytes and whereever the underlying code returns it will always
+			   be in a solid state. But this can only be guaranteed if the jump is the first
+			   instruction... */
 #ifndef _M_X64
-				if(pOld != InEntryPoint)
-					THROW(STATUS_NOT_SUPPORTED, L"Hooking far jumps is only supported if they are the first instruction.");
+			if((b1 == 0xE9) && (pOld != InEntryPoint))
+				THROW(STATUS_NOT_SUPPORTED, L"Hooking far jumps is only supported if they are the first instruction.");
 #endif
-				
-				// ATTENTION: will continue in "case 0xE8"
-			}
-			case 0xE8: // call imm16/imm32
-			{
-				if(a16)
-				{
-					AbsAddr = *((__int16*)(pOld + 1));
-					OpcodeLen = 3;
-				}
-				else
-				{
-					AbsAddr = *((__int32*)(pOld + 1));
-					OpcodeLen = 5;
-				}
-			}break;
-
-        	case 0xEB: // jmp imm8
+
+            switch(Instr->BranchDispSize)
             {
-                AbsAddr = *((__int8*)(pOld + 1));
-                OpcodeLen = 2;
-            }break;
-        /*
-			The problem with (conditional) jumps is that there will be no return into the relocated entry point.
-			So the execution will be proceeded in the original method and this will cause the whole
-			application to remain in an unstable state. Only near jumps with 32-bit offset are allowed as
-			first instruction (see above)...
-		*/
-			case 0xE3: // jcxz imm8
-			{
-				THROW(STATUS_NOT_SUPPORTED, L"Hooking near (conditional) jumps is not supported.");
-			}break;
-			case 0x0F:
-			{
-				if((b2 & 0xF0) == 0x80) // jcc imm16/imm32
-					THROW(STATUS_NOT_SUPPORTED,  L"Hooking far conditional jumps is not supported.");
-			}break;
-		}
+            case 1: AbsAddr = *((__int8*)(pOld + Instr->Length - 1)); break;
+            case 4: AbsAddr = *((__int32*)(pOld + Instr->Length - 4)); break;
+            default:
+                // an operand-size prefix truncates the instruction pointer to 16-bit
+                THROW(STATUS_NOT_SUPPORTED, L"Hooking 16-bit relative branches is not supported.");
+            }
 
-		if((b1 & 0xF0) == 0x70) // jcc imm8
-			THROW(STATUS_NOT_SUPPORTED,  L"Hooking near conditional jumps is not supported.");
+			AbsAddr += (POINTER_TYPE)(pOld + Instr->Length);
+
+            // points into entry point? Then branch to the relocated instruction instead.
+			if((AbsAddr >= (POINTER_TYPE)InEntryPoint) && (AbsAddr < (POINTER_TYPE)InEntryPoint + (POINTER_TYPE)InEPSize))
+            {
+                if((Target = LhFindPrologueInstruction(InPrologue, (UCHAR*)AbsAddr)) == InPrologue->Count)
+				    THROW(STATUS_NOT_SUPPORTED, L"Hooking jumps into the middle of an instruction within the hooked entry point is not supported.");
+
+                IsBranch = TRUE;
+            }
+		}
 
 		/////////////////////////////////////////////////////////
-		// convert to: mov eax, AbsAddr
+		// write relocated code
 
-		if(OpcodeLen > 0)
-		{
-			AbsAddr += (POINTER_TYPE)(pOld + OpcodeLen);
+        if(Instr->BranchType == LH_BRANCH_NONE)
+        {
+#ifdef _M_X64
+		    if(Instr->IsRIPRelative)
+		    {
+                // relocate the RIP displacement found while decoding
+                FORCE(LhRelocateRIPDisplacement(pOld, Instr, pRes));
+		    }
+            else
+#endif
+            {
+			    // just copy the instruction
+			    RtlCopyMemory(pRes, pOld, Instr->Length);
+            }
+
+			pRes += Instr->Length;
+        }
+        else if((Instr->BranchType == LH_BRANCH_CALL) || (Instr->BranchType == LH_BRANCH_JMP))
+        {
+            if(IsBranch)
+            {
+                // call/jmp imm32 to the relocated instruction
+                *(pRes++) = (b1 == 0xE8) ? 0xE8 : 0xE9;
+
+                Fixups[FixupCount] = pRes;
+                FixupTargets[FixupCount++] = Target;
 
+                pRes += 4;
+            }
+            else
+            {
+                // convert to: mov eax, AbsAddr
 #ifdef _M_X64
-			*(pRes++) = 0x48; // REX.W-Prefix
+			    *(pRes++) = 0x48; // REX.W-Prefix
 #endif
-			*(pRes++) = 0xB8;               // mov eax,
-			*((LONGLONG*)pRes) = AbsAddr;   //          address
-
-			pRes += sizeof(void*);
-
-			// points into entry point?
-			if((AbsAddr >= (LONGLONG)InEntryPoint) && (AbsAddr < (LONGLONG)InEntryPoint + InEPSize))
-				/* is not really unhookable but not worth the effort... */
-				THROW(STATUS_NOT_SUPPORTED, L"Hooking jumps into the hooked entry point is not supported.");
-
-			/////////////////////////////////////////////////////////
-			// insert alternate code
-			switch(b1)
-			{
-			case 0xE8: // call eax
-				{
-					*(pRes++) = 0xFF;
-					*(pRes++) = 0xD0;
-				}break;
-			case 0xE9: // jmp eax
-            case 0xEB: // jmp imm8
-				{
-					*(pRes++) = 0xFF;
-					*(pRes++) = 0xE0;
-				}break;
-			}
-
-			/* such conversions shouldnt be necessary in general...
-			   maybe the method was already hooked or uses some hook protection or is just
-			   bad programmed. EasyHook is capable of hooking the same method
-			   many times simultanously. Even if other (unknown) hook libraries are hooking methods that
-			   are already hooked by EasyHook. Only if EasyHook hooks methods that are already
-			   hooked with other libraries there can be problems if the other libraries are not
-			   capable of such a "bad" circumstance.
-			*/
-
-			*OutRelocSize = (ULONG)(pRes - Buffer);
-		}
-		else
-		{
-            // Check for RIP relative instructions and relocate
-            FORCE(LhRelocateRIPRelativeInstruction((ULONGLONG)pOld, (ULONGLONG)pRes, &IsRIPRelative));
-		}
+			    *(pRes++) = 0xB8;               // mov eax,
+			    *((LONGLONG*)pRes) = AbsAddr;   //          address
+
+			    pRes += sizeof(void*);
+
+			    /////////////////////////////////////////////////////////
+			    // insert alternate code
+			    switch(b1)
+			    {
+			    case 0xE8: // call eax
+				    {
+					    *(pRes++) = 0xFF;
+					    *(pRes++) = 0xD0;
+				    }break;
+			    case 0xE9: // jmp eax
+                case 0xEB: // jmp imm8
+				    {
+					    *(pRes++) = 0xFF;
+					    *(pRes++) = 0xE0;
+				    }break;
+			    }
+
+			    /* such conversions shouldnt be necessary in general...
+			       maybe the method was already hooked or uses some hook protection or is just
+			       bad programmed. EasyHook is capable of hooking the same method
+			       many times simultanously. Even if other (unknown) hook libraries are hooking methods that
+			       are already hooked by EasyHook. Only if EasyHook hooks methods that are already
+			       hooked with other libraries there can be problems if the other libraries are not
+			       capable of such a "bad" circumstance.
+			    */
+            }
+        }
+        else if(Instr->BranchType == LH_BRANCH_LOOP)
+        {
+            /*
+                loop/jcxz only exist with an 8-bit displacement, so they skip over
+                a jump to their target:
 
-		// If 16-bit address-prefix override, move pointer back to start of instruction
-		if (a16) pOld--;
+                    [67] E? 02      loop/jcxz taken
+                    EB ??           jmp not taken
+                    ...             jmp target
+            */
+            if(Instr->HasAddressPrefix)
+                *(pRes++) = 0x67;
 
-		// find next instruction
-		FORCE(InstrLen = LhGetInstructionLength(pOld));
+            *(pRes++) = b1;
+            *(pRes++) = 0x02;
+            *(pRes++) = 0xEB;
 
-		if(OpcodeLen == 0)
-		{
-			// just copy the instruction
-			if(!IsRIPRelative)
-				RtlCopyMemory(pRes, pOld, InstrLen);
+            pSkip = pRes++;
 
-			pRes += InstrLen;
-		}
+            if(IsBranch)
+            {
+                *(pRes++) = 0xE9;
 
-		pOld += InstrLen;
-		IsRIPRelative = FALSE;
-		a16 = FALSE;
+                Fixups[FixupCount] = pRes;
+                FixupTargets[FixupCount++] = Target;
+
+                pRes += 4;
+            }
+            else
+                pRes = LhWriteAbsoluteJump(pRes, AbsAddr);
+
+            *pSkip = (UCHAR)(pRes - pSkip - 1);
+        }
+        else
+        {
+            // conditional jump, the condition is the low nibble of 0x7? and 0x0F 0x8?
+            b1 &= 0x0F;
+
+            if(IsBranch)
+            {
+                // jcc imm32 to the relocated instruction
+                *(pRes++) = 0x0F;
+                *(pRes++) = 0x80 | b1;
+
+                Fixups[FixupCount] = pRes;
+                FixupTargets[FixupCount++] = Target;
+
+                pRes += 4;
+            }
+            else if(AbsAddr - (POINTER_TYPE)(pRes + 6) == (LONG)(AbsAddr - (POINTER_TYPE)(pRes + 6)))
+            {
+                // jcc imm32
+                *(pRes++) = 0x0F;
+                *(pRes++) = 0x80 | b1;
+                *((LONG*)pRes) = (LONG)(AbsAddr - (POINTER_TYPE)(pRes + 4));
+
+                pRes += 4;
+            }
+            else
+            {
+                // inverted jcc imm8 skipping an absolute jump to the target
+                *(pRes++) = 0x70 | (b1 ^ 1);
+
+                pSkip = pRes++;
+                pRes = LhWriteAbsoluteJump(pRes, AbsAddr);
+
+                *pSkip = (UCHAR)(pRes - pSkip - 1);
+            }
+        }
 	}
 
+    // now all relocated instructions are known
+    for(Index = 0; Index < FixupCount; Index++)
+    {
+        *((LONG*)Fixups[Index]) = (LONG)(Relocated[FixupTargets[Index]] - (Fixups[Index] + 4));
+    }
+
 	*OutRelocSize = (ULONG)(pRes - Buffer);
 
-	RETURN(STATUS_SUCCESS);
+	RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    return NtStatus;
+}
+
+EASYHOOK_NT_INTERNAL LhRelocateEntryPoint(
+				UCHAR* InEntryPoint,
+				ULONG InEPSize,
+				UCHAR* Buffer,
+				ULONG* OutRelocSize)
+{
+/*
+Description:
+
+    Relocates the given entry point into the buffer and finally
+    stores the relocated size in OutRelocSize. If the entry point
+    was already decoded, use LhRelocatePrologue() instead.
+
+Parameters:
+
+    - InEntryPoint
+
+        The entry point to relocate.
+
+    - InEPSize
+
+        Size of the given entry point in bytes.
+
+    - Buffer
+
+        A buffer receiving the relocated entry point, see
+        LhRelocatePrologue().
+
+    - OutRelocSize
+
+        Receives the size of the relocated entry point in bytes.
+*/
+    LH_DECODED_PROLOGUE     Prologue;
+    NTSTATUS                NtStatus;
+
+    FORCE(LhDecodePrologue(InEntryPoint, InEPSize, &Prologue));
+
+    FORCE(LhRelocatePrologue(&Prologue, Buffer, OutRelocSize));
+
+    RETURN;
 
 THROW_OUTRO:
 FINALLY_OUTRO:
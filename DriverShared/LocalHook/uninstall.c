@@ -44,8 +44,6 @@ Parameters:
         will still return STATUS_SUCCESS.
 */
     LOCAL_HOOK_INFO*        Hook = NULL;
-    LOCAL_HOOK_INFO*        List;
-    LOCAL_HOOK_INFO*        Prev;
     NTSTATUS                NtStatus;
     BOOLEAN                 IsAllocated = FALSE;
 
@@ -74,20 +72,7 @@ Parameters:
         }
 
         // remove from global list
-        List = GlobalHookListHead.Next;
-        Prev = &GlobalHookListHead;
-
-        while(List != NULL)
-        {
-            if(List == Hook)
-            {
-                Prev->Next = Hook->Next;
-
-                break;
-            }
-
-            List = List->Next;
-        }
+        LhUnlinkHook(Hook);
 
         // add to removal list
         Hook->Next = GlobalRemovalListHead.Next;
@@ -95,7 +80,7 @@ Parameters:
     }
     RtlReleaseLock(&GlobalHookLock);
 
-    RETURN(STATUS_SUCCESS);
+    RETURN;
 
 //THROW_OUTRO:
 FINALLY_OUTRO:
@@ -137,6 +122,7 @@ Description:
 
             // add to removal list
             Hook->HookProc = NULL;
+            Hook->Prev = NULL;
             Hook->Next = GlobalRemovalListHead.Next;
 
             GlobalRemovalListHead.Next = Hook;
@@ -146,7 +132,7 @@ Description:
     }
     RtlReleaseLock(&GlobalHookLock);
 
-    RETURN(STATUS_SUCCESS);
+    RETURN;
 
 FINALLY_OUTRO:
     return NtStatus;
@@ -157,93 +143,355 @@ FINALLY_OUTRO:
 
 
 
-EASYHOOK_NT_EXPORT LhWaitForPendingRemovals()
+/*
+    The execution counter of a hook covers its trampoline from the increment
+    on until the handler returned. It does not cover a thread that passed the
+    restored jumper but did not yet increment the counter, or a thread that
+    executes the relocated entry point, reached either directly or by the
+    handler calling the original method.
+
+    Within the DLL, a retired hook with a zero counter is therefore only
+    released if, with all other threads suspended, the counter is still zero
+    and no thread executes within the hook memory. The driver can't suspend
+    threads. There a hook is released after its counter was seen zero in two
+    sweeps at least LH_RECLAIM_GRACE_PERIOD milliseconds apart. This is only
+    safe as long as no thread is preempted for that long within the first
+    instructions of the trampoline or the relocated entry point.
+
+    Neither covers a return address into the relocated entry point, which
+    a call within the entry point leaves on the stack. Such hooks are pinned:
+    their slot is released, but their memory is kept until unload.
+*/
+#define LH_RECLAIM_GRACE_PERIOD         20
+#define LH_RECLAIM_SWEEP_INTERVAL       5
+#define LH_RECLAIM_TIMEOUT              1000
+
+// released hooks whose memory is kept until unload, protected by GlobalHookLock
+static LOCAL_HOOK_INFO*         GlobalPinnedList = NULL;
+
+static BOOL LhRestoreEntryPoint(LOCAL_HOOK_INFO* InHook)
 {
 /*
-Descriptions:
+Description:
 
-    For stability reasons, all resources associated with a hook
-    have to be released if no thread is currently executing the
-    handler. Separating this wait loop from the uninstallation
-    method is a great performance gain, because you can release
-    all hooks first, and then wait for all removals simultaneously.
+    Writes back the original entry point bytes, if the jumper
+    was not overwritten by someone else.
+
+Returns:
 
+    FALSE if the hook was changed and its resources can't be released.
 */
-    PLOCAL_HOOK_INFO        Hook;
-    NTSTATUS                NtStatus = STATUS_SUCCESS;
-    INT32                  Timeout = 1000;
 #ifdef X64_DRIVER
     KIRQL                  CurrentIRQL = PASSIVE_LEVEL;
 #endif
 
-#pragma warning(disable: 4127)
-    while(TRUE)
-#pragma warning(default: 4127)
+    if(InHook->HookCopy != *((ULONGLONG*)InHook->TargetProc))
+        return FALSE;
+
+#ifdef X64_DRIVER
+    CurrentIRQL = KeGetCurrentIrql();
+    RtlWPOff();
+#endif
+    *((ULONGLONG*)InHook->TargetProc) = InHook->TargetBackup;
+#ifdef X64_DRIVER
+    // we support a trampoline jump of up to 16 bytes in X64_DRIVER
+    *((ULONGLONG*)(InHook->TargetProc + 8)) = InHook->TargetBackup_x64;
+    RtlWPOn(CurrentIRQL);
+#endif
+
+    return TRUE;
+}
+
+
+
+
+static void LhRetirePendingRemovals()
+{
+/*
+Description:
+
+    Takes all hooks of the removal list at once, restores their
+    entry points and moves them to the retired list where they
+    wait for LhReclaimRetiredHooks().
+*/
+    LOCAL_HOOK_INFO*        List;
+    LOCAL_HOOK_INFO*        Hook;
+    LOCAL_HOOK_INFO*        Retired = NULL;
+    LOCAL_HOOK_INFO*        Last = NULL;
+
+    RtlAcquireLock(&GlobalHookLock);
     {
-        // pop from removal list
-        RtlAcquireLock(&GlobalHookLock);
+        List = GlobalRemovalListHead.Next;
+
+        GlobalRemovalListHead.Next = NULL;
+    }
+    RtlReleaseLock(&GlobalHookLock);
+
+    while(List != NULL)
+    {
+        Hook = List;
+        List = List->Next;
+
+        if(!LhRestoreEntryPoint(Hook))
         {
-            Hook = GlobalRemovalListHead.Next;
-            
-            if(Hook == NULL)
-            {
-                RtlReleaseLock(&GlobalHookLock);
+            // hook was changed... no chance to release resources
+            continue;
+        }
 
-                break;
-            }
+        Hook->IsQuiescent = FALSE;
+        Hook->Next = Retired;
+
+        if(Retired == NULL)
+            Last = Hook;
+
+        Retired = Hook;
+    }
+
+    if(Retired == NULL)
+        return;
+
+    RtlAcquireLock(&GlobalHookLock);
+    {
+        Last->Next = GlobalRetiredListHead.Next;
+        GlobalRetiredListHead.Next = Retired;
+    }
+    RtlReleaseLock(&GlobalHookLock);
+}
+
+
+
+
+ULONG LhReclaimRetiredHooks()
+{
+/*
+Description:
+
+    Releases all retired hooks that became quiescent. The list is
+    detached under the lock and checked outside, so concurrent sweeps
+    never look at the same hook.
+
+Returns:
+
+    The count of hooks still waiting for release.
+*/
+    LOCAL_HOOK_INFO*        List;
+    LOCAL_HOOK_INFO*        Hook;
+    LOCAL_HOOK_INFO*        Busy = NULL;
+    LOCAL_HOOK_INFO*        BusyLast = NULL;
+    LOCAL_HOOK_INFO*        Free = NULL;
+    LOCAL_HOOK_INFO*        Pinned = NULL;
+    LOCAL_HOOK_INFO*        PinnedLast = NULL;
+    ULONG                   BusyCount = 0;
+#ifdef DRIVER
+    ULONG                   Now;
+#else
+    LOCAL_HOOK_INFO*        Candidates = NULL;
+    LH_SUSPENDED_THREADS    Threads;
+    BOOL                    IsSuspended;
+#endif
+
+    // cheap check, most calls will find nothing to do
+    if(GlobalRetiredListHead.Next == NULL)
+        return 0;
 
-            GlobalRemovalListHead.Next = Hook->Next;
+    RtlAcquireLock(&GlobalHookLock);
+    {
+        List = GlobalRetiredListHead.Next;
+
+        GlobalRetiredListHead.Next = NULL;
+    }
+    RtlReleaseLock(&GlobalHookLock);
+
+#ifdef DRIVER
+    Now = RtlGetMilliseconds();
+
+    while(List != NULL)
+    {
+        Hook = List;
+        List = List->Next;
+
+        if(*Hook->IsExecutedPtr > 0)
+        {
+            Hook->IsQuiescent = FALSE;
         }
-        RtlReleaseLock(&GlobalHookLock);
+        else if(!Hook->IsQuiescent)
+        {
+            Hook->IsQuiescent = TRUE;
+            Hook->QuiescentSince = Now;
+        }
+        else if(Now - Hook->QuiescentSince >= LH_RECLAIM_GRACE_PERIOD)
+        {
+            Hook->Next = Free;
+            Free = Hook;
 
-        // restore entry point...
-        if(Hook->HookCopy == *((ULONGLONG*)Hook->TargetProc))
+            continue;
+        }
+
+        Hook->Next = Busy;
+
+        if(Busy == NULL)
+            BusyLast = Hook;
+
+        Busy = Hook;
+        BusyCount++;
+    }
+#else
+    // only hooks with a zero counter are worth suspending the other threads
+    while(List != NULL)
+    {
+        Hook = List;
+        List = List->Next;
+
+        if(*Hook->IsExecutedPtr > 0)
         {
-#ifdef X64_DRIVER
-            CurrentIRQL = KeGetCurrentIrql();
-            RtlWPOff();
-#endif
-            *((ULONGLONG*)Hook->TargetProc) = Hook->TargetBackup;
-#ifdef X64_DRIVER
-            // we support a trampoline jump of up to 16 bytes in X64_DRIVER
-            *((ULONGLONG*)(Hook->TargetProc + 8)) = Hook->TargetBackup_x64;
-            RtlWPOn(CurrentIRQL);
+            Hook->Next = Busy;
+
+            if(Busy == NULL)
+                BusyLast = Hook;
+
+            Busy = Hook;
+            BusyCount++;
+        }
+        else
+        {
+            Hook->Next = Candidates;
+            Candidates = Hook;
+        }
+    }
+
+    /*
+        Neither the heap nor any lock may be used until the threads are resumed,
+        the lists are only relinked.
+    */
+    IsSuspended = (Candidates != NULL) && RTL_SUCCESS(LhSuspendOtherThreads(&Threads));
+
+    while(Candidates != NULL)
+    {
+        Hook = Candidates;
+        Candidates = Candidates->Next;
+
+        if(IsSuspended && (*Hook->IsExecutedPtr == 0) && !LhIsThreadWithin(&Threads, Hook, Hook->NativeSize))
+        {
+            Hook->Next = Free;
+            Free = Hook;
+
+            continue;
+        }
+
+        Hook->Next = Busy;
+
+        if(Busy == NULL)
+            BusyLast = Hook;
+
+        Busy = Hook;
+        BusyCount++;
+    }
+
+    if(IsSuspended)
+        LhResumeOtherThreads(&Threads);
 #endif
 
-#pragma warning(disable: 4127)
-            while (TRUE)
-#pragma warning(default: 4127)
-            {
-                if (*Hook->IsExecutedPtr <= 0)
-                {
-                    // release slot
-                    if (GlobalSlotList[Hook->HLSIndex] == Hook->HLSIdent)
-                    {
-                        GlobalSlotList[Hook->HLSIndex] = 0;
-                    }
-
-                    // release memory...
-                    LhFreeMemory(&Hook);
-                    break;
-                }
-
-                if (Timeout <= 0)
-                {
-                    // this hook was not released within timeout or cannot be released.
-                    // We will leak the memory, but not hang forever.
-                    NtStatus = STATUS_TIMEOUT;
-                    break;
-                }
-
-                RtlSleep(25);
-                Timeout -= 25;
-            }
+    // keep the memory of pinned hooks
+    for(Hook = Free, Free = NULL; Hook != NULL; Hook = List)
+    {
+        List = Hook->Next;
+
+        if(Hook->IsPinned)
+        {
+            Hook->Next = Pinned;
+
+            if(Pinned == NULL)
+                PinnedLast = Hook;
+
+            Pinned = Hook;
         }
         else
         {
-            // hook was changed... no chance to release resources
+            Hook->Next = Free;
+            Free = Hook;
+        }
+    }
+
+    // release slots and requeue busy hooks in one pass
+    RtlAcquireLock(&GlobalHookLock);
+    {
+        for(Hook = Free; Hook != NULL; Hook = Hook->Next)
+        {
+            LhReleaseHookSlot(Hook);
+        }
+
+        for(Hook = Pinned; Hook != NULL; Hook = Hook->Next)
+        {
+            LhReleaseHookSlot(Hook);
+        }
+
+        if(Pinned != NULL)
+        {
+            PinnedLast->Next = GlobalPinnedList;
+            GlobalPinnedList = Pinned;
+        }
+
+        if(Busy != NULL)
+        {
+            BusyLast->Next = GlobalRetiredListHead.Next;
+            GlobalRetiredListHead.Next = Busy;
         }
     }
+    RtlReleaseLock(&GlobalHookLock);
+
+    // release memory...
+    while(Free != NULL)
+    {
+        Hook = Free;
+        Free = Free->Next;
+
+        LhFreeMemory(&Hook);
+    }
+
+    return BusyCount;
+}
+
+
+
+
+EASYHOOK_NT_EXPORT LhWaitForPendingRemovals()
+{
+/*
+Descriptions:
+
+    For stability reasons, all resources associated with a hook
+    have to be released if no thread is currently executing the
+    handler. Separating this wait loop from the uninstallation
+    method is a great performance gain, because you can release
+    all hooks first, and then wait for all removals simultaneously.
+
+    All pending entry points are restored first and then the hooks
+    are released together once they are quiescent, see
+    LhReclaimRetiredHooks(). Hooks still in use after the timeout
+    are kept and released by later calls.
+
+Returns:
+
+    STATUS_TIMEOUT if some hooks could not be released yet.
+*/
+    NTSTATUS                NtStatus = STATUS_SUCCESS;
+    INT32                   Timeout = LH_RECLAIM_TIMEOUT;
+
+    LhRetirePendingRemovals();
+
+    while(LhReclaimRetiredHooks() > 0)
+    {
+        if(Timeout <= 0)
+        {
+            // not released within timeout, the next call will try again
+            NtStatus = STATUS_TIMEOUT;
+
+            break;
+        }
+
+        RtlSleep(LH_RECLAIM_SWEEP_INTERVAL);
+        Timeout -= LH_RECLAIM_SWEEP_INTERVAL;
+    }
 
     return NtStatus;
 }
@@ -251,6 +499,55 @@ Descriptions:
 
 
 
+EASYHOOK_NT_EXPORT LhUninstallHooksAsync(
+            TRACED_HOOK_HANDLE* InHandles,
+            ULONG InCount)
+{
+/*
+Description:
+
+    Removes the given hooks like LhUninstallHook() and immediately
+    restores their entry points, but does not wait until their
+    resources can be released. This is done by subsequent calls to
+    this method, LhWaitForPendingRemovals() or the hook installation
+    APIs.
+
+Parameters:
+
+    - InHandles
+
+        The traced hook handles to remove. May be NULL if InCount
+        is zero, in which case only pending removals are processed.
+
+    - InCount
+
+        The count of handles.
+*/
+    ULONG                   Index;
+    NTSTATUS                NtStatus;
+
+    if((InCount > 0) && !IsValidPointer(InHandles, sizeof(TRACED_HOOK_HANDLE) * InCount))
+        THROW(STATUS_INVALID_PARAMETER_1, L"Invalid hook handle list.");
+
+    for(Index = 0; Index < InCount; Index++)
+    {
+        FORCE(LhUninstallHook(InHandles[Index]));
+    }
+
+    LhRetirePendingRemovals();
+
+    LhReclaimRetiredHooks();
+
+    RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    return NtStatus;
+}
+
+
+
+
 void LhCriticalFinalize()
 {
 /*
@@ -259,9 +556,24 @@ Description:
     Will be called in the DLL_PROCESS_DETACH event and just uninstalls
     all hooks. If it is possible also their memory is released. 
 */
+    LOCAL_HOOK_INFO*        Hook;
+
     LhUninstallAllHooks();
 
     LhWaitForPendingRemovals();
 
+    // pinned hooks are only released now, see LhReclaimRetiredHooks()
+    while(GlobalPinnedList != NULL)
+    {
+        Hook = GlobalPinnedList;
+        GlobalPinnedList = GlobalPinnedList->Next;
+
+        LhFreeMemory(&Hook);
+    }
+
 	RtlDeleteLock(&GlobalHookLock);
+
+    LhSlotListFinalize();
+
+    LhAllocatorFinalize();
 }
\ No newline at end of file
@@ -35,7 +35,7 @@ extern "C"{
 #if _DEBUG
     #define DEBUGMSG(...) do { WCHAR debugMsg[1024] = { 0 }; _snwprintf_s(debugMsg, 1024, _TRUNCATE, __VA_ARGS__); OutputDebugStringW(debugMsg); } while(0)
 #else
-    #define DEBUGMSG(__VA_ARGS__) do { } while(0)
+    #define DEBUGMSG(...) do { } while(0)
 #endif
 
 #ifndef DRIVER
@@ -80,6 +80,9 @@ void RtlDeleteLock(RTL_SPIN_LOCK* InLock);
 
 void RtlSleep(ULONG InTimeout);
 
+// a millisecond counter, only meaningful to compute time spans
+ULONG RtlGetMilliseconds();
+
 void* RtlAllocateMemory(
             BOOL InZeroMemory, 
             ULONG InSize);
@@ -93,7 +96,7 @@ void RtlCopyMemory(
             ULONG InByteCount);
 
 #undef RtlMoveMemory
-BOOL RtlMoveMemory(
+void RtlMoveMemory(
             PVOID InDest,
             PVOID InSource,
             ULONG InByteCount);
@@ -117,6 +120,8 @@ void RtlSetLastError(
             LONG InNtStatus,
             WCHAR* InMessage);
 
+WCHAR* RtlErrorCodeToString(LONG InCode);
+
 LONGLONG RtlAnsiHexToLongLong(
 	const CHAR *s, 
 	int len);
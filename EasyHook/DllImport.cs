@@ -57,12 +57,35 @@ namespace EasyHook
             IntPtr InCallback,
             IntPtr OutHandle);
 
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhInstallHookEx(
+            IntPtr InEntryPoint,
+            IntPtr InHookProc,
+            IntPtr InCallback,
+            Int32 InFlags,
+            IntPtr OutHandle);
+
         [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
         public static extern Int32 LhUninstallHook(IntPtr RefHandle);
 
         [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
         public static extern Int32 LhWaitForPendingRemovals();
 
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhSetMaxHookCount(Int32 InMaxHookCount);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhInstallHooks(
+            [In, Out] NativeAPI.HOOK_INSTALL_ENTRY[] InEntries,
+            Int32 InCount,
+            Boolean InAllOrNothing);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhUninstallHooksAsync(IntPtr[] InHandles, Int32 InCount);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhGetHookStatistics(IntPtr InHandle, out NativeAPI.HOOK_STATISTICS OutStatistics);
+
 
         /*
             Setup the ACLs after hook installation. Please note that every
@@ -250,12 +273,35 @@ namespace EasyHook
             IntPtr InCallback,
             IntPtr OutHandle);
 
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhInstallHookEx(
+            IntPtr InEntryPoint,
+            IntPtr InHookProc,
+            IntPtr InCallback,
+            Int32 InFlags,
+            IntPtr OutHandle);
+
         [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
         public static extern Int32 LhUninstallHook(IntPtr RefHandle);
 
         [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
         public static extern Int32 LhWaitForPendingRemovals();
 
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhSetMaxHookCount(Int32 InMaxHookCount);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhInstallHooks(
+            [In, Out] NativeAPI.HOOK_INSTALL_ENTRY[] InEntries,
+            Int32 InCount,
+            Boolean InAllOrNothing);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhUninstallHooksAsync(IntPtr[] InHandles, Int32 InCount);
+
+        [DllImport(DllName, CallingConvention = CallingConvention.StdCall)]
+        public static extern Int32 LhGetHookStatistics(IntPtr InHandle, out NativeAPI.HOOK_STATISTICS OutStatistics);
+
 
         /*
             Setup the ACLs after hook installation. Please note that every
@@ -423,7 +469,40 @@ namespace EasyHook
     public static class NativeAPI
     {
         public const Int32 MAX_HOOK_COUNT = 1024;
+        public const Int32 MAX_PINNED_HOOK_COUNT = 4096;
+        [Obsolete("ACLs are no longer limited to this count but to 0x100000 IDs.")]
         public const Int32 MAX_ACE_COUNT = 128;
+        public const Int32 EASYHOOK_HOOK_DEFAULT = 0x00000000;
+        public const Int32 EASYHOOK_HOOK_FAST_TRAMPOLINE = 0x00000001;
+        public const Int32 EASYHOOK_HOOK_STATISTICS = 0x00000002;
+        public const Int32 EASYHOOK_HOOK_NO_LOADER_LOCK_CHECK = 0x00000004;
+
+        public const Int32 HOOK_BYPASS_LOADER_LOCK = 0;
+        public const Int32 HOOK_BYPASS_SELF_PROTECTION = 1;
+        public const Int32 HOOK_BYPASS_RECURSION = 2;
+        public const Int32 HOOK_BYPASS_ACL = 3;
+        public const Int32 HOOK_BYPASS_RESOURCES = 4;
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct HOOK_STATISTICS
+        {
+            public UInt64 CallCount;
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 5)]
+            public UInt64[] BypassCount;
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 32)]
+            public UInt64[] LatencyHistogram;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct HOOK_INSTALL_ENTRY
+        {
+            public IntPtr EntryPoint;
+            public IntPtr HookProc;
+            public IntPtr Callback;
+            public Int32 Flags;
+            public IntPtr Handle;
+            public Int32 Status;
+        }
         public readonly static Boolean Is64Bit = IntPtr.Size == 8;
 
         [DllImport("kernel32.dll")]
@@ -523,6 +602,17 @@ namespace EasyHook
             else Force( NativeAPI_x86.LhInstallHook(InEntryPoint, InHookProc, InCallback, OutHandle));
         }
 
+        public static void LhInstallHookEx(
+            IntPtr InEntryPoint,
+            IntPtr InHookProc,
+            IntPtr InCallback,
+            Int32 InFlags,
+            IntPtr OutHandle)
+        {
+            if (Is64Bit) Force(NativeAPI_x64.LhInstallHookEx(InEntryPoint, InHookProc, InCallback, InFlags, OutHandle));
+            else Force(NativeAPI_x86.LhInstallHookEx(InEntryPoint, InHookProc, InCallback, InFlags, OutHandle));
+        }
+
         public static void LhUninstallHook(IntPtr RefHandle)
         {
             if (Is64Bit) Force( NativeAPI_x64.LhUninstallHook(RefHandle));
@@ -535,6 +625,41 @@ namespace EasyHook
             else Force( NativeAPI_x86.LhWaitForPendingRemovals());
         }
 
+        public static void LhSetMaxHookCount(Int32 InMaxHookCount)
+        {
+            if (Is64Bit) Force(NativeAPI_x64.LhSetMaxHookCount(InMaxHookCount));
+            else Force(NativeAPI_x86.LhSetMaxHookCount(InMaxHookCount));
+        }
+
+        public static void LhInstallHooks(
+            HOOK_INSTALL_ENTRY[] InEntries,
+            Boolean InAllOrNothing)
+        {
+            Int32 count = (InEntries == null) ? 0 : InEntries.Length;
+
+            // on failure, the entries still report the status of each hook
+            if (Is64Bit) Force(NativeAPI_x64.LhInstallHooks(InEntries, count, InAllOrNothing));
+            else Force(NativeAPI_x86.LhInstallHooks(InEntries, count, InAllOrNothing));
+        }
+
+        public static void LhUninstallHooksAsync(IntPtr[] InHandles)
+        {
+            Int32 count = (InHandles == null) ? 0 : InHandles.Length;
+
+            if (Is64Bit) Force(NativeAPI_x64.LhUninstallHooksAsync(InHandles, count));
+            else Force(NativeAPI_x86.LhUninstallHooksAsync(InHandles, count));
+        }
+
+        public static HOOK_STATISTICS LhGetHookStatistics(IntPtr InHandle)
+        {
+            HOOK_STATISTICS Result;
+
+            if (Is64Bit) Force(NativeAPI_x64.LhGetHookStatistics(InHandle, out Result));
+            else Force(NativeAPI_x86.LhGetHookStatistics(InHandle, out Result));
+
+            return Result;
+        }
+
         public static void LhIsThreadIntercepted(
                     IntPtr InHandle,
                     Int32 InThreadID,
@@ -52,14 +52,14 @@ Parameters:
 
     - InThreadCount
         The count of entries listed in the thread ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 */
 
     ULONG           Index;
 
     ASSERT(IsValidPointer(InAcl, sizeof(HOOK_ACL)),L"acl.c - IsValidPointer(InAcl, sizeof(HOOK_ACL))");
 
-    if(InThreadCount > MAX_ACE_COUNT)
+    if(InThreadCount > LH_MAX_ACL_COUNT)
         return STATUS_INVALID_PARAMETER_2;
 
     if(!IsValidPointer(InThreadIdList, InThreadCount * sizeof(ULONG)))
@@ -71,13 +71,8 @@ Parameters:
             InThreadIdList[Index] = GetCurrentThreadId();
     }
 
-    // set ACL...
-    InAcl->IsExclusive = InIsExclusive;
-    InAcl->Count = InThreadCount;
-
-    RtlCopyMemory(InAcl->Entries, InThreadIdList, InThreadCount * sizeof(ULONG));
-
-    return STATUS_SUCCESS;
+    // compile and publish ACL...
+    return LhUpdateACL(InAcl, InIsExclusive, InThreadIdList, InThreadCount);
 }
 
 EASYHOOK_NT_EXPORT LhSetInclusiveACL(
@@ -100,7 +95,7 @@ Parameters:
 
     - InThreadCount
         The count of entries listed in the thread ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 
     - InHandle
         The hook handle whose local ACL is going to be set.
@@ -130,7 +125,7 @@ Parameters:
 
     - InThreadCount
         The count of entries listed in the thread ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 
     - InHandle
         The hook handle whose local ACL is going to be set.
@@ -159,7 +154,7 @@ Parameters:
 
     - InThreadCount
         The count of entries listed in the thread ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 */
     return LhSetACL(LhBarrierGetAcl(), FALSE, InThreadIdList, InThreadCount);
 }
@@ -180,7 +175,7 @@ Parameters:
 
     - InThreadCount
         The count of entries listed in the thread ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 */
     return LhSetACL(LhBarrierGetAcl(), TRUE, InThreadIdList, InThreadCount);
 }
\ No newline at end of file
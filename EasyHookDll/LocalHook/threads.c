@@ -0,0 +1,224 @@
+// EasyHook (File: EasyHookDll\LocalHook\threads.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "stdafx.h"
+
+/*
+    While other threads are suspended, the heap and any lock they might own
+    must not be touched. So all memory is allocated before the first thread
+    is suspended and released after all threads were resumed.
+
+    Only one thread at a time may suspend the others. Two threads doing so
+    at once could suspend each other and never be resumed.
+*/
+static volatile LONG        IsSuspending = FALSE;
+
+NTSTATUS LhSuspendOtherThreads(LH_SUSPENDED_THREADS* OutThreads)
+{
+/*
+Description:
+
+    Suspends all other threads of the current process and captures
+    their instruction pointers. Threads created after the snapshot
+    was taken keep running. Every successful call has to be followed
+    by LhResumeOtherThreads().
+
+Parameters:
+
+    - OutThreads
+
+        Receives the suspended threads.
+*/
+    HANDLE              hSnapshot = INVALID_HANDLE_VALUE;
+    THREADENTRY32       Entry;
+    ULONG               Capacity = 0;
+    ULONG               Index;
+    HANDLE              hThread;
+    CONTEXT             Context;
+    NTSTATUS            NtStatus;
+
+    RtlZeroMemory(OutThreads, sizeof(LH_SUSPENDED_THREADS));
+
+    // the current thread might be suspended while waiting, but never owns anything then
+    while(InterlockedCompareExchange(&IsSuspending, TRUE, FALSE) != FALSE)
+    {
+        Sleep(1);
+    }
+
+    if((hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0)) == INVALID_HANDLE_VALUE)
+        THROW(STATUS_INTERNAL_ERROR, L"Unable to enumerate threads.");
+
+    /*
+        Collect the thread IDs first...
+    */
+    Entry.dwSize = sizeof(Entry);
+
+    if(Thread32First(hSnapshot, &Entry))
+    {
+        do
+        {
+            if((Entry.th32OwnerProcessID != GetCurrentProcessId()) || (Entry.th32ThreadID == GetCurrentThreadId()))
+                continue;
+
+            if(OutThreads->Count == Capacity)
+            {
+                LH_SUSPENDED_THREAD*    List;
+
+                Capacity = (Capacity == 0)?64:Capacity * 2;
+
+                if((List = (LH_SUSPENDED_THREAD*)RtlAllocateMemory(TRUE, Capacity * sizeof(LH_SUSPENDED_THREAD))) == NULL)
+                    THROW(STATUS_NO_MEMORY, L"Failed to allocate memory.");
+
+                if(OutThreads->Threads != NULL)
+                {
+                    RtlCopyMemory(List, OutThreads->Threads, OutThreads->Count * sizeof(LH_SUSPENDED_THREAD));
+                    RtlFreeMemory(OutThreads->Threads);
+                }
+
+                OutThreads->Threads = List;
+            }
+
+            OutThreads->Threads[OutThreads->Count++].ThreadId = Entry.th32ThreadID;
+        }while(Thread32Next(hSnapshot, &Entry));
+    }
+
+    CloseHandle(hSnapshot);
+    hSnapshot = INVALID_HANDLE_VALUE;
+
+    /*
+        ... then suspend them without allocating memory. A thread that already
+        exited is skipped, its handle stays NULL.
+    */
+    for(Index = 0; Index < OutThreads->Count; Index++)
+    {
+        if((hThread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT, FALSE, OutThreads->Threads[Index].ThreadId)) == NULL)
+            continue;
+
+        if(SuspendThread(hThread) == (DWORD)-1)
+        {
+            CloseHandle(hThread);
+
+            continue;
+        }
+
+        OutThreads->Threads[Index].hThread = hThread;
+
+        // also waits for the suspension to complete
+        Context.ContextFlags = CONTEXT_CONTROL;
+
+        if(!GetThreadContext(hThread, &Context))
+            continue;
+
+#ifdef _M_X64
+        OutThreads->Threads[Index].IP = (UCHAR*)Context.Rip;
+#else
+        OutThreads->Threads[Index].IP = (UCHAR*)Context.Eip;
+#endif
+        OutThreads->Threads[Index].HasIP = TRUE;
+    }
+
+    RETURN;
+
+THROW_OUTRO:
+    {
+        if(OutThreads->Threads != NULL)
+            RtlFreeMemory(OutThreads->Threads);
+
+        RtlZeroMemory(OutThreads, sizeof(LH_SUSPENDED_THREADS));
+
+        InterlockedExchange(&IsSuspending, FALSE);
+    }
+FINALLY_OUTRO:
+    {
+        if(hSnapshot != INVALID_HANDLE_VALUE)
+            CloseHandle(hSnapshot);
+
+        return NtStatus;
+    }
+}
+
+
+
+
+void LhResumeOtherThreads(LH_SUSPENDED_THREADS* InThreads)
+{
+/*
+Description:
+
+    Resumes all threads suspended by LhSuspendOtherThreads()
+    and releases the list.
+*/
+    ULONG               Index;
+
+    for(Index = 0; Index < InThreads->Count; Index++)
+    {
+        if(InThreads->Threads[Index].hThread == NULL)
+            continue;
+
+        ResumeThread(InThreads->Threads[Index].hThread);
+        CloseHandle(InThreads->Threads[Index].hThread);
+    }
+
+    if(InThreads->Threads != NULL)
+        RtlFreeMemory(InThreads->Threads);
+
+    RtlZeroMemory(InThreads, sizeof(LH_SUSPENDED_THREADS));
+
+    InterlockedExchange(&IsSuspending, FALSE);
+}
+
+
+
+
+BOOL LhIsThreadWithin(
+            LH_SUSPENDED_THREADS* InThreads,
+            void* InStart,
+            ULONG InSize)
+{
+/*
+Description:
+
+    Returns TRUE if a suspended thread is executing within the given range,
+    or if the location of a suspended thread is unknown.
+*/
+    ULONG               Index;
+    UCHAR*              IP;
+
+    for(Index = 0; Index < InThreads->Count; Index++)
+    {
+        if(InThreads->Threads[Index].hThread == NULL)
+            continue;
+
+        if(!InThreads->Threads[Index].HasIP)
+            return TRUE;
+
+        IP = InThreads->Threads[Index].IP;
+
+        if((IP >= (UCHAR*)InStart) && (IP < (UCHAR*)InStart + InSize))
+            return TRUE;
+    }
+
+    return FALSE;
+}
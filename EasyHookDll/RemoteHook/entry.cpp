@@ -401,8 +401,7 @@ Description:
 	GetEnvironmentVariableW(L"PATH", PATH, EnvSize);
 
 	// add library path to environment variable
-	if(!RtlMoveMemory(PATH + DirSize, PATH, (EnvSize - DirSize) * 2))
-        UNMANAGED_ERROR(1);
+	RtlMoveMemory(PATH + DirSize, PATH, (EnvSize - DirSize) * 2);
 
 	RtlCopyMemory(PATH, InInfo->PATH, DirSize * 2);
 
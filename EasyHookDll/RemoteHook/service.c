@@ -134,7 +134,7 @@ Returns:
         THROW(STATUS_INTERNAL_ERROR, L"Unable to start service.");
     }
 
-    RETURN(STATUS_SUCCESS);
+    RETURN;
 
 THROW_OUTRO:
 FINALLY_OUTRO:
@@ -45,7 +45,7 @@ Description:
     if(!TlsSetValue(RhTlsIndex, (LPVOID)(size_t)InThreadID))
         THROW(STATUS_INTERNAL_ERROR, L"Unable to set TLS value.");
 
-    RETURN(STATUS_SUCCESS);
+    RETURN;
 
 THROW_OUTRO:
 FINALLY_OUTRO:
@@ -69,11 +69,11 @@ Description:
 */
 
     NTSTATUS            NtStatus;
-    ULONG               ThreadID = (ULONG)TlsGetValue(RhTlsIndex);
+    ULONG               ThreadID = (ULONG)(size_t)TlsGetValue(RhTlsIndex);
     HANDLE              hThread = NULL;
 
     if(ThreadID == 0)
-        RETURN(STATUS_SUCCESS);
+        RETURN;
     
     if((hThread = OpenThread(THREAD_SUSPEND_RESUME, FALSE, ThreadID)) == NULL)
         THROW(STATUS_INTERNAL_ERROR, L"Unable to open wake up thread.");
@@ -81,7 +81,7 @@ Description:
     if(!ResumeThread(hThread))
         THROW(STATUS_INTERNAL_ERROR, L"Unable to resume process main thread.");
 
-    RETURN(STATUS_SUCCESS);
+    RETURN;
     
 THROW_OUTRO:
 FINALLY_OUTRO:
@@ -136,7 +136,7 @@ Parameters:
 	if(!OpenProcessToken(hProc, TOKEN_READ, OutToken))
 	    THROW(STATUS_INTERNAL_ERROR, L"Unable to query process token.");
 
-	RETURN(STATUS_SUCCESS);
+	RETURN;
 
 THROW_OUTRO:
 FINALLY_OUTRO:
@@ -419,7 +419,7 @@ Parameters:
 
 	*OutResult = IsTarget64Bit;
 
-    RETURN(STATUS_SUCCESS);
+    RETURN;
 
 THROW_OUTRO:
 FINALLY_OUTRO:
@@ -761,7 +761,7 @@ Parameters:
             continue;
         
         if(_stricmp((char*)pImageSectionHeader->Name, ".edata") == 0) {
-            if(!ReadProcessMemory(hProcess, (void*)pImageSectionHeader->VirtualAddress, ExportDirectory, sizeof(IMAGE_EXPORT_DIRECTORY), NULL))
+            if(!ReadProcessMemory(hProcess, (void*)((DWORD_PTR)hRemote + pImageSectionHeader->VirtualAddress), ExportDirectory, sizeof(IMAGE_EXPORT_DIRECTORY), NULL))
                 continue;
             
 			
@@ -834,198 +834,427 @@ Example:
 
 
 
-void * GetRemoteFuncAddress(unsigned long pId, HANDLE hProcess, char* module, char* func) {
+/*
+    Export tables of remote modules are read with a few large reads and their
+    names are sorted once. Many lookups within the same process then only cost
+    a binary search each, forwarded exports are resolved through the same cache.
+*/
+#define REMOTE_EXPORT_MAX_FORWARDS      8
+#define REMOTE_EXPORT_MAX_NAME_SIZE     256
+#define REMOTE_EXPORT_MAX_READ_SIZE     0x01000000
+
+typedef struct _REMOTE_EXPORT_
+{
+    PCHAR                           Name;
+    ULONG                           FunctionRva;
+}REMOTE_EXPORT;
+
+typedef struct _REMOTE_EXPORT_TABLE_
+{
+    struct _REMOTE_EXPORT_TABLE_*   Next;
+    CHAR                            Module[MAX_PATH];
+    UCHAR*                          Base;
+    ULONG                           ExportStart;
+    ULONG                           ExportEnd;
+    UCHAR*                          Directory;
+    ULONG                           OrdinalBase;
+    ULONG                           FunctionCount;
+    DWORD*                          Functions;
+    ULONG                           NameCount;
+    REMOTE_EXPORT*                  Names;
+    ULONG                           BufferCount;
+    void*                           Buffers[4];
+}REMOTE_EXPORT_TABLE;
+
+typedef struct _REMOTE_EXPORT_CACHE_
+{
+    ULONG                           ProcessId;
+    HANDLE                          hProcess;
+    HANDLE                          hSnapshot;
+    REMOTE_EXPORT_TABLE*            Tables;
+}REMOTE_EXPORT_CACHE;
+
+static void RemoteExportCacheInit(
+            REMOTE_EXPORT_CACHE* OutCache,
+            ULONG InProcessId,
+            HANDLE InProcess)
+{
+    memset(OutCache, 0, sizeof(REMOTE_EXPORT_CACHE));
+
+    OutCache->ProcessId = InProcessId;
+    OutCache->hProcess = InProcess;
+}
+
+static void RemoteExportCacheRelease(REMOTE_EXPORT_CACHE* InCache)
+{
+    REMOTE_EXPORT_TABLE*        Table;
+    ULONG                       Index;
+
+    while(InCache->Tables != NULL)
+    {
+        Table = InCache->Tables;
+        InCache->Tables = Table->Next;
+
+        for(Index = 0; Index < Table->BufferCount; Index++)
+        {
+            free(Table->Buffers[Index]);
+        }
+
+        free(Table->Directory);
+        free(Table->Names);
+        free(Table);
+    }
+
+    if((InCache->hSnapshot != NULL) && (InCache->hSnapshot != INVALID_HANDLE_VALUE))
+        CloseHandle(InCache->hSnapshot);
+
+    InCache->hSnapshot = NULL;
+}
+
+static UCHAR* RemoteExportFindModule(
+            REMOTE_EXPORT_CACHE* InCache,
+            char* InModule)
+{
 /*
 Description:
 
-	Get remote function address for the module within the remote process.
+    Like GetRemoteModuleHandle() but takes the module snapshot only once
+    per cache.
+*/
+    MODULEENTRY32       modEntry;
+    char                moduleChar[256];
+    size_t              i;
 
-	This is done by retrieving the exports found within the specified module and
-	finding a match for "func". The export name must exactly match "func".
+    if(InCache->hSnapshot == NULL)
+        InCache->hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, InCache->ProcessId);
 
-Parameters:
+    if(InCache->hSnapshot == INVALID_HANDLE_VALUE)
+        return NULL;
 
-	- pId
-		
-		The Id of the remote process
+    modEntry.dwSize = sizeof(MODULEENTRY32);
 
-	- hProcess
+    if(!Module32First(InCache->hSnapshot, &modEntry))
+        return NULL;
 
-		The handle of the remote process as returned by a call to OpenProcess
+    do
+    {
+        wcstombs_s(&i, moduleChar, 256, modEntry.szModule, _TRUNCATE);
 
-	- module
+        if(!_stricmp(moduleChar, InModule))
+            return (UCHAR*)modEntry.hModule;
 
-		The name of the module that contains the function within the remote process
+        modEntry.dwSize = sizeof(MODULEENTRY32);
+    }
+    while(Module32Next(InCache->hSnapshot, &modEntry));
 
-	- func
+    return NULL;
+}
 
-		The name of the function within the module to find the address for
+static BOOL RemoteExportRead(
+            REMOTE_EXPORT_CACHE* InCache,
+            REMOTE_EXPORT_TABLE* InTable,
+            ULONG InRva,
+            ULONG InSize,
+            void** OutData)
+{
+/*
+Description:
 
-Example:
+    Returns the given part of the remote image. Usually it is located within
+    the already copied export directory, otherwise it is read separately.
+    Every returned block is followed by a zero byte.
+*/
+    UCHAR*              Buffer;
 
-	INT_PTR fAddress = GetRemoteFuncAddress(pId, hProcess, "kernel32.dll", "GetProcAddress");
+    if((InRva >= InTable->ExportStart) && ((ULONGLONG)InRva + InSize <= InTable->ExportEnd))
+    {
+        *OutData = InTable->Directory + (InRva - InTable->ExportStart);
+
+        return TRUE;
+    }
+
+    if((InSize > REMOTE_EXPORT_MAX_READ_SIZE) || (InTable->BufferCount >= ARRAYSIZE(InTable->Buffers)))
+        return FALSE;
+
+    if((Buffer = (UCHAR*)malloc(InSize + 1)) == NULL)
+        return FALSE;
+
+    InTable->Buffers[InTable->BufferCount++] = Buffer;
+
+    Buffer[InSize] = 0;
+
+    if(!ReadProcessMemory(InCache->hProcess, InTable->Base + InRva, Buffer, InSize, NULL))
+        return FALSE;
+
+    *OutData = Buffer;
+
+    return TRUE;
+}
+
+static int __cdecl RemoteExportCompare(const void* InLeft, const void* InRight)
+{
+    return _stricmp(((REMOTE_EXPORT*)InLeft)->Name, ((REMOTE_EXPORT*)InRight)->Name);
+}
+
+static BOOL RemoteExportLoad(
+            REMOTE_EXPORT_CACHE* InCache,
+            REMOTE_EXPORT_TABLE* InTable)
+{
+/*
+Description:
+
+    Copies the export directory of the remote module and builds the sorted
+    name index. The directory usually contains the function, name and ordinal
+    arrays as well as all name strings, so a single read is enough.
 */
-	HMODULE hRemote = GetRemoteModuleHandle(pId, module);
-    IMAGE_DOS_HEADER DosHeader;
-    IMAGE_NT_HEADERS NtHeaders;
-	IMAGE_EXPORT_DIRECTORY EATDirectory;
+    IMAGE_DOS_HEADER            DosHeader;
+    IMAGE_NT_HEADERS            NtHeaders;
+    IMAGE_DATA_DIRECTORY*       ExportData;
+    IMAGE_EXPORT_DIRECTORY*     Exports;
+    DWORD*                      NameRvas;
+    WORD*                       Ordinals;
+    UCHAR*                      NameData;
+    ULONG                       MinNameRva = MAXULONG;
+    ULONG                       MaxNameRva = 0;
+    ULONG                       NameEnd;
+    ULONG                       Index;
+    ULONG                       Count = 0;
+
+    if((InTable->Base = RemoteExportFindModule(InCache, InTable->Module)) == NULL)
+        return FALSE;
 
-    DWORD*    AddressOfFunctions;
-	DWORD*    AddressOfNames;
-	WORD*    AddressOfOrdinals;
+    if(!ReadProcessMemory(InCache->hProcess, InTable->Base, &DosHeader, sizeof(IMAGE_DOS_HEADER), NULL) || (DosHeader.e_magic != IMAGE_DOS_SIGNATURE))
+        return FALSE;
 
-	unsigned int i;
+    if(!ReadProcessMemory(InCache->hProcess, InTable->Base + DosHeader.e_lfanew, &NtHeaders, sizeof(IMAGE_NT_HEADERS), NULL) || (NtHeaders.Signature != IMAGE_NT_SIGNATURE))
+        return FALSE;
 
-	DWORD_PTR dwExportBase;
-	DWORD_PTR dwExportSize;
-	DWORD_PTR dwAddressOfFunction;
-	DWORD_PTR dwAddressOfName;
+    ExportData = &NtHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
 
-	char pszFunctionName[256] = { 0 };
-	char pszRedirectName[256] = { 0 };
-	char pszModuleName[256] = { 0 };
-    char pszFunctionRedi[256] = { 0 };
+    if((ExportData->VirtualAddress == 0) || (ExportData->Size < sizeof(IMAGE_EXPORT_DIRECTORY)) || (ExportData->Size > REMOTE_EXPORT_MAX_READ_SIZE))
+        return FALSE;
 
-    int a = 0;
-	int b = 0;
+    if((InTable->Directory = (UCHAR*)malloc(ExportData->Size + 1)) == NULL)
+        return FALSE;
 
-	WORD OrdinalValue;
+    InTable->Directory[ExportData->Size] = 0;
 
-	DWORD_PTR dwAddressOfRedirectedFunction;
-	DWORD_PTR dwAddressOfRedirectedName;
+    if(!ReadProcessMemory(InCache->hProcess, InTable->Base + ExportData->VirtualAddress, InTable->Directory, ExportData->Size, NULL))
+        return FALSE;
 
-	char pszRedirectedFunctionName[ 256 ] = { 0 };
+    InTable->ExportStart = ExportData->VirtualAddress;
+    InTable->ExportEnd = ExportData->VirtualAddress + ExportData->Size;
 
-	if(!hRemote)
-        return NULL;
-    
-	// Load DOS PE header
-    if(!ReadProcessMemory(hProcess, (void*)hRemote, &DosHeader, sizeof(IMAGE_DOS_HEADER), NULL) || DosHeader.e_magic != IMAGE_DOS_SIGNATURE)
-        return NULL;
+    Exports = (IMAGE_EXPORT_DIRECTORY*)InTable->Directory;
 
-	// Load NT PE headers
-    if(!ReadProcessMemory(hProcess, (void *)((DWORD_PTR)hRemote + DosHeader.e_lfanew), &NtHeaders, sizeof(IMAGE_NT_HEADERS), NULL) || NtHeaders.Signature != IMAGE_NT_SIGNATURE)
-        return NULL;
+    if((Exports->NumberOfFunctions > REMOTE_EXPORT_MAX_READ_SIZE / sizeof(DWORD)) || (Exports->NumberOfNames > REMOTE_EXPORT_MAX_READ_SIZE / sizeof(DWORD)))
+        return FALSE;
 
-    // Load image export directory
-    if(!GetRemoteModuleExportDirectory(hProcess, hRemote, &EATDirectory, DosHeader, NtHeaders))
-        return NULL;
+    if(!RemoteExportRead(InCache, InTable, Exports->AddressOfFunctions, Exports->NumberOfFunctions * sizeof(DWORD), (void**)&InTable->Functions) ||
+            !RemoteExportRead(InCache, InTable, Exports->AddressOfNames, Exports->NumberOfNames * sizeof(DWORD), (void**)&NameRvas) ||
+            !RemoteExportRead(InCache, InTable, Exports->AddressOfNameOrdinals, Exports->NumberOfNames * sizeof(WORD), (void**)&Ordinals))
+        return FALSE;
+
+    InTable->OrdinalBase = Exports->Base;
+    InTable->FunctionCount = Exports->NumberOfFunctions;
+
+    if(Exports->NumberOfNames == 0)
+        return TRUE;
+
+    // all name strings are read as one block
+    for(Index = 0; Index < Exports->NumberOfNames; Index++)
+    {
+        if(NameRvas[Index] < MinNameRva)
+            MinNameRva = NameRvas[Index];
 
-	// Allocate room for all the function information
-    AddressOfFunctions	= (DWORD*)malloc(EATDirectory.NumberOfFunctions * sizeof(DWORD));
-    AddressOfNames      = (DWORD*)malloc(EATDirectory.NumberOfNames * sizeof(DWORD));
-    AddressOfOrdinals   = (WORD*)malloc(EATDirectory.NumberOfNames * sizeof(WORD));
+        if(NameRvas[Index] > MaxNameRva)
+            MaxNameRva = NameRvas[Index];
+    }
+
+    NameEnd = MaxNameRva + REMOTE_EXPORT_MAX_NAME_SIZE;
+
+    if((NameEnd < MaxNameRva) || (NameEnd > NtHeaders.OptionalHeader.SizeOfImage))
+        NameEnd = NtHeaders.OptionalHeader.SizeOfImage;
+
+    if((MaxNameRva >= NameEnd) || (MinNameRva >= NameEnd))
+        return FALSE;
+
+    if(!RemoteExportRead(InCache, InTable, MinNameRva, NameEnd - MinNameRva, (void**)&NameData))
+        return FALSE;
+
+    if((InTable->Names = (REMOTE_EXPORT*)malloc(Exports->NumberOfNames * sizeof(REMOTE_EXPORT))) == NULL)
+        return FALSE;
+
+    for(Index = 0; Index < Exports->NumberOfNames; Index++)
+    {
+        if(Ordinals[Index] >= InTable->FunctionCount)
+            continue;
+
+        InTable->Names[Count].Name = (PCHAR)(NameData + (NameRvas[Index] - MinNameRva));
+        InTable->Names[Count].FunctionRva = InTable->Functions[Ordinals[Index]];
+
+        Count++;
+    }
+
+    qsort(InTable->Names, Count, sizeof(REMOTE_EXPORT), RemoteExportCompare);
 
-	// Read function address locations
-    if(!ReadProcessMemory(hProcess, (void*)((DWORD_PTR)hRemote + (DWORD_PTR)EATDirectory.AddressOfFunctions), AddressOfFunctions, EATDirectory.NumberOfFunctions * sizeof(DWORD), NULL)) {
-        free(AddressOfFunctions);
-        free(AddressOfNames);
-        free(AddressOfOrdinals);
+    InTable->NameCount = Count;
+
+    return TRUE;
+}
+
+static REMOTE_EXPORT_TABLE* RemoteExportGetTable(
+            REMOTE_EXPORT_CACHE* InCache,
+            char* InModule)
+{
+/*
+Description:
+
+    Returns the cached export table of the given module. Modules that
+    can't be found or read are cached with an empty table.
+*/
+    REMOTE_EXPORT_TABLE*        Table;
+
+    for(Table = InCache->Tables; Table != NULL; Table = Table->Next)
+    {
+        if(_stricmp(Table->Module, InModule) == 0)
+            return Table;
+    }
+
+    if((Table = (REMOTE_EXPORT_TABLE*)malloc(sizeof(REMOTE_EXPORT_TABLE))) == NULL)
         return NULL;
+
+    memset(Table, 0, sizeof(REMOTE_EXPORT_TABLE));
+
+    strncpy_s(Table->Module, MAX_PATH, InModule, _TRUNCATE);
+
+    Table->Next = InCache->Tables;
+    InCache->Tables = Table;
+
+    if(!RemoteExportLoad(InCache, Table))
+    {
+        Table->Base = NULL;
+        Table->FunctionCount = 0;
+        Table->NameCount = 0;
     }
 
-	// Read function name locations
-    if(!ReadProcessMemory(hProcess, (void*)((DWORD_PTR)hRemote + (DWORD_PTR)EATDirectory.AddressOfNames), AddressOfNames, EATDirectory.NumberOfNames * sizeof(DWORD), NULL)) {
-        free(AddressOfFunctions);
-        free(AddressOfNames);
-        free(AddressOfOrdinals);
+    return Table;
+}
+
+static void* RemoteExportLookup(
+            REMOTE_EXPORT_CACHE* InCache,
+            char* InModule,
+            char* InFunction,
+            ULONG InDepth)
+{
+/*
+Description:
+
+    Returns the remote address of the given export or NULL. "InFunction"
+    may also be an ordinal in the form "#123", like used by forwarders.
+*/
+    REMOTE_EXPORT_TABLE*        Table;
+    REMOTE_EXPORT               Key;
+    REMOTE_EXPORT*              Export;
+    PCHAR                       Forwarder;
+    PCHAR                       Dot;
+    ULONG                       FunctionRva;
+    ULONG                       Ordinal;
+    CHAR                        Module[MAX_PATH];
+
+    if((Table = RemoteExportGetTable(InCache, InModule)) == NULL)
         return NULL;
+
+    if(InFunction[0] == '#')
+    {
+        Ordinal = (ULONG)strtoul(InFunction + 1, NULL, 10) - Table->OrdinalBase;
+
+        if(Ordinal >= Table->FunctionCount)
+            return NULL;
+
+        FunctionRva = Table->Functions[Ordinal];
+    }
+    else
+    {
+        Key.Name = InFunction;
+
+        if((Export = (REMOTE_EXPORT*)bsearch(&Key, Table->Names, Table->NameCount, sizeof(REMOTE_EXPORT), RemoteExportCompare)) == NULL)
+            return NULL;
+
+        FunctionRva = Export->FunctionRva;
     }
 
-	// Read function name ordinal locations
-    if(!ReadProcessMemory(hProcess, (void*)((DWORD_PTR)hRemote + (DWORD_PTR)EATDirectory.AddressOfNameOrdinals), AddressOfOrdinals, EATDirectory.NumberOfNames * sizeof(WORD), NULL)) {
-        free(AddressOfFunctions);
-        free(AddressOfNames);
-        free(AddressOfOrdinals);
+    if(FunctionRva == 0)
         return NULL;
+
+    // forwarded exports point to a "Module.Function" string within the export directory
+    if((FunctionRva >= Table->ExportStart) && (FunctionRva < Table->ExportEnd))
+    {
+        Forwarder = (PCHAR)(Table->Directory + (FunctionRva - Table->ExportStart));
+
+        if((InDepth >= REMOTE_EXPORT_MAX_FORWARDS) || ((Dot = strchr(Forwarder, '.')) == NULL))
+            return NULL;
+
+        if((ULONG)(Dot - Forwarder) + sizeof(".dll") > MAX_PATH)
+            return NULL;
+
+        strncpy_s(Module, MAX_PATH, Forwarder, (size_t)(Dot - Forwarder));
+        strcat_s(Module, MAX_PATH, ".dll");
+
+        return RemoteExportLookup(InCache, Module, Dot + 1, InDepth + 1);
     }
 
-    dwExportBase = ((DWORD_PTR)hRemote + NtHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress);
-    dwExportSize = (dwExportBase + NtHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size);
+    return Table->Base + FunctionRva;
+}
+
 
-	// Check each name for a match
-    for(i = 0; i < EATDirectory.NumberOfNames; ++i) {
-        dwAddressOfFunction    = (DWORD_PTR)hRemote + AddressOfFunctions[i];
-        dwAddressOfName        = (DWORD_PTR)hRemote + AddressOfNames[i];
 
-		memset(&pszFunctionName, 0, 256);
 
-        if(!ReadProcessMemory(hProcess, (void*)dwAddressOfName, pszFunctionName, 256, NULL))
-            continue;
 
-		// Skip until we find the matching function name
-        if(_stricmp(pszFunctionName, func) != 0)
-            continue;
+void * GetRemoteFuncAddress(unsigned long pId, HANDLE hProcess, char* module, char* func) {
+/*
+Description:
 
-		// Check if address of function is found in another module
-        if(dwAddressOfFunction >= dwExportBase && dwAddressOfFunction <= dwExportSize) {
-            memset(&pszRedirectName, 0, 256);
+	Get remote function address for the module within the remote process.
 
-            if(!ReadProcessMemory(hProcess, (void*)dwAddressOfFunction, pszRedirectName, 256, NULL))
-                continue;
+	This is done by retrieving the exports found within the specified module and
+	finding a match for "func". The export name must exactly match "func".
 
-            memset(&pszModuleName, 0, 256);
-			memset(&pszFunctionRedi, 0, 256);
+    To resolve many functions of the same process, use a REMOTE_EXPORT_CACHE
+    with RemoteExportLookup() instead, so the export tables are only read once.
 
-            a = 0;
-            for(; pszRedirectName[a] != '.'; a++)
-                pszModuleName[a] = pszRedirectName[a];
-            a++;
-            pszModuleName[a] = '\0';
+Parameters:
 
-            b = 0;
-            for(; pszRedirectName[a] != '\0'; a++, b++)
-                pszFunctionRedi[b] = pszRedirectName[a];
-            b++;
-            pszFunctionRedi[b] = '\0';
+	- pId
+		
+		The Id of the remote process
 
-            strcat_s(pszModuleName, 256, ".dll");
+	- hProcess
 
-            free(AddressOfFunctions);
-            free(AddressOfNames);
-            free(AddressOfOrdinals);
+		The handle of the remote process as returned by a call to OpenProcess
 
-            return GetRemoteFuncAddress(pId, hProcess, pszModuleName, pszFunctionRedi);
-        }
+	- module
 
-        OrdinalValue = AddressOfOrdinals[i];
+		The name of the module that contains the function within the remote process
 
-        if (OrdinalValue >= EATDirectory.NumberOfNames)
-        {
-            return NULL;
-        }
+	- func
 
-		// If ordinal doesn't match index retrieve correct address
-        if(OrdinalValue != i) {
-            dwAddressOfRedirectedFunction	= ((DWORD_PTR)hRemote + (DWORD_PTR)AddressOfFunctions[OrdinalValue]);
-            dwAddressOfRedirectedName		= ((DWORD_PTR)hRemote + (DWORD_PTR)AddressOfNames[OrdinalValue]);
+		The name of the function within the module to find the address for
 
-            memset(&pszRedirectedFunctionName, 0, 256);
+Example:
 
-            free(AddressOfFunctions);
-            free(AddressOfNames);
-            free(AddressOfOrdinals);
+	INT_PTR fAddress = GetRemoteFuncAddress(pId, hProcess, "kernel32.dll", "GetProcAddress");
+*/
+    REMOTE_EXPORT_CACHE     Cache;
+    void*                   Result;
 
-            if(!ReadProcessMemory(hProcess, (void*)dwAddressOfRedirectedName, pszRedirectedFunctionName, 256, NULL))
-                return NULL;
-            else
-                return (void*)dwAddressOfRedirectedFunction;
-        }
-		// Otherwise return the address
-        else {
-            free(AddressOfFunctions);
-            free(AddressOfNames);
-            free(AddressOfOrdinals);
+    RemoteExportCacheInit(&Cache, pId, hProcess);
 
-            return (void*)dwAddressOfFunction;
-        }
-    }
+    Result = RemoteExportLookup(&Cache, module, func, 0);
 
-    free(AddressOfFunctions);
-    free(AddressOfNames);
-    free(AddressOfOrdinals);
+    RemoteExportCacheRelease(&Cache);
 
-    return NULL;
+    return Result;
 }
 
 
@@ -1139,6 +1368,7 @@ Returns:
     NTSTATUS				NtStatus;
     LONGLONG                Diff;
     HANDLE                  Handles[2];
+    REMOTE_EXPORT_CACHE     ExportCache;
 
     ULONG                   UserLibrarySize;
     ULONG                   PATHSize;
@@ -1240,13 +1470,17 @@ Returns:
 	FORCE(NtForceLdrInitializeThunk(hProc));
 
 	// Determine function addresses within remote process
-    Info->LoadLibraryW   = (PVOID)GetRemoteFuncAddress(InTargetPID, hProc, "kernel32.dll", "LoadLibraryW");
-	Info->FreeLibrary    = (PVOID)GetRemoteFuncAddress(InTargetPID, hProc, "kernel32.dll", "FreeLibrary");
-	Info->GetProcAddress = (PVOID)GetRemoteFuncAddress(InTargetPID, hProc, "kernel32.dll", "GetProcAddress");
-	Info->VirtualFree    = (PVOID)GetRemoteFuncAddress(InTargetPID, hProc, "kernel32.dll", "VirtualFree");
-	Info->VirtualProtect = (PVOID)GetRemoteFuncAddress(InTargetPID, hProc, "kernel32.dll", "VirtualProtect");
-	Info->ExitThread     = (PVOID)GetRemoteFuncAddress(InTargetPID, hProc, "kernel32.dll", "ExitThread");
-	Info->GetLastError   = (PVOID)GetRemoteFuncAddress(InTargetPID, hProc, "kernel32.dll", "GetLastError");
+    RemoteExportCacheInit(&ExportCache, InTargetPID, hProc);
+
+    Info->LoadLibraryW   = (PVOID)RemoteExportLookup(&ExportCache, "kernel32.dll", "LoadLibraryW", 0);
+	Info->FreeLibrary    = (PVOID)RemoteExportLookup(&ExportCache, "kernel32.dll", "FreeLibrary", 0);
+	Info->GetProcAddress = (PVOID)RemoteExportLookup(&ExportCache, "kernel32.dll", "GetProcAddress", 0);
+	Info->VirtualFree    = (PVOID)RemoteExportLookup(&ExportCache, "kernel32.dll", "VirtualFree", 0);
+	Info->VirtualProtect = (PVOID)RemoteExportLookup(&ExportCache, "kernel32.dll", "VirtualProtect", 0);
+	Info->ExitThread     = (PVOID)RemoteExportLookup(&ExportCache, "kernel32.dll", "ExitThread", 0);
+	Info->GetLastError   = (PVOID)RemoteExportLookup(&ExportCache, "kernel32.dll", "GetLastError", 0);
+
+    RemoteExportCacheRelease(&ExportCache);
 
     Info->WakeUpThreadID = InWakeUpTID;
     Info->IsManaged = InInjectionOptions & EASYHOOK_INJECT_MANAGED;
@@ -1474,437 +1708,600 @@ ULONG GetInjectionSize()
 
 
 
-EASYHOOK_NT_EXPORT TestFuncHooks(ULONG pId, 
-        PCHAR module,
-        TEST_FUNC_HOOKS_OPTIONS options,
-        TEST_FUNC_HOOKS_RESULT** outResults,
-        int* resultCount)
-{
-/*
-Description:
+/*/////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////// TestFuncHooks support
+///////////////////////////////////////////////////////////////////////////////////////
 
-    Tests whether it is possible to hook DLL exports found within the specified module.
+Results are produced one at a time into a TEST_FUNC_RESULT_BUFFER and then
+appended to a TEST_FUNC_BUILDER. The builder keeps strings compacted in one
+growing buffer and finally moves all results and strings into a single
+allocation, which is released by ReleaseTestFuncHookResults().
+*/
+#define TEST_FUNC_NAME_SIZE             MAX_PATH
+#define TEST_FUNC_TEXT_SIZE             1024
 
-Parameters:
+typedef struct _TEST_FUNC_RESULT_BUFFER_
+{
+    TEST_FUNC_HOOKS_RESULT      Result;
+    CHAR                        FnName[TEST_FUNC_NAME_SIZE];
+    CHAR                        ModuleRedirect[TEST_FUNC_NAME_SIZE];
+    CHAR                        FnRedirect[TEST_FUNC_NAME_SIZE];
+    CHAR                        EntryDisasm[TEST_FUNC_TEXT_SIZE];
+    CHAR                        RelocDisasm[TEST_FUNC_TEXT_SIZE];
+    CHAR                        Error[TEST_FUNC_TEXT_SIZE];
+}TEST_FUNC_RESULT_BUFFER;
+
+typedef struct _TEST_FUNC_BUILDER_
+{
+    TEST_FUNC_HOOKS_RESULT*     Results;
+    ULONG                       Count;
+    ULONG                       Capacity;
+    CHAR*                       Strings;
+    ULONG                       StringSize;
+    ULONG                       StringCapacity;
+    BOOL                        IsOutOfMemory;
+}TEST_FUNC_BUILDER;
+
+static void TestFuncResultReset(TEST_FUNC_RESULT_BUFFER* InBuffer)
+{
+    InBuffer->Result.FnName = InBuffer->FnName;
+    InBuffer->Result.ModuleRedirect = InBuffer->ModuleRedirect;
+    InBuffer->Result.FnRedirect = InBuffer->FnRedirect;
+    InBuffer->Result.FnAddress = NULL;
+    InBuffer->Result.RelocAddress = NULL;
+    InBuffer->Result.EntryDisasm = InBuffer->EntryDisasm;
+    InBuffer->Result.RelocDisasm = InBuffer->RelocDisasm;
+    InBuffer->Result.Error = InBuffer->Error;
+
+    InBuffer->FnName[0] = 0;
+    InBuffer->ModuleRedirect[0] = 0;
+    InBuffer->FnRedirect[0] = 0;
+    InBuffer->EntryDisasm[0] = 0;
+    InBuffer->RelocDisasm[0] = 0;
+    InBuffer->Error[0] = 0;
+}
 
-    - pId
+static void TestFuncBuilderInit(TEST_FUNC_BUILDER* OutBuilder)
+{
+    memset(OutBuilder, 0, sizeof(TEST_FUNC_BUILDER));
 
-        The process Id to test.
-    
-    - module
+    // offset zero is a shared empty string
+    OutBuilder->StringSize = 1;
+}
 
-        The name of the module to look for exports within.
+static void TestFuncBuilderRelease(TEST_FUNC_BUILDER* InBuilder)
+{
+    free(InBuilder->Results);
+    free(InBuilder->Strings);
 
-    - options
+    TestFuncBuilderInit(InBuilder);
+}
 
-        Optionally specifies whether to output the results to a text file, or
-        the name of a single export to test.
+static BOOL TestFuncBuilderReserve(
+        TEST_FUNC_BUILDER* InBuilder,
+        ULONG InCapacity)
+{
+    TEST_FUNC_HOOKS_RESULT*     Results;
 
-    - outResults
+    if(InCapacity <= InBuilder->Capacity)
+        return TRUE;
 
-        Returns the array of results. This should be freed by a subsequent 
-        call to ReleaseTestFuncHookResults.
+    if((Results = (TEST_FUNC_HOOKS_RESULT*)realloc(InBuilder->Results, InCapacity * sizeof(TEST_FUNC_HOOKS_RESULT))) == NULL)
+    {
+        InBuilder->IsOutOfMemory = TRUE;
 
-    - resultCount
+        return FALSE;
+    }
 
-        The number of items added to outResults.
+    memset(Results + InBuilder->Capacity, 0, (InCapacity - InBuilder->Capacity) * sizeof(TEST_FUNC_HOOKS_RESULT));
 
-Returns:
+    InBuilder->Results = Results;
+    InBuilder->Capacity = InCapacity;
 
-    NTSTATUS
+    return TRUE;
+}
+
+static LPSTR TestFuncBuilderString(
+        TEST_FUNC_BUILDER* InBuilder,
+        LPSTR InString)
+{
+/*
+Description:
 
+    Appends the given string and returns its offset, disguised as pointer
+    until TestFuncBuilderFinish() relocates it.
 */
-    FILE *f = NULL;
-    HANDLE hProcess;
+    ULONG           Length;
+    ULONG           Capacity;
+    ULONG           Offset;
+    CHAR*           Strings;
 
-    HMODULE hRemote = GetRemoteModuleHandle(pId, module);
-    IMAGE_DOS_HEADER DosHeader;
-    IMAGE_NT_HEADERS NtHeaders;
-	IMAGE_EXPORT_DIRECTORY EATDirectory;
+    if((InString == NULL) || (InString[0] == 0))
+        return NULL;
 
-    DWORD*    AddressOfFunctions;
-	DWORD*    AddressOfNames;
-	WORD*    AddressOfOrdinals;
+    Length = (ULONG)strlen(InString) + 1;
 
-	unsigned int i;
+    if(InBuilder->StringSize + Length > InBuilder->StringCapacity)
+    {
+        Capacity = InBuilder->StringCapacity * 2;
 
-	DWORD_PTR dwExportBase;
-	DWORD_PTR dwExportSize;
-	DWORD_PTR dwAddressOfFunction;
-	DWORD_PTR dwAddressOfName;
+        if(Capacity < InBuilder->StringSize + Length)
+            Capacity = InBuilder->StringSize + Length + 4096;
 
-	char pszFunctionName[256] = { 0 };
-	char pszRedirectName[256] = { 0 };
-	char pszModuleName[256] = { 0 };
-    char pszFunctionRedi[256] = { 0 };
+        if((Strings = (CHAR*)realloc(InBuilder->Strings, Capacity)) == NULL)
+        {
+            InBuilder->IsOutOfMemory = TRUE;
 
-    unsigned int a = 0;
-	int b = 0;
+            return NULL;
+        }
 
-	WORD OrdinalValue;
+        Strings[0] = 0;
 
-	DWORD_PTR dwAddressOfRedirectedFunction;
-	DWORD_PTR dwAddressOfRedirectedName;
+        InBuilder->Strings = Strings;
+        InBuilder->StringCapacity = Capacity;
+    }
 
-    ULONG asmLength;
-    ULONG64 nextInstr;
-    CHAR buf[MAX_PATH];
+    Offset = InBuilder->StringSize;
 
-    CHAR asmBuf[MAX_PATH];
-    unsigned char *opcodes;
-    ULONG entryPointSize = 0;
-    UCHAR entryPoint[ 256 ] = { 0 };
-    DWORD_PTR pEntryPoint = 0;
-    LOCAL_HOOK_INFO* hookBuf = NULL;
-    ULONG relocBufSize = 0;
+    memcpy(InBuilder->Strings + Offset, InString, Length);
 
-    CHAR outputBuf[1024] = { 0 };
+    InBuilder->StringSize += Length;
 
-    TEST_FUNC_HOOKS_RESULT* results = NULL;
-    TEST_FUNC_HOOKS_RESULT* result;
-    unsigned int count = 0;
+    return (LPSTR)(ULONG_PTR)Offset;
+}
 
-	char pszRedirectedFunctionName[ 256 ] = { 0 };
+static void TestFuncBuilderStore(
+        TEST_FUNC_BUILDER* InBuilder,
+        ULONG InIndex,
+        TEST_FUNC_HOOKS_RESULT* InResult)
+{
+/*
+Description:
 
-    // Initialise results
-    *resultCount = 0;
-    *outResults = NULL;
+    Copies the given result into the reserved slot InIndex.
+*/
+    TEST_FUNC_HOOKS_RESULT*     Result = &InBuilder->Results[InIndex];
+
+    Result->FnName = TestFuncBuilderString(InBuilder, InResult->FnName);
+    Result->ModuleRedirect = TestFuncBuilderString(InBuilder, InResult->ModuleRedirect);
+    Result->FnRedirect = TestFuncBuilderString(InBuilder, InResult->FnRedirect);
+    Result->FnAddress = InResult->FnAddress;
+    Result->RelocAddress = InResult->RelocAddress;
+    Result->EntryDisasm = TestFuncBuilderString(InBuilder, InResult->EntryDisasm);
+    Result->RelocDisasm = TestFuncBuilderString(InBuilder, InResult->RelocDisasm);
+    Result->Error = TestFuncBuilderString(InBuilder, InResult->Error);
+}
 
-    // open target process
-    if((hProcess = OpenProcess(PROCESS_ALL_ACCESS, FALSE, pId)) == NULL)
-	{
-		if(GetLastError() == ERROR_ACCESS_DENIED)
-            return STATUS_ACCESS_DENIED;
-		else
-			return STATUS_NOT_FOUND;
-	}
-
-	if(!hRemote)
-        return STATUS_NOT_FOUND;
-    
-	// Load DOS PE header
-    if(!ReadProcessMemory(hProcess, (void*)hRemote, &DosHeader, sizeof(IMAGE_DOS_HEADER), NULL) || DosHeader.e_magic != IMAGE_DOS_SIGNATURE)
-        return STATUS_NOT_FOUND;
-
-	// Load NT PE headers
-    if(!ReadProcessMemory(hProcess, (void *)((DWORD_PTR)hRemote + DosHeader.e_lfanew), &NtHeaders, sizeof(IMAGE_NT_HEADERS), NULL) || NtHeaders.Signature != IMAGE_NT_SIGNATURE)
-        return STATUS_NOT_FOUND;
-
-    // Load image export directory
-    if(!GetRemoteModuleExportDirectory(hProcess, hRemote, &EATDirectory, DosHeader, NtHeaders))
-        return STATUS_NOT_FOUND;
-
-	// Allocate room for all the function information
-    AddressOfFunctions	= (DWORD*)malloc(EATDirectory.NumberOfFunctions * sizeof(DWORD));
-    AddressOfNames      = (DWORD*)malloc(EATDirectory.NumberOfNames * sizeof(DWORD));
-    AddressOfOrdinals   = (WORD*)malloc(EATDirectory.NumberOfNames * sizeof(WORD));
-
-	// Read function address locations
-    if(!ReadProcessMemory(hProcess, (void*)((DWORD_PTR)hRemote + (DWORD_PTR)EATDirectory.AddressOfFunctions), AddressOfFunctions, EATDirectory.NumberOfFunctions * sizeof(DWORD), NULL)) {
-        free(AddressOfFunctions);
-        free(AddressOfNames);
-        free(AddressOfOrdinals);
-        return STATUS_NOT_FOUND;
+static BOOL TestFuncBuilderAdd(
+        TEST_FUNC_BUILDER* InBuilder,
+        TEST_FUNC_HOOKS_RESULT* InResult)
+{
+    if(InBuilder->Count == InBuilder->Capacity)
+    {
+        if(!TestFuncBuilderReserve(InBuilder, (InBuilder->Capacity < 64) ? 64 : InBuilder->Capacity * 2))
+            return FALSE;
     }
 
-	// Read function name locations
-    if(!ReadProcessMemory(hProcess, (void*)((DWORD_PTR)hRemote + (DWORD_PTR)EATDirectory.AddressOfNames), AddressOfNames, EATDirectory.NumberOfNames * sizeof(DWORD), NULL)) {
-        free(AddressOfFunctions);
-        free(AddressOfNames);
-        free(AddressOfOrdinals);
-        return STATUS_NOT_FOUND;
+    TestFuncBuilderStore(InBuilder, InBuilder->Count++, InResult);
+
+    return !InBuilder->IsOutOfMemory;
+}
+
+static NTSTATUS TestFuncBuilderFinish(
+        TEST_FUNC_BUILDER* InBuilder,
+        TEST_FUNC_HOOKS_RESULT** OutResults,
+        int* OutCount)
+{
+/*
+Description:
+
+    Moves all results and strings into one CoTaskMemAlloc() block
+    and releases the builder.
+*/
+    TEST_FUNC_HOOKS_RESULT*     Results;
+    TEST_FUNC_HOOKS_RESULT*     Result;
+    CHAR*                       Strings;
+    ULONG                       Index;
+    NTSTATUS                    NtStatus;
+
+    if(InBuilder->IsOutOfMemory)
+        THROW(STATUS_NO_MEMORY, L"Not enough memory to store the test results.");
+
+    if((Results = (TEST_FUNC_HOOKS_RESULT*)CoTaskMemAlloc(InBuilder->Count * sizeof(TEST_FUNC_HOOKS_RESULT) + InBuilder->StringSize)) == NULL)
+        THROW(STATUS_NO_MEMORY, L"Not enough memory to store the test results.");
+
+    Strings = (CHAR*)(Results + InBuilder->Count);
+
+    if(InBuilder->Strings != NULL)
+        memcpy(Strings, InBuilder->Strings, InBuilder->StringSize);
+    else
+        Strings[0] = 0;
+
+    for(Index = 0; Index < InBuilder->Count; Index++)
+    {
+        Result = &Results[Index];
+
+        *Result = InBuilder->Results[Index];
+
+        Result->FnName = Strings + (ULONG_PTR)Result->FnName;
+        Result->ModuleRedirect = Strings + (ULONG_PTR)Result->ModuleRedirect;
+        Result->FnRedirect = Strings + (ULONG_PTR)Result->FnRedirect;
+        Result->EntryDisasm = Strings + (ULONG_PTR)Result->EntryDisasm;
+        Result->RelocDisasm = Strings + (ULONG_PTR)Result->RelocDisasm;
+        Result->Error = Strings + (ULONG_PTR)Result->Error;
     }
 
-	// Read function name ordinal locations
-    if(!ReadProcessMemory(hProcess, (void*)((DWORD_PTR)hRemote + (DWORD_PTR)EATDirectory.AddressOfNameOrdinals), AddressOfOrdinals, EATDirectory.NumberOfNames * sizeof(WORD), NULL)) {
-        free(AddressOfFunctions);
-        free(AddressOfNames);
-        free(AddressOfOrdinals);
-        return STATUS_NOT_FOUND;
+    *OutResults = Results;
+    *OutCount = (int)InBuilder->Count;
+
+    RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    TestFuncBuilderRelease(InBuilder);
+
+    return NtStatus;
+}
+
+static void TestFuncDisassemble(
+        UCHAR* InCode,
+        ULONG InSize,
+        ULONG InMinCount,
+        ULONGLONG InAddress,
+        PSTR OutText)
+{
+/*
+Description:
+
+    Appends one line per instruction to OutText until at least InSize bytes
+    and InMinCount instructions are covered. Instruction pointers are
+    reported relative to InAddress.
+*/
+    UCHAR*          Ptr = InCode;
+    ULONG           Length;
+    ULONG           Count = 0;
+    ULONG           Index;
+    ULONG64         NextInstr;
+    size_t          TextLen;
+    CHAR            OpText[MAX_PATH];
+    CHAR            AsmText[MAX_PATH];
+
+    while((((ULONG)(Ptr - InCode) < InSize) || (Count < InMinCount)) && 
+            RTL_SUCCESS(LhDisassembleInstruction(Ptr, &Length, AsmText, MAX_PATH, &NextInstr)))
+    {
+        sprintf_s(OpText, MAX_PATH, "\t");
+
+        for(Index = 0; Index < Length; Index++)
+        {
+            TextLen = strlen(OpText);
+            sprintf_s(OpText + TextLen, MAX_PATH - TextLen, "%02X ", Ptr[Index]);
+        }
+
+        TextLen = strlen(OutText);
+        sprintf_s(OutText + TextLen, TEST_FUNC_TEXT_SIZE - TextLen, "%-35s%-30sIP:%llx\n", 
+                OpText, AsmText, InAddress + (ULONG)(Ptr - InCode) + Length);
+
+        Ptr += Length;
+        Count++;
     }
+}
 
-    dwExportBase = ((DWORD_PTR)hRemote + NtHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress);
-    dwExportSize = (dwExportBase + NtHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size);
+static BOOL TestFuncWriteResults(
+        PCHAR InFilename,
+        TEST_FUNC_HOOKS_RESULT* InResults,
+        ULONG InCount)
+{
+/*
+Description:
 
-    // Determine result count
-    for(i = 0; i < EATDirectory.NumberOfNames; ++i) {
-        dwAddressOfFunction    = (DWORD_PTR)hRemote + AddressOfFunctions[i];
-        dwAddressOfName        = (DWORD_PTR)hRemote + AddressOfNames[i];
+    Writes the results of TestFuncHooks() or TestFuncHooksInImage()
+    to the given text file.
+*/
+    FILE*                       f = NULL;
+    TEST_FUNC_HOOKS_RESULT*     result;
+    ULONG                       i;
 
-		memset(&pszFunctionName, 0, 256);
+    fopen_s(&f, InFilename, "w");
+    if (f == NULL)
+    {
+        printf("Error opening file!\n");
+        return FALSE;
+    }
 
-        if(!ReadProcessMemory(hProcess, (void*)dwAddressOfName, pszFunctionName, 256, NULL))
-            continue;
+    for (i = 0; i < InCount; i++)
+    {
+        result = &InResults[i];
 
-        // Skip until we find the matching function name
-        if (options.FilterByName != NULL && strlen(options.FilterByName) > 0)
+        fprintf(f, "\nFunction: %s\n", result->FnName);
+        
+        if (result->ModuleRedirect != NULL && strlen(result->ModuleRedirect))
+            fprintf(f, "\t(redirected to DLL: %s!%s)\n", result->ModuleRedirect, result->FnRedirect);
+        if (result->FnRedirect != NULL && strlen(result->FnRedirect))
+            fprintf(f, "\t(redirected to function: %s)\n", result->FnRedirect);
+
+        if (result->Error != NULL && strlen(result->Error) > 0)
         {
-            if (_stricmp(pszFunctionName, options.FilterByName) == 0)
-                count++;
+            fprintf(f, "ERROR: %s\n", result->Error);
+
+            if (result->EntryDisasm != NULL && strlen(result->EntryDisasm) > 0) {
+                fprintf(f, "%s", result->EntryDisasm);
+            }
         }
-        else 
+        else
         {
-            count++;
+            fprintf(f, "Entry point:@ %p\n", result->FnAddress);
+            fprintf(f, "%s", result->EntryDisasm);
+            fprintf(f, "Relocated entry point:@ %p\n", result->RelocAddress);
+            fprintf(f, "%s", result->RelocDisasm);
         }
     }
 
-    // Allocate memory for the results
-    *resultCount = count;
-    results = (TEST_FUNC_HOOKS_RESULT *)CoTaskMemAlloc(count * sizeof(TEST_FUNC_HOOKS_RESULT));
-    *outResults = results;
+    fclose(f);
+
+    return TRUE;
+}
 
-    if (results == NULL)
+static void TestFuncRemoteExport(
+        REMOTE_EXPORT_CACHE* InCache,
+        REMOTE_EXPORT_TABLE* InTable,
+        REMOTE_EXPORT* InExport,
+        TEST_FUNC_HOOKS_RESULT* OutResult)
+{
+/*
+Description:
+
+    Checks whether the given export of a remote module can be hooked. Like
+    before, the entry point is expected at the same address in the current
+    process, which holds for system libraries.
+*/
+    UCHAR*              Function;
+    PCHAR               Forwarder;
+    PCHAR               Dot;
+    LOCAL_HOOK_INFO*    Hook = NULL;
+    ULONG               RelocSize = 0;
+
+    strncpy_s(OutResult->FnName, TEST_FUNC_NAME_SIZE, InExport->Name, _TRUNCATE);
+
+    // Check if address of function is found in another module
+    if((InExport->FunctionRva >= InTable->ExportStart) && (InExport->FunctionRva < InTable->ExportEnd))
     {
-        *outResults = NULL;
-        *resultCount = 0;
-        return STATUS_NO_MEMORY;
+        Forwarder = (PCHAR)(InTable->Directory + (InExport->FunctionRva - InTable->ExportStart));
+
+        if(((Dot = strchr(Forwarder, '.')) == NULL) || ((ULONG)(Dot - Forwarder) + sizeof(".dll") > TEST_FUNC_NAME_SIZE))
+        {
+            strcpy_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "DLL redirect unreadable");
+            return;
+        }
+
+        strncpy_s(OutResult->ModuleRedirect, TEST_FUNC_NAME_SIZE, Forwarder, (size_t)(Dot - Forwarder));
+        strcat_s(OutResult->ModuleRedirect, TEST_FUNC_NAME_SIZE, ".dll");
+
+        if((Function = (UCHAR*)RemoteExportLookup(InCache, OutResult->ModuleRedirect, Dot + 1, 1)) == NULL)
+        {
+            strcpy_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "DLL redirect unreadable");
+            return;
+        }
+
+        strncpy_s(OutResult->FnRedirect, TEST_FUNC_NAME_SIZE, Dot + 1, _TRUNCATE);
     }
+    else
+        Function = InTable->Base + InExport->FunctionRva;
 
-    memset(results, 0, count * sizeof(TEST_FUNC_HOOKS_RESULT));
+    OutResult->FnAddress = Function;
 
-    for (a = 0; a < count; a++) {
-        result = &results[a];
-        result->FnName = (LPSTR)CoTaskMemAlloc(MAX_PATH);
-        memset(result->FnName, 0, MAX_PATH);
+    // 1. Allocate memory and prepare the hook
+    if(!RTL_SUCCESS(LhAllocateHook(Function, Function, NULL, EASYHOOK_HOOK_DEFAULT, &Hook, &RelocSize)))
+    {
+        // Unable to allocate hook or unable to relocate instructions
+        sprintf_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "Unable to allocate hook: %S", RtlGetLastErrorString());
 
-        result->ModuleRedirect = (LPSTR)CoTaskMemAlloc(MAX_PATH);
-        memset(result->ModuleRedirect, 0, MAX_PATH);
+        TestFuncDisassemble(Function, 5, 2, (ULONG_PTR)Function, OutResult->EntryDisasm);
 
-        result->FnRedirect = (LPSTR)CoTaskMemAlloc(MAX_PATH);
-        memset(result->FnRedirect, 0, MAX_PATH);
+        return;
+    }
 
-        result->EntryDisasm = (LPSTR)CoTaskMemAlloc(1024);
-        memset(result->EntryDisasm, 0, 1024);
+    // 2. Disassemble entry point and relocated buffer
+    if(Hook->EntrySize == 0)
+        strcpy_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "Entry point size is Zero");
+    else if(Hook->EntrySize >= 20)
+        sprintf_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "Entry point is too large: %d", Hook->EntrySize);
+    else
+    {
+        TestFuncDisassemble(Function, Hook->EntrySize, 0, (ULONG_PTR)Function, OutResult->EntryDisasm);
 
-        result->RelocDisasm = (LPSTR)CoTaskMemAlloc(1024);
-        memset(result->RelocDisasm, 0, 1024);
+        OutResult->RelocAddress = Hook->OldProc;
 
-        result->Error = (LPSTR)CoTaskMemAlloc(1024);
-        memset(result->Error, 0, 1024);
+        TestFuncDisassemble(Hook->OldProc, RelocSize, 0, (ULONG_PTR)Hook->OldProc, OutResult->RelocDisasm);
     }
 
+    LhFreeMemory(&Hook);
+}
 
-    count = a = b = 0;
+EASYHOOK_NT_EXPORT TestFuncHooksEx(
+        ULONG pId,
+        PCHAR module,
+        TEST_FUNC_HOOKS_OPTIONS options,
+        TEST_FUNC_HOOKS_CALLBACK* InCallback,
+        void* InContext)
+{
+/*
+Description:
 
-	// Check each name for a match
-    for(i = 0; i < EATDirectory.NumberOfNames; ++i) {
-        dwAddressOfFunction    = (DWORD_PTR)hRemote + AddressOfFunctions[i];
-        dwAddressOfName        = (DWORD_PTR)hRemote + AddressOfNames[i];
+    Tests whether it is possible to hook DLL exports found within the specified
+    module and passes each result to the given callback as soon as it is available.
+    The export table is read at once, so each export name is read only once.
 
-		memset(&pszFunctionName, 0, 256);
-        
-        if(!ReadProcessMemory(hProcess, (void*)dwAddressOfName, pszFunctionName, 256, NULL))
-            continue;
+Parameters:
 
-        memset(&outputBuf, 0, 1024);
+    - pId
 
-        // Skip until we find the matching function name
-        if (options.FilterByName != NULL && strlen(options.FilterByName) > 0 && (_stricmp(pszFunctionName, options.FilterByName) != 0))
-            continue;
+        The process Id to test.
+    
+    - module
 
-        // Get next result obj
-        result = &results[count++];
-        
-        strcpy_s(result->FnName, MAX_PATH, pszFunctionName);
-        
-        // Check if address of function is found in another module
-        if(dwAddressOfFunction >= dwExportBase && dwAddressOfFunction <= dwExportSize) {
-            memset(&pszRedirectName, 0, 256);
+        The name of the module to look for exports within.
 
-            if(!ReadProcessMemory(hProcess, (void*)dwAddressOfFunction, pszRedirectName, 256, NULL))
-                continue;
+    - options
 
-            memset(&pszModuleName, 0, 256);
-			memset(&pszFunctionRedi, 0, 256);
+        Optionally specifies the name of a single export to test.
+        The output file name is ignored.
 
-            a = 0;
-            for(; pszRedirectName[a] != '.'; a++)
-                pszModuleName[a] = pszRedirectName[a];
-            a++;
-            pszModuleName[a] = '\0';
+    - InCallback
 
-            b = 0;
-            for(; pszRedirectName[a] != '\0'; a++, b++)
-                pszFunctionRedi[b] = pszRedirectName[a];
-            b++;
-            pszFunctionRedi[b] = '\0';
+        Receives each result. The result and its strings are only valid
+        during the call. Return FALSE to stop testing.
 
-            strcat_s(pszModuleName, 256, ".dll");
-            strcpy_s(result->ModuleRedirect, MAX_PATH, pszModuleName);
+    - InContext
 
-            dwAddressOfFunction = (DWORD_PTR)GetRemoteFuncAddress(pId, hProcess, pszModuleName, pszFunctionRedi);
-            if (dwAddressOfFunction == 0) {
-                strcpy_s(result->Error, 1024, "DLL redirect unreadable");
-                continue;
-            }
-            else {
-                strcpy_s(result->FnRedirect, MAX_PATH, pszFunctionRedi);
-            }
-        }
-        else {
-            OrdinalValue = AddressOfOrdinals[i];
+        Passed to the callback.
 
-            if (OrdinalValue >= EATDirectory.NumberOfNames)
-            {
-                    strcpy_s(result->Error, 1024, "Ordinal redirect out of range");
-                    continue;
-            }
+Returns:
 
-		    // If ordinal doesn't match index retrieve correct address
-            if(OrdinalValue != i) {
-                dwAddressOfRedirectedFunction	= ((DWORD_PTR)hRemote + (DWORD_PTR)AddressOfFunctions[OrdinalValue]);
-                dwAddressOfRedirectedName		= ((DWORD_PTR)hRemote + (DWORD_PTR)AddressOfNames[OrdinalValue]);
-
-                memset(&pszRedirectedFunctionName, 0, 256);
-
-                if(!ReadProcessMemory(hProcess, (void*)dwAddressOfRedirectedName, pszRedirectedFunctionName, 256, NULL))
-                {
-                    
-                    strcpy_s(result->Error, 1024, "Ordinal redirect unreadable");
-                    continue;
-                }
-                else
-                {
-                    strcpy_s(result->FnRedirect, MAX_PATH, pszRedirectedFunctionName);
-                    dwAddressOfFunction = dwAddressOfRedirectedFunction;
-                }
-            }
-        }
-        result->FnAddress = (void*)dwAddressOfFunction;
-        
-        entryPointSize = 0;
+    STATUS_NOT_FOUND
 
-        a = 0;
-        
-        // 1. Allocate memory and prepare the hook
-        if (!RTL_SUCCESS(LhAllocateHook((void*)dwAddressOfFunction, (void*)dwAddressOfFunction, NULL, &hookBuf, &relocBufSize)))
-        {
-            // Unable to allocate hook or unable to relocate instructions
-            BOOL usedDefault = FALSE;
-            WideCharToMultiByte(CP_ACP,
-                                WC_COMPOSITECHECK | WC_DEFAULTCHAR,
-                                RtlGetLastErrorString(),
-                                lstrlenW(RtlGetLastErrorString()),
-                                outputBuf,
-                                1024,
-                                "?",
-                                &usedDefault);
-            sprintf_s(result->Error, 1024, "Unable to allocate hook: %s", outputBuf);
-            memset(&asmBuf, 0, MAX_PATH);
-            pEntryPoint = dwAddressOfFunction;
-            // Disassemble instructions
-            while ((a < 2 || (pEntryPoint - dwAddressOfFunction < 5)) && RTL_SUCCESS(LhDisassembleInstruction((void*)pEntryPoint, &asmLength, buf, MAX_PATH, &nextInstr)))
-            {
-                opcodes = (unsigned char *)pEntryPoint;
-                sprintf_s(asmBuf, 260, "\t");
-                for (b = 0; b < (int)(nextInstr - pEntryPoint); b++)
-                {
-                    entryPoint[entryPointSize + b] = *opcodes;
-                
-                    sprintf_s(asmBuf + strlen(asmBuf), 260 - strlen(asmBuf), "%02X ", *opcodes);
-                    opcodes++;
-                }
+        The process, the module or its exports could not be found.
 
-                sprintf_s(result->EntryDisasm + strlen(result->EntryDisasm), 1024 - strlen(result->EntryDisasm), "%-35s%-30sIP:%x\n", asmBuf, buf, nextInstr);
-                a++;
+    STATUS_ACCESS_DENIED
 
-                pEntryPoint = (DWORD_PTR)nextInstr;
-            }
-            
+        The process can't be opened.
+*/
+    HANDLE                      hProcess = NULL;
+    REMOTE_EXPORT_CACHE         ExportCache;
+    REMOTE_EXPORT_TABLE*        Table;
+    REMOTE_EXPORT*              Export;
+    TEST_FUNC_RESULT_BUFFER     Buffer;
+    ULONG                       Index;
+    NTSTATUS                    NtStatus;
+
+    RemoteExportCacheInit(&ExportCache, pId, NULL);
+
+    if(!IsValidPointer(InCallback, 1))
+        THROW(STATUS_INVALID_PARAMETER_4, L"Invalid callback.");
+
+    // open target process
+    if((hProcess = OpenProcess(PROCESS_ALL_ACCESS, FALSE, pId)) == NULL)
+	{
+		if(GetLastError() == ERROR_ACCESS_DENIED)
+            THROW(STATUS_ACCESS_DENIED, L"Unable to open target process. Consider using a system service.")
+		else
+			THROW(STATUS_NOT_FOUND, L"The given target process does not exist!");
+	}
+
+    ExportCache.hProcess = hProcess;
+
+    // forwarded exports of the whole module are resolved through the same cache
+    if(((Table = RemoteExportGetTable(&ExportCache, module)) == NULL) || (Table->Base == NULL))
+        THROW(STATUS_NOT_FOUND, L"Unable to read the exports of the given module.");
+
+    for(Index = 0; Index < Table->NameCount; Index++)
+    {
+        Export = &Table->Names[Index];
+
+        // Skip until we find the matching function name
+        if((options.FilterByName != NULL) && (strlen(options.FilterByName) > 0) && (_stricmp(Export->Name, options.FilterByName) != 0))
             continue;
-        }
-        entryPointSize = hookBuf->EntrySize;
 
-        // 2. Disassemble entry point and relocated buffer
-        if (entryPointSize == 0)
-            strcpy_s(result->Error, 1024, "Entry point size is Zero");
-        else if (entryPointSize >= 20)
-            sprintf_s(result->Error, 1024, "Entry point is too large: %d", entryPointSize);
-        else
-        {
-            pEntryPoint = dwAddressOfFunction;
-            memset(asmBuf, 0, MAX_PATH);
-            while ((pEntryPoint - (DWORD_PTR)dwAddressOfFunction < entryPointSize) && RTL_SUCCESS(LhDisassembleInstruction((void*)pEntryPoint, &asmLength, buf, MAX_PATH, &nextInstr)))
-            {
-                opcodes = (PUCHAR)pEntryPoint;
-                sprintf_s(asmBuf, 260, "\t");
-                for (b = 0; b < (int)(nextInstr - pEntryPoint); b++)
-                {
-                    sprintf_s(asmBuf + strlen(asmBuf), 260 - strlen(asmBuf), "%02X ", *opcodes);
-                    opcodes++;
-                }
-                sprintf_s(result->EntryDisasm + strlen(result->EntryDisasm), 1024 - strlen(result->EntryDisasm), "%-35s%-30sIP:%x\n", asmBuf, buf, nextInstr);
-                pEntryPoint = (DWORD_PTR)nextInstr;
-            }
-            pEntryPoint = (DWORD_PTR)hookBuf->OldProc;
-            result->RelocAddress = (void*)pEntryPoint;
-            memset(asmBuf, 0, MAX_PATH);
-            while ((pEntryPoint - (DWORD_PTR)hookBuf->OldProc < relocBufSize) && RTL_SUCCESS(LhDisassembleInstruction((void*)pEntryPoint, &asmLength, buf, MAX_PATH, &nextInstr)))
-            {
-                opcodes = (PUCHAR)pEntryPoint;
-                sprintf_s(asmBuf, 260, "\t");
-                for (b = 0; b < (int)(nextInstr - pEntryPoint); b++)
-                {
-                    sprintf_s(asmBuf + strlen(asmBuf), 260 - strlen(asmBuf), "%02X ", *opcodes);
-                    opcodes++;
-                }
-                sprintf_s(result->RelocDisasm + strlen(result->RelocDisasm), 1024 - strlen(result->RelocDisasm), "%-35s%-30sIP:%x\n", asmBuf, buf, nextInstr);
-                pEntryPoint = (DWORD_PTR)nextInstr;
-            }
-        }
-        
-        if (hookBuf != NULL)
-            LhFreeMemory(&hookBuf);
-        hookBuf = NULL;
+        TestFuncResultReset(&Buffer);
+
+        TestFuncRemoteExport(&ExportCache, Table, Export, &Buffer.Result);
+
+        if(!InCallback(&Buffer.Result, InContext))
+            break;
     }
 
-    // Write to file
-        
-    if (options.Filename != NULL && strlen(options.Filename) > 0)
-    {
-        fopen_s(&f, options.Filename, "w");
-        if (f == NULL)
-        {
-            printf("Error opening file!\n");
-            return STATUS_NOT_FOUND;
-        }
+    RETURN;
 
-        for (i = 0; i < count; i++)
-        {
-            result = &results[i];
+THROW_OUTRO:
+FINALLY_OUTRO:
+    {
+        RemoteExportCacheRelease(&ExportCache);
 
-            fprintf(f, "\nFunction: %s\n", result->FnName);
-            
-            if (result->ModuleRedirect != NULL && strlen(result->ModuleRedirect))
-                fprintf(f, "\t(redirected to DLL: %s!%s)\n", result->ModuleRedirect, result->FnRedirect);
-            if (result->FnRedirect != NULL && strlen(result->FnRedirect))
-                fprintf(f, "\t(redirected to function: %s)\n", result->FnRedirect);
-
-            if (result->Error != NULL && strlen(result->Error) > 0)
-            {
-                fprintf(f, "ERROR: %s\n", result->Error);
-
-                if (result->EntryDisasm != NULL && strlen(result->EntryDisasm) > 0) {
-                    fprintf(f, "%s", result->EntryDisasm);
-                }
-            }
-            else
-            {
-                fprintf(f, "Entry point:@ %p\n", result->FnAddress);
-                fprintf(f, "%s", result->EntryDisasm);
-                fprintf(f, "Relocated entry point:@ %p\n", result->RelocAddress);
-                fprintf(f, "%s", result->RelocDisasm);
-            }
-        }
+        if(hProcess != NULL)
+            CloseHandle(hProcess);
 
-        fclose(f);
+        return NtStatus;
     }
+}
+
+static BOOL __stdcall TestFuncCollectResult(
+        TEST_FUNC_HOOKS_RESULT* InResult,
+        void* InBuilder)
+{
+    return TestFuncBuilderAdd((TEST_FUNC_BUILDER*)InBuilder, InResult);
+}
+
+EASYHOOK_NT_EXPORT TestFuncHooks(ULONG pId, 
+        PCHAR module,
+        TEST_FUNC_HOOKS_OPTIONS options,
+        TEST_FUNC_HOOKS_RESULT** outResults,
+        int* resultCount)
+{
+/*
+Description:
+
+    Tests whether it is possible to hook DLL exports found within the specified module.
+
+Parameters:
 
-    free(AddressOfFunctions);
-    free(AddressOfNames);
-    free(AddressOfOrdinals);
+    - pId
+
+        The process Id to test.
     
-    return 0;
+    - module
+
+        The name of the module to look for exports within.
+
+    - options
+
+        Optionally specifies whether to output the results to a text file, or
+        the name of a single export to test.
+
+    - outResults
+
+        Returns the array of results. This should be freed by a subsequent 
+        call to ReleaseTestFuncHookResults.
+
+    - resultCount
+
+        The number of items added to outResults.
+
+Returns:
+
+    NTSTATUS
+
+*/
+    TEST_FUNC_BUILDER           Builder;
+    NTSTATUS                    NtStatus;
+
+    TestFuncBuilderInit(&Builder);
+
+    // Initialise results
+    *resultCount = 0;
+    *outResults = NULL;
+
+    FORCE(TestFuncHooksEx(pId, module, options, TestFuncCollectResult, &Builder));
+
+    FORCE(TestFuncBuilderFinish(&Builder, outResults, resultCount));
+
+    // Write to file
+    if((options.Filename != NULL) && (strlen(options.Filename) > 0))
+    {
+        if(!TestFuncWriteResults(options.Filename, *outResults, (ULONG)*resultCount))
+            THROW(STATUS_NOT_FOUND, L"Unable to write the results file.");
+    }
+
+    RETURN;
+
+THROW_OUTRO:
+    if(*outResults != NULL)
+        ReleaseTestFuncHookResults(*outResults, *resultCount);
+
+    *outResults = NULL;
+    *resultCount = 0;
+FINALLY_OUTRO:
+    TestFuncBuilderRelease(&Builder);
+
+    return NtStatus;
 }
 
 
@@ -1913,7 +2310,8 @@ EASYHOOK_NT_EXPORT ReleaseTestFuncHookResults(TEST_FUNC_HOOKS_RESULT* results, i
 /*
 Description:
 
-    Free the memory allocated for the results from a previous call to TestFuncHooks.
+    Free the memory allocated for the results from a previous call to TestFuncHooks
+    or TestFuncHooksInImage. All results and their strings are a single block.
 
 Parameters:
 
@@ -1930,21 +2328,431 @@ Returns:
     STATUS_SUCCESS
 
 */
-    int i = 0;
-    TEST_FUNC_HOOKS_RESULT* result;
-    for (i = 0; i < count; i++)
+    CoTaskMemFree(results);
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+
+/*/////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////// TestFuncHooksInImage
+///////////////////////////////////////////////////////////////////////////////////////
+
+Offline variant of TestFuncHooks(). The image is mapped from disk without being
+loaded and every export is checked against the mapped bytes. The exports are
+shared between a pool of worker threads.
+*/
+// udis86 always reads 32 bytes ahead of the current instruction
+#define TEST_FUNC_DISASM_PADDING        32
+
+typedef struct _TEST_FUNC_IMAGE_
+{
+    UCHAR*                      Base;
+    ULONG                       ImageSize;
+    ULONGLONG                   ImageBase;
+    IMAGE_SECTION_HEADER*       Sections;
+    ULONG                       SectionCount;
+    ULONG                       ExportStart;
+    ULONG                       ExportEnd;
+    DWORD*                      AddressOfFunctions;
+    ULONG                       NumberOfFunctions;
+    DWORD*                      AddressOfNames;
+    WORD*                       AddressOfOrdinals;
+    ULONG*                      NameIndices;
+    ULONG                       Count;
+    volatile LONG               NextResult;
+    TEST_FUNC_BUILDER           Builder;
+    RTL_SPIN_LOCK               BuilderLock;
+}TEST_FUNC_IMAGE;
+
+typedef struct _TEST_FUNC_SCRATCH_
+{
+    /*
+        The entry point is copied right in front of the relocation buffer,
+        so RIP relative displacements stay in range like they do for a
+        trampoline allocated near the real entry point. The real allocator
+        might find no free memory within 2 GB of an export though; such
+        exports are still reported as hookable.
+    */
+    UCHAR                       Entry[64 + TEST_FUNC_DISASM_PADDING];
+    UCHAR                       Reloc[LH_MAX_RELOC_SIZE + MAX_JMP_SIZE + TEST_FUNC_DISASM_PADDING];
+}TEST_FUNC_SCRATCH;
+
+static PCHAR TestFuncImageString(
+        TEST_FUNC_IMAGE* InImage,
+        ULONG InRva)
+{
+/*
+Description:
+
+    Returns the zero terminated string at the given RVA or NULL
+    if it does not end within the image.
+*/
+    if(InRva >= InImage->ImageSize)
+        return NULL;
+
+    if(memchr(InImage->Base + InRva, 0, InImage->ImageSize - InRva) == NULL)
+        return NULL;
+
+    return (PCHAR)(InImage->Base + InRva);
+}
+
+static void TestFuncImageExport(
+        TEST_FUNC_IMAGE* InImage,
+        ULONG InNameIndex,
+        TEST_FUNC_HOOKS_RESULT* OutResult)
+{
+/*
+Description:
+
+    Checks whether the export with the given name index can be hooked.
+    Works on a private copy of the entry point, so it can be called by
+    many threads at once.
+*/
+    TEST_FUNC_SCRATCH           Scratch;
+    IMAGE_SECTION_HEADER*       Section = NULL;
+    PCHAR                       Name;
+    PCHAR                       Forwarder;
+    PCHAR                       Dot;
+    ULONG                       Ordinal;
+    ULONG                       FnRva;
+    ULONG                       Index;
+    ULONG                       CopySize;
+    ULONG                       RelocSize = 0;
+    LH_DECODED_PROLOGUE         Prologue;
+    NTSTATUS                    NtStatus;
+
+    if((Name = TestFuncImageString(InImage, InImage->AddressOfNames[InNameIndex])) != NULL)
+        strncpy_s(OutResult->FnName, TEST_FUNC_NAME_SIZE, Name, _TRUNCATE);
+
+    Ordinal = InImage->AddressOfOrdinals[InNameIndex];
+
+    if(Ordinal >= InImage->NumberOfFunctions)
     {
-        result = &results[i];
-
-        CoTaskMemFree(result->FnName);
-        CoTaskMemFree(result->ModuleRedirect);
-        CoTaskMemFree(result->FnRedirect);
-        CoTaskMemFree(result->EntryDisasm);
-        CoTaskMemFree(result->RelocDisasm);
-        CoTaskMemFree(result->Error);
+        strcpy_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "Ordinal redirect out of range");
+        return;
     }
 
-    CoTaskMemFree(results);
+    FnRva = InImage->AddressOfFunctions[Ordinal];
 
-    return STATUS_SUCCESS;
-}
\ No newline at end of file
+    /*
+        Forwarded exports point to a "Module.Function" string within the export
+        directory. It is split at the first dot, like TestFuncHooks() and the
+        remote export lookup do.
+    */
+    if((FnRva >= InImage->ExportStart) && (FnRva < InImage->ExportEnd))
+    {
+        if(((Forwarder = TestFuncImageString(InImage, FnRva)) == NULL) ||
+                ((Dot = strchr(Forwarder, '.')) == NULL) ||
+                ((ULONG)(Dot - Forwarder) + sizeof(".dll") > TEST_FUNC_NAME_SIZE))
+        {
+            strcpy_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "DLL redirect unreadable");
+            return;
+        }
+
+        strncpy_s(OutResult->ModuleRedirect, TEST_FUNC_NAME_SIZE, Forwarder, (size_t)(Dot - Forwarder));
+        strcat_s(OutResult->ModuleRedirect, TEST_FUNC_NAME_SIZE, ".dll");
+        strncpy_s(OutResult->FnRedirect, TEST_FUNC_NAME_SIZE, Dot + 1, _TRUNCATE);
+
+        strcpy_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "DLL redirect not followed, test the target module instead");
+        return;
+    }
+
+    for(Index = 0; Index < InImage->SectionCount; Index++)
+    {
+        Section = &InImage->Sections[Index];
+
+        if((FnRva >= Section->VirtualAddress) && (FnRva - Section->VirtualAddress < Section->Misc.VirtualSize))
+            break;
+    }
+
+    if((Index == InImage->SectionCount) || (FnRva >= InImage->ImageSize) || !(Section->Characteristics & IMAGE_SCN_MEM_EXECUTE))
+    {
+        strcpy_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "Export is not located in executable code");
+        return;
+    }
+
+    OutResult->FnAddress = (void*)(ULONG_PTR)(InImage->ImageBase + FnRva);
+
+    RtlZeroMemory(&Scratch, sizeof(Scratch));
+
+    CopySize = InImage->ImageSize - FnRva;
+
+    if(CopySize > sizeof(Scratch.Entry) - TEST_FUNC_DISASM_PADDING)
+        CopySize = sizeof(Scratch.Entry) - TEST_FUNC_DISASM_PADDING;
+
+    RtlCopyMemory(Scratch.Entry, InImage->Base + FnRva, CopySize);
+
+    // same checks as LhAllocateHook() without allocating a hook
+    if(!RTL_SUCCESS(NtStatus = LhDecodePrologue(Scratch.Entry, 5, &Prologue)))
+        goto ERROR_ABORT;
+
+    if(Prologue.Size >= 20)
+    {
+        sprintf_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "Entry point is too large: %d", Prologue.Size);
+        return;
+    }
+
+    if(!RTL_SUCCESS(NtStatus = LhRelocatePrologue(&Prologue, Scratch.Reloc, &RelocSize)))
+        goto ERROR_ABORT;
+
+    TestFuncDisassemble(Scratch.Entry, Prologue.Size, 0, InImage->ImageBase + FnRva, OutResult->EntryDisasm);
+    TestFuncDisassemble(Scratch.Reloc, RelocSize, 0, 0, OutResult->RelocDisasm);
+
+    return;
+
+ERROR_ABORT:
+    // the last error string is shared by all threads, so only the status is reported
+    sprintf_s(OutResult->Error, TEST_FUNC_TEXT_SIZE, "Unable to relocate entry point: %S", RtlErrorCodeToString(NtStatus));
+
+    TestFuncDisassemble(Scratch.Entry, 5, 2, InImage->ImageBase + FnRva, OutResult->EntryDisasm);
+}
+
+static DWORD WINAPI TestFuncImageWorker(LPVOID InImage)
+{
+    TEST_FUNC_IMAGE*            Image = (TEST_FUNC_IMAGE*)InImage;
+    TEST_FUNC_RESULT_BUFFER     Buffer;
+    ULONG                       Index;
+
+    while((Index = (ULONG)(InterlockedIncrement(&Image->NextResult) - 1)) < Image->Count)
+    {
+        TestFuncResultReset(&Buffer);
+
+        TestFuncImageExport(Image, Image->NameIndices[Index], &Buffer.Result);
+
+        // results keep the export order, no matter which thread finishes first
+        RtlAcquireLock(&Image->BuilderLock);
+        {
+            TestFuncBuilderStore(&Image->Builder, Index, &Buffer.Result);
+        }
+        RtlReleaseLock(&Image->BuilderLock);
+    }
+
+    return 0;
+}
+
+EASYHOOK_NT_EXPORT TestFuncHooksInImage(
+        PWCHAR InImagePath,
+        TEST_FUNC_HOOKS_OPTIONS options,
+        ULONG InThreadCount,
+        TEST_FUNC_HOOKS_RESULT** outResults,
+        int* resultCount)
+{
+/*
+Description:
+
+    Tests whether it is possible to hook the exports of the given image file,
+    without the need for a process that has it loaded. The file is mapped as
+    image but nothing within it is executed. Results are the same as for
+    TestFuncHooks() with the following differences:
+
+        - Forwarded exports are reported with their redirection but are
+          not followed.
+        - FnAddress is relative to the preferred image base and RelocAddress
+          is always NULL.
+        - Absolute branch targets within RelocDisasm point into a private
+          copy of the entry point, so they differ between calls.
+        - Only images of the same architecture as this library are supported.
+
+Parameters:
+
+    - InImagePath
+
+        The full path of the image file to test.
+
+    - options
+
+        Optionally specifies whether to output the results to a text file, or
+        the name of a single export to test.
+
+    - InThreadCount
+
+        The count of threads testing exports, including the calling one.
+        Zero uses one thread per processor.
+
+    - outResults
+
+        Returns the array of results. This should be freed by a subsequent 
+        call to ReleaseTestFuncHookResults.
+
+    - resultCount
+
+        The number of items added to outResults.
+
+Returns:
+
+    STATUS_NOT_FOUND
+
+        The file could not be opened or has no exports.
+
+    STATUS_NOT_SUPPORTED
+
+        The image was built for another architecture.
+*/
+    HANDLE                      hFile = INVALID_HANDLE_VALUE;
+    HANDLE                      hMapping = NULL;
+    HANDLE                      hThreads[MAXIMUM_WAIT_OBJECTS];
+    ULONG                       ThreadCount = 0;
+    SYSTEM_INFO                 SysInfo;
+    TEST_FUNC_IMAGE             Image;
+    IMAGE_DOS_HEADER*           DosHeader;
+    IMAGE_NT_HEADERS*           NtHeaders;
+    IMAGE_DATA_DIRECTORY*       ExportData;
+    IMAGE_EXPORT_DIRECTORY*     Exports;
+    PCHAR                       Name;
+    ULONG                       Index;
+    NTSTATUS                    NtStatus;
+
+    RtlZeroMemory(&Image, sizeof(Image));
+
+    TestFuncBuilderInit(&Image.Builder);
+    RtlInitializeLock(&Image.BuilderLock);
+
+    if(!IsValidPointer(outResults, sizeof(TEST_FUNC_HOOKS_RESULT*)))
+        THROW(STATUS_INVALID_PARAMETER_4, L"Invalid result pointer.");
+
+    if(!IsValidPointer(resultCount, sizeof(int)))
+        THROW(STATUS_INVALID_PARAMETER_5, L"Invalid result count pointer.");
+
+    *outResults = NULL;
+    *resultCount = 0;
+
+    if((hFile = CreateFileW(InImagePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)) == INVALID_HANDLE_VALUE)
+        THROW(STATUS_NOT_FOUND, L"Unable to open the given image file.");
+
+    // map with section layout, the image is neither loaded nor relocated by the loader
+    if((hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY | SEC_IMAGE, 0, 0, NULL)) == NULL)
+        THROW(STATUS_INVALID_PARAMETER_1, L"The given file is not a valid image.");
+
+    if((Image.Base = (UCHAR*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0)) == NULL)
+        THROW(STATUS_NO_MEMORY, L"Unable to map the given image file.");
+
+    DosHeader = (IMAGE_DOS_HEADER*)Image.Base;
+    NtHeaders = (IMAGE_NT_HEADERS*)(Image.Base + DosHeader->e_lfanew);
+
+#ifdef _M_X64
+    if(NtHeaders->FileHeader.Machine != IMAGE_FILE_MACHINE_AMD64)
+#else
+    if(NtHeaders->FileHeader.Machine != IMAGE_FILE_MACHINE_I386)
+#endif
+        THROW(STATUS_NOT_SUPPORTED, L"The given image does not match the architecture of this library.");
+
+    Image.ImageSize = NtHeaders->OptionalHeader.SizeOfImage;
+    Image.ImageBase = NtHeaders->OptionalHeader.ImageBase;
+    Image.Sections = IMAGE_FIRST_SECTION(NtHeaders);
+    Image.SectionCount = NtHeaders->FileHeader.NumberOfSections;
+
+    // parse the export directory once, all workers share it
+    ExportData = &NtHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+
+    if((ExportData->VirtualAddress == 0) || ((ULONGLONG)ExportData->VirtualAddress + sizeof(IMAGE_EXPORT_DIRECTORY) > Image.ImageSize))
+        THROW(STATUS_NOT_FOUND, L"The given image has no exports.");
+
+    Exports = (IMAGE_EXPORT_DIRECTORY*)(Image.Base + ExportData->VirtualAddress);
+
+    if(((ULONGLONG)Exports->AddressOfFunctions + Exports->NumberOfFunctions * 4ULL > Image.ImageSize) ||
+            ((ULONGLONG)Exports->AddressOfNames + Exports->NumberOfNames * 4ULL > Image.ImageSize) ||
+            ((ULONGLONG)Exports->AddressOfNameOrdinals + Exports->NumberOfNames * 2ULL > Image.ImageSize))
+        THROW(STATUS_NOT_FOUND, L"The export directory of the given image is invalid.");
+
+    Image.ExportStart = ExportData->VirtualAddress;
+    Image.ExportEnd = ExportData->VirtualAddress + ExportData->Size;
+    Image.AddressOfFunctions = (DWORD*)(Image.Base + Exports->AddressOfFunctions);
+    Image.NumberOfFunctions = Exports->NumberOfFunctions;
+    Image.AddressOfNames = (DWORD*)(Image.Base + Exports->AddressOfNames);
+    Image.AddressOfOrdinals = (WORD*)(Image.Base + Exports->AddressOfNameOrdinals);
+
+    // select exports
+    if((Image.NameIndices = (ULONG*)RtlAllocateMemory(FALSE, Exports->NumberOfNames * sizeof(ULONG) + 1)) == NULL)
+        THROW(STATUS_NO_MEMORY, L"Not enough memory to test exports.");
+
+    for(Index = 0; Index < Exports->NumberOfNames; Index++)
+    {
+        if((options.FilterByName != NULL) && (strlen(options.FilterByName) > 0))
+        {
+            if(((Name = TestFuncImageString(&Image, Image.AddressOfNames[Index])) == NULL) || (_stricmp(Name, options.FilterByName) != 0))
+                continue;
+        }
+
+        Image.NameIndices[Image.Count++] = Index;
+    }
+
+    // reserve one result slot per export, the strings are compacted as they arrive
+    if(!TestFuncBuilderReserve(&Image.Builder, Image.Count))
+        THROW(STATUS_NO_MEMORY, L"Not enough memory to test exports.");
+
+    Image.Builder.Count = Image.Count;
+
+    // test exports, the calling thread is one of the workers
+    if(InThreadCount == 0)
+    {
+        GetSystemInfo(&SysInfo);
+
+        InThreadCount = SysInfo.dwNumberOfProcessors;
+    }
+
+    if(InThreadCount > MAXIMUM_WAIT_OBJECTS)
+        InThreadCount = MAXIMUM_WAIT_OBJECTS;
+
+    if(InThreadCount > Image.Count)
+        InThreadCount = Image.Count;
+
+    for(ThreadCount = 0; ThreadCount + 1 < InThreadCount; ThreadCount++)
+    {
+        // if a thread can't be created, the others just take its share
+        if((hThreads[ThreadCount] = CreateThread(NULL, 0, TestFuncImageWorker, &Image, 0, NULL)) == NULL)
+            break;
+    }
+
+    TestFuncImageWorker(&Image);
+
+    if(ThreadCount > 0)
+        WaitForMultipleObjects(ThreadCount, hThreads, TRUE, INFINITE);
+
+    FORCE(TestFuncBuilderFinish(&Image.Builder, outResults, resultCount));
+
+    // write to file
+    if((options.Filename != NULL) && (strlen(options.Filename) > 0))
+    {
+        if(!TestFuncWriteResults(options.Filename, *outResults, (ULONG)*resultCount))
+        {
+            ReleaseTestFuncHookResults(*outResults, *resultCount);
+
+            *outResults = NULL;
+            *resultCount = 0;
+
+            THROW(STATUS_NOT_FOUND, L"Unable to write the results file.");
+        }
+    }
+
+    RETURN;
+
+THROW_OUTRO:
+FINALLY_OUTRO:
+    {
+        for(Index = 0; Index < ThreadCount; Index++)
+        {
+            CloseHandle(hThreads[Index]);
+        }
+
+        TestFuncBuilderRelease(&Image.Builder);
+        RtlDeleteLock(&Image.BuilderLock);
+
+        if(Image.NameIndices != NULL)
+            RtlFreeMemory(Image.NameIndices);
+
+        if(Image.Base != NULL)
+            UnmapViewOfFile(Image.Base);
+
+        if(hMapping != NULL)
+            CloseHandle(hMapping);
+
+        if(hFile != INVALID_HANDLE_VALUE)
+            CloseHandle(hFile);
+
+        return NtStatus;
+    }
+}
@@ -24,6 +24,7 @@
 // about the project and latest updates.
 
 #include "stdafx.h"
+#include <emmintrin.h>
 
 void RtlInitializeLock(RTL_SPIN_LOCK* OutLock)
 {
@@ -62,17 +63,75 @@ void RtlSleep(ULONG InTimeout)
     Sleep(InTimeout);
 }
 
+ULONG RtlGetMilliseconds()
+{
+    return GetTickCount();
+}
+
+
+/*
+    The memory routines don't rely on the CRT. Blocks of at least 16 bytes are
+    processed with SSE2, which every supported processor provides. The first
+    and the last 16 bytes are handled with unaligned accesses that may overlap
+    the aligned middle part, so no byte loops are needed for them. Smaller
+    blocks are processed word by word.
+*/
+#define RTL_SSE2_BLOCK_SIZE         16
 
 void RtlCopyMemory(
             PVOID InDest,
             PVOID InSource,
             ULONG InByteCount)
 {
-    ULONG       Index;
     UCHAR*      Dest = (UCHAR*)InDest;
     UCHAR*      Src = (UCHAR*)InSource;
+    ULONG       Head;
+
+    if(InByteCount >= RTL_SSE2_BLOCK_SIZE)
+    {
+        // align destination
+        Head = RTL_SSE2_BLOCK_SIZE - ((ULONG_PTR)Dest & (RTL_SSE2_BLOCK_SIZE - 1));
+
+        _mm_storeu_si128((__m128i*)Dest, _mm_loadu_si128((__m128i*)Src));
+
+        Dest += Head;
+        Src += Head;
+        InByteCount -= Head;
+
+        for(; InByteCount >= 4 * RTL_SSE2_BLOCK_SIZE; InByteCount -= 4 * RTL_SSE2_BLOCK_SIZE)
+        {
+            _mm_store_si128((__m128i*)Dest, _mm_loadu_si128((__m128i*)Src));
+            _mm_store_si128((__m128i*)(Dest + 16), _mm_loadu_si128((__m128i*)(Src + 16)));
+            _mm_store_si128((__m128i*)(Dest + 32), _mm_loadu_si128((__m128i*)(Src + 32)));
+            _mm_store_si128((__m128i*)(Dest + 48), _mm_loadu_si128((__m128i*)(Src + 48)));
+
+            Dest += 4 * RTL_SSE2_BLOCK_SIZE;
+            Src += 4 * RTL_SSE2_BLOCK_SIZE;
+        }
+
+        for(; InByteCount >= RTL_SSE2_BLOCK_SIZE; InByteCount -= RTL_SSE2_BLOCK_SIZE)
+        {
+            _mm_store_si128((__m128i*)Dest, _mm_loadu_si128((__m128i*)Src));
+
+            Dest += RTL_SSE2_BLOCK_SIZE;
+            Src += RTL_SSE2_BLOCK_SIZE;
+        }
+
+        _mm_storeu_si128((__m128i*)(Dest + InByteCount - RTL_SSE2_BLOCK_SIZE), 
+            _mm_loadu_si128((__m128i*)(Src + InByteCount - RTL_SSE2_BLOCK_SIZE)));
+
+        return;
+    }
 
-    for(Index = 0; Index < InByteCount; Index++)
+    for(; InByteCount >= sizeof(ULONG_PTR); InByteCount -= sizeof(ULONG_PTR))
+    {
+        *((ULONG_PTR*)Dest) = *((ULONG_PTR*)Src);
+
+        Dest += sizeof(ULONG_PTR);
+        Src += sizeof(ULONG_PTR);
+    }
+
+    for(; InByteCount > 0; InByteCount--)
     {
         *Dest = *Src;
 
@@ -81,43 +140,141 @@ void RtlCopyMemory(
     }
 }
 
-BOOL RtlMoveMemory(
+void RtlMoveMemory(
             PVOID InDest,
             PVOID InSource,
             ULONG InByteCount)
 {
-    PVOID       Buffer = RtlAllocateMemory(FALSE, InByteCount);
+/*
+Description:
+
+    Copies possibly overlapping memory without allocating a buffer. If the
+    destination starts within the source, the block is copied backwards.
+    Each block is completely loaded before it is stored, so no source
+    byte is overwritten before it was read.
+*/
+    UCHAR*      Dest = (UCHAR*)InDest;
+    UCHAR*      Src = (UCHAR*)InSource;
 
-    if(Buffer == NULL)
-        return FALSE;
+    if((Dest <= Src) || (Dest >= Src + InByteCount))
+    {
+        if(Dest + InByteCount <= Src)
+        {
+            // no overlap at all
+            RtlCopyMemory(Dest, Src, InByteCount);
 
-    RtlCopyMemory(Buffer, InSource, InByteCount);
-    RtlCopyMemory(InDest, Buffer, InByteCount);
+            return;
+        }
 
-    RtlFreeMemory(Buffer);
-    return TRUE;
+        for(; InByteCount >= RTL_SSE2_BLOCK_SIZE; InByteCount -= RTL_SSE2_BLOCK_SIZE)
+        {
+            _mm_storeu_si128((__m128i*)Dest, _mm_loadu_si128((__m128i*)Src));
+
+            Dest += RTL_SSE2_BLOCK_SIZE;
+            Src += RTL_SSE2_BLOCK_SIZE;
+        }
+
+        for(; InByteCount >= sizeof(ULONG_PTR); InByteCount -= sizeof(ULONG_PTR))
+        {
+            *((ULONG_PTR*)Dest) = *((ULONG_PTR*)Src);
+
+            Dest += sizeof(ULONG_PTR);
+            Src += sizeof(ULONG_PTR);
+        }
+
+        for(; InByteCount > 0; InByteCount--)
+        {
+            *Dest = *Src;
+
+            Dest++;
+            Src++;
+        }
+    }
+    else
+    {
+        Dest += InByteCount;
+        Src += InByteCount;
+
+        for(; InByteCount >= RTL_SSE2_BLOCK_SIZE; InByteCount -= RTL_SSE2_BLOCK_SIZE)
+        {
+            Dest -= RTL_SSE2_BLOCK_SIZE;
+            Src -= RTL_SSE2_BLOCK_SIZE;
+
+            _mm_storeu_si128((__m128i*)Dest, _mm_loadu_si128((__m128i*)Src));
+        }
+
+        for(; InByteCount >= sizeof(ULONG_PTR); InByteCount -= sizeof(ULONG_PTR))
+        {
+            Dest -= sizeof(ULONG_PTR);
+            Src -= sizeof(ULONG_PTR);
+
+            *((ULONG_PTR*)Dest) = *((ULONG_PTR*)Src);
+        }
+
+        for(; InByteCount > 0; InByteCount--)
+        {
+            Dest--;
+            Src--;
+
+            *Dest = *Src;
+        }
+    }
 }
 
-#ifndef _DEBUG
-    #pragma optimize ("", off) // suppress _memset
-#endif
 void RtlZeroMemory(
             PVOID InTarget,
             ULONG InByteCount)
 {
-    ULONG           Index;
     UCHAR*          Target = (UCHAR*)InTarget;
+    __m128i         Zero = _mm_setzero_si128();
+    ULONG           Head;
+
+    if(InByteCount >= RTL_SSE2_BLOCK_SIZE)
+    {
+        _mm_storeu_si128((__m128i*)(Target + InByteCount - RTL_SSE2_BLOCK_SIZE), Zero);
 
-    for(Index = 0; Index < InByteCount; Index++)
+        // align target
+        Head = RTL_SSE2_BLOCK_SIZE - ((ULONG_PTR)Target & (RTL_SSE2_BLOCK_SIZE - 1));
+
+        _mm_storeu_si128((__m128i*)Target, Zero);
+
+        Target += Head;
+        InByteCount -= Head;
+
+        for(; InByteCount >= 4 * RTL_SSE2_BLOCK_SIZE; InByteCount -= 4 * RTL_SSE2_BLOCK_SIZE)
+        {
+            _mm_store_si128((__m128i*)Target, Zero);
+            _mm_store_si128((__m128i*)(Target + 16), Zero);
+            _mm_store_si128((__m128i*)(Target + 32), Zero);
+            _mm_store_si128((__m128i*)(Target + 48), Zero);
+
+            Target += 4 * RTL_SSE2_BLOCK_SIZE;
+        }
+
+        for(; InByteCount >= RTL_SSE2_BLOCK_SIZE; InByteCount -= RTL_SSE2_BLOCK_SIZE)
+        {
+            _mm_store_si128((__m128i*)Target, Zero);
+
+            Target += RTL_SSE2_BLOCK_SIZE;
+        }
+
+        return;
+    }
+
+    for(; InByteCount >= sizeof(ULONG_PTR); InByteCount -= sizeof(ULONG_PTR))
+    {
+        *((ULONG_PTR*)Target) = 0;
+
+        Target += sizeof(ULONG_PTR);
+    }
+
+    for(; InByteCount > 0; InByteCount--)
     {
         *Target = 0;
 
         Target++;
     }
 }
-#ifndef _DEBUG
-    #pragma optimize ("", on) 
-#endif
 
 
 void* RtlAllocateMemory(BOOL InZeroMemory, ULONG InSize)
@@ -74,6 +74,24 @@ void LhBarrierProcessDetach();
 ULONGLONG LhBarrierIntro(LOCAL_HOOK_INFO* InHandle, void* InRetAddr, void** InAddrOfRetAddr);
 void* __stdcall LhBarrierOutro(LOCAL_HOOK_INFO* InHandle, void** InAddrOfRetAddr);
 
+typedef struct _LH_SUSPENDED_THREAD_
+{
+    ULONG               ThreadId;
+    HANDLE              hThread; // NULL if the thread wasn't suspended
+    BOOL                HasIP;
+    UCHAR*              IP;
+}LH_SUSPENDED_THREAD;
+
+typedef struct _LH_SUSPENDED_THREADS_
+{
+    ULONG                   Count;
+    LH_SUSPENDED_THREAD*    Threads;
+}LH_SUSPENDED_THREADS;
+
+NTSTATUS LhSuspendOtherThreads(LH_SUSPENDED_THREADS* OutThreads);
+void LhResumeOtherThreads(LH_SUSPENDED_THREADS* InThreads);
+BOOL LhIsThreadWithin(LH_SUSPENDED_THREADS* InThreads, void* InStart, ULONG InSize);
+
 LONG DbgRelocateRIPRelative(
 	        ULONGLONG InOffset,
 	        ULONGLONG InTargetOffset,
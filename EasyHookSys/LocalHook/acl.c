@@ -52,14 +52,14 @@ Parameters:
 
     - InProcessCount
         The count of entries listed in the process ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 */
 
     ULONG           Index;
 
     ASSERT(IsValidPointer(InAcl, sizeof(HOOK_ACL)),L"acl.c - IsValidPointer(InAcl, sizeof(HOOK_ACL))");
 
-    if(InProcessCount > MAX_ACE_COUNT)
+    if(InProcessCount > LH_MAX_ACL_COUNT)
         return STATUS_INVALID_PARAMETER_2;
 
     if(!IsValidPointer(InProcessIdList, InProcessCount * sizeof(ULONG)))
@@ -71,13 +71,8 @@ Parameters:
             InProcessIdList[Index] = (ULONG)PsGetCurrentProcessId();
     }
 
-    // set ACL...
-    InAcl->IsExclusive = InIsExclusive;
-    InAcl->Count = InProcessCount;
-
-    RtlCopyMemory(InAcl->Entries, InProcessIdList, InProcessCount * sizeof(ULONG));
-
-    return STATUS_SUCCESS;
+    // compile and publish ACL...
+    return LhUpdateACL(InAcl, InIsExclusive, InProcessIdList, InProcessCount);
 }
 
 EASYHOOK_NT_EXPORT LhSetInclusiveACL(
@@ -100,7 +95,7 @@ Parameters:
 
     - InProcessCount
         The count of entries listed in the process ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 
     - InHandle
         The hook handle whose local ACL is going to be set.
@@ -130,7 +125,7 @@ Parameters:
 
     - InProcessCount
         The count of entries listed in the process ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 
     - InHandle
         The hook handle whose local ACL is going to be set.
@@ -159,7 +154,7 @@ Parameters:
 
     - InProcessCount
         The count of entries listed in the process ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 */
     return LhSetACL(LhBarrierGetAcl(), FALSE, InProcessIdList, InProcessCount);
 }
@@ -180,7 +175,7 @@ Parameters:
 
     - InProcessCount
         The count of entries listed in the process ID list. This value must not exceed
-        MAX_ACE_COUNT! 
+        LH_MAX_ACL_COUNT.
 */
     return LhSetACL(LhBarrierGetAcl(), TRUE, InProcessIdList, InProcessCount);
 }
\ No newline at end of file
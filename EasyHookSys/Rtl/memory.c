@@ -59,17 +59,48 @@ void RtlSleep(ULONG InTimeout)
     KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, &DueTime);
 }
 
+ULONG RtlGetMilliseconds()
+{
+	LARGE_INTEGER		Ticks;
+
+	KeQueryTickCount(&Ticks);
+
+	return (ULONG)((Ticks.QuadPart * KeQueryTimeIncrement()) / 10000);
+}
+
 
+/*
+    The memory routines don't rely on the CRT and process whole words where
+    possible. Unaligned word accesses are fine on all supported processors.
+*/
 void RtlCopyMemory(
             PVOID InDest,
             PVOID InSource,
             ULONG InByteCount)
 {
-    ULONG       Index;
     UCHAR*      Dest = (UCHAR*)InDest;
     UCHAR*      Src = (UCHAR*)InSource;
 
-    for(Index = 0; Index < InByteCount; Index++)
+    for(; InByteCount >= 4 * sizeof(ULONG_PTR); InByteCount -= 4 * sizeof(ULONG_PTR))
+    {
+        ((ULONG_PTR*)Dest)[0] = ((ULONG_PTR*)Src)[0];
+        ((ULONG_PTR*)Dest)[1] = ((ULONG_PTR*)Src)[1];
+        ((ULONG_PTR*)Dest)[2] = ((ULONG_PTR*)Src)[2];
+        ((ULONG_PTR*)Dest)[3] = ((ULONG_PTR*)Src)[3];
+
+        Dest += 4 * sizeof(ULONG_PTR);
+        Src += 4 * sizeof(ULONG_PTR);
+    }
+
+    for(; InByteCount >= sizeof(ULONG_PTR); InByteCount -= sizeof(ULONG_PTR))
+    {
+        *((ULONG_PTR*)Dest) = *((ULONG_PTR*)Src);
+
+        Dest += sizeof(ULONG_PTR);
+        Src += sizeof(ULONG_PTR);
+    }
+
+    for(; InByteCount > 0; InByteCount--)
     {
         *Dest = *Src;
 
@@ -78,44 +109,101 @@ void RtlCopyMemory(
     }
 }
 
-BOOL RtlMoveMemory(
+void RtlMoveMemory(
             PVOID InDest,
             PVOID InSource,
             ULONG InByteCount)
 {
-    PVOID       Buffer = RtlAllocateMemory(FALSE, InByteCount);
+/*
+Description:
 
-    if(Buffer == NULL)
-        return FALSE;
+    Copies possibly overlapping memory without allocating a buffer. If the
+    destination starts within the source, the block is copied backwards.
+    Each word is completely loaded before it is stored, so no source byte
+    is overwritten before it was read.
+*/
+    UCHAR*      Dest = (UCHAR*)InDest;
+    UCHAR*      Src = (UCHAR*)InSource;
 
-    RtlCopyMemory(Buffer, InSource, InByteCount);
-    RtlCopyMemory(InDest, Buffer, InByteCount);
+    if(Dest + InByteCount <= Src)
+    {
+        // no overlap at all
+        RtlCopyMemory(Dest, Src, InByteCount);
 
-	RtlFreeMemory(Buffer);
+        return;
+    }
 
-    return TRUE;
+    if((Dest <= Src) || (Dest >= Src + InByteCount))
+    {
+        for(; InByteCount >= sizeof(ULONG_PTR); InByteCount -= sizeof(ULONG_PTR))
+        {
+            *((ULONG_PTR*)Dest) = *((ULONG_PTR*)Src);
+
+            Dest += sizeof(ULONG_PTR);
+            Src += sizeof(ULONG_PTR);
+        }
+
+        for(; InByteCount > 0; InByteCount--)
+        {
+            *Dest = *Src;
+
+            Dest++;
+            Src++;
+        }
+
+        return;
+    }
+
+    Dest += InByteCount;
+    Src += InByteCount;
+
+    for(; InByteCount >= sizeof(ULONG_PTR); InByteCount -= sizeof(ULONG_PTR))
+    {
+        Dest -= sizeof(ULONG_PTR);
+        Src -= sizeof(ULONG_PTR);
+
+        *((ULONG_PTR*)Dest) = *((ULONG_PTR*)Src);
+    }
+
+    for(; InByteCount > 0; InByteCount--)
+    {
+        Dest--;
+        Src--;
+
+        *Dest = *Src;
+    }
 }
 
-#ifndef _DEBUG
-    #pragma optimize ("", off) // suppress _memset
-#endif
 void RtlZeroMemory(
             PVOID InTarget,
             ULONG InByteCount)
 {
-    ULONG           Index;
     UCHAR*          Target = (UCHAR*)InTarget;
 
-    for(Index = 0; Index < InByteCount; Index++)
+    for(; InByteCount >= 4 * sizeof(ULONG_PTR); InByteCount -= 4 * sizeof(ULONG_PTR))
+    {
+        ((ULONG_PTR*)Target)[0] = 0;
+        ((ULONG_PTR*)Target)[1] = 0;
+        ((ULONG_PTR*)Target)[2] = 0;
+        ((ULONG_PTR*)Target)[3] = 0;
+
+        Target += 4 * sizeof(ULONG_PTR);
+    }
+
+    for(; InByteCount >= sizeof(ULONG_PTR); InByteCount -= sizeof(ULONG_PTR))
+    {
+        *((ULONG_PTR*)Target) = 0;
+
+        Target += sizeof(ULONG_PTR);
+    }
+
+    for(; InByteCount > 0; InByteCount--)
     {
         *Target = 0;
 
         Target++;
     }
 }
-#ifndef _DEBUG
-    #pragma optimize ("", on) 
-#endif
 
 
 void* RtlAllocateMemory(BOOL InZeroMemory, ULONG InSize)
@@ -73,7 +73,11 @@ extern "C"{
 #define EASYHOOK_NT_EXPORT          EXTERN_C NTSTATUS EASYHOOK_API
 #define EASYHOOK_BOOL_EXPORT        EXTERN_C BOOL EASYHOOK_API
 
+// default limit of simultaneously installed hooks, see LhSetMaxHookCount()
 #define MAX_HOOK_COUNT              1024
+// limit of hooks whose memory is kept until unload, see EASYHOOK_HOOK_FAST_TRAMPOLINE
+#define MAX_PINNED_HOOK_COUNT       4096
+// obsolete, ACLs are no longer limited to this count but to 0x100000 IDs
 #define MAX_ACE_COUNT               128
 #define MAX_THREAD_COUNT            128
 #define MAX_PASSTHRU_SIZE           1024 * 64
@@ -99,12 +103,80 @@ DRIVER_SHARED_API(NTSTATUS, LhInstallHook(
             void* InCallback,
             TRACED_HOOK_HANDLE OutHandle));
 
+#define EASYHOOK_HOOK_DEFAULT               0x00000000
+/*
+    No thread deadlock barrier, ACLs and barrier APIs, see LhInstallHookEx().
+    The memory of such a hook is only released on unload, so every install
+    and uninstall cycle keeps one hook block. At most MAX_PINNED_HOOK_COUNT
+    of them may exist, installed or not; further installs fail.
+*/
+#define EASYHOOK_HOOK_FAST_TRAMPOLINE       0x00000001
+// maintain statistics for LhGetHookStatistics()
+#define EASYHOOK_HOOK_STATISTICS            0x00000002
+// also intercept calls within the OS loader lock
+#define EASYHOOK_HOOK_NO_LOADER_LOCK_CHECK  0x00000004
+
+DRIVER_SHARED_API(NTSTATUS, LhInstallHookEx(
+            void* InEntryPoint,
+            void* InHookProc,
+            void* InCallback,
+            ULONG InFlags,
+            TRACED_HOOK_HANDLE OutHandle));
+
+typedef struct _HOOK_INSTALL_ENTRY_
+{
+    void*                   EntryPoint;
+    void*                   HookProc;
+    void*                   Callback;
+    ULONG                   Flags; // EASYHOOK_HOOK_*, see LhInstallHookEx()
+    TRACED_HOOK_HANDLE      Handle;
+    NTSTATUS                Status;
+}HOOK_INSTALL_ENTRY;
+
+DRIVER_SHARED_API(NTSTATUS, LhInstallHooks(
+            HOOK_INSTALL_ENTRY* InEntries,
+            ULONG InCount,
+            BOOL InAllOrNothing));
+
+DRIVER_SHARED_API(NTSTATUS, LhSetMaxHookCount(ULONG InMaxHookCount));
+
 DRIVER_SHARED_API(NTSTATUS, LhUninstallAllHooks());
 
 DRIVER_SHARED_API(NTSTATUS, LhUninstallHook(TRACED_HOOK_HANDLE InHandle));
 
 DRIVER_SHARED_API(NTSTATUS, LhWaitForPendingRemovals());
 
+DRIVER_SHARED_API(NTSTATUS, LhUninstallHooksAsync(
+            TRACED_HOOK_HANDLE* InHandles,
+            ULONG InCount));
+
+/*
+    Statistics of hooks installed with EASYHOOK_HOOK_STATISTICS. Handler
+    latencies are measured in time stamp counter ticks; bucket N counts
+    latencies in [2^N, 2^(N+1)), the last bucket also all larger ones.
+*/
+#define HOOK_BYPASS_LOADER_LOCK             0
+#define HOOK_BYPASS_SELF_PROTECTION         1
+#define HOOK_BYPASS_RECURSION               2
+#define HOOK_BYPASS_ACL                     3
+#define HOOK_BYPASS_RESOURCES               4
+#define HOOK_BYPASS_REASON_COUNT            5
+
+#define HOOK_LATENCY_BUCKET_COUNT           32
+
+typedef struct _HOOK_STATISTICS_
+{
+    // calls that entered the hook handler
+    ULONGLONG               CallCount;
+    // calls passed to the original method, by HOOK_BYPASS_*
+    ULONGLONG               BypassCount[HOOK_BYPASS_REASON_COUNT];
+    ULONGLONG               LatencyHistogram[HOOK_LATENCY_BUCKET_COUNT];
+}HOOK_STATISTICS;
+
+DRIVER_SHARED_API(NTSTATUS, LhGetHookStatistics(
+            TRACED_HOOK_HANDLE InHandle,
+            HOOK_STATISTICS* OutStatistics));
+
 /*
     Setup the ACLs after hook installation. Please note that every
     hook starts suspended. You will have to set a proper ACL to
@@ -377,6 +449,27 @@ DRIVER_SHARED_API(NTSTATUS, LhBarrierCallStackTrace(
         TEST_FUNC_HOOKS_RESULT** outResults,
         int* resultCount);
 
+    /*
+        Receives a single result of TestFuncHooksEx(), which is only valid
+        during the call. Return FALSE to stop testing.
+    */
+    typedef BOOL __stdcall TEST_FUNC_HOOKS_CALLBACK(
+        TEST_FUNC_HOOKS_RESULT* InResult,
+        void* InContext);
+
+    EASYHOOK_NT_EXPORT TestFuncHooksEx(ULONG pId,
+        PCHAR module,
+        TEST_FUNC_HOOKS_OPTIONS options,
+        TEST_FUNC_HOOKS_CALLBACK* InCallback,
+        void* InContext);
+
+    EASYHOOK_NT_EXPORT TestFuncHooksInImage(
+        PWCHAR InImagePath,
+        TEST_FUNC_HOOKS_OPTIONS options,
+        ULONG InThreadCount,
+        TEST_FUNC_HOOKS_RESULT** outResults,
+        int* resultCount);
+
     EASYHOOK_NT_EXPORT ReleaseTestFuncHookResults(TEST_FUNC_HOOKS_RESULT* results, int count);
 	/*
 		Injection support API.
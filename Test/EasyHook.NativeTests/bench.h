@@ -0,0 +1,136 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench.h)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+    Benchmarks report the mean time of one iteration. Results are only
+    comparable between runs on the same machine.
+*/
+static double BenchNow()
+{
+    struct timespec     Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    return Now.tv_sec * 1e9 + Now.tv_nsec;
+}
+
+#define BENCH_RUN(Name, Iterations, Statement)\
+    do\
+    {\
+        long long   Iteration;\
+        double      Start = BenchNow();\
+        for(Iteration = 0; Iteration < (Iterations); Iteration++)\
+        {\
+            Statement;\
+        }\
+        printf("%-48s %10.1f ns\n", Name, (BenchNow() - Start) / (Iterations));\
+    }while(0)
+
+/*
+    Runs a routine on several threads at once, each for the given number
+    of iterations, and reports the iterations per second of all threads.
+*/
+typedef void (*BENCH_ROUTINE)(void* InParameter, long long InIteration);
+
+typedef struct _BENCH_THREAD_
+{
+    BENCH_ROUTINE       Routine;
+    void*               Parameter;
+    long long           Iterations;
+    pthread_barrier_t*  Start;
+}BENCH_THREAD;
+
+static inline void* BenchThreadStart(void* InThread)
+{
+    BENCH_THREAD*       Thread = (BENCH_THREAD*)InThread;
+    long long           Iteration;
+
+    pthread_barrier_wait(Thread->Start);
+
+    for(Iteration = 0; Iteration < Thread->Iterations; Iteration++)
+    {
+        Thread->Routine(Thread->Parameter, Iteration);
+    }
+
+    return NULL;
+}
+
+static inline void BenchParallel(
+            const char* InName,
+            const char* InUnit,
+            unsigned int InThreadCount,
+            long long InIterations,
+            BENCH_ROUTINE InRoutine,
+            void* InParameter)
+{
+    pthread_t           Threads[256];
+    BENCH_THREAD        Thread = { InRoutine, InParameter, InIterations, NULL };
+    pthread_barrier_t   Start;
+    unsigned int        Index;
+    unsigned int        Count = 0;
+    double              Begin;
+
+    pthread_barrier_init(&Start, NULL, InThreadCount + 1);
+
+    Thread.Start = &Start;
+
+    for(Index = 0; (Index < InThreadCount) && (Index < 256); Index++)
+    {
+        if(pthread_create(&Threads[Count], NULL, BenchThreadStart, &Thread) == 0)
+            Count++;
+    }
+
+    if(Count < InThreadCount)
+    {
+        printf("%-48s failed to start %u threads\n", InName, InThreadCount);
+
+        // nobody can pass the barrier anymore
+        _exit(1);
+    }
+
+    pthread_barrier_wait(&Start);
+
+    Begin = BenchNow();
+
+    for(Index = 0; Index < Count; Index++)
+    {
+        pthread_join(Threads[Index], NULL);
+    }
+
+    printf("%-48s %10.0f %s/s\n", InName, InIterations * Count / ((BenchNow() - Begin) / 1e9), InUnit);
+
+    pthread_barrier_destroy(&Start);
+}
+
+#endif
@@ -0,0 +1,141 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_acl.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "local_hook.h"
+#include "bench.h"
+
+/*
+    Measures the ACL check of the thread barrier for ACLs of 0 to 4096
+    entries, once evaluated for every call by IsThreadIntercepted() and
+    once for calls through a hook, which reuse the verdict cached in the
+    thread's runtime entry. Bumping the generation of the local ACL before
+    each call makes every call miss that cache.
+
+    The reader gate guarding the ACL tables is compared with a single
+    counter shared by all readers, which ACL checks used before. Both
+    only differ if threads run on several processors.
+*/
+#define BENCH_ITERATIONS        1000000
+#define BENCH_CALL_ITERATIONS   10000000
+#define BENCH_ID_BASE           0x100000
+
+static const ULONG      AclSizes[] = { 0, 16, 128, 4096 };
+static ULONG            Ids[4096];
+static volatile LONG    SharedCount = 0;
+static LH_READER_GATE   Gate;
+
+static void EnterGate(void* InParameter, long long InIteration)
+{
+    LhLeaveReaderGate(&Gate, LhEnterReaderGate(&Gate));
+}
+
+static void EnterSharedCount(void* InParameter, long long InIteration)
+{
+    InterlockedIncrement(&SharedCount);
+    InterlockedDecrement(&SharedCount);
+}
+
+static void CheckAcl(void* InParameter, long long InIteration)
+{
+    IsThreadIntercepted((HOOK_ACL*)InParameter, 0);
+}
+
+static void BenchReaders(unsigned int InThreadCount)
+{
+    char                Name[64];
+
+    snprintf(Name, sizeof(Name), "reader gate, %u thread%s", InThreadCount, (InThreadCount == 1)?"":"s");
+    BenchParallel(Name, "checks", InThreadCount, BENCH_ITERATIONS, EnterGate, NULL);
+
+    snprintf(Name, sizeof(Name), "shared reader count, %u thread%s", InThreadCount, (InThreadCount == 1)?"":"s");
+    BenchParallel(Name, "checks", InThreadCount, BENCH_ITERATIONS, EnterSharedCount, NULL);
+}
+
+static void BenchAcl(
+            LOCAL_HOOK_TARGET InTarget,
+            ULONG InCount,
+            unsigned int InThreadCount)
+{
+    HOOK_TRACE_INFO     Handle = { NULL };
+    LOCAL_HOOK_INFO*    Hook;
+    char                Name[64];
+
+    if(!NT_SUCCESS(LhInstallHookEx(InTarget, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handle)))
+        return;
+
+    // the calling thread is never listed, so it is intercepted
+    LhSetExclusiveACL(Ids, InCount, &Handle);
+
+    if(!LhIsValidHandle(&Handle, &Hook) || (InTarget(1) != 3))
+        printf("%-48s not intercepted\n", "ACL");
+
+    snprintf(Name, sizeof(Name), "IsThreadIntercepted, %u entries", InCount);
+    BENCH_RUN(Name, BENCH_ITERATIONS, CheckAcl(&Hook->LocalACL, Iteration));
+
+    snprintf(Name, sizeof(Name), "IsThreadIntercepted, %u entries, %u threads", InCount, InThreadCount);
+    BenchParallel(Name, "checks", InThreadCount, BENCH_ITERATIONS, CheckAcl, &Hook->LocalACL);
+
+    snprintf(Name, sizeof(Name), "hooked call, %u entries", InCount);
+    BENCH_RUN(Name, BENCH_CALL_ITERATIONS, InTarget((int)Iteration));
+
+    snprintf(Name, sizeof(Name), "hooked call, %u entries, not cached", InCount);
+    BENCH_RUN(Name, BENCH_CALL_ITERATIONS,
+        InterlockedIncrement(&Hook->LocalACL.Generation);
+        InTarget((int)Iteration));
+
+    LhUninstallHook(&Handle);
+    LhWaitForPendingRemovals();
+}
+
+int main()
+{
+    LOCAL_HOOK_TARGET   Target;
+    unsigned int        Processors = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    ULONG               Index;
+
+    LhBarrierProcessAttach();
+    LhCriticalInitialize();
+
+    if((Target = LocalHookCreateTarget()) == NULL)
+        return 1;
+
+    for(Index = 0; Index < ARRAYSIZE(Ids); Index++)
+    {
+        Ids[Index] = BENCH_ID_BASE + Index * 4;
+    }
+
+    BenchReaders(1);
+    BenchReaders(4);
+
+    if((Processors != 1) && (Processors != 4))
+        BenchReaders(Processors);
+
+    for(Index = 0; Index < ARRAYSIZE(AclSizes); Index++)
+    {
+        BenchAcl(Target, AclSizes[Index], (Processors > 4)?Processors:4);
+    }
+
+    return 0;
+}
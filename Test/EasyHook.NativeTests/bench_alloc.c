@@ -0,0 +1,273 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_alloc.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "bench.h"
+
+#include "../../DriverShared/LocalHook/alloc.c"
+
+/*
+    Places hook memory near an entry point within a simulated, heavily
+    fragmented address space. Around the entry point, 256 MB are used
+    except for gaps smaller than an allocation granule, further away
+    everything is free. Like on Windows, memory is reserved in whole
+    granules, so none of the gaps can be used.
+
+    The former allocator probed the address space page by page with
+    VirtualAlloc() for every hook. Slabs are placed with a map of free
+    regions built once by VirtualQuery(). Only the calls are simulated,
+    each of them is a system call on Windows.
+*/
+#define BENCH_MAX_FREE_RANGES       16384
+#define BENCH_GRANULARITY           0x10000ULL
+#define BENCH_PAGE_SIZE             0x1000ULL
+#define BENCH_TARGET                0x400000000000ULL
+#define BENCH_USED_SPAN             0x10000000ULL
+#define BENCH_PATTERN_SIZE          0x18000ULL
+#define BENCH_GAP_SIZE              0x8000ULL
+#define BENCH_ALLOCATIONS           100
+
+typedef struct _BENCH_RANGE_
+{
+    ULONGLONG       Base;
+    ULONGLONG       End;
+}BENCH_RANGE;
+
+static BENCH_RANGE      FreeRanges[BENCH_MAX_FREE_RANGES];
+static ULONG            FreeRangeCount = 0;
+static ULONG            QueryCount = 0;
+static ULONG            AllocCount = 0;
+
+ULONG GetTrampolineSize() { return 128; }
+
+void LhReleaseACL(HOOK_ACL* InAcl) { }
+
+static void AddFreeRange(ULONGLONG InBase, ULONGLONG InEnd)
+{
+    // ranges have to be added in ascending order
+    FreeRanges[FreeRangeCount].Base = InBase;
+    FreeRanges[FreeRangeCount].End = InEnd;
+
+    FreeRangeCount++;
+}
+
+static void CreateAddressSpace()
+{
+    ULONGLONG       Pattern;
+
+    FreeRangeCount = 0;
+    FreeRegionCount = 0;
+    IsFreeRegionMapValid = FALSE;
+
+    AddFreeRange(0x10000, BENCH_TARGET - BENCH_USED_SPAN);
+
+    // a gap in each pattern, never covering a whole granule
+    for(Pattern = BENCH_TARGET - BENCH_USED_SPAN; Pattern < BENCH_TARGET + BENCH_USED_SPAN; Pattern += BENCH_PATTERN_SIZE)
+    {
+        AddFreeRange(Pattern + BENCH_PATTERN_SIZE - BENCH_GAP_SIZE, Pattern + BENCH_PATTERN_SIZE);
+    }
+
+    AddFreeRange(Pattern + BENCH_GRANULARITY, 0x7FFFFFFF0000ULL);
+}
+
+static ULONG FindFreeRange(ULONGLONG InAddress)
+{
+    ULONG           Lower = 0;
+    ULONG           Upper = FreeRangeCount;
+    ULONG           Middle;
+
+    // returns the first range ending behind the address
+    while(Lower < Upper)
+    {
+        Middle = (Lower + Upper) / 2;
+
+        if(FreeRanges[Middle].End <= InAddress)
+            Lower = Middle + 1;
+        else
+            Upper = Middle;
+    }
+
+    return Lower;
+}
+
+SIZE_T VirtualQuery(LPCVOID InAddress, MEMORY_BASIC_INFORMATION* OutInfo, SIZE_T InSize)
+{
+    ULONGLONG       Address = (ULONGLONG)InAddress;
+    ULONG           Index = FindFreeRange(Address);
+
+    QueryCount++;
+
+    memset(OutInfo, 0, sizeof(MEMORY_BASIC_INFORMATION));
+
+    if((Index < FreeRangeCount) && (FreeRanges[Index].Base <= Address))
+    {
+        OutInfo->BaseAddress = (PVOID)FreeRanges[Index].Base;
+        OutInfo->RegionSize = FreeRanges[Index].End - FreeRanges[Index].Base;
+        OutInfo->State = MEM_FREE;
+
+        return sizeof(MEMORY_BASIC_INFORMATION);
+    }
+
+    OutInfo->BaseAddress = (PVOID)((Index > 0)?FreeRanges[Index - 1].End:0);
+    OutInfo->AllocationBase = OutInfo->BaseAddress;
+    OutInfo->RegionSize = ((Index < FreeRangeCount)?FreeRanges[Index].Base:0x800000000000ULL) - (ULONGLONG)OutInfo->BaseAddress;
+    OutInfo->State = MEM_COMMIT;
+    OutInfo->Type = MEM_PRIVATE;
+
+    return sizeof(MEMORY_BASIC_INFORMATION);
+}
+
+PVOID VirtualAlloc(PVOID InAddress, SIZE_T InSize, DWORD InType, DWORD InProtect)
+{
+    ULONGLONG       Base = (ULONGLONG)InAddress & ~(BENCH_GRANULARITY - 1);
+    ULONGLONG       End = LhRoundUp((ULONGLONG)InAddress + InSize, BENCH_GRANULARITY);
+    ULONG           Index = FindFreeRange(Base);
+    BENCH_RANGE*    Range = &FreeRanges[Index];
+
+    AllocCount++;
+
+    // whole granules are reserved
+    if((Index >= FreeRangeCount) || (Range->Base > Base) || (Range->End < End))
+        return NULL;
+
+    if(Range->Base == Base)
+        Range->Base = End;
+    else if(Range->End == End)
+        Range->End = Base;
+    else if(FreeRangeCount < BENCH_MAX_FREE_RANGES)
+    {
+        memmove(Range + 1, Range, (FreeRangeCount - Index) * sizeof(BENCH_RANGE));
+
+        Range[0].End = Base;
+        Range[1].Base = End;
+
+        FreeRangeCount++;
+    }
+    else
+        return NULL;
+
+    return (PVOID)Base;
+}
+
+static void* AllocatePageNear(void* InEntryPoint)
+{
+/*
+    The former LhAllocateMemoryEx(), probing outward from the entry point.
+*/
+    UCHAR*          Res = NULL;
+    SYSTEM_INFO     SysInfo;
+    LONGLONG        Base;
+    LONGLONG        iStart;
+    LONGLONG        iEnd;
+    LONGLONG        Index;
+    BOOL            IsEnd;
+
+    GetSystemInfo(&SysInfo);
+
+    iStart = ((LONGLONG)InEntryPoint) - ((LONGLONG)0x7FFFFF00);
+    iEnd = ((LONGLONG)InEntryPoint) + ((LONGLONG)0x7FFFFF00);
+
+    if(iStart < (LONGLONG)SysInfo.lpMinimumApplicationAddress)
+        iStart = (LONGLONG)SysInfo.lpMinimumApplicationAddress;
+
+    if(iEnd > (LONGLONG)SysInfo.lpMaximumApplicationAddress)
+        iEnd = (LONGLONG)SysInfo.lpMaximumApplicationAddress;
+
+    for(Base = (LONGLONG)InEntryPoint, Index = 0; ; Index += SysInfo.dwPageSize)
+    {
+        IsEnd = TRUE;
+
+        if(Base + Index < iEnd)
+        {
+            if((Res = (UCHAR*)VirtualAlloc((void*)(Base + Index), SysInfo.dwPageSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE)) != NULL)
+                break;
+
+            IsEnd = FALSE;
+        }
+
+        if(Base - Index > iStart)
+        {
+            if((Res = (UCHAR*)VirtualAlloc((void*)(Base - Index), SysInfo.dwPageSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE)) != NULL)
+                break;
+
+            IsEnd = FALSE;
+        }
+
+        if(IsEnd)
+            break;
+    }
+
+    return Res;
+}
+
+static void Report(const char* InName, double InStart)
+{
+    printf("%-48s %10.1f ns, %.1f VirtualQuery, %.1f VirtualAlloc\n", InName, (BenchNow() - InStart) / BENCH_ALLOCATIONS,
+        (double)QueryCount / BENCH_ALLOCATIONS, (double)AllocCount / BENCH_ALLOCATIONS);
+}
+
+int main()
+{
+    ULONG           Index;
+    ULONG           Failures = 0;
+    double          Start;
+
+    LhAllocatorInitialize();
+
+    CreateAddressSpace();
+
+    printf("%-48s %10lu\n", "free ranges", (unsigned long)FreeRangeCount);
+
+    QueryCount = 0;
+    AllocCount = 0;
+    Start = BenchNow();
+
+    for(Index = 0; Index < BENCH_ALLOCATIONS; Index++)
+    {
+        if(AllocatePageNear((void*)BENCH_TARGET) == NULL)
+            Failures++;
+    }
+
+    Report("page probing, per hook", Start);
+
+    CreateAddressSpace();
+
+    QueryCount = 0;
+    AllocCount = 0;
+    Start = BenchNow();
+
+    for(Index = 0; Index < BENCH_ALLOCATIONS; Index++)
+    {
+        if(LhAllocateSlabMemory((void*)BENCH_TARGET) == NULL)
+            Failures++;
+    }
+
+    Report("free region map, per slab", Start);
+
+    if(Failures > 0)
+        printf("%-48s %10lu\n", "failed allocations", (unsigned long)Failures);
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_caller.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "module_space.h"
+#include "bench.h"
+
+/*
+    Measures LhBarrierPointerToModule() against a simulated address space
+    with as many modules as a large process. VirtualQuery() is simulated, so
+    a miss costs one system call more on Windows.
+
+    Lookups from several threads are measured alone and while another
+    thread keeps publishing new snapshots, which are released through the
+    reader gate while lookups go on.
+*/
+#define BENCH_ITERATIONS        1000000
+#define BENCH_MODULE_COUNT      300
+#define BENCH_NEW_MODULE_COUNT  256
+#define BENCH_IMAGE_BASE        0x10000000ULL
+#define BENCH_PRIVATE_BASE      0x80000000ULL
+
+static volatile LONG    IsUpdating = FALSE;
+static volatile LONG    UpdateCount = 0;
+
+static UCHAR* RegionPointer(ULONGLONG InBase, long long InIndex, ULONG InCount)
+{
+    // spread lookups over all regions and within them
+    return (UCHAR*)(InBase + (InIndex % InCount) * MODULE_SPACE_REGION_SIZE + (InIndex * 64) % MODULE_SPACE_REGION_SIZE);
+}
+
+static void LookUpModule(void* InParameter, long long InIteration)
+{
+    MODULE_INFORMATION  Module;
+
+    LhBarrierPointerToModule(RegionPointer(BENCH_IMAGE_BASE, InIteration, BENCH_MODULE_COUNT), &Module);
+}
+
+static void* UpdateModules(void* InParameter)
+{
+    while(IsUpdating)
+    {
+        LhUpdateModuleInformation();
+
+        InterlockedIncrement(&UpdateCount);
+    }
+
+    return NULL;
+}
+
+static ULONG CountRetiredSnapshots()
+{
+    LH_MODULE_SNAPSHOT* Snapshot;
+    ULONG               Count = 0;
+    ULONG               Parity;
+
+    for(Parity = 0; Parity < 2; Parity++)
+    {
+        for(Snapshot = LhRetiredSnapshots[Parity]; Snapshot != NULL; Snapshot = Snapshot->Retired)
+        {
+            Count++;
+        }
+    }
+
+    return Count;
+}
+
+static void BenchLookups(unsigned int InThreadCount)
+{
+    pthread_t           Writer;
+    char                Name[64];
+
+    snprintf(Name, sizeof(Name), "hits, %u thread%s", InThreadCount, (InThreadCount == 1)?"":"s");
+    BenchParallel(Name, "lookups", InThreadCount, BENCH_ITERATIONS, LookUpModule, NULL);
+
+    IsUpdating = TRUE;
+    UpdateCount = 0;
+
+    if(pthread_create(&Writer, NULL, UpdateModules, NULL) != 0)
+        return;
+
+    snprintf(Name, sizeof(Name), "hits, %u thread%s, one updating", InThreadCount, (InThreadCount == 1)?"":"s");
+    BenchParallel(Name, "lookups", InThreadCount, BENCH_ITERATIONS, LookUpModule, NULL);
+
+    IsUpdating = FALSE;
+
+    pthread_join(Writer, NULL);
+
+    printf("%-48s %10ld updates, %lu retired\n", "", (long)UpdateCount, (unsigned long)CountRetiredSnapshots());
+}
+
+int main()
+{
+    MODULE_INFORMATION  Module;
+    unsigned int        Processors = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    ULONG               Index;
+
+    RtlInitializeLock(&GlobalHookLock);
+
+    for(Index = 0; Index < BENCH_MODULE_COUNT; Index++)
+    {
+        MapRegion(BENCH_IMAGE_BASE + Index * MODULE_SPACE_REGION_SIZE, MEM_IMAGE);
+        MapRegion(BENCH_PRIVATE_BASE + Index * MODULE_SPACE_REGION_SIZE, MEM_PRIVATE);
+    }
+
+    // the first lookup enumerates all modules
+    LhBarrierPointerToModule(RegionPointer(BENCH_IMAGE_BASE, 0, 1), &Module);
+
+    BENCH_RUN("hit, 300 modules", BENCH_ITERATIONS,
+        LhBarrierPointerToModule(RegionPointer(BENCH_IMAGE_BASE, Iteration, BENCH_MODULE_COUNT), &Module));
+    BENCH_RUN("miss on private memory, 300 modules", BENCH_ITERATIONS,
+        LhBarrierPointerToModule(RegionPointer(BENCH_PRIVATE_BASE, Iteration, BENCH_MODULE_COUNT), &Module));
+
+    BenchLookups(1);
+    BenchLookups(4);
+
+    if((Processors != 1) && (Processors != 4))
+        BenchLookups(Processors);
+
+    // modules loaded after the snapshot was taken are added one by one
+    for(Index = 0; Index < BENCH_NEW_MODULE_COUNT; Index++)
+    {
+        MapRegion(BENCH_IMAGE_BASE + (BENCH_MODULE_COUNT + Index) * MODULE_SPACE_REGION_SIZE, MEM_IMAGE);
+    }
+
+    BENCH_RUN("miss on a new module, 300 to 556 modules", BENCH_NEW_MODULE_COUNT,
+        LhBarrierPointerToModule(RegionPointer(BENCH_IMAGE_BASE + BENCH_MODULE_COUNT * MODULE_SPACE_REGION_SIZE, Iteration, BENCH_NEW_MODULE_COUNT), &Module));
+
+    // what each miss cost before, enumerating all modules again
+    BENCH_RUN("full enumeration, 556 modules", BENCH_NEW_MODULE_COUNT, LhUpdateModuleInformation());
+
+    ResetAddressSpace();
+
+    return 0;
+}
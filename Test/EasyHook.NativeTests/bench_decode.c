@@ -0,0 +1,104 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_decode.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "bench.h"
+
+#include "disassembler/udis86.h"
+
+/*
+    Compares the full ud_disassemble() that LhGetInstructionLength() used
+    to run against ud_insn_length(), at every offset of pseudo random code
+    and on a real prologue.
+*/
+#define BENCH_BUFFER_SIZE       0x100000
+#define BENCH_ITERATIONS        1000000
+
+static UCHAR            Buffer[BENCH_BUFFER_SIZE + 16];
+
+static const UCHAR      Prologue[] =
+{
+    0x48, 0x89, 0x5C, 0x24, 0x08,                       // mov [rsp+8], rbx
+    0x57,                                               // push rdi
+    0x48, 0x83, 0xEC, 0x20,                             // sub rsp, 20h
+    0x48, 0x8B, 0x05, 0x01, 0x02, 0x03, 0x00,           // mov rax, [rip+disp]
+    0x48, 0x85, 0xC0,                                   // test rax, rax
+    0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90,     // padding
+    0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90,
+};
+
+static volatile unsigned int    Sink;
+
+static unsigned int FullDecodeLength(const UCHAR* InCode)
+{
+    ud_t                Disasm;
+
+    ud_init(&Disasm);
+    ud_set_mode(&Disasm, 64);
+    ud_set_input_buffer(&Disasm, (UCHAR*)InCode, 16);
+
+    return ud_disassemble(&Disasm);
+}
+
+static void DecodePrologue(unsigned int (*InLength)(const UCHAR*))
+{
+    ULONG               Offset;
+
+    // what LhRoundToNextInstruction() does for a 5 byte jump
+    for(Offset = 0; Offset < 5; Offset += InLength(Prologue + Offset));
+
+    Sink = Offset;
+}
+
+static unsigned int LengthOnly(const UCHAR* InCode)
+{
+    return ud_insn_length(InCode, 16, 64);
+}
+
+int main()
+{
+    ULONG               State = 0x2545F491;
+    ULONG               Index;
+
+    for(Index = 0; Index < sizeof(Buffer); Index++)
+    {
+        State ^= State << 13;
+        State ^= State >> 17;
+        State ^= State << 5;
+
+        Buffer[Index] = (UCHAR)State;
+    }
+
+    BENCH_RUN("ud_disassemble (random bytes)", BENCH_ITERATIONS,
+        Sink = FullDecodeLength(Buffer + Iteration % BENCH_BUFFER_SIZE));
+    BENCH_RUN("ud_insn_length (random bytes)", BENCH_ITERATIONS,
+        Sink = LengthOnly(Buffer + Iteration % BENCH_BUFFER_SIZE));
+    BENCH_RUN("ud_disassemble (prologue, 5 bytes)", BENCH_ITERATIONS,
+        DecodePrologue(FullDecodeLength));
+    BENCH_RUN("ud_insn_length (prologue, 5 bytes)", BENCH_ITERATIONS,
+        DecodePrologue(LengthOnly));
+
+    return 0;
+}
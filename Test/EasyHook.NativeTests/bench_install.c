@@ -0,0 +1,305 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_install.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "local_hook.h"
+#include "bench.h"
+
+#include <errno.h>
+#include <semaphore.h>
+
+/*
+    Installs 1k, 10k and 50k hooks on distinct entry points and reports
+    the install time and the hook memory taken from the system. Each hook
+    used to take a page of its own, which on Windows also reserves a whole
+    allocation granule.
+
+    Startup is measured by installing 500 and 5000 hooks, once with one
+    LhInstallHookEx() call per hook and once with a single LhInstallHooks()
+    batch, which suspends all other threads while it writes the jumpers.
+
+    Churn installs and removes 64 hooks in a loop while 0 to 10k other
+    hooks stay installed. Their HLS slots and memory blocks have to be
+    reused, so neither the slot list nor the slab count grows.
+*/
+#define BENCH_MAX_HOOKS         50000
+#define BENCH_TARGET_SIZE       16
+#define BENCH_PAGE_SIZE         0x1000
+#define BENCH_GRANULARITY       0x10000
+#define BENCH_IDLE_THREADS      8
+#define BENCH_CHURN_HOOKS       64
+#define BENCH_CHURN_CYCLES      200
+
+static const ULONG      HookCounts[] = { 1000, 10000, 50000 };
+static const ULONG      StartupCounts[] = { 500, 5000 };
+static const ULONG      ResidentCounts[] = { 0, 1000, 10000 };
+static HOOK_TRACE_INFO  Handles[BENCH_MAX_HOOKS];
+static HOOK_INSTALL_ENTRY Entries[BENCH_MAX_HOOKS];
+static sem_t            Finished;
+
+static UCHAR* CreateTargets(ULONG InCount)
+{
+    UCHAR*              Targets = (UCHAR*)mmap(NULL, InCount * BENCH_TARGET_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ULONG               Index;
+
+    if(Targets == MAP_FAILED)
+        return NULL;
+
+    for(Index = 0; Index < InCount; Index++)
+    {
+        memcpy(Targets + Index * BENCH_TARGET_SIZE, LocalHookTargetCode, sizeof(LocalHookTargetCode));
+    }
+
+    return Targets;
+}
+
+static ULONG CountSlabs()
+{
+    LH_SLAB*            Slab;
+    ULONG               Count = 0;
+
+    for(Slab = SlabListHead; Slab != NULL; Slab = Slab->Next)
+    {
+        Count++;
+    }
+
+    for(Slab = FullSlabListHead; Slab != NULL; Slab = Slab->Next)
+    {
+        Count++;
+    }
+
+    return Count;
+}
+
+static void BenchInstall(ULONG InCount, UCHAR* InTargets)
+{
+    ULONG               Index;
+    ULONG               SlabCount;
+    NTSTATUS            NtStatus = STATUS_SUCCESS;
+    double              Start;
+    char                Name[64];
+
+    memset(Handles, 0, sizeof(Handles));
+
+    Start = BenchNow();
+
+    for(Index = 0; (Index < InCount) && NT_SUCCESS(NtStatus); Index++)
+    {
+        NtStatus = LhInstallHookEx(InTargets + Index * BENCH_TARGET_SIZE, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handles[Index]);
+    }
+
+    snprintf(Name, sizeof(Name), "LhInstallHookEx, %lu hooks", (unsigned long)InCount);
+
+    if(!NT_SUCCESS(NtStatus))
+        printf("%-48s failed with 0x%08X\n", Name, (ULONG)NtStatus);
+    else
+    {
+        printf("%-48s %10.1f ns\n", Name, (BenchNow() - Start) / InCount);
+
+        SlabCount = CountSlabs();
+
+        printf("%-48s %10lu KB in %lu slabs of %lu blocks\n", "  hook memory", (unsigned long)(SlabCount * (LH_SLAB_SIZE / 1024)),
+            (unsigned long)SlabCount, (unsigned long)FullSlabListHead->BlockCount);
+        printf("%-48s %10lu KB committed, %lu KB reserved\n", "  page per hook", (unsigned long)(InCount * (BENCH_PAGE_SIZE / 1024)),
+            (unsigned long)(InCount * (BENCH_GRANULARITY / 1024)));
+    }
+
+    // no thread is intercepted, so the hooks call the original code
+    if(((LOCAL_HOOK_TARGET)InTargets)(1) != 2)
+        printf("%-48s first target returned %d\n", Name, ((LOCAL_HOOK_TARGET)InTargets)(1));
+
+    LhUninstallAllHooks();
+    LhWaitForPendingRemovals();
+}
+
+static void BenchChurn(ULONG InResidentCount, UCHAR* InTargets)
+{
+    UCHAR*              Targets = InTargets + InResidentCount * BENCH_TARGET_SIZE;
+    ULONG               Index;
+    ULONG               Cycle;
+    ULONG               SlotCapacity;
+    ULONG               SlabCount;
+    ULONG               Failures = 0;
+    double              Start;
+    char                Name[64];
+
+    memset(Handles, 0, sizeof(Handles));
+
+    for(Index = 0; Index < InResidentCount; Index++)
+    {
+        if(!NT_SUCCESS(LhInstallHookEx(InTargets + Index * BENCH_TARGET_SIZE, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handles[Index])))
+            Failures++;
+    }
+
+    SlotCapacity = 0;
+    SlabCount = 0;
+    Start = BenchNow();
+
+    for(Cycle = 0; Cycle < BENCH_CHURN_CYCLES; Cycle++)
+    {
+        for(Index = 0; Index < BENCH_CHURN_HOOKS; Index++)
+        {
+            if(!NT_SUCCESS(LhInstallHookEx(Targets + Index * BENCH_TARGET_SIZE, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT,
+                    &Handles[InResidentCount + Index])))
+                Failures++;
+        }
+
+        // both are taken at the peak of the first cycle
+        if(Cycle == 0)
+        {
+            SlotCapacity = GlobalSlotCapacity;
+            SlabCount = CountSlabs();
+        }
+
+        for(Index = 0; Index < BENCH_CHURN_HOOKS; Index++)
+        {
+            LhUninstallHook(&Handles[InResidentCount + Index]);
+        }
+
+        LhWaitForPendingRemovals();
+    }
+
+    snprintf(Name, sizeof(Name), "churn, %lu other hooks", (unsigned long)InResidentCount);
+
+    printf("%-48s %10.1f ns\n", Name, (BenchNow() - Start) / (BENCH_CHURN_CYCLES * BENCH_CHURN_HOOKS));
+
+    // the last cycle must not have needed more than the first
+    for(Index = 0; Index < BENCH_CHURN_HOOKS; Index++)
+    {
+        LhInstallHookEx(Targets + Index * BENCH_TARGET_SIZE, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handles[InResidentCount + Index]);
+    }
+
+    if((GlobalSlotCapacity != SlotCapacity) || (CountSlabs() != SlabCount) || (Failures > 0))
+        printf("%-48s %lu slots, %lu slabs, %lu failures\n", "  grew", (unsigned long)GlobalSlotCapacity, (unsigned long)CountSlabs(),
+            (unsigned long)Failures);
+
+    LhUninstallAllHooks();
+    LhWaitForPendingRemovals();
+}
+
+static DWORD __stdcall WaitIdle(void* InParameter)
+{
+    while((sem_wait(&Finished) != 0) && (errno == EINTR));
+
+    return 0;
+}
+
+static void BenchStartup(ULONG InCount, UCHAR* InTargets, ULONG InThreadCount)
+{
+    ULONG               Index;
+    NTSTATUS            NtStatus = STATUS_SUCCESS;
+    double              Start;
+    char                Name[64];
+
+    memset(Handles, 0, sizeof(Handles));
+
+    Start = BenchNow();
+
+    for(Index = 0; (Index < InCount) && NT_SUCCESS(NtStatus); Index++)
+    {
+        NtStatus = LhInstallHookEx(InTargets + Index * BENCH_TARGET_SIZE, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handles[Index]);
+    }
+
+    snprintf(Name, sizeof(Name), "%lu x LhInstallHookEx, %lu other threads", (unsigned long)InCount, (unsigned long)InThreadCount);
+
+    if(NT_SUCCESS(NtStatus))
+        printf("%-48s %10.1f us\n", Name, (BenchNow() - Start) / 1000);
+    else
+        printf("%-48s failed with 0x%08X\n", Name, (ULONG)NtStatus);
+
+    LhUninstallAllHooks();
+    LhWaitForPendingRemovals();
+
+    memset(Handles, 0, sizeof(Handles));
+
+    for(Index = 0; Index < InCount; Index++)
+    {
+        Entries[Index].EntryPoint = InTargets + Index * BENCH_TARGET_SIZE;
+        Entries[Index].HookProc = (void*)LocalHookProc;
+        Entries[Index].Callback = NULL;
+        Entries[Index].Flags = EASYHOOK_HOOK_DEFAULT;
+        Entries[Index].Handle = &Handles[Index];
+    }
+
+    Start = BenchNow();
+
+    NtStatus = LhInstallHooks(Entries, InCount, TRUE);
+
+    snprintf(Name, sizeof(Name), "LhInstallHooks(%lu), %lu other threads", (unsigned long)InCount, (unsigned long)InThreadCount);
+
+    if(NT_SUCCESS(NtStatus))
+        printf("%-48s %10.1f us\n", Name, (BenchNow() - Start) / 1000);
+    else
+        printf("%-48s failed with 0x%08X\n", Name, (ULONG)NtStatus);
+
+    LhUninstallAllHooks();
+    LhWaitForPendingRemovals();
+}
+
+int main()
+{
+    UCHAR*              Targets;
+    ULONG               Index;
+
+    LhBarrierProcessAttach();
+    LhCriticalInitialize();
+
+    if(((Targets = CreateTargets(BENCH_MAX_HOOKS)) == NULL) || !NT_SUCCESS(LhSetMaxHookCount(BENCH_MAX_HOOKS)))
+        return 1;
+
+    for(Index = 0; Index < ARRAYSIZE(HookCounts); Index++)
+    {
+        BenchInstall(HookCounts[Index], Targets);
+    }
+
+    for(Index = 0; Index < ARRAYSIZE(StartupCounts); Index++)
+    {
+        BenchStartup(StartupCounts[Index], Targets, 0);
+    }
+
+    for(Index = 0; Index < ARRAYSIZE(ResidentCounts); Index++)
+    {
+        BenchChurn(ResidentCounts[Index], Targets);
+    }
+
+    sem_init(&Finished, 0, 0);
+
+    for(Index = 0; Index < BENCH_IDLE_THREADS; Index++)
+    {
+        CloseHandle(CreateThread(NULL, 0, WaitIdle, NULL, 0, NULL));
+    }
+
+    for(Index = 0; Index < ARRAYSIZE(StartupCounts); Index++)
+    {
+        BenchStartup(StartupCounts[Index], Targets, BENCH_IDLE_THREADS);
+    }
+
+    for(Index = 0; Index < BENCH_IDLE_THREADS; Index++)
+    {
+        sem_post(&Finished);
+    }
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_loader.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "local_hook.h"
+#include "bench.h"
+
+/*
+    Measures what the loader lock check adds to a hooked call. The query
+    is stubbed, once returning immediately and once spinning for a while
+    like a more expensive implementation would. The barrier only queries
+    for calls that would be intercepted; hooks installed with
+    EASYHOOK_HOOK_NO_LOADER_LOCK_CHECK never query.
+*/
+#define BENCH_ITERATIONS        2000000
+#define BENCH_SLOW_QUERY_SPINS  20
+
+static volatile LONG    QuerySpins = 0;
+static volatile LONG    QueryCount = 0;
+
+BOOL WINAPI AuxUlibIsDLLSynchronizationHeld(PBOOL SynchronizationHeld)
+{
+    volatile LONG       Spin;
+
+    for(Spin = 0; Spin < QuerySpins; Spin++);
+
+    QueryCount++;
+
+    *SynchronizationHeld = FALSE;
+
+    return TRUE;
+}
+
+static void BenchCall(
+            const char* InName,
+            LOCAL_HOOK_TARGET InTarget,
+            ULONG InFlags,
+            BOOL InIsIntercepted,
+            LONG InSpins)
+{
+    HOOK_TRACE_INFO     Handle = { NULL };
+    ULONG               ThreadIds[1] = { 0 };
+    NTSTATUS            NtStatus;
+
+    if(!NT_SUCCESS(NtStatus = LhInstallHookEx(InTarget, LocalHookProc, NULL, InFlags, &Handle)))
+    {
+        printf("%-48s failed with 0x%08X\n", InName, (ULONG)NtStatus);
+
+        return;
+    }
+
+    LhSetInclusiveACL(ThreadIds, InIsIntercepted?1:0, &Handle);
+
+    if(InTarget(1) != (InIsIntercepted?3:2))
+        printf("%-48s returned %d\n", InName, InTarget(1));
+
+    QuerySpins = InSpins;
+    QueryCount = 0;
+
+    BENCH_RUN(InName, BENCH_ITERATIONS, InTarget((int)Iteration));
+
+    printf("%-48s %10.2f per call\n", "  loader lock queries", (double)QueryCount / BENCH_ITERATIONS);
+
+    LhUninstallHook(&Handle);
+    LhWaitForPendingRemovals();
+}
+
+int main()
+{
+    LOCAL_HOOK_TARGET   Target;
+
+    LhBarrierProcessAttach();
+    LhCriticalInitialize();
+
+    if((Target = LocalHookCreateTarget()) == NULL)
+        return 1;
+
+    BENCH_RUN("loader lock query, stub", BENCH_ITERATIONS, IsLoaderLock());
+
+    QuerySpins = BENCH_SLOW_QUERY_SPINS;
+
+    BENCH_RUN("loader lock query, slow stub", BENCH_ITERATIONS, IsLoaderLock());
+
+    BenchCall("handler, checked, stub", Target, EASYHOOK_HOOK_DEFAULT, TRUE, 0);
+    BenchCall("handler, checked, slow stub", Target, EASYHOOK_HOOK_DEFAULT, TRUE, BENCH_SLOW_QUERY_SPINS);
+    BenchCall("handler, not checked, slow stub", Target, EASYHOOK_HOOK_NO_LOADER_LOCK_CHECK, TRUE, BENCH_SLOW_QUERY_SPINS);
+    BenchCall("not intercepted, checked, slow stub", Target, EASYHOOK_HOOK_DEFAULT, FALSE, BENCH_SLOW_QUERY_SPINS);
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_memory.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "bench.h"
+#include "sys_memory.h"
+
+/*
+    Compares the memory routines of EasyHookDll\Rtl\memory.c and those of the
+    driver with the former byte loops and the CRT, for block sizes from 8 bytes
+    to 64 KB. The byte loops are kept from being turned into CRT calls or vector
+    code, like the old RtlZeroMemory() which was compiled without optimizations.
+    Moves shift a block one byte down, so source and destination overlap.
+*/
+#define BENCH_BYTES_PER_RUN     (256 * 1024 * 1024)
+#define BENCH_MAX_SIZE          (64 * 1024)
+
+static UCHAR            Source[BENCH_MAX_SIZE + 64];
+static UCHAR            Dest[BENCH_MAX_SIZE + 64];
+
+__attribute__((noinline, optimize("no-tree-vectorize", "no-tree-loop-distribute-patterns")))
+static void ByteCopy(UCHAR* InDest, UCHAR* InSource, ULONG InByteCount)
+{
+    ULONG       Index;
+
+    for(Index = 0; Index < InByteCount; Index++)
+    {
+        InDest[Index] = InSource[Index];
+    }
+}
+
+__attribute__((noinline, optimize("no-tree-vectorize", "no-tree-loop-distribute-patterns")))
+static void ByteZero(UCHAR* InTarget, ULONG InByteCount)
+{
+    ULONG       Index;
+
+    for(Index = 0; Index < InByteCount; Index++)
+    {
+        InTarget[Index] = 0;
+    }
+}
+
+int main()
+{
+    static const ULONG  Sizes[] = { 8, 64, 512, 4096, BENCH_MAX_SIZE };
+    ULONG               Index;
+    ULONG               Size;
+    long long           Iterations;
+    char                Name[64];
+
+    for(Index = 0; Index < ARRAYSIZE(Sizes); Index++)
+    {
+        Size = Sizes[Index];
+        Iterations = BENCH_BYTES_PER_RUN / Size;
+
+        if(Iterations > 10000000)
+            Iterations = 10000000;
+
+        // an odd offset, so neither block is aligned
+        snprintf(Name, sizeof(Name), "byte loop copy, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, ByteCopy(Dest + 1, Source + 3, Size));
+
+        snprintf(Name, sizeof(Name), "RtlCopyMemory, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, RtlCopyMemory(Dest + 1, Source + 3, Size));
+
+        snprintf(Name, sizeof(Name), "SysCopyMemory, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, SysCopyMemory(Dest + 1, Source + 3, Size));
+
+        snprintf(Name, sizeof(Name), "memcpy, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, memcpy(Dest + 1, Source + 3, Size); __asm__ volatile("" ::: "memory"));
+
+        snprintf(Name, sizeof(Name), "byte loop zero, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, ByteZero(Dest + 1, Size));
+
+        snprintf(Name, sizeof(Name), "RtlZeroMemory, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, RtlZeroMemory(Dest + 1, Size));
+
+        snprintf(Name, sizeof(Name), "SysZeroMemory, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, SysZeroMemory(Dest + 1, Size));
+
+        snprintf(Name, sizeof(Name), "memset, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, memset(Dest + 1, 0, Size); __asm__ volatile("" ::: "memory"));
+
+        snprintf(Name, sizeof(Name), "RtlMoveMemory, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, RtlMoveMemory(Dest + 1, Dest + 2, Size));
+
+        snprintf(Name, sizeof(Name), "SysMoveMemory, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, SysMoveMemory(Dest + 1, Dest + 2, Size));
+
+        snprintf(Name, sizeof(Name), "memmove, %u bytes", Size);
+        BENCH_RUN(Name, Iterations, memmove(Dest + 1, Dest + 2, Size); __asm__ volatile("" ::: "memory"));
+    }
+
+    return 0;
+}
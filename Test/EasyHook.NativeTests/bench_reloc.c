@@ -0,0 +1,244 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_reloc.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+
+#include "compat.h"
+#include "bench.h"
+
+#include "../../DriverShared/LocalHook/reloc.c"
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+    Compares preparing a hook with two decode passes (LhRoundToNextInstruction()
+    followed by LhRelocateEntryPoint()) against a single LhDecodePrologue()
+    whose result is relocated by LhRelocatePrologue().
+
+    Install throughput is then measured over the entry points of all
+    functions exported by the C library of this process. Each one is
+    relocated into a buffer within 32-Bit reach, once by decoding only and
+    once by formatting every instruction to Intel syntax and parsing the
+    RIP-relative displacement back out of the text, as reloc.c did before.
+*/
+static const UCHAR      Prologues[][16] =
+{
+    { 0x48, 0x89, 0x5C, 0x24, 0x08, 0x57, 0x48, 0x83, 0xEC, 0x20 },    // mov [rsp+8], rbx; push rdi; sub rsp, 20h
+    { 0x48, 0x8B, 0x05, 0x01, 0x02, 0x03, 0x00, 0x48, 0x85, 0xC0 },    // mov rax, [rip+disp]; test rax, rax
+    { 0x83, 0x3D, 0x71, 0x08, 0x06, 0x00, 0x00, 0x74, 0x05 },          // cmp dword [rip+disp], 0; jz
+    { 0x40, 0x53, 0x48, 0x83, 0xEC, 0x20, 0x8B, 0xD9 },                // push rbx; sub rsp, 20h; mov ebx, ecx
+    { 0xFF, 0x25, 0x00, 0x01, 0x00, 0x00, 0x90 },                      // jmp [rip+disp]
+};
+
+#define BENCH_ITERATIONS        1000000
+#define BENCH_MAX_ENTRY_POINTS  8192
+#define BENCH_CORPUS_ROUNDS     20
+
+static UCHAR            Buffer[256];
+static UCHAR*           NearBuffer = NULL;
+static UCHAR*           Corpus[BENCH_MAX_ENTRY_POINTS];
+static ULONG            CorpusCount = 0;
+static ULONG            Failures = 0;
+
+static void RelocateTwoPasses(UCHAR* InEntryPoint)
+{
+    LONG                EntrySize = LhRoundToNextInstruction(InEntryPoint, 5);
+    ULONG               RelocSize;
+
+    if(EntrySize > 0)
+        LhRelocateEntryPoint(InEntryPoint, EntrySize, Buffer, &RelocSize);
+}
+
+static void RelocateOnePass(UCHAR* InEntryPoint)
+{
+    LH_DECODED_PROLOGUE Prologue;
+    ULONG               RelocSize;
+
+    if(NT_SUCCESS(LhDecodePrologue(InEntryPoint, 5, &Prologue)))
+        LhRelocatePrologue(&Prologue, Buffer, &RelocSize);
+}
+
+static void RelocateNear(UCHAR* InEntryPoint)
+{
+    LH_DECODED_PROLOGUE Prologue;
+    ULONG               RelocSize;
+
+    if(!NT_SUCCESS(LhDecodePrologue(InEntryPoint, 5, &Prologue)) || !NT_SUCCESS(LhRelocatePrologue(&Prologue, NearBuffer, &RelocSize)))
+        Failures++;
+}
+
+static void RelocateFormatted(UCHAR* InEntryPoint)
+{
+/*
+    The former per instruction work: format, search for "[rip", parse the
+    displacement and find it within the instruction bytes.
+*/
+    CHAR                Text[100];
+    ULONG               Length;
+    ULONG64             Next;
+    ULONG               Offset = 0;
+    ULONG               Pos;
+    LONGLONG            Disp;
+    char*               Rip;
+
+    while(Offset < 5)
+    {
+        if(!NT_SUCCESS(LhDisassembleInstruction(InEntryPoint + Offset, &Length, Text, sizeof(Text), &Next)))
+        {
+            Failures++;
+
+            return;
+        }
+
+        if((Rip = strstr(Text, "[rip")) != NULL)
+        {
+            Disp = strtoll(Rip + 5, NULL, 16) * ((Rip[4] == '-')?-1:1);
+
+            for(Pos = 1; Pos + 4 <= Length; Pos++)
+            {
+                if(*((LONG*)(InEntryPoint + Offset + Pos)) == (LONG)Disp)
+                    break;
+            }
+
+            memcpy(NearBuffer + Offset, InEntryPoint + Offset, Length);
+
+            *((LONG*)(NearBuffer + Offset + Pos)) = (LONG)(Disp - (NearBuffer - InEntryPoint));
+        }
+        else
+            memcpy(NearBuffer + Offset, InEntryPoint + Offset, Length);
+
+        Offset += Length;
+    }
+}
+
+static BOOL LoadCorpus()
+{
+/*
+    Collects the exported functions of the C library from its dynamic
+    symbol table. Their code is taken from the mapped library.
+*/
+    Dl_info             Info;
+    struct stat         Stat;
+    Elf64_Ehdr*         Header;
+    Elf64_Shdr*         Sections;
+    Elf64_Sym*          Symbols;
+    UCHAR*              File;
+    ULONG               Count;
+    ULONG               Index;
+    ULONG               Symbol;
+    int                 Handle;
+
+    if((dladdr((void*)strlen, &Info) == 0) || ((Handle = open(Info.dli_fname, O_RDONLY)) < 0))
+        return FALSE;
+
+    fstat(Handle, &Stat);
+
+    File = (UCHAR*)mmap(NULL, Stat.st_size, PROT_READ, MAP_PRIVATE, Handle, 0);
+
+    close(Handle);
+
+    if(File == MAP_FAILED)
+        return FALSE;
+
+    Header = (Elf64_Ehdr*)File;
+    Sections = (Elf64_Shdr*)(File + Header->e_shoff);
+
+    for(Index = 0; Index < Header->e_shnum; Index++)
+    {
+        if(Sections[Index].sh_type != SHT_DYNSYM)
+            continue;
+
+        Symbols = (Elf64_Sym*)(File + Sections[Index].sh_offset);
+        Count = (ULONG)(Sections[Index].sh_size / sizeof(Elf64_Sym));
+
+        for(Symbol = 0; (Symbol < Count) && (CorpusCount < BENCH_MAX_ENTRY_POINTS); Symbol++)
+        {
+            // entry points shorter than a jumper can't be hooked
+            if((ELF64_ST_TYPE(Symbols[Symbol].st_info) == STT_FUNC) && (Symbols[Symbol].st_shndx != SHN_UNDEF) && (Symbols[Symbol].st_size >= 5))
+                Corpus[CorpusCount++] = (UCHAR*)Info.dli_fbase + Symbols[Symbol].st_value;
+        }
+
+        break;
+    }
+
+    munmap(File, Stat.st_size);
+
+    // a relocation buffer below the library, within reach of all its code
+    for(Index = 1; (Index < 64) && (NearBuffer == NULL); Index++)
+    {
+        NearBuffer = (UCHAR*)mmap((UCHAR*)Info.dli_fbase - Index * 0x1000000, 0x1000, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+        if(NearBuffer == MAP_FAILED)
+            NearBuffer = NULL;
+    }
+
+    return (CorpusCount > 0) && (NearBuffer != NULL);
+}
+
+int main()
+{
+    static UCHAR        Image[0x1000];
+    UCHAR*              EntryPoints[ARRAYSIZE(Prologues)];
+    ULONG               Index;
+
+    // the displacements above stay within the image, the buffer is near it
+    for(Index = 0; Index < ARRAYSIZE(Prologues); Index++)
+    {
+        EntryPoints[Index] = Image + Index * 32;
+
+        memcpy(EntryPoints[Index], Prologues[Index], sizeof(Prologues[Index]));
+    }
+
+    BENCH_RUN("LhRoundToNextInstruction + LhRelocateEntryPoint", BENCH_ITERATIONS,
+        RelocateTwoPasses(EntryPoints[Iteration % ARRAYSIZE(Prologues)]));
+    BENCH_RUN("LhDecodePrologue + LhRelocatePrologue", BENCH_ITERATIONS,
+        RelocateOnePass(EntryPoints[Iteration % ARRAYSIZE(Prologues)]));
+
+    if(!LoadCorpus())
+    {
+        printf("%-48s not found\n", "C library");
+
+        return 0;
+    }
+
+    printf("%-48s %10lu entry points\n", "C library", (unsigned long)CorpusCount);
+
+    BENCH_RUN("LhDecodePrologue + LhRelocatePrologue, libc", CorpusCount * BENCH_CORPUS_ROUNDS,
+        RelocateNear(Corpus[Iteration % CorpusCount]));
+
+    printf("%-48s %10lu\n", "  not relocatable", (unsigned long)(Failures / BENCH_CORPUS_ROUNDS));
+
+    Failures = 0;
+
+    BENCH_RUN("formatted relocation, libc", CorpusCount * BENCH_CORPUS_ROUNDS,
+        RelocateFormatted(Corpus[Iteration % CorpusCount]));
+
+    return 0;
+}
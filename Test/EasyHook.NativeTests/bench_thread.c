@@ -0,0 +1,164 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_thread.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "bench.h"
+#include "remote_image.h"
+
+/*
+    Compares lookups through one export cache, like RhInjectLibrary() does,
+    against GetRemoteFuncAddress(), which reads the export table for every
+    call. The simulated reads are plain copies, so a real process only
+    widens the gap.
+
+    TestFuncHooks() runs over all exports of the simulated kernel32. Its
+    result block is compared with the former layout, which allocated three
+    MAX_PATH and three 1024 byte buffers per result.
+
+    TestFuncHooksInImage() scans a corpus of image files with one worker,
+    four workers and one worker per processor. The corpus is made of both simulated modules,
+    followed by any x64 DLLs given on the command line.
+*/
+#define BENCH_NAME_COUNT        256
+#define BENCH_CORPUS_SIZE       64
+#define BENCH_IMAGE_ROUNDS      20
+
+static char             Names[BENCH_NAME_COUNT][32];
+static void* volatile   Sink;
+static SIZE_T           AllocSize = 0;
+
+LPVOID CoTaskMemAlloc(SIZE_T InSize)
+{
+    AllocSize = InSize;
+
+    return malloc(InSize);
+}
+
+static void TestKernel32()
+{
+    TEST_FUNC_HOOKS_OPTIONS     Options = { NULL, NULL };
+    TEST_FUNC_HOOKS_RESULT*     Results;
+    int                         Count;
+
+    if(TestFuncHooks(1, "kernel32.dll", Options, &Results, &Count) == STATUS_SUCCESS)
+        ReleaseTestFuncHookResults(Results, Count);
+}
+
+static void BenchImageCorpus(
+            WCHAR (*InPaths)[MAX_PATH],
+            ULONG InCount,
+            ULONG InThreadCount)
+{
+    TEST_FUNC_HOOKS_OPTIONS     Options = { NULL, NULL };
+    TEST_FUNC_HOOKS_RESULT*     Results;
+    ULONG                       Round;
+    ULONG                       Index;
+    ULONGLONG                   Exports = 0;
+    double                      Start = BenchNow();
+    char                        Name[64];
+    int                         Count;
+
+    for(Round = 0; Round < BENCH_IMAGE_ROUNDS; Round++)
+    {
+        for(Index = 0; Index < InCount; Index++)
+        {
+            if(TestFuncHooksInImage(InPaths[Index], Options, InThreadCount, &Results, &Count) != STATUS_SUCCESS)
+                continue;
+
+            Exports += Count;
+
+            ReleaseTestFuncHookResults(Results, Count);
+        }
+    }
+
+    sprintf(Name, "TestFuncHooksInImage (%u worker%s)", InThreadCount, (InThreadCount == 1)?"":"s");
+
+    printf("%-48s %10.0f exports/s\n", Name, Exports / ((BenchNow() - Start) / 1e9));
+}
+
+int main(int argc, char** argv)
+{
+    REMOTE_EXPORT_CACHE     Cache;
+    ULONG                   Index;
+    ULONG                   CorpusCount = 0;
+    char                    Corpus[REMOTE_IMAGE_COUNT][64];
+    WCHAR                   Paths[BENCH_CORPUS_SIZE][MAX_PATH];
+    SYSTEM_INFO             SysInfo;
+
+    RemoteImageInit();
+
+    for(Index = 0; Index < BENCH_NAME_COUNT; Index++)
+    {
+        RemoteImageName(1, (Index * 7) % REMOTE_KERNEL32_EXPORTS, Names[Index]);
+    }
+
+    RemoteExportCacheInit(&Cache, 1, (HANDLE)1);
+
+    BENCH_RUN("RemoteExportLookup (cached)", 1000000,
+        Sink = RemoteExportLookup(&Cache, "kernel32.dll", Names[Iteration % BENCH_NAME_COUNT], 0));
+
+    RemoteExportCacheRelease(&Cache);
+
+    RemoteReadCount = 0;
+
+    BENCH_RUN("GetRemoteFuncAddress", 1000,
+        Sink = GetRemoteFuncAddress(1, (HANDLE)1, "kernel32.dll", Names[Iteration % BENCH_NAME_COUNT]));
+
+    printf("%-48s %10.1f\n", "reads per GetRemoteFuncAddress", RemoteReadCount / 1000.0);
+
+    BENCH_RUN("TestFuncHooks (2000 exports)", 20, TestKernel32());
+
+    printf("%-48s %10lu bytes\n", "result block", (unsigned long)AllocSize);
+    printf("%-48s %10lu bytes\n", "former layout", (unsigned long)(REMOTE_KERNEL32_EXPORTS *
+        (sizeof(TEST_FUNC_HOOKS_RESULT) + 3 * MAX_PATH + 3 * 1024)));
+
+    for(Index = 0; Index < REMOTE_IMAGE_COUNT; Index++)
+    {
+        if(RemoteImageWrite(Index, Corpus[Index]))
+            mbstowcs(Paths[CorpusCount++], Corpus[Index], MAX_PATH);
+    }
+
+    for(Index = 1; (Index < (ULONG)argc) && (CorpusCount < BENCH_CORPUS_SIZE); Index++)
+    {
+        mbstowcs(Paths[CorpusCount++], argv[Index], MAX_PATH);
+    }
+
+    GetSystemInfo(&SysInfo);
+
+    printf("%-48s %10u images\n", "corpus", CorpusCount);
+
+    BenchImageCorpus(Paths, CorpusCount, 1);
+    BenchImageCorpus(Paths, CorpusCount, 4);
+
+    if((SysInfo.dwNumberOfProcessors != 1) && (SysInfo.dwNumberOfProcessors != 4))
+        BenchImageCorpus(Paths, CorpusCount, SysInfo.dwNumberOfProcessors);
+
+    for(Index = 0; Index < REMOTE_IMAGE_COUNT; Index++)
+    {
+        unlink(Corpus[Index]);
+    }
+
+    return 0;
+}
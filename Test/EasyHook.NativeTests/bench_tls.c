@@ -0,0 +1,141 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_tls.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "local_hook.h"
+#include "bench.h"
+
+#include <errno.h>
+#include <semaphore.h>
+
+/*
+    Measures the thread barrier's entry for a hooked call, while 1 to 1000
+    other threads are registered in the thread storage. Every thread calls
+    the hook once, which registers it, and then waits until the end. The
+    calling thread is not in the ACL, so the handler is never entered and
+    only LhBarrierIntro() runs.
+
+    For comparison, the former storage scanned an array of thread IDs.
+*/
+#define BENCH_ITERATIONS        1000000
+#define BENCH_MAX_THREADS       1000
+#define BENCH_STACK_SIZE        0x10000
+
+static const ULONG      ThreadCounts[] = { 1, 10, 100, 250, 500, 1000 };
+static LOCAL_HOOK_TARGET Target;
+static sem_t            Registered;
+static sem_t            Finished;
+static ULONG            IdList[BENCH_MAX_THREADS];
+static volatile BOOL    Sink;
+
+static void* WaitInHook(void* InParameter)
+{
+    Target(1);
+
+    sem_post(&Registered);
+
+    while((sem_wait(&Finished) != 0) && (errno == EINTR));
+
+    return NULL;
+}
+
+static BOOL ScanIdList(ULONG InCount, ULONG InThreadId)
+{
+    ULONG               Index;
+
+    for(Index = 0; Index < InCount; Index++)
+    {
+        if(IdList[Index] == InThreadId)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+int main()
+{
+    static pthread_t    Threads[BENCH_MAX_THREADS];
+    HOOK_TRACE_INFO     Handle = { NULL };
+    pthread_attr_t      Attributes;
+    LPTHREAD_RUNTIME_INFO Info;
+    ULONG               ThreadCount = 0;
+    ULONG               Index;
+    char                Name[64];
+
+    LhBarrierProcessAttach();
+    LhCriticalInitialize();
+
+    if(((Target = LocalHookCreateTarget()) == NULL) ||
+            !NT_SUCCESS(LhInstallHookEx(Target, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handle)))
+        return 1;
+
+    sem_init(&Registered, 0, 0);
+    sem_init(&Finished, 0, 0);
+
+    pthread_attr_init(&Attributes);
+    pthread_attr_setstacksize(&Attributes, BENCH_STACK_SIZE);
+
+    // the calling thread is registered by its first call
+    Target(1);
+
+    for(Index = 0; Index < ARRAYSIZE(ThreadCounts); Index++)
+    {
+        while(ThreadCount < ThreadCounts[Index])
+        {
+            if(pthread_create(&Threads[ThreadCount], &Attributes, WaitInHook, NULL) != 0)
+                break;
+
+            while((sem_wait(&Registered) != 0) && (errno == EINTR));
+
+            IdList[ThreadCount] = (ULONG)(ThreadCount + 1) * 4;
+
+            ThreadCount++;
+        }
+
+        snprintf(Name, sizeof(Name), "hooked call, %lu other thread%s", (unsigned long)ThreadCount, (ThreadCount == 1)?"":"s");
+        BENCH_RUN(Name, BENCH_ITERATIONS, Target((int)Iteration));
+
+        snprintf(Name, sizeof(Name), "TlsGetCurrentValue, %lu other thread%s", (unsigned long)ThreadCount, (ThreadCount == 1)?"":"s");
+        BENCH_RUN(Name, BENCH_ITERATIONS, TlsGetCurrentValue(&Unit.TLS, &Info));
+
+        snprintf(Name, sizeof(Name), "ID list scan, %lu thread%s", (unsigned long)ThreadCount, (ThreadCount == 1)?"":"s");
+        // listed IDs are multiples of four, so the whole list is scanned
+        BENCH_RUN(Name, BENCH_ITERATIONS, Sink = ScanIdList(ThreadCount, (ULONG)Iteration | 1));
+    }
+
+    for(Index = 0; Index < ThreadCount; Index++)
+    {
+        sem_post(&Finished);
+    }
+
+    for(Index = 0; Index < ThreadCount; Index++)
+    {
+        pthread_join(Threads[Index], NULL);
+    }
+
+    LhUninstallHook(&Handle);
+    LhWaitForPendingRemovals();
+
+    return 0;
+}
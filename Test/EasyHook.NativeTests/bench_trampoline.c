@@ -0,0 +1,98 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_trampoline.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "local_hook.h"
+#include "bench.h"
+
+/*
+    Compares the cost of one call through the regular trampoline, which
+    enters the thread barrier, with the barrier-free fast trampoline, and
+    with the regular trampoline maintaining the statistics of the hook.
+*/
+#define BENCH_ITERATIONS        10000000
+#define BENCH_CYCLES            1000
+
+static void BenchCall(const char* InName, LOCAL_HOOK_TARGET InTarget, ULONG InFlags, BOOL InIsIntercepted)
+{
+    HOOK_TRACE_INFO     Handle = { NULL };
+    ULONG               ThreadIds[1] = { 0 };
+    NTSTATUS            NtStatus;
+
+    if(!NT_SUCCESS(NtStatus = LhInstallHookEx(InTarget, LocalHookProc, NULL, InFlags, &Handle)))
+    {
+        printf("%-48s failed with 0x%08X\n", InName, (ULONG)NtStatus);
+
+        return;
+    }
+
+    // the regular trampoline only enters the handler for threads in the ACL
+    LhSetInclusiveACL(ThreadIds, InIsIntercepted?1:0, &Handle);
+
+    if(InTarget(1) != (InIsIntercepted?3:2))
+        printf("%-48s returned %d\n", InName, InTarget(1));
+
+    BENCH_RUN(InName, BENCH_ITERATIONS, InTarget((int)Iteration));
+
+    LhUninstallHook(&Handle);
+    LhWaitForPendingRemovals();
+}
+
+static void BenchCycles(const char* InName, LOCAL_HOOK_TARGET InTarget, ULONG InFlags)
+{
+    HOOK_TRACE_INFO     Handle;
+    LONG                PinnedCount = GlobalPinnedHookCount;
+
+    BENCH_RUN(InName, BENCH_CYCLES,
+        Handle.Link = NULL;
+        LhInstallHookEx(InTarget, LocalHookProc, NULL, InFlags, &Handle);
+        LhUninstallHook(&Handle);
+        LhWaitForPendingRemovals());
+
+    printf("%-48s %10ld blocks\n", "  kept until unload", (long)(GlobalPinnedHookCount - PinnedCount));
+}
+
+int main()
+{
+    LOCAL_HOOK_TARGET   Target;
+
+    LhBarrierProcessAttach();
+    LhCriticalInitialize();
+
+    if((Target = LocalHookCreateTarget()) == NULL)
+        return 1;
+
+    BENCH_RUN("direct call", BENCH_ITERATIONS, Target((int)Iteration));
+
+    BenchCall("regular trampoline, not intercepted", Target, EASYHOOK_HOOK_DEFAULT, FALSE);
+    BenchCall("regular trampoline, handler", Target, EASYHOOK_HOOK_DEFAULT, TRUE);
+    BenchCall("fast trampoline, handler", Target, EASYHOOK_HOOK_FAST_TRAMPOLINE, TRUE);
+    BenchCall("statistics, not intercepted", Target, EASYHOOK_HOOK_STATISTICS, FALSE);
+    BenchCall("statistics, handler", Target, EASYHOOK_HOOK_STATISTICS, TRUE);
+
+    BenchCycles("install and uninstall, regular", Target, EASYHOOK_HOOK_DEFAULT);
+    BenchCycles("install and uninstall, fast", Target, EASYHOOK_HOOK_FAST_TRAMPOLINE);
+
+    return 0;
+}
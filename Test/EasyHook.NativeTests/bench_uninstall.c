@@ -0,0 +1,175 @@
+// EasyHook (File: Test\EasyHook.NativeTests\bench_uninstall.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "local_hook.h"
+#include "bench.h"
+
+/*
+    Removes 100 to 2000 hooks while other threads keep calling all of them,
+    and reports how long LhWaitForPendingRemovals() takes until every hook
+    is released. The handler is entered for every call, so a thread may be
+    preempted within any hook. LhUninstallHooksAsync() returns before the
+    hooks are released, a later LhWaitForPendingRemovals() releases them.
+*/
+#define BENCH_MAX_HOOKS         2000
+#define BENCH_TARGET_SIZE       16
+#define BENCH_MAX_THREADS       4
+
+static const ULONG          HookCounts[] = { 100, 500, 2000 };
+static const ULONG          ThreadCounts[] = { 0, 1, BENCH_MAX_THREADS };
+static UCHAR*               Targets;
+static HOOK_TRACE_INFO      Handles[BENCH_MAX_HOOKS];
+static TRACED_HOOK_HANDLE   HandleList[BENCH_MAX_HOOKS];
+static volatile ULONG       CallCount = 0;
+static volatile BOOL        IsStopping = FALSE;
+static volatile LONG        CallsMade = 0;
+
+static DWORD __stdcall CallHooks(void* InParameter)
+{
+    ULONG               Index = 0;
+    LONG                Calls = 0;
+
+    while(!IsStopping)
+    {
+        ((LOCAL_HOOK_TARGET)(Targets + (Index % CallCount) * BENCH_TARGET_SIZE))((int)Index);
+
+        Index++;
+        Calls++;
+    }
+
+    InterlockedExchangeAdd(&CallsMade, Calls);
+
+    return 0;
+}
+
+static BOOL InstallHooks(ULONG InCount)
+{
+    ULONG               Index;
+
+    memset(Handles, 0, sizeof(Handles));
+
+    for(Index = 0; Index < InCount; Index++)
+    {
+        if(!NT_SUCCESS(LhInstallHookEx(Targets + Index * BENCH_TARGET_SIZE, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handles[Index])))
+            return FALSE;
+
+        // every thread enters the handler
+        LhSetExclusiveACL(NULL, 0, &Handles[Index]);
+
+        HandleList[Index] = &Handles[Index];
+    }
+
+    return TRUE;
+}
+
+static void BenchTeardown(ULONG InCount, ULONG InThreadCount, BOOL InIsAsync)
+{
+    HANDLE              Threads[BENCH_MAX_THREADS];
+    ULONG               Index;
+    NTSTATUS            NtStatus;
+    double              Start;
+    double              Removed;
+    char                Name[64];
+
+    snprintf(Name, sizeof(Name), "%s, %lu hooks, %lu thread%s", InIsAsync?"LhUninstallHooksAsync":"LhUninstallAllHooks",
+        (unsigned long)InCount, (unsigned long)InThreadCount, (InThreadCount == 1)?"":"s");
+
+    if(!InstallHooks(InCount))
+    {
+        printf("%-48s failed to install\n", Name);
+
+        return;
+    }
+
+    CallCount = InCount;
+    CallsMade = 0;
+    IsStopping = FALSE;
+
+    for(Index = 0; Index < InThreadCount; Index++)
+    {
+        Threads[Index] = CreateThread(NULL, 0, CallHooks, NULL, 0, NULL);
+    }
+
+    // let the threads get into the hooks
+    Sleep(10);
+
+    Start = BenchNow();
+
+    if(InIsAsync)
+        LhUninstallHooksAsync(HandleList, InCount);
+    else
+        LhUninstallAllHooks();
+
+    Removed = BenchNow();
+
+    NtStatus = LhWaitForPendingRemovals();
+
+    printf("%-48s %10.1f ms, %.1f ms removing\n", Name, (BenchNow() - Start) / 1e6, (Removed - Start) / 1e6);
+
+    if(!NT_SUCCESS(NtStatus))
+        printf("%-48s failed with 0x%08X\n", "", (ULONG)NtStatus);
+
+    IsStopping = TRUE;
+
+    for(Index = 0; Index < InThreadCount; Index++)
+    {
+        WaitForSingleObject(Threads[Index], INFINITE);
+        CloseHandle(Threads[Index]);
+    }
+
+    if((InThreadCount > 0) && (CallsMade == 0))
+        printf("%-48s no calls made\n", "");
+}
+
+int main()
+{
+    ULONG               Index;
+    ULONG               Count;
+
+    LhBarrierProcessAttach();
+    LhCriticalInitialize();
+
+    Targets = (UCHAR*)mmap(NULL, BENCH_MAX_HOOKS * BENCH_TARGET_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if((Targets == MAP_FAILED) || !NT_SUCCESS(LhSetMaxHookCount(BENCH_MAX_HOOKS)))
+        return 1;
+
+    for(Index = 0; Index < BENCH_MAX_HOOKS; Index++)
+    {
+        memcpy(Targets + Index * BENCH_TARGET_SIZE, LocalHookTargetCode, sizeof(LocalHookTargetCode));
+    }
+
+    for(Count = 0; Count < ARRAYSIZE(HookCounts); Count++)
+    {
+        for(Index = 0; Index < ARRAYSIZE(ThreadCounts); Index++)
+        {
+            BenchTeardown(HookCounts[Count], ThreadCounts[Index], FALSE);
+        }
+
+        BenchTeardown(HookCounts[Count], BENCH_MAX_THREADS, TRUE);
+    }
+
+    return 0;
+}
@@ -0,0 +1,1392 @@
+// EasyHook (File: Test\EasyHook.NativeTests\compat\compat.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+/*
+    Linux implementation of the Windows API declared in windows.h. All
+    functions are weak, so a test replaces any of them, like VirtualQuery()
+    to simulate an address space, just by defining it again. The same
+    applies to the few EasyHook internals a test might not link.
+*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "stdafx.h"
+#include "compat.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <ucontext.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define COMPAT_WEAK         __attribute__((weak))
+
+HANDLE                      hEasyHookHeap = (HANDLE)1;
+RTL_SPIN_LOCK COMPAT_WEAK   GlobalHookLock;
+volatile LONG COMPAT_WEAK  GlobalPinnedHookCount = 0;
+LONG                        CompatLastStatus = STATUS_SUCCESS;
+BOOL                        CompatIsLoaderLockHeld = FALSE;
+
+static __thread DWORD       CompatThreadId = 0;
+static __thread DWORD       CompatSystemThreadId = 0;
+static __thread DWORD       CompatLastError = 0;
+
+void CompatSetThreadId(DWORD InThreadId)
+{
+    CompatThreadId = InThreadId;
+}
+
+/*
+    Threads
+*/
+COMPAT_WEAK DWORD GetCurrentThreadId(void)
+{
+    if(CompatThreadId != 0)
+        return CompatThreadId;
+
+    // Windows reads the id from the thread environment block, so it is cheap
+    if(CompatSystemThreadId == 0)
+        CompatSystemThreadId = (DWORD)syscall(SYS_gettid);
+
+    return CompatSystemThreadId;
+}
+
+/*
+    The main thread and threads created by CreateThread() are registered,
+    so they can be enumerated and suspended like on Windows. A thread is
+    suspended by a signal, whose handler captures the instruction pointer
+    and waits until the thread is resumed. Thread handles of OpenThread()
+    just encode the thread id, so suspending threads never allocates memory
+    or takes a lock another thread might hold.
+*/
+#define COMPAT_MAX_THREADS          4096
+#define COMPAT_SUSPEND_SIGNAL       SIGUSR1
+#define COMPAT_THREAD_HANDLE        ((ULONG_PTR)0xFEED << 48)
+
+typedef struct _COMPAT_THREAD_
+{
+    volatile LONG           Lock;
+    volatile DWORD          ThreadId;
+    pthread_t               Thread;
+    volatile LONG           SuspendCount;
+    volatile LONG           SuspendSequence;
+    sem_t                   Suspended;
+    ULONGLONG               Rip;
+}COMPAT_THREAD;
+
+static COMPAT_THREAD        CompatThreads[COMPAT_MAX_THREADS];
+static volatile LONG        CompatThreadLimit = 0;
+static __thread COMPAT_THREAD* CompatCurrentThread = NULL;
+
+static void CompatSuspendHandler(int InSignal, siginfo_t* InInfo, void* InContext)
+{
+    COMPAT_THREAD*          Thread = CompatCurrentThread;
+    struct timespec         Delay = { 0, 20000 };
+    int                     Error = errno;
+    LONG                    Sequence = Thread->SuspendSequence;
+
+    Thread->Rip = ((ucontext_t*)InContext)->uc_mcontext.gregs[REG_RIP];
+
+    sem_post(&Thread->Suspended);
+
+    /*
+        A thread resumed and suspended again before it left this handler gets
+        another signal, which is only delivered once the handler returned.
+    */
+    while((Thread->SuspendCount > 0) && (Thread->SuspendSequence == Sequence))
+    {
+        nanosleep(&Delay, NULL);
+    }
+
+    errno = Error;
+}
+
+static COMPAT_THREAD* CompatRegisterThread()
+{
+    COMPAT_THREAD*          Thread;
+    LONG                    Index;
+    LONG                    Limit;
+
+    for(Index = 0; Index < COMPAT_MAX_THREADS; Index++)
+    {
+        Thread = &CompatThreads[Index];
+
+        if((Thread->ThreadId != 0) || !__sync_bool_compare_and_swap(&Thread->Lock, 0, 1))
+            continue;
+
+        if(Thread->ThreadId == 0)
+        {
+            Thread->Thread = pthread_self();
+            Thread->SuspendCount = 0;
+            Thread->ThreadId = (DWORD)syscall(SYS_gettid);
+
+            while((Limit = CompatThreadLimit) <= Index)
+            {
+                __sync_bool_compare_and_swap(&CompatThreadLimit, Limit, Index + 1);
+            }
+
+            CompatCurrentThread = Thread;
+
+            __sync_lock_release(&Thread->Lock);
+
+            return Thread;
+        }
+
+        __sync_lock_release(&Thread->Lock);
+    }
+
+    return NULL;
+}
+
+static void CompatLockThreadEntry(COMPAT_THREAD* InThread)
+{
+    while(!__sync_bool_compare_and_swap(&InThread->Lock, 0, 1))
+    {
+        sched_yield();
+    }
+}
+
+static void CompatUnlockThread(COMPAT_THREAD* InThread)
+{
+    __sync_lock_release(&InThread->Lock);
+}
+
+static void CompatUnregisterThread(COMPAT_THREAD* InThread)
+{
+    if(InThread == NULL)
+        return;
+
+    // a thread being suspended receives the signal while waiting here
+    CompatLockThreadEntry(InThread);
+    {
+        InThread->ThreadId = 0;
+    }
+    CompatUnlockThread(InThread);
+
+    CompatCurrentThread = NULL;
+}
+
+static COMPAT_THREAD* CompatFindThread(DWORD InThreadId)
+{
+    LONG                    Index;
+
+    for(Index = 0; Index < CompatThreadLimit; Index++)
+    {
+        if(CompatThreads[Index].ThreadId == InThreadId)
+            return &CompatThreads[Index];
+    }
+
+    return NULL;
+}
+
+static COMPAT_THREAD* CompatLockThread(DWORD InThreadId)
+{
+/*
+    Returns the locked entry of the given thread, so it can't exit
+    until the entry is unlocked.
+*/
+    COMPAT_THREAD*          Thread;
+
+    if((Thread = CompatFindThread(InThreadId)) == NULL)
+        return NULL;
+
+    CompatLockThreadEntry(Thread);
+
+    if(Thread->ThreadId != InThreadId)
+    {
+        CompatUnlockThread(Thread);
+
+        return NULL;
+    }
+
+    return Thread;
+}
+
+static void __attribute__((constructor)) CompatThreadInitialize()
+{
+    struct sigaction        Action;
+    LONG                    Index;
+
+    for(Index = 0; Index < COMPAT_MAX_THREADS; Index++)
+    {
+        sem_init(&CompatThreads[Index].Suspended, 0, 0);
+    }
+
+    memset(&Action, 0, sizeof(Action));
+
+    Action.sa_sigaction = CompatSuspendHandler;
+    Action.sa_flags = SA_SIGINFO | SA_RESTART;
+
+    sigemptyset(&Action.sa_mask);
+    sigaction(COMPAT_SUSPEND_SIGNAL, &Action, NULL);
+
+    CompatRegisterThread();
+}
+
+COMPAT_WEAK DWORD GetCurrentProcessId(void) { return (DWORD)getpid(); }
+
+COMPAT_WEAK HANDLE GetCurrentProcess(void) { return (HANDLE)(LONG_PTR)-1; }
+
+COMPAT_WEAK DWORD GetLastError(void) { return CompatLastError; }
+
+COMPAT_WEAK void SetLastError(DWORD InCode) { CompatLastError = InCode; }
+
+COMPAT_WEAK DWORD GetTickCount(void)
+{
+    struct timespec         Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    return (DWORD)(Now.tv_sec * 1000 + Now.tv_nsec / 1000000);
+}
+
+COMPAT_WEAK BOOL QueryPerformanceCounter(LARGE_INTEGER* OutCounter)
+{
+    struct timespec         Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    OutCounter->QuadPart = (LONGLONG)Now.tv_sec * 1000000000 + Now.tv_nsec;
+
+    return TRUE;
+}
+
+COMPAT_WEAK BOOL QueryPerformanceFrequency(LARGE_INTEGER* OutFrequency)
+{
+    OutFrequency->QuadPart = 1000000000;
+
+    return TRUE;
+}
+
+COMPAT_WEAK void Sleep(DWORD InMilliseconds) { usleep(InMilliseconds * 1000); }
+
+COMPAT_WEAK BOOL SwitchToThread(void) { return sched_yield() == 0; }
+
+COMPAT_WEAK void InitializeCriticalSection(CRITICAL_SECTION* InLock)
+{
+    pthread_mutexattr_t     Attr;
+
+    InLock->Mutex = malloc(sizeof(pthread_mutex_t));
+
+    pthread_mutexattr_init(&Attr);
+    pthread_mutexattr_settype(&Attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init((pthread_mutex_t*)InLock->Mutex, &Attr);
+    pthread_mutexattr_destroy(&Attr);
+}
+
+COMPAT_WEAK void EnterCriticalSection(CRITICAL_SECTION* InLock) { pthread_mutex_lock((pthread_mutex_t*)InLock->Mutex); }
+
+COMPAT_WEAK void LeaveCriticalSection(CRITICAL_SECTION* InLock) { pthread_mutex_unlock((pthread_mutex_t*)InLock->Mutex); }
+
+COMPAT_WEAK void DeleteCriticalSection(CRITICAL_SECTION* InLock)
+{
+    pthread_mutex_destroy((pthread_mutex_t*)InLock->Mutex);
+
+    free(InLock->Mutex);
+}
+
+COMPAT_WEAK BOOL WINAPI AuxUlibInitialize(VOID) { return TRUE; }
+
+COMPAT_WEAK BOOL WINAPI AuxUlibIsDLLSynchronizationHeld(PBOOL SynchronizationHeld)
+{
+    *SynchronizationHeld = CompatIsLoaderLockHeld;
+
+    return TRUE;
+}
+
+/*
+    Memory
+*/
+COMPAT_WEAK void GetSystemInfo(SYSTEM_INFO* OutInfo)
+{
+    memset(OutInfo, 0, sizeof(SYSTEM_INFO));
+
+    OutInfo->dwPageSize = 0x1000;
+    OutInfo->dwAllocationGranularity = 0x10000;
+    OutInfo->lpMinimumApplicationAddress = (LPVOID)0x10000;
+    OutInfo->lpMaximumApplicationAddress = (LPVOID)0x7FFFFFFEFFFF;
+    OutInfo->dwNumberOfProcessors = (DWORD)sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+static int CompatProtection(DWORD InProtect)
+{
+    switch(InProtect)
+    {
+    case PAGE_READONLY: return PROT_READ;
+    case PAGE_READWRITE: return PROT_READ | PROT_WRITE;
+    case PAGE_EXECUTE_READ: return PROT_READ | PROT_EXEC;
+    case PAGE_EXECUTE_READWRITE: return PROT_READ | PROT_WRITE | PROT_EXEC;
+    default: return PROT_NONE;
+    }
+}
+
+/*
+    mmap() needs the size to unmap, so allocations are remembered.
+*/
+typedef struct _COMPAT_ALLOCATION_
+{
+    struct _COMPAT_ALLOCATION_*     Next;
+    UCHAR*                          Base;
+    SIZE_T                          Size;
+}COMPAT_ALLOCATION;
+
+static COMPAT_ALLOCATION*   CompatAllocations = NULL;
+static pthread_mutex_t      CompatAllocationLock = PTHREAD_MUTEX_INITIALIZER;
+
+COMPAT_WEAK PVOID VirtualAlloc(PVOID InAddress, SIZE_T InSize, DWORD InType, DWORD InProtect)
+{
+    COMPAT_ALLOCATION*      Entry;
+    void*                   Result;
+    int                     Flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    if(InAddress != NULL)
+        Flags |= MAP_FIXED_NOREPLACE;
+
+    Result = mmap(InAddress, InSize, (InType & MEM_COMMIT)?CompatProtection(InProtect):PROT_NONE, Flags, -1, 0);
+
+    if(Result == MAP_FAILED)
+        return NULL;
+
+    if((InAddress != NULL) && (Result != InAddress))
+    {
+        // older kernels ignore MAP_FIXED_NOREPLACE and treat the address as hint
+        munmap(Result, InSize);
+
+        return NULL;
+    }
+
+    Entry = (COMPAT_ALLOCATION*)malloc(sizeof(COMPAT_ALLOCATION));
+    Entry->Base = (UCHAR*)Result;
+    Entry->Size = InSize;
+
+    pthread_mutex_lock(&CompatAllocationLock);
+    {
+        Entry->Next = CompatAllocations;
+        CompatAllocations = Entry;
+    }
+    pthread_mutex_unlock(&CompatAllocationLock);
+
+    return Result;
+}
+
+COMPAT_WEAK BOOL VirtualFree(PVOID InAddress, SIZE_T InSize, DWORD InType)
+{
+    COMPAT_ALLOCATION**     Link;
+    COMPAT_ALLOCATION*      Entry = NULL;
+
+    pthread_mutex_lock(&CompatAllocationLock);
+    {
+        for(Link = &CompatAllocations; *Link != NULL; Link = &(*Link)->Next)
+        {
+            if((*Link)->Base == (UCHAR*)InAddress)
+            {
+                Entry = *Link;
+                *Link = Entry->Next;
+
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&CompatAllocationLock);
+
+    if(Entry == NULL)
+        return FALSE;
+
+    munmap(Entry->Base, Entry->Size);
+    free(Entry);
+
+    return TRUE;
+}
+
+COMPAT_WEAK BOOL VirtualProtect(PVOID InAddress, SIZE_T InSize, DWORD InProtect, DWORD* OutOldProtect)
+{
+    ULONG_PTR               Start = (ULONG_PTR)InAddress & ~(ULONG_PTR)0xFFF;
+    ULONG_PTR               End = ((ULONG_PTR)InAddress + InSize + 0xFFF) & ~(ULONG_PTR)0xFFF;
+
+    *OutOldProtect = PAGE_EXECUTE_READWRITE;
+
+    return mprotect((void*)Start, End - Start, CompatProtection(InProtect)) == 0;
+}
+
+COMPAT_WEAK SIZE_T VirtualQuery(LPCVOID InAddress, MEMORY_BASIC_INFORMATION* OutInfo, SIZE_T InSize)
+{
+/*
+Description:
+
+    Reports the mapping containing the given address, or the gap up to
+    the next mapping, as read from "/proc/self/maps".
+*/
+    FILE*                   Maps;
+    char                    Line[512];
+    unsigned long long      Base;
+    unsigned long long      End;
+    unsigned long long      Address = (unsigned long long)(ULONG_PTR)InAddress;
+    unsigned long long      Gap = 0;
+    char                    Perms[8];
+    char                    Path[256];
+
+    if((Maps = fopen("/proc/self/maps", "r")) == NULL)
+        return 0;
+
+    memset(OutInfo, 0, sizeof(MEMORY_BASIC_INFORMATION));
+
+    OutInfo->State = MEM_FREE;
+    OutInfo->Protect = PAGE_NOACCESS;
+    OutInfo->BaseAddress = (PVOID)(ULONG_PTR)(Address & ~0xFFFULL);
+    OutInfo->RegionSize = 0x7FFFFFFFF000ULL - (Address & ~0xFFFULL);
+
+    while(fgets(Line, sizeof(Line), Maps) != NULL)
+    {
+        Path[0] = 0;
+
+        if(sscanf(Line, "%llx-%llx %7s %*s %*s %*s %255s", &Base, &End, Perms, Path) < 3)
+            continue;
+
+        if(Address < Base)
+        {
+            OutInfo->BaseAddress = (PVOID)(ULONG_PTR)Gap;
+            OutInfo->RegionSize = Base - Gap;
+
+            break;
+        }
+
+        if(Address < End)
+        {
+            OutInfo->BaseAddress = (PVOID)(ULONG_PTR)Base;
+            OutInfo->AllocationBase = OutInfo->BaseAddress;
+            OutInfo->RegionSize = End - Base;
+            OutInfo->State = MEM_COMMIT;
+            OutInfo->Type = (Path[0] == '/')?MEM_IMAGE:MEM_PRIVATE;
+            OutInfo->Protect = (Perms[2] == 'x')?PAGE_EXECUTE_READ:PAGE_READWRITE;
+
+            break;
+        }
+
+        Gap = End;
+    }
+
+    fclose(Maps);
+
+    return sizeof(MEMORY_BASIC_INFORMATION);
+}
+
+COMPAT_WEAK BOOL IsBadReadPtr(LPCVOID InPointer, UINT_PTR InSize) { return InPointer == NULL; }
+
+COMPAT_WEAK BOOL FlushInstructionCache(HANDLE InProcess, LPCVOID InAddress, SIZE_T InSize)
+{
+    __builtin___clear_cache((char*)InAddress, (char*)InAddress + InSize);
+
+    return TRUE;
+}
+
+COMPAT_WEAK HANDLE HeapCreate(DWORD InOptions, SIZE_T InInitialSize, SIZE_T InMaximumSize) { return (HANDLE)1; }
+
+COMPAT_WEAK BOOL HeapDestroy(HANDLE InHeap) { return TRUE; }
+
+COMPAT_WEAK PVOID HeapAlloc(HANDLE InHeap, DWORD InFlags, SIZE_T InSize) { return malloc(InSize); }
+
+COMPAT_WEAK BOOL HeapFree(HANDLE InHeap, DWORD InFlags, PVOID InPointer)
+{
+    free(InPointer);
+
+    return TRUE;
+}
+
+/*
+    Modules; a test simulating modules provides its own versions.
+*/
+COMPAT_WEAK BOOL EnumProcessModules(HANDLE InProcess, HMODULE* OutModules, DWORD InSize, DWORD* OutRequired)
+{
+    *OutRequired = 0;
+
+    return TRUE;
+}
+
+COMPAT_WEAK BOOL GetModuleInformation(HANDLE InProcess, HMODULE InModule, MODULEINFO* OutInfo, DWORD InSize) { return FALSE; }
+
+COMPAT_WEAK DWORD GetModuleFileNameA(HMODULE InModule, LPSTR OutPath, DWORD InSize) { return 0; }
+
+COMPAT_WEAK PVOID GetProcAddress(HMODULE InModule, LPCSTR InName) { return NULL; }
+
+COMPAT_WEAK void OutputDebugStringW(LPCWSTR InMessage) { fwprintf(stderr, L"%ls", InMessage); }
+
+COMPAT_WEAK int _snwprintf_s(wchar_t* OutBuffer, size_t InSize, size_t InCount, const wchar_t* InFormat, ...)
+{
+    va_list                 Args;
+    int                     Result;
+
+    va_start(Args, InFormat);
+    Result = vswprintf(OutBuffer, InSize, InFormat, Args);
+    va_end(Args);
+
+    return Result;
+}
+
+COMPAT_WEAK int sprintf_s(char* OutBuffer, size_t InSize, const char* InFormat, ...)
+{
+    va_list                 Args;
+    int                     Result;
+
+    va_start(Args, InFormat);
+    Result = vsnprintf(OutBuffer, InSize, InFormat, Args);
+    va_end(Args);
+
+    return Result;
+}
+
+COMPAT_WEAK int vsnprintf_s(char* OutBuffer, size_t InSize, size_t InCount, const char* InFormat, va_list InArgs)
+{
+    return vsnprintf(OutBuffer, InSize, InFormat, InArgs);
+}
+
+/*
+    Kernel objects. Handles returned by the functions below point to a
+    COMPAT_OBJECT, so CloseHandle() and the wait functions recognize them.
+    Any other handle, like the ones returned by the fakes of a test, is
+    accepted and ignored as before.
+*/
+#define COMPAT_OBJECT_ANY           0
+#define COMPAT_OBJECT_FILE          1
+#define COMPAT_OBJECT_MAPPING       2
+#define COMPAT_OBJECT_VIEW          3
+#define COMPAT_OBJECT_THREAD        4
+#define COMPAT_OBJECT_SNAPSHOT      5
+
+typedef struct _COMPAT_OBJECT_
+{
+    struct _COMPAT_OBJECT_*     Next;
+    ULONG                       Type;
+    // files and mappings
+    int                         File;
+    // mappings, views and snapshots
+    UCHAR*                      Base;
+    SIZE_T                      Size;
+    SIZE_T                      Position;
+    // threads, only one thread may wait for another
+    pthread_t                   Thread;
+    BOOL                        IsJoined;
+    LPTHREAD_START_ROUTINE      Start;
+    LPVOID                      Parameter;
+    DWORD                       ThreadId;
+    volatile DWORD              ExitCode;
+    // the handle and the running thread
+    volatile LONG               References;
+    sem_t                       Started;
+}COMPAT_OBJECT;
+
+static COMPAT_OBJECT*       CompatObjects = NULL;
+static pthread_mutex_t      CompatObjectLock = PTHREAD_MUTEX_INITIALIZER;
+
+static COMPAT_OBJECT* CompatCreateObject(ULONG InType)
+{
+    COMPAT_OBJECT*          Object = (COMPAT_OBJECT*)calloc(1, sizeof(COMPAT_OBJECT));
+
+    if(Object == NULL)
+        return NULL;
+
+    Object->Type = InType;
+    Object->File = -1;
+
+    pthread_mutex_lock(&CompatObjectLock);
+    {
+        Object->Next = CompatObjects;
+        CompatObjects = Object;
+    }
+    pthread_mutex_unlock(&CompatObjectLock);
+
+    return Object;
+}
+
+static COMPAT_OBJECT* CompatFindObject(
+            LPCVOID InHandle,
+            ULONG InType,
+            BOOL InRemove)
+{
+/*
+    Views are looked up by their base address, all other objects by handle.
+    Views are not handles, so COMPAT_OBJECT_ANY skips them.
+*/
+    COMPAT_OBJECT**         Link;
+    COMPAT_OBJECT*          Object;
+
+    pthread_mutex_lock(&CompatObjectLock);
+    {
+        for(Link = &CompatObjects; (Object = *Link) != NULL; Link = &Object->Next)
+        {
+            if((InType == COMPAT_OBJECT_ANY)?(Object->Type == COMPAT_OBJECT_VIEW):(Object->Type != InType))
+                continue;
+
+            if((Object->Type == COMPAT_OBJECT_VIEW)?(Object->Base == InHandle):(Object == InHandle))
+            {
+                if(InRemove)
+                    *Link = Object->Next;
+
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&CompatObjectLock);
+
+    return Object;
+}
+
+static void CompatDeleteObject(COMPAT_OBJECT* InObject)
+{
+    if(InObject->File >= 0)
+        close(InObject->File);
+
+    if(InObject->Type == COMPAT_OBJECT_VIEW)
+        munmap(InObject->Base, InObject->Size);
+
+    if(InObject->Type == COMPAT_OBJECT_SNAPSHOT)
+        free(InObject->Base);
+
+    if(InObject->Type == COMPAT_OBJECT_THREAD)
+    {
+        if(!InObject->IsJoined)
+            pthread_detach(InObject->Thread);
+
+        // the thread might still run
+        if(InterlockedDecrement(&InObject->References) > 0)
+            return;
+
+        sem_destroy(&InObject->Started);
+    }
+
+    free(InObject);
+}
+
+/*
+    Other processes, threads and files
+*/
+COMPAT_WEAK BOOL CloseHandle(HANDLE InHandle)
+{
+    COMPAT_OBJECT*          Object;
+
+    // no lock may be taken for threads opened while others are suspended
+    if(((ULONG_PTR)InHandle & ~(ULONG_PTR)MAXULONG) == COMPAT_THREAD_HANDLE)
+        return TRUE;
+
+    if((Object = CompatFindObject(InHandle, COMPAT_OBJECT_ANY, TRUE)) != NULL)
+        CompatDeleteObject(Object);
+
+    return TRUE;
+}
+
+COMPAT_WEAK HANDLE OpenProcess(DWORD InAccess, BOOL InInherit, DWORD InProcessId) { return NULL; }
+
+COMPAT_WEAK HANDLE OpenThread(DWORD InAccess, BOOL InInherit, DWORD InThreadId)
+{
+/*
+    The handle just encodes the thread id, so it neither allocates
+    memory nor takes a lock, see SuspendThread().
+*/
+    if(CompatFindThread(InThreadId) == NULL)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+
+        return NULL;
+    }
+
+    return (HANDLE)(COMPAT_THREAD_HANDLE | InThreadId);
+}
+
+COMPAT_WEAK BOOL OpenProcessToken(HANDLE InProcess, DWORD InAccess, PHANDLE OutToken) { return FALSE; }
+
+COMPAT_WEAK BOOL TerminateProcess(HANDLE InProcess, UINT InExitCode) { return FALSE; }
+
+COMPAT_WEAK BOOL CreateProcessW(LPCWSTR InApplication, LPWSTR InCommandLine, LPSECURITY_ATTRIBUTES InProcessAttributes,
+            LPSECURITY_ATTRIBUTES InThreadAttributes, BOOL InInherit, DWORD InFlags, LPVOID InEnvironment,
+            LPCWSTR InDirectory, LPSTARTUPINFOW InStartupInfo, LPPROCESS_INFORMATION OutProcessInfo) { return FALSE; }
+
+static void* CompatThreadStart(void* InObject)
+{
+    COMPAT_OBJECT*          Object = (COMPAT_OBJECT*)InObject;
+    COMPAT_THREAD*          Thread = CompatRegisterThread();
+
+    Object->ThreadId = (Thread != NULL)?Thread->ThreadId:0;
+
+    sem_post(&Object->Started);
+
+    Object->ExitCode = Object->Start(Object->Parameter);
+
+    CompatUnregisterThread(Thread);
+
+    if(InterlockedDecrement(&Object->References) == 0)
+    {
+        sem_destroy(&Object->Started);
+
+        free(Object);
+    }
+
+    return NULL;
+}
+
+COMPAT_WEAK HANDLE CreateThread(LPSECURITY_ATTRIBUTES InAttributes, SIZE_T InStackSize, LPTHREAD_START_ROUTINE InStart,
+            LPVOID InParameter, DWORD InFlags, LPDWORD OutThreadId)
+{
+    COMPAT_OBJECT*          Object;
+
+    // suspended threads are not supported
+    if(InFlags & CREATE_SUSPENDED)
+        return NULL;
+
+    if((Object = CompatCreateObject(COMPAT_OBJECT_THREAD)) == NULL)
+        return NULL;
+
+    Object->Start = InStart;
+    Object->Parameter = InParameter;
+    Object->ExitCode = STILL_ACTIVE;
+    // the thread might exit before pthread_create() returns
+    Object->References = 2;
+
+    sem_init(&Object->Started, 0, 0);
+
+    if(pthread_create(&Object->Thread, NULL, CompatThreadStart, Object) != 0)
+    {
+        // nothing to detach
+        Object->IsJoined = TRUE;
+        Object->References = 1;
+
+        CloseHandle(Object);
+
+        return NULL;
+    }
+
+    // like on Windows, the new thread is enumerated as soon as it exists
+    while((sem_wait(&Object->Started) != 0) && (errno == EINTR));
+
+    if(OutThreadId != NULL)
+        *OutThreadId = Object->ThreadId;
+
+    return Object;
+}
+
+COMPAT_WEAK HANDLE CreateRemoteThread(HANDLE InProcess, LPSECURITY_ATTRIBUTES InAttributes, SIZE_T InStackSize,
+            LPTHREAD_START_ROUTINE InStart, LPVOID InParameter, DWORD InFlags, LPDWORD OutThreadId) { return NULL; }
+
+COMPAT_WEAK DWORD SuspendThread(HANDLE InThread)
+{
+    COMPAT_THREAD*          Thread;
+    DWORD                   ThreadId = (DWORD)(ULONG_PTR)InThread;
+    LONG                    Count;
+
+    if((((ULONG_PTR)InThread & ~(ULONG_PTR)MAXULONG) != COMPAT_THREAD_HANDLE) || (ThreadId == GetCurrentThreadId()))
+        return (DWORD)-1;
+
+    if((Thread = CompatLockThread(ThreadId)) == NULL)
+        return (DWORD)-1;
+
+    if((Count = Thread->SuspendCount++) == 0)
+    {
+        Thread->SuspendSequence++;
+
+        pthread_kill(Thread->Thread, COMPAT_SUSPEND_SIGNAL);
+
+        // wait until the handler captured the instruction pointer
+        while((sem_wait(&Thread->Suspended) != 0) && (errno == EINTR));
+    }
+
+    CompatUnlockThread(Thread);
+
+    return (DWORD)Count;
+}
+
+COMPAT_WEAK DWORD ResumeThread(HANDLE InThread)
+{
+    COMPAT_THREAD*          Thread;
+    LONG                    Count;
+
+    if(((ULONG_PTR)InThread & ~(ULONG_PTR)MAXULONG) != COMPAT_THREAD_HANDLE)
+        return (DWORD)-1;
+
+    if((Thread = CompatLockThread((DWORD)(ULONG_PTR)InThread)) == NULL)
+        return (DWORD)-1;
+
+    if((Count = Thread->SuspendCount) > 0)
+        Thread->SuspendCount--;
+
+    CompatUnlockThread(Thread);
+
+    return (DWORD)Count;
+}
+
+COMPAT_WEAK BOOL GetThreadContext(HANDLE InThread, CONTEXT* OutContext)
+{
+    COMPAT_THREAD*          Thread;
+    BOOL                    IsSuspended;
+
+    if(((ULONG_PTR)InThread & ~(ULONG_PTR)MAXULONG) != COMPAT_THREAD_HANDLE)
+        return FALSE;
+
+    if((Thread = CompatLockThread((DWORD)(ULONG_PTR)InThread)) == NULL)
+        return FALSE;
+
+    // only the instruction pointer is captured
+    if((IsSuspended = (Thread->SuspendCount > 0)))
+        OutContext->Rip = Thread->Rip;
+
+    CompatUnlockThread(Thread);
+
+    return IsSuspended;
+}
+
+COMPAT_WEAK BOOL GetExitCodeThread(HANDLE InThread, LPDWORD OutExitCode)
+{
+    COMPAT_OBJECT*          Object;
+
+    if((Object = CompatFindObject(InThread, COMPAT_OBJECT_THREAD, FALSE)) == NULL)
+        return FALSE;
+
+    *OutExitCode = Object->IsJoined?Object->ExitCode:STILL_ACTIVE;
+
+    return TRUE;
+}
+
+COMPAT_WEAK HANDLE CreateEventW(LPSECURITY_ATTRIBUTES InAttributes, BOOL InManualReset, BOOL InInitialState, LPCWSTR InName) { return NULL; }
+
+COMPAT_WEAK BOOL DuplicateHandle(HANDLE InSourceProcess, HANDLE InSource, HANDLE InTargetProcess, PHANDLE OutTarget,
+            DWORD InAccess, BOOL InInherit, DWORD InOptions) { return FALSE; }
+
+COMPAT_WEAK DWORD WaitForSingleObject(HANDLE InHandle, DWORD InMilliseconds)
+{
+    COMPAT_OBJECT*          Object;
+    struct timespec         Deadline;
+    int                     Result;
+
+    if((Object = CompatFindObject(InHandle, COMPAT_OBJECT_THREAD, FALSE)) == NULL)
+        return WAIT_OBJECT_0;
+
+    if(Object->IsJoined)
+        return WAIT_OBJECT_0;
+
+    if(InMilliseconds == INFINITE)
+        Result = pthread_join(Object->Thread, NULL);
+    else
+    {
+        clock_gettime(CLOCK_REALTIME, &Deadline);
+
+        Deadline.tv_sec += InMilliseconds / 1000;
+        Deadline.tv_nsec += (InMilliseconds % 1000) * 1000000L;
+
+        if(Deadline.tv_nsec >= 1000000000L)
+        {
+            Deadline.tv_sec++;
+            Deadline.tv_nsec -= 1000000000L;
+        }
+
+        Result = pthread_timedjoin_np(Object->Thread, NULL, &Deadline);
+    }
+
+    if(Result == ETIMEDOUT)
+        return WAIT_TIMEOUT;
+
+    if(Result != 0)
+        return WAIT_FAILED;
+
+    Object->IsJoined = TRUE;
+
+    return WAIT_OBJECT_0;
+}
+
+COMPAT_WEAK DWORD WaitForMultipleObjects(DWORD InCount, const HANDLE* InHandles, BOOL InWaitAll, DWORD InMilliseconds)
+{
+/*
+    Waiting for all objects uses the timeout for each of them. Waiting
+    for any object polls them every millisecond.
+*/
+    DWORD                   Index;
+    DWORD                   Elapsed;
+    DWORD                   Result;
+
+    if(InWaitAll)
+    {
+        for(Index = 0; Index < InCount; Index++)
+        {
+            if((Result = WaitForSingleObject(InHandles[Index], InMilliseconds)) != WAIT_OBJECT_0)
+                return Result;
+        }
+
+        return WAIT_OBJECT_0;
+    }
+
+    for(Elapsed = 0; ; Elapsed++)
+    {
+        for(Index = 0; Index < InCount; Index++)
+        {
+            if((Result = WaitForSingleObject(InHandles[Index], 0)) != WAIT_TIMEOUT)
+                return (Result == WAIT_OBJECT_0)?(WAIT_OBJECT_0 + Index):Result;
+        }
+
+        if((InMilliseconds != INFINITE) && (Elapsed >= InMilliseconds))
+            return WAIT_TIMEOUT;
+
+        usleep(1000);
+    }
+}
+
+COMPAT_WEAK LPVOID TlsGetValue(DWORD InIndex) { return NULL; }
+
+COMPAT_WEAK BOOL TlsSetValue(DWORD InIndex, LPVOID InValue) { return FALSE; }
+
+COMPAT_WEAK PVOID VirtualAllocEx(HANDLE InProcess, PVOID InAddress, SIZE_T InSize, DWORD InType, DWORD InProtect) { return NULL; }
+
+COMPAT_WEAK BOOL ReadProcessMemory(HANDLE InProcess, LPCVOID InAddress, LPVOID OutBuffer, SIZE_T InSize, SIZE_T* OutRead)
+{
+    memcpy(OutBuffer, InAddress, InSize);
+
+    if(OutRead != NULL)
+        *OutRead = InSize;
+
+    return TRUE;
+}
+
+COMPAT_WEAK BOOL WriteProcessMemory(HANDLE InProcess, LPVOID InAddress, LPCVOID InBuffer, SIZE_T InSize, SIZE_T* OutWritten) { return FALSE; }
+
+COMPAT_WEAK HANDLE CreateToolhelp32Snapshot(DWORD InFlags, DWORD InProcessId)
+{
+/*
+    Only the threads of this process can be enumerated.
+*/
+    COMPAT_OBJECT*          Object;
+    DWORD*                  ThreadIds;
+    LONG                    Index;
+    LONG                    Limit = CompatThreadLimit;
+    SIZE_T                  Count = 0;
+
+    if(InFlags != TH32CS_SNAPTHREAD)
+        return INVALID_HANDLE_VALUE;
+
+    if((ThreadIds = (DWORD*)malloc((Limit + 1) * sizeof(DWORD))) == NULL)
+        return INVALID_HANDLE_VALUE;
+
+    for(Index = 0; Index < Limit; Index++)
+    {
+        if(CompatThreads[Index].ThreadId != 0)
+            ThreadIds[Count++] = CompatThreads[Index].ThreadId;
+    }
+
+    if((Object = CompatCreateObject(COMPAT_OBJECT_SNAPSHOT)) == NULL)
+    {
+        free(ThreadIds);
+
+        return INVALID_HANDLE_VALUE;
+    }
+
+    Object->Base = (UCHAR*)ThreadIds;
+    Object->Size = Count;
+
+    return Object;
+}
+
+COMPAT_WEAK BOOL Thread32Next(HANDLE InSnapshot, THREADENTRY32* OutEntry)
+{
+    COMPAT_OBJECT*          Object;
+
+    if(((Object = CompatFindObject(InSnapshot, COMPAT_OBJECT_SNAPSHOT, FALSE)) == NULL) || (Object->Position >= Object->Size))
+        return FALSE;
+
+    OutEntry->th32ThreadID = ((DWORD*)Object->Base)[Object->Position++];
+    OutEntry->th32OwnerProcessID = GetCurrentProcessId();
+
+    return TRUE;
+}
+
+COMPAT_WEAK BOOL Thread32First(HANDLE InSnapshot, THREADENTRY32* OutEntry)
+{
+    COMPAT_OBJECT*          Object;
+
+    if((Object = CompatFindObject(InSnapshot, COMPAT_OBJECT_SNAPSHOT, FALSE)) == NULL)
+        return FALSE;
+
+    Object->Position = 0;
+
+    return Thread32Next(InSnapshot, OutEntry);
+}
+
+COMPAT_WEAK BOOL Module32First(HANDLE InSnapshot, MODULEENTRY32* OutEntry) { return FALSE; }
+
+COMPAT_WEAK BOOL Module32Next(HANDLE InSnapshot, MODULEENTRY32* OutEntry) { return FALSE; }
+
+COMPAT_WEAK SC_HANDLE OpenSCManagerW(LPCWSTR InMachine, LPCWSTR InDatabase, DWORD InAccess) { return NULL; }
+
+COMPAT_WEAK BOOL CloseServiceHandle(SC_HANDLE InHandle) { return TRUE; }
+
+COMPAT_WEAK DWORD GetFullPathNameW(LPCWSTR InPath, DWORD InSize, LPWSTR OutPath, LPWSTR* OutFilePart) { return 0; }
+
+COMPAT_WEAK HANDLE CreateFileW(LPCWSTR InPath, DWORD InAccess, DWORD InShare, LPSECURITY_ATTRIBUTES InAttributes,
+            DWORD InDisposition, DWORD InFlags, HANDLE InTemplate)
+{
+/*
+    Only opening existing files for reading is supported.
+*/
+    COMPAT_OBJECT*          Object;
+    char                    Path[PATH_MAX];
+    int                     File;
+
+    if((InAccess != GENERIC_READ) || (InDisposition != OPEN_EXISTING) ||
+            (wcstombs(Path, InPath, sizeof(Path)) >= sizeof(Path)))
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+
+        return INVALID_HANDLE_VALUE;
+    }
+
+    if((File = open(Path, O_RDONLY | O_CLOEXEC)) < 0)
+    {
+        SetLastError((errno == EACCES)?ERROR_ACCESS_DENIED:ERROR_FILE_NOT_FOUND);
+
+        return INVALID_HANDLE_VALUE;
+    }
+
+    if((Object = CompatCreateObject(COMPAT_OBJECT_FILE)) == NULL)
+    {
+        close(File);
+
+        return INVALID_HANDLE_VALUE;
+    }
+
+    Object->File = File;
+
+    return Object;
+}
+
+static int CompatLoadImage(
+            int InFile,
+            SIZE_T* OutSize)
+{
+/*
+    Lays out the sections of the given PE file like the loader does and
+    returns a memory file holding the image. Nothing is relocated or
+    resolved. Returns -1 if the file is not a valid image.
+*/
+    struct stat             Stat;
+    UCHAR*                  File = NULL;
+    IMAGE_DOS_HEADER*       DosHeader;
+    IMAGE_NT_HEADERS*       NtHeaders;
+    IMAGE_SECTION_HEADER*   Section;
+    ULONG                   SectionEnd;
+    ULONG                   Index;
+    ULONG                   Size;
+    int                     Image = -1;
+
+    if((fstat(InFile, &Stat) != 0) || (Stat.st_size < (off_t)sizeof(IMAGE_DOS_HEADER)) || (Stat.st_size > 0x7FFFFFFF))
+        goto ERROR_ABORT;
+
+    if(((File = (UCHAR*)malloc(Stat.st_size)) == NULL) || (pread(InFile, File, Stat.st_size, 0) != Stat.st_size))
+        goto ERROR_ABORT;
+
+    DosHeader = (IMAGE_DOS_HEADER*)File;
+
+    if((DosHeader->e_magic != IMAGE_DOS_SIGNATURE) || (DosHeader->e_lfanew <= 0) ||
+            ((ULONGLONG)DosHeader->e_lfanew + sizeof(IMAGE_NT_HEADERS) > (ULONGLONG)Stat.st_size))
+        goto ERROR_ABORT;
+
+    NtHeaders = (IMAGE_NT_HEADERS*)(File + DosHeader->e_lfanew);
+
+    SectionEnd = (ULONG)((UCHAR*)(IMAGE_FIRST_SECTION(NtHeaders) + NtHeaders->FileHeader.NumberOfSections) - File);
+
+    if((NtHeaders->Signature != IMAGE_NT_SIGNATURE) ||
+            (NtHeaders->OptionalHeader.SizeOfHeaders < SectionEnd) ||
+            (NtHeaders->OptionalHeader.SizeOfHeaders > NtHeaders->OptionalHeader.SizeOfImage) ||
+            ((off_t)NtHeaders->OptionalHeader.SizeOfHeaders > Stat.st_size))
+        goto ERROR_ABORT;
+
+    for(Index = 0; Index < NtHeaders->FileHeader.NumberOfSections; Index++)
+    {
+        Section = IMAGE_FIRST_SECTION(NtHeaders) + Index;
+
+        if(((ULONGLONG)Section->PointerToRawData + Section->SizeOfRawData > (ULONGLONG)Stat.st_size) ||
+                ((ULONGLONG)Section->VirtualAddress + Section->Misc.VirtualSize > NtHeaders->OptionalHeader.SizeOfImage) ||
+                ((ULONGLONG)Section->VirtualAddress + Section->SizeOfRawData > NtHeaders->OptionalHeader.SizeOfImage))
+            goto ERROR_ABORT;
+    }
+
+    // the memory file reads as zero where no section data is copied
+    if(((Image = memfd_create("image", MFD_CLOEXEC)) < 0) || (ftruncate(Image, NtHeaders->OptionalHeader.SizeOfImage) != 0))
+        goto ERROR_ABORT;
+
+    if(pwrite(Image, File, NtHeaders->OptionalHeader.SizeOfHeaders, 0) != NtHeaders->OptionalHeader.SizeOfHeaders)
+        goto ERROR_ABORT;
+
+    for(Index = 0; Index < NtHeaders->FileHeader.NumberOfSections; Index++)
+    {
+        Section = IMAGE_FIRST_SECTION(NtHeaders) + Index;
+        Size = Section->SizeOfRawData;
+
+        // the raw data is padded to the file alignment
+        if((Section->Misc.VirtualSize != 0) && (Size > Section->Misc.VirtualSize))
+            Size = Section->Misc.VirtualSize;
+
+        if(pwrite(Image, File + Section->PointerToRawData, Size, Section->VirtualAddress) != Size)
+            goto ERROR_ABORT;
+    }
+
+    *OutSize = NtHeaders->OptionalHeader.SizeOfImage;
+
+    free(File);
+
+    return Image;
+
+ERROR_ABORT:
+    if(Image >= 0)
+        close(Image);
+
+    free(File);
+
+    return -1;
+}
+
+COMPAT_WEAK HANDLE CreateFileMappingW(HANDLE InFile, LPSECURITY_ATTRIBUTES InAttributes, DWORD InProtect,
+            DWORD InSizeHigh, DWORD InSizeLow, LPCWSTR InName)
+{
+/*
+    Read only mappings of a file, optionally as image (SEC_IMAGE).
+*/
+    COMPAT_OBJECT*          File;
+    COMPAT_OBJECT*          Object;
+    struct stat             Stat;
+    SIZE_T                  Size = 0;
+    int                     Mapping;
+
+    if(((File = CompatFindObject(InFile, COMPAT_OBJECT_FILE, FALSE)) == NULL) || ((InProtect & 0xFF) != PAGE_READONLY))
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+
+        return NULL;
+    }
+
+    if(InProtect & SEC_IMAGE)
+    {
+        if((Mapping = CompatLoadImage(File->File, &Size)) < 0)
+        {
+            SetLastError(ERROR_BAD_EXE_FORMAT);
+
+            return NULL;
+        }
+    }
+    else
+    {
+        if(((Mapping = dup(File->File)) < 0) || (fstat(Mapping, &Stat) != 0))
+        {
+            if(Mapping >= 0)
+                close(Mapping);
+
+            return NULL;
+        }
+
+        Size = ((SIZE_T)InSizeHigh << 32) | InSizeLow;
+
+        if((Size == 0) || (Size > (SIZE_T)Stat.st_size))
+            Size = Stat.st_size;
+    }
+
+    if((Object = CompatCreateObject(COMPAT_OBJECT_MAPPING)) == NULL)
+    {
+        close(Mapping);
+
+        return NULL;
+    }
+
+    Object->File = Mapping;
+    Object->Size = Size;
+
+    return Object;
+}
+
+COMPAT_WEAK LPVOID MapViewOfFile(HANDLE InMapping, DWORD InAccess, DWORD InOffsetHigh, DWORD InOffsetLow, SIZE_T InSize)
+{
+    COMPAT_OBJECT*          Mapping;
+    COMPAT_OBJECT*          Object;
+    SIZE_T                  Offset = ((SIZE_T)InOffsetHigh << 32) | InOffsetLow;
+    UCHAR*                  Base;
+
+    if(((Mapping = CompatFindObject(InMapping, COMPAT_OBJECT_MAPPING, FALSE)) == NULL) ||
+            (InAccess != FILE_MAP_READ) || (Offset >= Mapping->Size))
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+
+        return NULL;
+    }
+
+    if((InSize == 0) || (InSize > Mapping->Size - Offset))
+        InSize = Mapping->Size - Offset;
+
+    if((Base = (UCHAR*)mmap(NULL, InSize, PROT_READ, MAP_SHARED, Mapping->File, Offset)) == MAP_FAILED)
+        return NULL;
+
+    if((Object = CompatCreateObject(COMPAT_OBJECT_VIEW)) == NULL)
+    {
+        munmap(Base, InSize);
+
+        return NULL;
+    }
+
+    Object->Base = Base;
+    Object->Size = InSize;
+
+    return Base;
+}
+
+COMPAT_WEAK BOOL UnmapViewOfFile(LPCVOID InAddress)
+{
+    COMPAT_OBJECT*          Object;
+
+    if((Object = CompatFindObject(InAddress, COMPAT_OBJECT_VIEW, TRUE)) == NULL)
+        return FALSE;
+
+    CompatDeleteObject(Object);
+
+    return TRUE;
+}
+
+COMPAT_WEAK LPVOID CoTaskMemAlloc(SIZE_T InSize) { return malloc(InSize); }
+
+COMPAT_WEAK void CoTaskMemFree(LPVOID InPointer) { free(InPointer); }
+
+/*
+    Secure CRT; truncation is the only error handled
+*/
+COMPAT_WEAK int _stricmp(const char* InLeft, const char* InRight) { return strcasecmp(InLeft, InRight); }
+
+COMPAT_WEAK int strncpy_s(char* OutBuffer, size_t InSize, const char* InSource, size_t InCount)
+{
+    size_t                  Length = strlen(InSource);
+
+    if((InCount != _TRUNCATE) && (InCount < Length))
+        Length = InCount;
+
+    if(Length >= InSize)
+        Length = InSize - 1;
+
+    memcpy(OutBuffer, InSource, Length);
+
+    OutBuffer[Length] = 0;
+
+    return 0;
+}
+
+COMPAT_WEAK int strcpy_s(char* OutBuffer, size_t InSize, const char* InSource)
+{
+    return strncpy_s(OutBuffer, InSize, InSource, _TRUNCATE);
+}
+
+COMPAT_WEAK int strcat_s(char* OutBuffer, size_t InSize, const char* InSource)
+{
+    size_t                  Length = strlen(OutBuffer);
+
+    return strncpy_s(OutBuffer + Length, InSize - Length, InSource, _TRUNCATE);
+}
+
+COMPAT_WEAK int wcstombs_s(size_t* OutCount, char* OutBuffer, size_t InSize, const wchar_t* InSource, size_t InCount)
+{
+    size_t                  Length = wcstombs(OutBuffer, InSource, InSize - 1);
+
+    if(Length == (size_t)-1)
+        Length = 0;
+
+    OutBuffer[Length] = 0;
+
+    *OutCount = Length + 1;
+
+    return 0;
+}
+
+COMPAT_WEAK int swprintf_s(wchar_t* OutBuffer, size_t InSize, const wchar_t* InFormat, ...)
+{
+    va_list                 Args;
+    int                     Result;
+
+    va_start(Args, InFormat);
+    Result = vswprintf(OutBuffer, InSize, InFormat, Args);
+    va_end(Args);
+
+    return Result;
+}
+
+COMPAT_WEAK int fopen_s(FILE** OutFile, const char* InPath, const char* InMode)
+{
+    *OutFile = fopen(InPath, InMode);
+
+    return (*OutFile == NULL)?-1:0;
+}
+
+/*
+    EasyHook internals outside of the tested sources
+*/
+COMPAT_WEAK void RtlSetLastError(LONG InCode, LONG InNtStatus, WCHAR* InMessage)
+{
+    CompatLastStatus = InNtStatus;
+}
+
+COMPAT_WEAK void RtlAssert(BOOL InAssert, LPCWSTR lpMessageText)
+{
+    if(InAssert)
+        return;
+
+    fwprintf(stderr, L"assertion failed: %ls\n", lpMessageText);
+
+    abort();
+}
+
+COMPAT_WEAK ULONG RtlAnsiLength(CHAR* InString) { return (ULONG)strlen(InString); }
+
+COMPAT_WEAK BOOL LhIsValidHandle(TRACED_HOOK_HANDLE InTracedHandle, PLOCAL_HOOK_INFO* OutHandle) { return FALSE; }
+
+COMPAT_WEAK HMODULE         hKernel32 = NULL;
+COMPAT_WEAK HMODULE         hNtDll = NULL;
+COMPAT_WEAK DWORD           RhTlsIndex = TLS_OUT_OF_INDEXES;
+
+COMPAT_WEAK void Injection_ASM_x64() { }
+
+COMPAT_WEAK BOOL RtlFileExists(WCHAR* InPath) { return FALSE; }
+
+COMPAT_WEAK LONG RtlGetWorkingDirectory(WCHAR* OutPath, ULONG InMaxLength) { return STATUS_NOT_SUPPORTED; }
+
+COMPAT_WEAK LONG RtlGetCurrentModulePath(WCHAR* OutPath, ULONG InMaxLength) { return STATUS_NOT_SUPPORTED; }
+
+COMPAT_WEAK ULONG RtlUnicodeLength(WCHAR* InString) { return (ULONG)wcslen(InString); }
+
+COMPAT_WEAK WCHAR* RtlErrorCodeToString(LONG InCode) { return L""; }
+
+COMPAT_WEAK PWCHAR RtlGetLastErrorString() { return L""; }
+
+COMPAT_WEAK NTSTATUS RhCreateStealthRemoteThread(ULONG InTargetPID, LPTHREAD_START_ROUTINE InRemoteRoutine,
+            PVOID InRemoteParam, HANDLE* OutRemoteThread) { return STATUS_NOT_SUPPORTED; }
+
+COMPAT_WEAK NTSTATUS LhAllocateHook(void* InEntryPoint, void* InHookProc, void* InCallback, ULONG InFlags,
+            LOCAL_HOOK_INFO** OutHook, ULONG* RelocSize) { return STATUS_NOT_SUPPORTED; }
+
+COMPAT_WEAK void LhFreeMemory(PLOCAL_HOOK_INFO* RefHandle) { }
@@ -0,0 +1,40 @@
+// EasyHook (File: Test\EasyHook.NativeTests\compat\stdio.h)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#ifndef _COMPAT_STDIO_H_
+#define _COMPAT_STDIO_H_
+
+#include_next <stdio.h>
+#include <stdarg.h>
+
+/*
+    The secure CRT functions Visual C++ declares in stdio.h, also
+    used by udis86 which doesn't include windows.h.
+*/
+int sprintf_s(char* OutBuffer, size_t InSize, const char* InFormat, ...);
+int vsnprintf_s(char* OutBuffer, size_t InSize, size_t InCount, const char* InFormat, va_list InArgs);
+int fopen_s(FILE** OutFile, const char* InPath, const char* InMode);
+
+#endif
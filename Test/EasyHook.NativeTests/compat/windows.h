@@ -0,0 +1,591 @@
+// EasyHook (File: Test\EasyHook.NativeTests\compat\windows.h)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+/*
+    Just enough of the Windows API to compile the platform independent parts
+    of EasyHook with GCC on Linux. Types follow the LLP64 model, so ULONG is
+    32-Bit like on Windows. Everything that touches the process, like
+    VirtualQuery() or GetCurrentThreadId(), is implemented in compat.c and
+    can be replaced by a test, see compat.h.
+*/
+#ifndef _COMPAT_WINDOWS_H_
+#define _COMPAT_WINDOWS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+
+#define __stdcall
+#define __cdecl
+#define __fastcall
+#define WINAPI
+#define NTAPI
+#define APIENTRY
+#define CALLBACK
+#define NTSYSAPI
+#define IN
+#define OUT
+#define OPTIONAL
+#define __in
+#define __out
+#define __out_opt
+#define __out_ecount(x)
+#define __declspec(x)
+#define __forceinline           static inline
+#define __inline                inline
+#define __int8                  char
+#define __int16                 short
+#define __int32                 int
+#define __int64                 long long
+#define EXTERN_C
+#define C_ASSERT(e)             typedef char __C_ASSERT__[(e)?1:-1]
+#define UNREFERENCED_PARAMETER(P) ((void)(P))
+#define ARRAYSIZE(A)            (sizeof(A) / sizeof((A)[0]))
+
+typedef int                     BOOL, *PBOOL, INT;
+typedef unsigned char           BOOLEAN, UCHAR, BYTE, *PUCHAR, *PBYTE;
+typedef char                    CHAR, *PCHAR, *PSTR, *LPSTR;
+typedef const char*             LPCSTR;
+typedef unsigned short          WORD, USHORT;
+typedef short                   SHORT;
+typedef unsigned int            ULONG, DWORD, UINT, *PULONG, *PDWORD, *LPDWORD;
+typedef int                     LONG, INT32, *PLONG;
+typedef unsigned long long      ULONGLONG, ULONG64, DWORD64, UINT64;
+typedef long long               LONGLONG, LONG64, INT64;
+typedef uintptr_t               ULONG_PTR, DWORD_PTR, SIZE_T, UINT_PTR, *PULONG_PTR;
+typedef intptr_t                LONG_PTR, INT_PTR;
+typedef void                    VOID, *PVOID, *LPVOID, *HANDLE, *HMODULE, *HINSTANCE;
+typedef const void*             LPCVOID;
+typedef wchar_t                 WCHAR, TCHAR, *PWCHAR, *PWSTR, *LPWSTR;
+typedef const wchar_t*          LPCWSTR;
+typedef LONG                    NTSTATUS;
+typedef unsigned char           KIRQL;
+
+typedef struct _CRITICAL_SECTION_
+{
+    void*                   Mutex;
+}CRITICAL_SECTION, RTL_CRITICAL_SECTION, *PRTL_CRITICAL_SECTION;
+
+typedef struct _SYSTEM_INFO
+{
+    DWORD                   dwOemId;
+    DWORD                   dwPageSize;
+    LPVOID                  lpMinimumApplicationAddress;
+    LPVOID                  lpMaximumApplicationAddress;
+    DWORD_PTR               dwActiveProcessorMask;
+    DWORD                   dwNumberOfProcessors;
+    DWORD                   dwProcessorType;
+    DWORD                   dwAllocationGranularity;
+    WORD                    wProcessorLevel;
+    WORD                    wProcessorRevision;
+}SYSTEM_INFO, *LPSYSTEM_INFO;
+
+typedef struct _MEMORY_BASIC_INFORMATION
+{
+    PVOID                   BaseAddress;
+    PVOID                   AllocationBase;
+    DWORD                   AllocationProtect;
+    SIZE_T                  RegionSize;
+    DWORD                   State;
+    DWORD                   Protect;
+    DWORD                   Type;
+}MEMORY_BASIC_INFORMATION, *PMEMORY_BASIC_INFORMATION;
+
+typedef struct _MODULEINFO
+{
+    LPVOID                  lpBaseOfDll;
+    DWORD                   SizeOfImage;
+    LPVOID                  EntryPoint;
+}MODULEINFO;
+
+typedef union _LARGE_INTEGER
+{
+    struct
+    {
+        DWORD               LowPart;
+        LONG                HighPart;
+    };
+    LONGLONG                QuadPart;
+}LARGE_INTEGER;
+
+typedef struct _UNICODE_STRING
+{
+    USHORT                  Length;
+    USHORT                  MaximumLength;
+    PWSTR                   Buffer;
+}UNICODE_STRING;
+
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+
+typedef HANDLE                  *PHANDLE, SC_HANDLE;
+typedef DWORD                   ACCESS_MASK;
+
+typedef struct _STARTUPINFOW
+{
+    DWORD                   cb;
+    LPWSTR                  lpReserved;
+    LPWSTR                  lpDesktop;
+    LPWSTR                  lpTitle;
+    DWORD                   dwX;
+    DWORD                   dwY;
+    DWORD                   dwXSize;
+    DWORD                   dwYSize;
+    DWORD                   dwXCountChars;
+    DWORD                   dwYCountChars;
+    DWORD                   dwFillAttribute;
+    DWORD                   dwFlags;
+    WORD                    wShowWindow;
+    WORD                    cbReserved2;
+    PBYTE                   lpReserved2;
+    HANDLE                  hStdInput;
+    HANDLE                  hStdOutput;
+    HANDLE                  hStdError;
+}STARTUPINFO, STARTUPINFOW, *LPSTARTUPINFOW;
+
+typedef struct _PROCESS_INFORMATION
+{
+    HANDLE                  hProcess;
+    HANDLE                  hThread;
+    DWORD                   dwProcessId;
+    DWORD                   dwThreadId;
+}PROCESS_INFORMATION, *LPPROCESS_INFORMATION;
+
+typedef struct _SECURITY_ATTRIBUTES
+{
+    DWORD                   nLength;
+    LPVOID                  lpSecurityDescriptor;
+    BOOL                    bInheritHandle;
+}SECURITY_ATTRIBUTES, *LPSECURITY_ATTRIBUTES;
+
+typedef struct tagMODULEENTRY32W
+{
+    DWORD                   dwSize;
+    DWORD                   th32ModuleID;
+    DWORD                   th32ProcessID;
+    DWORD                   GlblcntUsage;
+    DWORD                   ProccntUsage;
+    BYTE*                   modBaseAddr;
+    DWORD                   modBaseSize;
+    HMODULE                 hModule;
+    WCHAR                   szModule[256];
+    WCHAR                   szExePath[260];
+}MODULEENTRY32, MODULEENTRY32W;
+
+typedef struct tagTHREADENTRY32
+{
+    DWORD                   dwSize;
+    DWORD                   cntUsage;
+    DWORD                   th32ThreadID;
+    DWORD                   th32OwnerProcessID;
+    LONG                    tpBasePri;
+    LONG                    tpDeltaPri;
+    DWORD                   dwFlags;
+}THREADENTRY32;
+
+// only the instruction pointer is available
+typedef struct _CONTEXT
+{
+    DWORD                   ContextFlags;
+    ULONGLONG               Rip;
+}CONTEXT;
+
+/*
+    Portable executable images, the 64-Bit layout as _M_X64 is defined
+*/
+typedef struct _IMAGE_DOS_HEADER
+{
+    WORD                    e_magic;
+    WORD                    e_cblp;
+    WORD                    e_cp;
+    WORD                    e_crlc;
+    WORD                    e_cparhdr;
+    WORD                    e_minalloc;
+    WORD                    e_maxalloc;
+    WORD                    e_ss;
+    WORD                    e_sp;
+    WORD                    e_csum;
+    WORD                    e_ip;
+    WORD                    e_cs;
+    WORD                    e_lfarlc;
+    WORD                    e_ovno;
+    WORD                    e_res[4];
+    WORD                    e_oemid;
+    WORD                    e_oeminfo;
+    WORD                    e_res2[10];
+    LONG                    e_lfanew;
+}IMAGE_DOS_HEADER, *PIMAGE_DOS_HEADER;
+
+typedef struct _IMAGE_FILE_HEADER
+{
+    WORD                    Machine;
+    WORD                    NumberOfSections;
+    DWORD                   TimeDateStamp;
+    DWORD                   PointerToSymbolTable;
+    DWORD                   NumberOfSymbols;
+    WORD                    SizeOfOptionalHeader;
+    WORD                    Characteristics;
+}IMAGE_FILE_HEADER;
+
+typedef struct _IMAGE_DATA_DIRECTORY
+{
+    DWORD                   VirtualAddress;
+    DWORD                   Size;
+}IMAGE_DATA_DIRECTORY;
+
+typedef struct _IMAGE_OPTIONAL_HEADER64
+{
+    WORD                    Magic;
+    BYTE                    MajorLinkerVersion;
+    BYTE                    MinorLinkerVersion;
+    DWORD                   SizeOfCode;
+    DWORD                   SizeOfInitializedData;
+    DWORD                   SizeOfUninitializedData;
+    DWORD                   AddressOfEntryPoint;
+    DWORD                   BaseOfCode;
+    ULONGLONG               ImageBase;
+    DWORD                   SectionAlignment;
+    DWORD                   FileAlignment;
+    WORD                    MajorOperatingSystemVersion;
+    WORD                    MinorOperatingSystemVersion;
+    WORD                    MajorImageVersion;
+    WORD                    MinorImageVersion;
+    WORD                    MajorSubsystemVersion;
+    WORD                    MinorSubsystemVersion;
+    DWORD                   Win32VersionValue;
+    DWORD                   SizeOfImage;
+    DWORD                   SizeOfHeaders;
+    DWORD                   CheckSum;
+    WORD                    Subsystem;
+    WORD                    DllCharacteristics;
+    ULONGLONG               SizeOfStackReserve;
+    ULONGLONG               SizeOfStackCommit;
+    ULONGLONG               SizeOfHeapReserve;
+    ULONGLONG               SizeOfHeapCommit;
+    DWORD                   LoaderFlags;
+    DWORD                   NumberOfRvaAndSizes;
+    IMAGE_DATA_DIRECTORY    DataDirectory[16];
+}IMAGE_OPTIONAL_HEADER, IMAGE_OPTIONAL_HEADER64;
+
+typedef struct _IMAGE_NT_HEADERS64
+{
+    DWORD                   Signature;
+    IMAGE_FILE_HEADER       FileHeader;
+    IMAGE_OPTIONAL_HEADER   OptionalHeader;
+}IMAGE_NT_HEADERS, IMAGE_NT_HEADERS64, *PIMAGE_NT_HEADERS;
+
+typedef struct _IMAGE_SECTION_HEADER
+{
+    BYTE                    Name[8];
+    union
+    {
+        DWORD               PhysicalAddress;
+        DWORD               VirtualSize;
+    }Misc;
+    DWORD                   VirtualAddress;
+    DWORD                   SizeOfRawData;
+    DWORD                   PointerToRawData;
+    DWORD                   PointerToRelocations;
+    DWORD                   PointerToLinenumbers;
+    WORD                    NumberOfRelocations;
+    WORD                    NumberOfLinenumbers;
+    DWORD                   Characteristics;
+}IMAGE_SECTION_HEADER, *PIMAGE_SECTION_HEADER;
+
+typedef struct _IMAGE_EXPORT_DIRECTORY
+{
+    DWORD                   Characteristics;
+    DWORD                   TimeDateStamp;
+    WORD                    MajorVersion;
+    WORD                    MinorVersion;
+    DWORD                   Name;
+    DWORD                   Base;
+    DWORD                   NumberOfFunctions;
+    DWORD                   NumberOfNames;
+    DWORD                   AddressOfFunctions;
+    DWORD                   AddressOfNames;
+    DWORD                   AddressOfNameOrdinals;
+}IMAGE_EXPORT_DIRECTORY, *PIMAGE_EXPORT_DIRECTORY;
+
+#define TRUE                            1
+#define FALSE                           0
+#define MAX_PATH                        260
+#define INFINITE                        0xFFFFFFFF
+#define MAXULONG                        0xFFFFFFFF
+#define INVALID_HANDLE_VALUE            ((HANDLE)(LONG_PTR)-1)
+#define TLS_OUT_OF_INDEXES              0xFFFFFFFF
+#define _TRUNCATE                       ((size_t)-1)
+
+#define MEM_COMMIT                      0x1000
+#define MEM_RESERVE                     0x2000
+#define MEM_DECOMMIT                    0x4000
+#define MEM_RELEASE                     0x8000
+#define MEM_FREE                        0x10000
+#define MEM_PRIVATE                     0x20000
+#define MEM_MAPPED                      0x40000
+#define MEM_IMAGE                       0x1000000
+#define PAGE_NOACCESS                   0x01
+#define PAGE_READONLY                   0x02
+#define PAGE_READWRITE                  0x04
+#define PAGE_EXECUTE_READ               0x20
+#define PAGE_EXECUTE_READWRITE          0x40
+#define SEC_IMAGE                       0x1000000
+
+#define GENERIC_READ                    0x80000000
+#define FILE_SHARE_READ                 0x00000001
+#define OPEN_EXISTING                   3
+#define FILE_ATTRIBUTE_NORMAL           0x00000080
+#define FILE_MAP_READ                   0x0004
+#define PROCESS_QUERY_INFORMATION       0x0400
+#define PROCESS_ALL_ACCESS              0x001FFFFF
+#define THREAD_SUSPEND_RESUME           0x0002
+#define THREAD_GET_CONTEXT              0x0008
+#define CONTEXT_CONTROL                 0x00100001
+#define EVENT_ALL_ACCESS                0x001F0003
+#define TOKEN_READ                      0x00020008
+#define SC_MANAGER_ALL_ACCESS           0x000F003F
+#define CREATE_SUSPENDED                0x00000004
+#define TH32CS_SNAPTHREAD               0x00000004
+#define TH32CS_SNAPMODULE               0x00000008
+#define MAXIMUM_WAIT_OBJECTS            64
+#define WAIT_OBJECT_0                   0
+#define WAIT_TIMEOUT                    0x00000102
+#define WAIT_FAILED                     0xFFFFFFFF
+#define STILL_ACTIVE                    0x00000103
+#define ERROR_FILE_NOT_FOUND            2
+#define ERROR_ACCESS_DENIED             5
+#define ERROR_INVALID_PARAMETER         87
+#define ERROR_BAD_EXE_FORMAT            193
+
+#define IMAGE_DOS_SIGNATURE             0x5A4D
+#define IMAGE_NT_SIGNATURE              0x00004550
+#define IMAGE_FILE_MACHINE_I386         0x014C
+#define IMAGE_FILE_MACHINE_AMD64        0x8664
+#define IMAGE_DIRECTORY_ENTRY_EXPORT    0
+#define IMAGE_NT_OPTIONAL_HDR64_MAGIC   0x020B
+#define IMAGE_SCN_CNT_CODE              0x00000020
+#define IMAGE_SCN_CNT_INITIALIZED_DATA  0x00000040
+#define IMAGE_SCN_MEM_EXECUTE           0x20000000
+#define IMAGE_SCN_MEM_READ              0x40000000
+
+#define IMAGE_FIRST_SECTION(NtHeaders)  ((PIMAGE_SECTION_HEADER)((ULONG_PTR)(NtHeaders) +\
+                                            offsetof(IMAGE_NT_HEADERS, OptionalHeader) + (NtHeaders)->FileHeader.SizeOfOptionalHeader))
+
+#define NT_SUCCESS(Status)              (((NTSTATUS)(Status)) >= 0)
+
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000)
+#define STATUS_TIMEOUT                  ((NTSTATUS)0x00000102)
+#define STATUS_PENDING                  ((NTSTATUS)0x00000103)
+#define STATUS_BUFFER_OVERFLOW          ((NTSTATUS)0x80000005)
+#define STATUS_UNSUCCESSFUL             ((NTSTATUS)0xC0000001)
+#define STATUS_NOT_IMPLEMENTED          ((NTSTATUS)0xC0000002)
+#define STATUS_INFO_LENGTH_MISMATCH     ((NTSTATUS)0xC0000004)
+#define STATUS_INVALID_HANDLE           ((NTSTATUS)0xC0000008)
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000D)
+#define STATUS_NO_MEMORY                ((NTSTATUS)0xC0000017)
+#define STATUS_ACCESS_DENIED            ((NTSTATUS)0xC0000022)
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023)
+#define STATUS_INVALID_IMAGE_FORMAT     ((NTSTATUS)0xC000007B)
+#define STATUS_PROCEDURE_NOT_FOUND      ((NTSTATUS)0xC000007A)
+#define STATUS_INSUFFICIENT_RESOURCES   ((NTSTATUS)0xC000009A)
+#define STATUS_NOT_SUPPORTED            ((NTSTATUS)0xC00000BB)
+#define STATUS_INTERNAL_ERROR           ((NTSTATUS)0xC00000E5)
+#define STATUS_INVALID_PARAMETER_1      ((NTSTATUS)0xC00000EF)
+#define STATUS_INVALID_PARAMETER_2      ((NTSTATUS)0xC00000F0)
+#define STATUS_INVALID_PARAMETER_3      ((NTSTATUS)0xC00000F1)
+#define STATUS_INVALID_PARAMETER_4      ((NTSTATUS)0xC00000F2)
+#define STATUS_INVALID_PARAMETER_5      ((NTSTATUS)0xC00000F3)
+#define STATUS_INVALID_PARAMETER_6      ((NTSTATUS)0xC00000F4)
+#define STATUS_INVALID_PARAMETER_7      ((NTSTATUS)0xC00000F5)
+#define STATUS_INVALID_PARAMETER_8      ((NTSTATUS)0xC00000F6)
+#define STATUS_CANCELLED                ((NTSTATUS)0xC0000120)
+#define STATUS_DLL_INIT_FAILED          ((NTSTATUS)0xC0000142)
+#define STATUS_UNHANDLED_EXCEPTION      ((NTSTATUS)0xC0000144)
+#define STATUS_NOT_FOUND                ((NTSTATUS)0xC0000225)
+#define STATUS_RETRY                    ((NTSTATUS)0xC000022D)
+#define STATUS_NOINTERFACE              ((NTSTATUS)0xC00002B9)
+#define STATUS_ALREADY_REGISTERED       ((NTSTATUS)0xC0000718)
+#define STATUS_WOW_ASSERTION            ((NTSTATUS)0xC0009898)
+#define SUCCEEDED(x)                    (((LONG)(x)) >= 0)
+
+/*
+    Interlocked operations and compiler intrinsics
+*/
+#define InterlockedIncrement(p)                     __sync_add_and_fetch((p), 1)
+#define InterlockedDecrement(p)                     __sync_sub_and_fetch((p), 1)
+#define InterlockedIncrement64(p)                   __sync_add_and_fetch((p), 1)
+#define InterlockedExchangeAdd(p, v)                __sync_fetch_and_add((p), (v))
+#define InterlockedExchangeAdd64(p, v)              __sync_fetch_and_add((p), (v))
+#define InterlockedExchange(p, v)                   __sync_lock_test_and_set((p), (v))
+#define InterlockedExchange64(p, v)                 __sync_lock_test_and_set((p), (v))
+#define InterlockedExchangePointer(p, v)            ((PVOID)__sync_lock_test_and_set((PVOID*)(p), (PVOID)(v)))
+#define InterlockedCompareExchange(p, v, c)         __sync_val_compare_and_swap((p), (c), (v))
+#define InterlockedCompareExchange64(p, v, c)       __sync_val_compare_and_swap((p), (c), (v))
+#define InterlockedCompareExchangePointer(p, v, c)  ((PVOID)__sync_val_compare_and_swap((PVOID*)(p), (PVOID)(c), (PVOID)(v)))
+#define MemoryBarrier()                             __sync_synchronize()
+#define _ReadWriteBarrier()                         __asm__ __volatile__("" ::: "memory")
+#define YieldProcessor()                            __builtin_ia32_pause()
+#define __rdtsc()                                   __builtin_ia32_rdtsc()
+#define ReadTimeStampCounter()                      __rdtsc()
+
+// MSVC leaves the index undefined for an empty mask, here it is cleared
+static inline unsigned char CompatBitScanForward(unsigned int* OutIndex, unsigned long long InMask)
+{
+    *OutIndex = 0;
+
+    if(InMask == 0)
+        return 0;
+
+    *OutIndex = (unsigned int)__builtin_ctzll(InMask);
+
+    return 1;
+}
+
+static inline unsigned char CompatBitScanReverse(unsigned int* OutIndex, unsigned long long InMask)
+{
+    *OutIndex = 0;
+
+    if(InMask == 0)
+        return 0;
+
+    *OutIndex = 63 - (unsigned int)__builtin_clzll(InMask);
+
+    return 1;
+}
+
+// MSVC passes an "unsigned long*", which is 64-Bit on Linux
+#define _BitScanForward(Index, Mask)        CompatBitScanForward((unsigned int*)(Index), (unsigned int)(Mask))
+#define _BitScanReverse(Index, Mask)        CompatBitScanReverse((unsigned int*)(Index), (unsigned int)(Mask))
+#define _BitScanForward64(Index, Mask)      CompatBitScanForward((unsigned int*)(Index), (unsigned long long)(Mask))
+#define _BitScanReverse64(Index, Mask)      CompatBitScanReverse((unsigned int*)(Index), (unsigned long long)(Mask))
+
+/*
+    Process related API, see compat.c
+*/
+DWORD GetCurrentThreadId(void);
+DWORD GetCurrentProcessId(void);
+HANDLE GetCurrentProcess(void);
+DWORD GetLastError(void);
+void SetLastError(DWORD InCode);
+DWORD GetTickCount(void);
+BOOL QueryPerformanceCounter(LARGE_INTEGER* OutCounter);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* OutFrequency);
+void Sleep(DWORD InMilliseconds);
+BOOL SwitchToThread(void);
+
+void InitializeCriticalSection(CRITICAL_SECTION* InLock);
+void EnterCriticalSection(CRITICAL_SECTION* InLock);
+void LeaveCriticalSection(CRITICAL_SECTION* InLock);
+void DeleteCriticalSection(CRITICAL_SECTION* InLock);
+
+void GetSystemInfo(SYSTEM_INFO* OutInfo);
+PVOID VirtualAlloc(PVOID InAddress, SIZE_T InSize, DWORD InType, DWORD InProtect);
+BOOL VirtualFree(PVOID InAddress, SIZE_T InSize, DWORD InType);
+BOOL VirtualProtect(PVOID InAddress, SIZE_T InSize, DWORD InProtect, DWORD* OutOldProtect);
+SIZE_T VirtualQuery(LPCVOID InAddress, MEMORY_BASIC_INFORMATION* OutInfo, SIZE_T InSize);
+BOOL IsBadReadPtr(LPCVOID InPointer, UINT_PTR InSize);
+BOOL FlushInstructionCache(HANDLE InProcess, LPCVOID InAddress, SIZE_T InSize);
+
+HANDLE HeapCreate(DWORD InOptions, SIZE_T InInitialSize, SIZE_T InMaximumSize);
+BOOL HeapDestroy(HANDLE InHeap);
+PVOID HeapAlloc(HANDLE InHeap, DWORD InFlags, SIZE_T InSize);
+BOOL HeapFree(HANDLE InHeap, DWORD InFlags, PVOID InPointer);
+
+BOOL EnumProcessModules(HANDLE InProcess, HMODULE* OutModules, DWORD InSize, DWORD* OutRequired);
+BOOL GetModuleInformation(HANDLE InProcess, HMODULE InModule, MODULEINFO* OutInfo, DWORD InSize);
+DWORD GetModuleFileNameA(HMODULE InModule, LPSTR OutPath, DWORD InSize);
+PVOID GetProcAddress(HMODULE InModule, LPCSTR InName);
+
+void OutputDebugStringW(LPCWSTR InMessage);
+int _snwprintf_s(wchar_t* OutBuffer, size_t InSize, size_t InCount, const wchar_t* InFormat, ...);
+
+/*
+    Other processes, threads and files; the defaults fail or act on the
+    current process, a test simulating a target provides its own versions.
+*/
+#define CreateEvent                     CreateEventW
+#define GetFullPathName                 GetFullPathNameW
+
+BOOL CloseHandle(HANDLE InHandle);
+HANDLE OpenProcess(DWORD InAccess, BOOL InInherit, DWORD InProcessId);
+HANDLE OpenThread(DWORD InAccess, BOOL InInherit, DWORD InThreadId);
+BOOL OpenProcessToken(HANDLE InProcess, DWORD InAccess, PHANDLE OutToken);
+BOOL TerminateProcess(HANDLE InProcess, UINT InExitCode);
+BOOL CreateProcessW(LPCWSTR InApplication, LPWSTR InCommandLine, LPSECURITY_ATTRIBUTES InProcessAttributes,
+            LPSECURITY_ATTRIBUTES InThreadAttributes, BOOL InInherit, DWORD InFlags, LPVOID InEnvironment,
+            LPCWSTR InDirectory, LPSTARTUPINFOW InStartupInfo, LPPROCESS_INFORMATION OutProcessInfo);
+HANDLE CreateThread(LPSECURITY_ATTRIBUTES InAttributes, SIZE_T InStackSize, LPTHREAD_START_ROUTINE InStart,
+            LPVOID InParameter, DWORD InFlags, LPDWORD OutThreadId);
+HANDLE CreateRemoteThread(HANDLE InProcess, LPSECURITY_ATTRIBUTES InAttributes, SIZE_T InStackSize,
+            LPTHREAD_START_ROUTINE InStart, LPVOID InParameter, DWORD InFlags, LPDWORD OutThreadId);
+DWORD SuspendThread(HANDLE InThread);
+DWORD ResumeThread(HANDLE InThread);
+BOOL GetThreadContext(HANDLE InThread, CONTEXT* OutContext);
+BOOL GetExitCodeThread(HANDLE InThread, LPDWORD OutExitCode);
+HANDLE CreateEventW(LPSECURITY_ATTRIBUTES InAttributes, BOOL InManualReset, BOOL InInitialState, LPCWSTR InName);
+BOOL DuplicateHandle(HANDLE InSourceProcess, HANDLE InSource, HANDLE InTargetProcess, PHANDLE OutTarget,
+            DWORD InAccess, BOOL InInherit, DWORD InOptions);
+DWORD WaitForSingleObject(HANDLE InHandle, DWORD InMilliseconds);
+DWORD WaitForMultipleObjects(DWORD InCount, const HANDLE* InHandles, BOOL InWaitAll, DWORD InMilliseconds);
+LPVOID TlsGetValue(DWORD InIndex);
+BOOL TlsSetValue(DWORD InIndex, LPVOID InValue);
+
+PVOID VirtualAllocEx(HANDLE InProcess, PVOID InAddress, SIZE_T InSize, DWORD InType, DWORD InProtect);
+BOOL ReadProcessMemory(HANDLE InProcess, LPCVOID InAddress, LPVOID OutBuffer, SIZE_T InSize, SIZE_T* OutRead);
+BOOL WriteProcessMemory(HANDLE InProcess, LPVOID InAddress, LPCVOID InBuffer, SIZE_T InSize, SIZE_T* OutWritten);
+
+HANDLE CreateToolhelp32Snapshot(DWORD InFlags, DWORD InProcessId);
+BOOL Module32First(HANDLE InSnapshot, MODULEENTRY32* OutEntry);
+BOOL Module32Next(HANDLE InSnapshot, MODULEENTRY32* OutEntry);
+BOOL Thread32First(HANDLE InSnapshot, THREADENTRY32* OutEntry);
+BOOL Thread32Next(HANDLE InSnapshot, THREADENTRY32* OutEntry);
+
+SC_HANDLE OpenSCManagerW(LPCWSTR InMachine, LPCWSTR InDatabase, DWORD InAccess);
+BOOL CloseServiceHandle(SC_HANDLE InHandle);
+
+DWORD GetFullPathNameW(LPCWSTR InPath, DWORD InSize, LPWSTR OutPath, LPWSTR* OutFilePart);
+HANDLE CreateFileW(LPCWSTR InPath, DWORD InAccess, DWORD InShare, LPSECURITY_ATTRIBUTES InAttributes,
+            DWORD InDisposition, DWORD InFlags, HANDLE InTemplate);
+HANDLE CreateFileMappingW(HANDLE InFile, LPSECURITY_ATTRIBUTES InAttributes, DWORD InProtect,
+            DWORD InSizeHigh, DWORD InSizeLow, LPCWSTR InName);
+LPVOID MapViewOfFile(HANDLE InMapping, DWORD InAccess, DWORD InOffsetHigh, DWORD InOffsetLow, SIZE_T InSize);
+BOOL UnmapViewOfFile(LPCVOID InAddress);
+
+LPVOID CoTaskMemAlloc(SIZE_T InSize);
+void CoTaskMemFree(LPVOID InPointer);
+
+/*
+    Secure CRT
+*/
+int _stricmp(const char* InLeft, const char* InRight);
+int strcpy_s(char* OutBuffer, size_t InSize, const char* InSource);
+int strncpy_s(char* OutBuffer, size_t InSize, const char* InSource, size_t InCount);
+int strcat_s(char* OutBuffer, size_t InSize, const char* InSource);
+int wcstombs_s(size_t* OutCount, char* OutBuffer, size_t InSize, const wchar_t* InSource, size_t InCount);
+int swprintf_s(wchar_t* OutBuffer, size_t InSize, const wchar_t* InFormat, ...);
+
+#endif
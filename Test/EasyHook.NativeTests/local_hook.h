@@ -0,0 +1,94 @@
+// EasyHook (File: Test\EasyHook.NativeTests\local_hook.h)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#ifndef _LOCAL_HOOK_H_
+#define _LOCAL_HOOK_H_
+
+#include "compat.h"
+
+#include <sys/mman.h>
+
+/*
+    Installs real hooks in this process. The trampolines of
+    HookSpecific_x64.asm are translated to GNU as by the Makefile and call
+    the barrier with the Windows x64 calling convention, so the barrier is
+    entered through the thunks below. Hooked functions and handlers may use
+    up to four integer parameters, the trampoline preserves RDI and RSI
+    through the calling convention of the thunks.
+*/
+#define LhBarrierIntro              LhBarrierIntroSysV
+#define LhBarrierOutro              LhBarrierOutroSysV
+
+#include "../../DriverShared/LocalHook/barrier.c"
+#include "../../DriverShared/LocalHook/gate.c"
+
+#undef LhBarrierIntro
+#undef LhBarrierOutro
+
+static __attribute__((ms_abi)) ULONGLONG LhBarrierIntro(LOCAL_HOOK_INFO* InHandle, void* InRetAddr, void** InAddrOfRetAddr)
+{
+    return LhBarrierIntroSysV(InHandle, InRetAddr, InAddrOfRetAddr);
+}
+
+static __attribute__((ms_abi)) void* LhBarrierOutro(LOCAL_HOOK_INFO* InHandle, void** InAddrOfRetAddr)
+{
+    return LhBarrierOutroSysV(InHandle, InAddrOfRetAddr);
+}
+
+#include "../../DriverShared/LocalHook/alloc.c"
+#include "../../DriverShared/LocalHook/reloc.c"
+#include "../../DriverShared/LocalHook/install.c"
+#include "../../DriverShared/LocalHook/uninstall.c"
+#include "../../DriverShared/LocalHook/caller.c"
+#include "../../EasyHookDll/LocalHook/threads.c"
+#include "../../EasyHookDll/LocalHook/acl.c"
+
+/*
+    Hook targets are copied into executable memory. The target returns its
+    parameter plus one, LocalHookProc() plus two.
+*/
+typedef int (*LOCAL_HOOK_TARGET)(int InValue);
+
+// lea eax, [rdi + 1]; nop dword [rax + 0]; ret
+static const UCHAR      LocalHookTargetCode[] = { 0x8D, 0x47, 0x01, 0x0F, 0x1F, 0x40, 0x00, 0xC3 };
+
+static int LocalHookProc(int InValue)
+{
+    return InValue + 2;
+}
+
+static inline LOCAL_HOOK_TARGET LocalHookCreateTarget()
+{
+    UCHAR*              Code = (UCHAR*)mmap(NULL, 0x1000, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(Code == MAP_FAILED)
+        return NULL;
+
+    memcpy(Code, LocalHookTargetCode, sizeof(LocalHookTargetCode));
+
+    return (LOCAL_HOOK_TARGET)Code;
+}
+
+#endif
@@ -0,0 +1,178 @@
+// EasyHook (File: Test\EasyHook.NativeTests\module_space.h)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#ifndef _MODULE_SPACE_H_
+#define _MODULE_SPACE_H_
+
+#include "compat.h"
+
+#include "../../DriverShared/LocalHook/caller.c"
+#include "../../DriverShared/LocalHook/gate.c"
+
+/*
+    Simulates the address space seen by the module lookup. Regions are
+    either image memory, which is a loaded module, or private memory like
+    JIT code. Nothing is ever accessed, so any addresses can be used.
+    Regions are sorted by base address, so VirtualQuery() stays cheap for
+    large module lists. The space must not change during lookups.
+*/
+#define MODULE_SPACE_MAX_REGIONS    1024
+#define MODULE_SPACE_REGION_SIZE    0x100000
+
+typedef struct _MODULE_SPACE_REGION_
+{
+    UCHAR*          Base;
+    DWORD           Type;
+}MODULE_SPACE_REGION;
+
+static MODULE_SPACE_REGION  Regions[MODULE_SPACE_MAX_REGIONS];
+static ULONG                RegionCount = 0;
+
+HMODULE                     hKernel32 = NULL;
+
+EASYHOOK_NT_EXPORT LhBarrierGetReturnAddress(PVOID* OutValue) { return STATUS_NOT_SUPPORTED; }
+
+EASYHOOK_NT_EXPORT LhBarrierBeginStackTrace(PVOID* OutBackup) { return STATUS_NOT_SUPPORTED; }
+
+EASYHOOK_NT_EXPORT LhBarrierEndStackTrace(PVOID InBackup) { return STATUS_NOT_SUPPORTED; }
+
+static ULONG LowerRegion(const void* InAddress)
+{
+    ULONG           Low = 0;
+    ULONG           High = RegionCount;
+    ULONG           Middle;
+
+    // the first region ending behind the address
+    while(Low < High)
+    {
+        Middle = (Low + High) / 2;
+
+        if(Regions[Middle].Base + MODULE_SPACE_REGION_SIZE <= (UCHAR*)InAddress)
+            Low = Middle + 1;
+        else
+            High = Middle;
+    }
+
+    return Low;
+}
+
+static MODULE_SPACE_REGION* FindRegion(const void* InAddress)
+{
+    ULONG           Index = LowerRegion(InAddress);
+
+    if((Index < RegionCount) && ((UCHAR*)InAddress >= Regions[Index].Base))
+        return &Regions[Index];
+
+    return NULL;
+}
+
+static void MapRegion(ULONGLONG InBase, DWORD InType)
+{
+    MODULE_SPACE_REGION*    Region = FindRegion((void*)InBase);
+    ULONG                   Index;
+
+    if(Region == NULL)
+    {
+        if(RegionCount >= MODULE_SPACE_MAX_REGIONS)
+            return;
+
+        Index = LowerRegion((void*)InBase);
+
+        memmove(&Regions[Index + 1], &Regions[Index], (RegionCount - Index) * sizeof(MODULE_SPACE_REGION));
+
+        Region = &Regions[Index];
+        RegionCount++;
+    }
+
+    Region->Base = (UCHAR*)InBase;
+    Region->Type = InType;
+}
+
+static void ResetAddressSpace()
+{
+    RegionCount = 0;
+
+    LhModuleInfoFinalize();
+}
+
+SIZE_T VirtualQuery(LPCVOID InAddress, MEMORY_BASIC_INFORMATION* OutInfo, SIZE_T InSize)
+{
+    MODULE_SPACE_REGION*    Region = FindRegion(InAddress);
+
+    memset(OutInfo, 0, sizeof(MEMORY_BASIC_INFORMATION));
+
+    if(Region == NULL)
+        return 0;
+
+    OutInfo->BaseAddress = Region->Base;
+    OutInfo->AllocationBase = Region->Base;
+    OutInfo->RegionSize = MODULE_SPACE_REGION_SIZE;
+    OutInfo->State = MEM_COMMIT;
+    OutInfo->Type = Region->Type;
+
+    return sizeof(MEMORY_BASIC_INFORMATION);
+}
+
+BOOL EnumProcessModules(HANDLE InProcess, HMODULE* OutModules, DWORD InSize, DWORD* OutRequired)
+{
+    ULONG           Index;
+    DWORD           Count = 0;
+
+    for(Index = 0; Index < RegionCount; Index++)
+    {
+        if(Regions[Index].Type != MEM_IMAGE)
+            continue;
+
+        if((Count + 1) * sizeof(HMODULE) <= InSize)
+            OutModules[Count] = (HMODULE)Regions[Index].Base;
+
+        Count++;
+    }
+
+    *OutRequired = Count * sizeof(HMODULE);
+
+    return TRUE;
+}
+
+BOOL GetModuleInformation(HANDLE InProcess, HMODULE InModule, MODULEINFO* OutInfo, DWORD InSize)
+{
+    MODULE_SPACE_REGION*    Region = FindRegion(InModule);
+
+    if((Region == NULL) || (Region->Type != MEM_IMAGE))
+        return FALSE;
+
+    OutInfo->lpBaseOfDll = Region->Base;
+    OutInfo->SizeOfImage = MODULE_SPACE_REGION_SIZE;
+    OutInfo->EntryPoint = Region->Base;
+
+    return TRUE;
+}
+
+DWORD GetModuleFileNameA(HMODULE InModule, LPSTR OutPath, DWORD InSize)
+{
+    return (DWORD)snprintf(OutPath, InSize, "C:\\Test\\%p.dll", (void*)InModule);
+}
+
+#endif
@@ -0,0 +1,330 @@
+// EasyHook (File: Test\EasyHook.NativeTests\remote_image.h)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#ifndef _REMOTE_IMAGE_H_
+#define _REMOTE_IMAGE_H_
+
+#include "compat.h"
+
+#include <unistd.h>
+
+#include "../../DriverShared/LocalHook/reloc.c"
+#include "../../EasyHookDll/RemoteHook/thread.c"
+
+/*
+    Simulates the modules of a remote process for the export cache of
+    RemoteHook\thread.c. The images live in this process, the toolhelp and
+    ReadProcessMemory() fakes count every snapshot and read. Any process id
+    opens this simulated process.
+
+    "kernel32.dll" keeps all names within its export directory and forwards
+    some exports to "ntdll.dll", by name and by ordinal. "ntdll.dll" stores
+    its names behind the export directory, so they need a read of their own.
+    Names are stored in a shuffled order, like with a broken linker.
+
+    Both images are valid x64 DLLs with a data and a code section, so
+    RemoteImageWrite() can store them as files for TestFuncHooksInImage().
+    Every fifth function starts with an instruction that can't be relocated.
+*/
+#define REMOTE_IMAGE_SIZE           0x100000
+#define REMOTE_IMAGE_HEADERS        0x400
+#define REMOTE_IMAGE_EXPORTS        0x1000
+#define REMOTE_IMAGE_FUNCTIONS      0x20000
+#define REMOTE_IMAGE_BASE           0x180000000ULL
+#define REMOTE_IMAGE_ALIGNMENT      0x200
+#define REMOTE_IMAGE_COUNT          2
+#define REMOTE_NTDLL_EXPORTS        3000
+#define REMOTE_KERNEL32_EXPORTS     2000
+
+typedef struct _REMOTE_IMAGE_
+{
+    const WCHAR*        Module;
+    UCHAR*              Base;
+    ULONG               Count;
+}REMOTE_IMAGE;
+
+static REMOTE_IMAGE     RemoteImages[REMOTE_IMAGE_COUNT] =
+{
+    { L"ntdll.dll", NULL, REMOTE_NTDLL_EXPORTS },
+    { L"KERNEL32.DLL", NULL, REMOTE_KERNEL32_EXPORTS },
+};
+
+static ULONG            RemoteSnapshotCount = 0;
+static ULONG            RemoteReadCount = 0;
+static ULONG            RemoteModuleIndex = 0;
+
+HANDLE OpenProcess(DWORD InAccess, BOOL InInherit, DWORD InProcessId) { return (HANDLE)1; }
+
+HANDLE CreateToolhelp32Snapshot(DWORD InFlags, DWORD InProcessId)
+{
+    RemoteSnapshotCount++;
+
+    return (HANDLE)1;
+}
+
+BOOL Module32First(HANDLE InSnapshot, MODULEENTRY32* OutEntry)
+{
+    RemoteModuleIndex = 0;
+
+    OutEntry->hModule = (HMODULE)RemoteImages[0].Base;
+
+    wcscpy(OutEntry->szModule, RemoteImages[0].Module);
+
+    return TRUE;
+}
+
+BOOL Module32Next(HANDLE InSnapshot, MODULEENTRY32* OutEntry)
+{
+    if(++RemoteModuleIndex >= REMOTE_IMAGE_COUNT)
+        return FALSE;
+
+    OutEntry->hModule = (HMODULE)RemoteImages[RemoteModuleIndex].Base;
+
+    wcscpy(OutEntry->szModule, RemoteImages[RemoteModuleIndex].Module);
+
+    return TRUE;
+}
+
+BOOL ReadProcessMemory(HANDLE InProcess, LPCVOID InAddress, LPVOID OutBuffer, SIZE_T InSize, SIZE_T* OutRead)
+{
+    ULONG               Index;
+    UCHAR*              Address = (UCHAR*)InAddress;
+
+    RemoteReadCount++;
+
+    for(Index = 0; Index < REMOTE_IMAGE_COUNT; Index++)
+    {
+        if((Address >= RemoteImages[Index].Base) && (Address + InSize <= RemoteImages[Index].Base + REMOTE_IMAGE_SIZE))
+        {
+            memcpy(OutBuffer, InAddress, InSize);
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void RemoteImageName(
+            ULONG InImage,
+            ULONG InIndex,
+            char* OutName)
+{
+    sprintf(OutName, "%s%c%05uFn", (InImage == 0)?"Nt":"", 'A' + (InIndex * 7) % 26, InIndex);
+}
+
+typedef struct _REMOTE_PROLOGUE_
+{
+    ULONG               Size;
+    UCHAR               Code[16];
+}REMOTE_PROLOGUE;
+
+static const REMOTE_PROLOGUE RemotePrologues[5] =
+{
+    // mov [rsp+8], rbx; push rdi; sub rsp, 20h; ret
+    { 11, { 0x48, 0x89, 0x5C, 0x24, 0x08, 0x57, 0x48, 0x83, 0xEC, 0x20, 0xC3 } },
+    // mov rax, [rip+100h]; ret
+    { 8, { 0x48, 0x8B, 0x05, 0x00, 0x01, 0x00, 0x00, 0xC3 } },
+    // jmp $+105h
+    { 5, { 0xE9, 0x00, 0x01, 0x00, 0x00 } },
+    // mov r11, rsp; mov [r11+8], rbx; ret
+    { 8, { 0x4C, 0x8B, 0xDC, 0x49, 0x89, 0x5B, 0x08, 0xC3 } },
+    // mov eax, [eip+100h]; ret, EIP relative addressing can't be relocated
+    { 8, { 0x67, 0x8B, 0x05, 0x00, 0x01, 0x00, 0x00, 0xC3 } },
+};
+
+static void RemoteImageSection(
+            IMAGE_SECTION_HEADER* InSection,
+            const char* InName,
+            ULONG InAddress,
+            ULONG InSize,
+            ULONG InCharacteristics,
+            ULONG* RefRawData)
+{
+    memcpy(InSection->Name, InName, strlen(InName));
+
+    InSection->VirtualAddress = InAddress;
+    InSection->Misc.VirtualSize = InSize;
+    InSection->SizeOfRawData = (InSize + REMOTE_IMAGE_ALIGNMENT - 1) & ~(REMOTE_IMAGE_ALIGNMENT - 1);
+    InSection->PointerToRawData = *RefRawData;
+    InSection->Characteristics = InCharacteristics;
+
+    *RefRawData += InSection->SizeOfRawData;
+}
+
+static UCHAR* RemoteImageBuild(ULONG InImage)
+{
+    UCHAR*                      Image = (UCHAR*)calloc(1, REMOTE_IMAGE_SIZE);
+    IMAGE_DOS_HEADER*           DosHeader = (IMAGE_DOS_HEADER*)Image;
+    IMAGE_NT_HEADERS*           NtHeaders = (IMAGE_NT_HEADERS*)(Image + 0x40);
+    IMAGE_EXPORT_DIRECTORY*     Exports = (IMAGE_EXPORT_DIRECTORY*)(Image + REMOTE_IMAGE_EXPORTS);
+    ULONG                       Count = RemoteImages[InImage].Count;
+    ULONG                       Next = REMOTE_IMAGE_EXPORTS + sizeof(IMAGE_EXPORT_DIRECTORY);
+    DWORD*                      Functions;
+    DWORD*                      Names;
+    WORD*                       Ordinals;
+    ULONG                       Index;
+    ULONG                       Slot;
+    ULONG                       RawData = REMOTE_IMAGE_HEADERS;
+    char                        Name[32];
+
+    DosHeader->e_magic = IMAGE_DOS_SIGNATURE;
+    DosHeader->e_lfanew = 0x40;
+
+    NtHeaders->Signature = IMAGE_NT_SIGNATURE;
+    NtHeaders->FileHeader.Machine = IMAGE_FILE_MACHINE_AMD64;
+    NtHeaders->FileHeader.NumberOfSections = 2;
+    NtHeaders->FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+    NtHeaders->OptionalHeader.Magic = IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+    NtHeaders->OptionalHeader.ImageBase = REMOTE_IMAGE_BASE;
+    NtHeaders->OptionalHeader.SectionAlignment = 0x1000;
+    NtHeaders->OptionalHeader.FileAlignment = REMOTE_IMAGE_ALIGNMENT;
+    NtHeaders->OptionalHeader.SizeOfImage = REMOTE_IMAGE_SIZE;
+    NtHeaders->OptionalHeader.SizeOfHeaders = REMOTE_IMAGE_HEADERS;
+    NtHeaders->OptionalHeader.NumberOfRvaAndSizes = 16;
+
+    RemoteImageSection(IMAGE_FIRST_SECTION(NtHeaders), ".edata", REMOTE_IMAGE_EXPORTS,
+        REMOTE_IMAGE_FUNCTIONS - REMOTE_IMAGE_EXPORTS, IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ, &RawData);
+    RemoteImageSection(IMAGE_FIRST_SECTION(NtHeaders) + 1, ".text", REMOTE_IMAGE_FUNCTIONS,
+        Count * 16, IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ, &RawData);
+
+    Exports->Base = 1;
+    Exports->NumberOfFunctions = Count;
+    Exports->NumberOfNames = Count;
+    Exports->AddressOfFunctions = Next;
+    Exports->AddressOfNames = (Next += Count * sizeof(DWORD));
+    Exports->AddressOfNameOrdinals = (Next += Count * sizeof(DWORD));
+
+    Next += Count * sizeof(WORD);
+
+    Functions = (DWORD*)(Image + Exports->AddressOfFunctions);
+    Names = (DWORD*)(Image + Exports->AddressOfNames);
+    Ordinals = (WORD*)(Image + Exports->AddressOfNameOrdinals);
+
+    // ntdll's names are placed behind its export directory
+    if(InImage == 0)
+        NtHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size = Next - REMOTE_IMAGE_EXPORTS;
+
+    for(Index = 0; Index < Count; Index++)
+    {
+        Slot = (Index * 37) % Count;
+
+        Functions[Index] = REMOTE_IMAGE_FUNCTIONS + Index * 16;
+
+        memset(Image + Functions[Index], 0xCC, 16);
+        memcpy(Image + Functions[Index], RemotePrologues[Index % 5].Code, RemotePrologues[Index % 5].Size);
+        Ordinals[Slot] = (WORD)((Index * 11) % Count);
+
+        RemoteImageName(InImage, Index, Name);
+
+        Names[Slot] = Next;
+        Next += sprintf((char*)Image + Next, "%s", Name) + 1;
+    }
+
+    // every 10th export of kernel32 is forwarded by name, every 25th by ordinal
+    if(InImage == 1)
+    {
+        for(Index = 0; Index < Count; Index += 10)
+        {
+            RemoteImageName(0, Index, Name);
+
+            Functions[Index] = Next;
+            Next += sprintf((char*)Image + Next, "ntdll.%s", Name) + 1;
+        }
+
+        for(Index = 5; Index < Count; Index += 25)
+        {
+            Functions[Index] = Next;
+            Next += sprintf((char*)Image + Next, "NTDLL.#%u", Index + 1) + 1;
+        }
+
+        // a forwarder pointing to itself, through the name of ordinal 2
+        for(Index = 0; (Index * 11) % Count != 1; Index++);
+
+        RemoteImageName(1, Index, Name);
+
+        Functions[1] = Next;
+        Next += sprintf((char*)Image + Next, "kernel32.%s", Name) + 1;
+
+        NtHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size = Next - REMOTE_IMAGE_EXPORTS;
+    }
+
+    NtHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress = REMOTE_IMAGE_EXPORTS;
+
+    return Image;
+}
+
+static BOOL RemoteImageWrite(
+            ULONG InImage,
+            char* OutPath)
+{
+/*
+    Stores the given image as DLL file with a unique name in the temporary
+    directory. OutPath receives the name and needs at least 64 characters.
+*/
+    UCHAR*                      Image = RemoteImages[InImage].Base;
+    IMAGE_NT_HEADERS*           NtHeaders = (IMAGE_NT_HEADERS*)(Image + 0x40);
+    IMAGE_SECTION_HEADER*       Section;
+    ULONG                       Index;
+    FILE*                       File;
+    int                         Handle;
+    BOOL                        IsWritten;
+
+    strcpy(OutPath, "/tmp/remote_image_XXXXXX");
+
+    if((Handle = mkstemp(OutPath)) < 0)
+        return FALSE;
+
+    if((File = fdopen(Handle, "wb")) == NULL)
+    {
+        close(Handle);
+
+        return FALSE;
+    }
+
+    IsWritten = (fwrite(Image, 1, REMOTE_IMAGE_HEADERS, File) == REMOTE_IMAGE_HEADERS);
+
+    for(Index = 0; Index < NtHeaders->FileHeader.NumberOfSections; Index++)
+    {
+        Section = IMAGE_FIRST_SECTION(NtHeaders) + Index;
+
+        if(fwrite(Image + Section->VirtualAddress, 1, Section->SizeOfRawData, File) != Section->SizeOfRawData)
+            IsWritten = FALSE;
+    }
+
+    return (fclose(File) == 0) && IsWritten;
+}
+
+static void RemoteImageInit()
+{
+    ULONG               Index;
+
+    for(Index = 0; Index < REMOTE_IMAGE_COUNT; Index++)
+    {
+        RemoteImages[Index].Base = RemoteImageBuild(Index);
+    }
+}
+
+#endif
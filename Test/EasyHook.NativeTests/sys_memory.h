@@ -0,0 +1,90 @@
+// EasyHook (File: Test\EasyHook.NativeTests\sys_memory.h)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#ifndef _SYS_MEMORY_H_
+#define _SYS_MEMORY_H_
+
+#include "stdafx.h"
+
+/*
+    Compiles the memory routines of EasyHookSys\Rtl\memory.c next to the
+    ones of EasyHookDll, which every test links. All routines of the driver
+    get a "Sys" prefix and the few kernel APIs they use are stubbed.
+*/
+typedef struct _SYS_SPIN_LOCK_
+{
+    int             Lock;
+    int             OldIrql;
+}SYS_SPIN_LOCK;
+
+typedef int         KEVENT;
+
+#define RTL_SPIN_LOCK                                   SYS_SPIN_LOCK
+#define RtlInitializeLock                               SysInitializeLock
+#define RtlAcquireLock                                  SysAcquireLock
+#define RtlReleaseLock                                  SysReleaseLock
+#define RtlDeleteLock                                   SysDeleteLock
+#define RtlSleep                                        SysSleep
+#define RtlGetMilliseconds                              SysGetMilliseconds
+#define RtlCopyMemory                                   SysCopyMemory
+#define RtlMoveMemory                                   SysMoveMemory
+#define RtlZeroMemory                                   SysZeroMemory
+#define RtlAllocateMemory                               SysAllocateMemory
+#define RtlProtectMemory                                SysProtectMemory
+#define RtlFreeMemory                                   SysFreeMemory
+#define RtlIsValidPointer                               SysIsValidPointer
+
+#define PASSIVE_LEVEL                                   0
+#define KeInitializeSpinLock(Lock)                      ((void)(Lock))
+#define KeAcquireSpinLock(Lock, OldIrql)                ((void)(Lock), (void)(OldIrql))
+#define KeReleaseSpinLock(Lock, OldIrql)                ((void)(Lock), (void)(OldIrql))
+#define KeInitializeEvent(Event, Type, State)           ((void)(Event))
+#define KeWaitForSingleObject(Event, Reason, Mode, Alertable, Timeout)  ((void)(Event), (void)(Timeout))
+#define KeQueryTickCount(Ticks)                         ((Ticks)->QuadPart = 0)
+#define KeQueryTimeIncrement()                          1
+#define ExAllocatePoolWithTag(Type, Size, Tag)          malloc(Size)
+#define ExFreePool(Pointer)                             free(Pointer)
+
+// used by SysDeleteLock() before its definition
+void SysZeroMemory(PVOID InTarget, ULONG InByteCount);
+
+#include "../../EasyHookSys/Rtl/memory.c"
+
+#undef RTL_SPIN_LOCK
+#undef RtlInitializeLock
+#undef RtlAcquireLock
+#undef RtlReleaseLock
+#undef RtlDeleteLock
+#undef RtlSleep
+#undef RtlGetMilliseconds
+#undef RtlCopyMemory
+#undef RtlMoveMemory
+#undef RtlZeroMemory
+#undef RtlAllocateMemory
+#undef RtlProtectMemory
+#undef RtlFreeMemory
+#undef RtlIsValidPointer
+
+#endif
@@ -0,0 +1,57 @@
+// EasyHook (File: Test\EasyHook.NativeTests\test.h)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdio.h>
+
+/*
+    Every test program includes the sources under test, so static methods
+    can be called directly, and reports through these macros.
+*/
+static int                  TestFailureCount = 0;
+
+#define TEST_CHECK(expr)\
+    do\
+    {\
+        if(!(expr))\
+        {\
+            fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #expr);\
+            TestFailureCount++;\
+        }\
+    }while(0)
+
+#define TEST_RUN(Method)\
+    do\
+    {\
+        int     FailuresBefore = TestFailureCount;\
+        Method();\
+        printf("%s %s\n", (TestFailureCount == FailuresBefore)?"PASS":"FAIL", #Method);\
+    }while(0)
+
+#define TEST_RESULT()       ((TestFailureCount == 0)?0:1)
+
+#endif
@@ -0,0 +1,334 @@
+// EasyHook (File: Test\EasyHook.NativeTests\test_alloc.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "test.h"
+
+#include "../../DriverShared/LocalHook/alloc.c"
+
+/*
+    Tests the placement of x64 slabs against a simulated address space. The
+    space is described by its free ranges, everything else counts as used.
+    Slabs are never touched, so nothing is really allocated.
+*/
+#define TEST_MAX_FREE_RANGES        64
+#define TEST_GRANULARITY            0x10000ULL
+#define TEST_TARGET                 0x400000000000ULL
+
+typedef struct _TEST_RANGE_
+{
+    ULONGLONG       Base;
+    ULONGLONG       End;
+}TEST_RANGE;
+
+static TEST_RANGE       FreeRanges[TEST_MAX_FREE_RANGES];
+static ULONG            FreeRangeCount = 0;
+static ULONG            AllocCount = 0;
+
+ULONG GetTrampolineSize() { return 128; }
+
+void LhReleaseACL(HOOK_ACL* InAcl) { }
+
+static void ResetAddressSpace()
+{
+    FreeRangeCount = 0;
+    AllocCount = 0;
+
+    FreeRegionCount = 0;
+    IsFreeRegionMapValid = FALSE;
+}
+
+static void AddFreeRange(ULONGLONG InBase, ULONGLONG InEnd)
+{
+    // ranges have to be added in ascending order
+    FreeRanges[FreeRangeCount].Base = InBase;
+    FreeRanges[FreeRangeCount].End = InEnd;
+
+    FreeRangeCount++;
+}
+
+static void RemoveFreeRange(ULONGLONG InBase, ULONGLONG InEnd)
+{
+    ULONG           Index;
+    ULONG           Shift;
+
+    for(Index = 0; Index < FreeRangeCount; Index++)
+    {
+        if((InBase < FreeRanges[Index].Base) || (InEnd > FreeRanges[Index].End))
+            continue;
+
+        if(InBase == FreeRanges[Index].Base)
+            FreeRanges[Index].Base = InEnd;
+        else if(InEnd == FreeRanges[Index].End)
+            FreeRanges[Index].End = InBase;
+        else
+        {
+            for(Shift = FreeRangeCount; Shift > Index + 1; Shift--)
+            {
+                FreeRanges[Shift] = FreeRanges[Shift - 1];
+            }
+
+            FreeRanges[Index + 1].Base = InEnd;
+            FreeRanges[Index + 1].End = FreeRanges[Index].End;
+            FreeRanges[Index].End = InBase;
+
+            FreeRangeCount++;
+        }
+
+        return;
+    }
+}
+
+SIZE_T VirtualQuery(LPCVOID InAddress, MEMORY_BASIC_INFORMATION* OutInfo, SIZE_T InSize)
+{
+    ULONGLONG       Address = (ULONGLONG)InAddress;
+    ULONGLONG       UsedBase = 0;
+    ULONGLONG       UsedEnd = 0x800000000000ULL;
+    ULONG           Index;
+
+    memset(OutInfo, 0, sizeof(MEMORY_BASIC_INFORMATION));
+
+    for(Index = 0; Index < FreeRangeCount; Index++)
+    {
+        if((Address >= FreeRanges[Index].Base) && (Address < FreeRanges[Index].End))
+        {
+            OutInfo->BaseAddress = (PVOID)FreeRanges[Index].Base;
+            OutInfo->RegionSize = FreeRanges[Index].End - FreeRanges[Index].Base;
+            OutInfo->State = MEM_FREE;
+
+            return sizeof(MEMORY_BASIC_INFORMATION);
+        }
+
+        if(FreeRanges[Index].End <= Address)
+            UsedBase = FreeRanges[Index].End;
+        else if(FreeRanges[Index].Base < UsedEnd)
+            UsedEnd = FreeRanges[Index].Base;
+    }
+
+    OutInfo->BaseAddress = (PVOID)UsedBase;
+    OutInfo->AllocationBase = (PVOID)UsedBase;
+    OutInfo->RegionSize = UsedEnd - UsedBase;
+    OutInfo->State = MEM_COMMIT;
+    OutInfo->Type = MEM_PRIVATE;
+
+    return sizeof(MEMORY_BASIC_INFORMATION);
+}
+
+PVOID VirtualAlloc(PVOID InAddress, SIZE_T InSize, DWORD InType, DWORD InProtect)
+{
+    ULONGLONG       Base = (ULONGLONG)InAddress;
+    ULONG           Index;
+
+    AllocCount++;
+
+    for(Index = 0; Index < FreeRangeCount; Index++)
+    {
+        if((Base >= FreeRanges[Index].Base) && (Base + InSize <= FreeRanges[Index].End))
+        {
+            RemoveFreeRange(Base, Base + InSize);
+
+            return InAddress;
+        }
+    }
+
+    return NULL;
+}
+
+static void Alloc_RemoveFreeRangeSplitsRegion()
+{
+    ResetAddressSpace();
+
+    LhReserveFreeRegion();
+
+    FreeRegionMap[0].Base = 0x10000000;
+    FreeRegionMap[0].End = 0x20000000;
+    FreeRegionMap[1].Base = 0x30000000;
+    FreeRegionMap[1].End = 0x40000000;
+    FreeRegionCount = 2;
+    IsFreeRegionMapValid = TRUE;
+
+    // in the middle, the upper part becomes a new region behind the split one
+    LhRemoveFreeRange(0, 0x15000000);
+
+    TEST_CHECK(FreeRegionCount == 3);
+    TEST_CHECK((FreeRegionMap[0].Base == 0x10000000) && (FreeRegionMap[0].End == 0x15000000));
+    TEST_CHECK((FreeRegionMap[1].Base == 0x15000000 + LH_SLAB_SIZE) && (FreeRegionMap[1].End == 0x20000000));
+    TEST_CHECK((FreeRegionMap[2].Base == 0x30000000) && (FreeRegionMap[2].End == 0x40000000));
+
+    // at the start or end, the region just shrinks
+    LhRemoveFreeRange(0, 0x10000000);
+    LhRemoveFreeRange(2, 0x40000000 - LH_SLAB_SIZE);
+
+    TEST_CHECK(FreeRegionCount == 3);
+    TEST_CHECK(FreeRegionMap[0].Base == 0x10000000 + LH_SLAB_SIZE);
+    TEST_CHECK(FreeRegionMap[2].End == 0x40000000 - LH_SLAB_SIZE);
+    TEST_CHECK(IsFreeRegionMapValid);
+}
+
+static void Alloc_FindNearestFreeRegion()
+{
+    LH_FREE_REGION      Regions[] = {
+        { 0x10000000, 0x10100000 },
+        { 0x20000000, 0x20100000 },
+        { 0x30000000, 0x30020000 } };
+    ULONG               Region = ~0U;
+    ULONGLONG           Address = 0;
+
+    // inside a region, the granule containing the target is taken
+    TEST_CHECK(LhFindNearestFreeRegion(Regions, 3, 0x20012345, 0, ~0ULL, TEST_GRANULARITY, &Region, &Address));
+    TEST_CHECK((Region == 1) && (Address == 0x20010000));
+
+    // at the end of a region, the slab still has to fit
+    TEST_CHECK(LhFindNearestFreeRegion(Regions, 3, 0x200FFFFF, 0, ~0ULL, TEST_GRANULARITY, &Region, &Address));
+    TEST_CHECK((Region == 1) && (Address == 0x20100000 - LH_SLAB_SIZE));
+
+    // between two regions, the nearer edge wins
+    TEST_CHECK(LhFindNearestFreeRegion(Regions, 3, 0x1F000000, 0, ~0ULL, TEST_GRANULARITY, &Region, &Address));
+    TEST_CHECK((Region == 1) && (Address == 0x20000000));
+
+    TEST_CHECK(LhFindNearestFreeRegion(Regions, 3, 0x11000000, 0, ~0ULL, TEST_GRANULARITY, &Region, &Address));
+    TEST_CHECK((Region == 0) && (Address == 0x10100000 - LH_SLAB_SIZE));
+
+    // bounds clip regions, what is left must still hold a slab
+    TEST_CHECK(LhFindNearestFreeRegion(Regions, 3, 0x30000000, 0, 0x30010000, TEST_GRANULARITY, &Region, &Address));
+    TEST_CHECK((Region == 2) && (Address == 0x30000000));
+
+    TEST_CHECK(LhFindNearestFreeRegion(Regions, 3, 0x30000000, 0x30000001, ~0ULL, TEST_GRANULARITY, &Region, &Address));
+    TEST_CHECK((Region == 2) && (Address == 0x30010000));
+
+    TEST_CHECK(!LhFindNearestFreeRegion(Regions, 3, 0x30000000, 0x30000001, 0x3001FFFF, TEST_GRANULARITY, &Region, &Address));
+}
+
+static void Alloc_SlabStaysWithinRelDistance()
+{
+    UCHAR*          Slab;
+
+    // the nearest free memory is just out of reach below, far but reachable memory above
+    ResetAddressSpace();
+
+    AddFreeRange(TEST_TARGET - LH_MAX_REL_DISTANCE - 0x100000, TEST_TARGET - LH_MAX_REL_DISTANCE + 0x8000);
+    AddFreeRange(TEST_TARGET + 0x7FF00000, TEST_TARGET + 0x90000000);
+
+    Slab = (UCHAR*)LhAllocateSlabMemory((void*)TEST_TARGET);
+
+    TEST_CHECK(Slab == (UCHAR*)(TEST_TARGET + 0x7FF00000));
+    TEST_CHECK(LhIsSlabInRange((LH_SLAB*)Slab, (void*)TEST_TARGET));
+
+    // regions crossing the bounds are used up to the last reachable granule
+    ResetAddressSpace();
+
+    AddFreeRange(TEST_TARGET + 0x7FFE0000, TEST_TARGET + 0x80100000);
+
+    Slab = (UCHAR*)LhAllocateSlabMemory((void*)TEST_TARGET);
+
+    TEST_CHECK(Slab == (UCHAR*)(TEST_TARGET + 0x7FFE0000));
+    TEST_CHECK(LhIsSlabInRange((LH_SLAB*)Slab, (void*)TEST_TARGET));
+    TEST_CHECK(LhAllocateSlabMemory((void*)TEST_TARGET) == NULL);
+
+    ResetAddressSpace();
+
+    AddFreeRange(TEST_TARGET - 0x80100000, TEST_TARGET - 0x7FFE0000);
+
+    Slab = (UCHAR*)LhAllocateSlabMemory((void*)TEST_TARGET);
+
+    TEST_CHECK(Slab == (UCHAR*)(TEST_TARGET - 0x7FFF0000));
+    TEST_CHECK(LhIsSlabInRange((LH_SLAB*)Slab, (void*)TEST_TARGET));
+
+    // nothing in reach
+    ResetAddressSpace();
+
+    AddFreeRange(TEST_TARGET - 0x100000000ULL, TEST_TARGET - 0x80000000ULL);
+    AddFreeRange(TEST_TARGET + 0x80000000ULL, TEST_TARGET + 0x100000000ULL);
+
+    TEST_CHECK(LhAllocateSlabMemory((void*)TEST_TARGET) == NULL);
+}
+
+static void Alloc_ConsecutiveSlabsUseTheMap()
+{
+    UCHAR*          Slab;
+    UCHAR*          Previous = NULL;
+    ULONG           Index;
+
+    ResetAddressSpace();
+
+    AddFreeRange(TEST_TARGET - 0x40000, TEST_TARGET + 0x40000);
+
+    // the map is built once and all slabs are cut out of it
+    for(Index = 0; Index < 8; Index++)
+    {
+        Slab = (UCHAR*)LhAllocateSlabMemory((void*)TEST_TARGET);
+
+        TEST_CHECK(Slab != NULL);
+        TEST_CHECK(Slab != Previous);
+        TEST_CHECK(IsFreeRegionMapValid);
+
+        Previous = Slab;
+    }
+
+    TEST_CHECK(AllocCount == 8);
+
+    for(Index = 0; Index < FreeRangeCount; Index++)
+    {
+        TEST_CHECK(FreeRanges[Index].Base == FreeRanges[Index].End);
+    }
+
+    TEST_CHECK(LhAllocateSlabMemory((void*)TEST_TARGET) == NULL);
+}
+
+static void Alloc_StaleMapIsRebuilt()
+{
+    UCHAR*          Slab;
+
+    ResetAddressSpace();
+
+    AddFreeRange(TEST_TARGET + 0x100000, TEST_TARGET + 0x200000);
+    AddFreeRange(TEST_TARGET + 0x800000, TEST_TARGET + 0x900000);
+
+    TEST_CHECK(LhAllocateSlabMemory((void*)TEST_TARGET) == (UCHAR*)(TEST_TARGET + 0x100000));
+
+    // memory is allocated behind the map's back
+    RemoveFreeRange(TEST_TARGET + 0x110000, TEST_TARGET + 0x200000);
+
+    AllocCount = 0;
+
+    Slab = (UCHAR*)LhAllocateSlabMemory((void*)TEST_TARGET);
+
+    TEST_CHECK(Slab == (UCHAR*)(TEST_TARGET + 0x800000));
+    TEST_CHECK(AllocCount == 2);
+    TEST_CHECK(IsFreeRegionMapValid);
+}
+
+int main()
+{
+    LhAllocatorInitialize();
+
+    TEST_RUN(Alloc_RemoveFreeRangeSplitsRegion);
+    TEST_RUN(Alloc_FindNearestFreeRegion);
+    TEST_RUN(Alloc_SlabStaysWithinRelDistance);
+    TEST_RUN(Alloc_ConsecutiveSlabsUseTheMap);
+    TEST_RUN(Alloc_StaleMapIsRebuilt);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,166 @@
+// EasyHook (File: Test\EasyHook.NativeTests\test_caller.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "module_space.h"
+#include "test.h"
+
+/*
+    Tests the module lookup against a simulated address space, see
+    module_space.h.
+*/
+#define TEST_MAX_REGIONS            16
+
+static BOOL IsModuleListed(ULONGLONG InBase)
+{
+    HMODULE         Modules[TEST_MAX_REGIONS];
+    ULONG           Count = 0;
+    ULONG           Index;
+
+    TEST_CHECK(LhEnumModules(Modules, TEST_MAX_REGIONS, &Count) == STATUS_SUCCESS);
+
+    for(Index = 0; Index < Count; Index++)
+    {
+        if(Modules[Index] == (HMODULE)InBase)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void Caller_ModuleIsFoundOnMiss()
+{
+    MODULE_INFORMATION      Module;
+
+    ResetAddressSpace();
+
+    MapRegion(0x10000000, MEM_IMAGE);
+    MapRegion(0x20000000, MEM_PRIVATE);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x10000100, &Module) == STATUS_SUCCESS);
+    TEST_CHECK(Module.BaseAddress == (UCHAR*)0x10000000);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x20000100, &Module) == STATUS_NOT_FOUND);
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x20000200, &Module) == STATUS_NOT_FOUND);
+}
+
+static void Caller_MissIsNotCached()
+{
+    MODULE_INFORMATION      Module;
+
+    ResetAddressSpace();
+
+    MapRegion(0x10000000, MEM_IMAGE);
+    MapRegion(0x20000000, MEM_PRIVATE);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x10000100, &Module) == STATUS_SUCCESS);
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x20000100, &Module) == STATUS_NOT_FOUND);
+
+    // the JIT code is released and a module is loaded at the same address
+    MapRegion(0x20000000, MEM_IMAGE);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x20000100, &Module) == STATUS_SUCCESS);
+    TEST_CHECK(Module.BaseAddress == (UCHAR*)0x20000000);
+}
+
+static void Caller_UnloadedModuleIsDropped()
+{
+    MODULE_INFORMATION      Module;
+
+    ResetAddressSpace();
+
+    MapRegion(0x10000000, MEM_IMAGE);
+    MapRegion(0x20000000, MEM_IMAGE);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x10000100, &Module) == STATUS_SUCCESS);
+    TEST_CHECK(IsModuleListed(0x20000000));
+
+    // the first module is unloaded and its memory reused for JIT code
+    MapRegion(0x10000000, MEM_PRIVATE);
+    MapRegion(0x30000000, MEM_IMAGE);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x30000100, &Module) == STATUS_SUCCESS);
+    TEST_CHECK(IsModuleListed(0x20000000));
+    TEST_CHECK(IsModuleListed(0x30000000));
+    TEST_CHECK(!IsModuleListed(0x10000000));
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x10000100, &Module) == STATUS_NOT_FOUND);
+}
+
+/*
+    A snapshot replaced while a thread looks up modules is kept until that
+    thread is done, later updates release it.
+*/
+static void Caller_RetiredSnapshotWaitsForReaders()
+{
+    MODULE_INFORMATION      Module;
+    LH_MODULE_SNAPSHOT*     First;
+    ULONG                   Token;
+    ULONG                   Parity;
+
+    ResetAddressSpace();
+
+    MapRegion(0x10000000, MEM_IMAGE);
+    MapRegion(0x20000000, MEM_IMAGE);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x10000100, &Module) == STATUS_SUCCESS);
+
+    First = LhAcquireModuleSnapshot(&Token);
+    Parity = Token / LH_READER_STRIPE_COUNT;
+
+    MapRegion(0x30000000, MEM_IMAGE);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x30000100, &Module) == STATUS_SUCCESS);
+    TEST_CHECK(LhModuleSnapshot != First);
+    TEST_CHECK(LhRetiredSnapshots[Parity] == First);
+
+    MapRegion(0x40000000, MEM_IMAGE);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x40000100, &Module) == STATUS_SUCCESS);
+    TEST_CHECK(LhRetiredSnapshots[Parity] == First);
+    TEST_CHECK(First->Count == 2);
+
+    LhReleaseModuleSnapshot(Token);
+
+    MapRegion(0x50000000, MEM_IMAGE);
+
+    TEST_CHECK(LhBarrierPointerToModule((PVOID)0x50000100, &Module) == STATUS_SUCCESS);
+    TEST_CHECK((LhRetiredSnapshots[0] == NULL) && (LhRetiredSnapshots[1] == NULL));
+    TEST_CHECK(IsModuleListed(0x10000000));
+    TEST_CHECK(IsModuleListed(0x50000000));
+}
+
+int main()
+{
+    RtlInitializeLock(&GlobalHookLock);
+
+    TEST_RUN(Caller_ModuleIsFoundOnMiss);
+    TEST_RUN(Caller_MissIsNotCached);
+    TEST_RUN(Caller_UnloadedModuleIsDropped);
+    TEST_RUN(Caller_RetiredSnapshotWaitsForReaders);
+
+    ResetAddressSpace();
+
+    return TEST_RESULT();
+}
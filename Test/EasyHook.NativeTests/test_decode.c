@@ -0,0 +1,157 @@
+// EasyHook (File: Test\EasyHook.NativeTests\test_decode.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "test.h"
+
+#include "disassembler/udis86.h"
+
+/*
+    ud_insn_length() must return exactly what a full ud_disassemble() would
+    for any input, so both are compared at every offset of a pseudo random
+    buffer, in 32- and 64-Bit mode, with full and with truncated input.
+*/
+#define TEST_BUFFER_SIZE        0x40000
+#define TEST_MAX_INSN_SIZE      16
+
+static UCHAR            Buffer[TEST_BUFFER_SIZE + TEST_MAX_INSN_SIZE];
+
+static void FillBuffer(ULONG InSeed)
+{
+    ULONG               State = InSeed;
+    ULONG               Index;
+
+    // xorshift32, so failures can be reproduced
+    for(Index = 0; Index < sizeof(Buffer); Index++)
+    {
+        State ^= State << 13;
+        State ^= State >> 17;
+        State ^= State << 5;
+
+        Buffer[Index] = (UCHAR)State;
+    }
+}
+
+static unsigned int FullDecodeLength(
+            UCHAR* InCode,
+            ULONG InSize,
+            UCHAR InMode)
+{
+    ud_t                Disasm;
+
+    ud_init(&Disasm);
+    ud_set_mode(&Disasm, InMode);
+    ud_set_input_buffer(&Disasm, InCode, InSize);
+
+    return ud_disassemble(&Disasm);
+}
+
+static ULONG CountMismatches(
+            ULONG InSize,
+            UCHAR InMode)
+{
+    ULONG               Offset;
+    ULONG               Mismatches = 0;
+    unsigned int        Expected;
+    unsigned int        Actual;
+
+    for(Offset = 0; Offset < TEST_BUFFER_SIZE; Offset++)
+    {
+        Expected = FullDecodeLength(Buffer + Offset, InSize, InMode);
+        Actual = ud_insn_length(Buffer + Offset, InSize, InMode);
+
+        if(Expected != Actual)
+        {
+            if(Mismatches++ < 5)
+                fprintf(stderr, "mode %u, size %u, offset 0x%x: full %u, length-only %u\n",
+                    InMode, InSize, Offset, Expected, Actual);
+        }
+    }
+
+    return Mismatches;
+}
+
+static void Decode_KnownLengths()
+{
+    static const struct
+    {
+        UCHAR           Mode;
+        ULONG           Length;
+        UCHAR           Code[TEST_MAX_INSN_SIZE];
+    }Cases[] =
+    {
+        { 64, 1, { 0x90 } },                                                        // nop
+        { 64, 5, { 0x48, 0x89, 0x5C, 0x24, 0x08 } },                                // mov [rsp+8], rbx
+        { 64, 7, { 0x48, 0x8B, 0x05, 0x01, 0x02, 0x03, 0x00 } },                    // mov rax, [rip+disp]
+        { 64, 10, { 0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8 } },                         // mov rax, imm64
+        { 64, 12, { 0x48, 0xC7, 0x84, 0x24, 1, 2, 3, 4, 5, 6, 7, 8 } },             // mov qword [rsp+disp32], imm32
+        { 64, 6, { 0xFF, 0x25, 0x00, 0x01, 0x00, 0x00 } },                          // jmp [rip+disp]
+        { 64, 9, { 0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 } },        // nop word [rax+rax+0]
+        { 32, 5, { 0xE8, 0x00, 0x00, 0x00, 0x00 } },                                // call rel32
+        { 32, 4, { 0x66, 0xE8, 0x00, 0x00 } },                                      // call rel16
+        { 32, 7, { 0x8B, 0x84, 0x24, 0x00, 0x01, 0x00, 0x00 } },                    // mov eax, [esp+disp32]
+    };
+    static UCHAR        Truncated[] = { 0x8B, 0x84, 0x24, 0x00, 0x01, 0x00 };
+    ULONG               Index;
+
+    for(Index = 0; Index < ARRAYSIZE(Cases); Index++)
+    {
+        TEST_CHECK(ud_insn_length(Cases[Index].Code, sizeof(Cases[Index].Code), Cases[Index].Mode) == Cases[Index].Length);
+        TEST_CHECK(FullDecodeLength((UCHAR*)Cases[Index].Code, sizeof(Cases[Index].Code), Cases[Index].Mode) == Cases[Index].Length);
+    }
+
+    // an instruction cut off by the end of the input
+    TEST_CHECK(ud_insn_length(Truncated, sizeof(Truncated), 32) == FullDecodeLength(Truncated, sizeof(Truncated), 32));
+}
+
+static void Decode_LengthMatchesFullDecode()
+{
+    FillBuffer(0x2545F491);
+
+    TEST_CHECK(CountMismatches(TEST_MAX_INSN_SIZE, 32) == 0);
+    TEST_CHECK(CountMismatches(TEST_MAX_INSN_SIZE, 64) == 0);
+}
+
+static void Decode_TruncatedLengthMatchesFullDecode()
+{
+    ULONG               Size;
+
+    FillBuffer(0x9E3779B9);
+
+    for(Size = 1; Size < TEST_MAX_INSN_SIZE; Size += 3)
+    {
+        TEST_CHECK(CountMismatches(Size, 32) == 0);
+        TEST_CHECK(CountMismatches(Size, 64) == 0);
+    }
+}
+
+int main()
+{
+    TEST_RUN(Decode_KnownLengths);
+    TEST_RUN(Decode_LengthMatchesFullDecode);
+    TEST_RUN(Decode_TruncatedLengthMatchesFullDecode);
+
+    return TEST_RESULT();
+}
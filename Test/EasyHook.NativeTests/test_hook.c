@@ -0,0 +1,238 @@
+// EasyHook (File: Test\EasyHook.NativeTests\test_hook.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "local_hook.h"
+#include "test.h"
+
+/*
+    Installs real hooks on functions copied into executable memory. The
+    regular trampoline only enters the handler for threads in the ACL.
+*/
+static void Hook_HandlerIsEnteredForAclThreads()
+{
+    LOCAL_HOOK_TARGET   Target = LocalHookCreateTarget();
+    HOOK_TRACE_INFO     Handle = { NULL };
+    ULONG               ThreadIds[1] = { 0 };
+
+    TEST_CHECK(Target != NULL);
+    TEST_CHECK(NT_SUCCESS(LhInstallHookEx(Target, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handle)));
+
+    // every hook starts suspended
+    TEST_CHECK(Target(1) == 2);
+
+    TEST_CHECK(NT_SUCCESS(LhSetInclusiveACL(ThreadIds, 1, &Handle)));
+    TEST_CHECK(Target(1) == 3);
+
+    TEST_CHECK(NT_SUCCESS(LhUninstallHook(&Handle)));
+    TEST_CHECK(NT_SUCCESS(LhWaitForPendingRemovals()));
+    TEST_CHECK(Target(1) == 2);
+}
+
+static void Hook_BatchRejectsDuplicates()
+{
+    LOCAL_HOOK_TARGET   Targets[3] = { LocalHookCreateTarget(), LocalHookCreateTarget(), LocalHookCreateTarget() };
+    HOOK_TRACE_INFO     Handles[4];
+    HOOK_INSTALL_ENTRY  Entries[5];
+    ULONG               Index;
+
+    memset(Handles, 0, sizeof(Handles));
+    memset(Entries, 0, sizeof(Entries));
+
+    // the later entry naming an entry point or handle again fails
+    for(Index = 0; Index < 5; Index++)
+    {
+        Entries[Index].EntryPoint = (void*)Targets[Index % 3];
+        Entries[Index].HookProc = (void*)LocalHookProc;
+        Entries[Index].Handle = &Handles[(Index == 4)?2:Index];
+    }
+
+    Entries[4].EntryPoint = (void*)LocalHookCreateTarget();
+
+    TEST_CHECK(LhInstallHooks(Entries, 5, FALSE) == STATUS_INVALID_PARAMETER_1);
+    TEST_CHECK(NT_SUCCESS(Entries[0].Status) && NT_SUCCESS(Entries[1].Status) && NT_SUCCESS(Entries[2].Status));
+    TEST_CHECK(Entries[3].Status == STATUS_INVALID_PARAMETER_1);
+    TEST_CHECK(Entries[4].Status == STATUS_INVALID_PARAMETER_5);
+
+    for(Index = 0; Index < 3; Index++)
+    {
+        TEST_CHECK(Handles[Index].Link != NULL);
+        TEST_CHECK(NT_SUCCESS(LhUninstallHook(&Handles[Index])));
+    }
+
+    TEST_CHECK(Handles[3].Link == NULL);
+
+    TEST_CHECK(NT_SUCCESS(LhWaitForPendingRemovals()));
+}
+
+/*
+    Several threads install hooks on entry points of their own and remove
+    them out of order, so most removals unlink a hook from the middle of
+    the global list while other threads change it.
+*/
+#define TEST_UNLINK_THREADS         8
+#define TEST_UNLINK_HOOKS           16
+#define TEST_UNLINK_CYCLES          100
+
+static volatile LONG    UnlinkFailures = 0;
+
+static DWORD __stdcall InstallAndUninstall(void* InParameter)
+{
+    LOCAL_HOOK_TARGET   Targets[TEST_UNLINK_HOOKS];
+    HOOK_TRACE_INFO*    Handles = (HOOK_TRACE_INFO*)InParameter;
+    ULONG               Cycle;
+    ULONG               Index;
+
+    for(Index = 0; Index < TEST_UNLINK_HOOKS; Index++)
+    {
+        if((Targets[Index] = LocalHookCreateTarget()) == NULL)
+            InterlockedIncrement(&UnlinkFailures);
+    }
+
+    for(Cycle = 0; (Cycle < TEST_UNLINK_CYCLES) && (UnlinkFailures == 0); Cycle++)
+    {
+        for(Index = 0; Index < TEST_UNLINK_HOOKS; Index++)
+        {
+            Handles[Index].Link = NULL;
+
+            if(!NT_SUCCESS(LhInstallHookEx(Targets[Index], LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handles[Index])))
+                InterlockedIncrement(&UnlinkFailures);
+        }
+
+        // odd ones first, the last cycle keeps the even ones installed
+        for(Index = 1; Index < TEST_UNLINK_HOOKS; Index += 2)
+        {
+            if(!NT_SUCCESS(LhUninstallHook(&Handles[Index])))
+                InterlockedIncrement(&UnlinkFailures);
+        }
+
+        for(Index = 0; (Index < TEST_UNLINK_HOOKS) && (Cycle + 1 < TEST_UNLINK_CYCLES); Index += 2)
+        {
+            if(!NT_SUCCESS(LhUninstallHook(&Handles[Index])))
+                InterlockedIncrement(&UnlinkFailures);
+        }
+
+        LhWaitForPendingRemovals();
+    }
+
+    return 0;
+}
+
+static void Hook_ConcurrentUnlinkKeepsListIntact()
+{
+    static HOOK_TRACE_INFO  Handles[TEST_UNLINK_THREADS][TEST_UNLINK_HOOKS];
+    HANDLE              Threads[TEST_UNLINK_THREADS];
+    LOCAL_HOOK_INFO*    Hook;
+    LOCAL_HOOK_INFO*    Prev = &GlobalHookListHead;
+    ULONG               Count = 0;
+    ULONG               Index;
+
+    for(Index = 0; Index < TEST_UNLINK_THREADS; Index++)
+    {
+        Threads[Index] = CreateThread(NULL, 0, InstallAndUninstall, Handles[Index], 0, NULL);
+
+        TEST_CHECK(Threads[Index] != NULL);
+    }
+
+    for(Index = 0; Index < TEST_UNLINK_THREADS; Index++)
+    {
+        WaitForSingleObject(Threads[Index], INFINITE);
+        CloseHandle(Threads[Index]);
+    }
+
+    TEST_CHECK(UnlinkFailures == 0);
+
+    // only the even hooks of the last cycle are left, each linked both ways
+    for(Hook = GlobalHookListHead.Next; Hook != NULL; Prev = Hook, Hook = Hook->Next)
+    {
+        TEST_CHECK(Hook->Prev == Prev);
+        TEST_CHECK(Hook->Tracking->Link == Hook);
+
+        Count++;
+    }
+
+    TEST_CHECK(Count == TEST_UNLINK_THREADS * TEST_UNLINK_HOOKS / 2);
+
+    TEST_CHECK(NT_SUCCESS(LhUninstallAllHooks()));
+    TEST_CHECK(NT_SUCCESS(LhWaitForPendingRemovals()));
+    TEST_CHECK(GlobalHookListHead.Next == NULL);
+
+    for(Index = 0; Index < GlobalSlotCapacity / SLOT_BITMAP_BITS; Index++)
+    {
+        TEST_CHECK(GlobalSlotBitmap[Index] == 0);
+    }
+}
+
+static void Hook_FastHooksAreLimited()
+{
+    LOCAL_HOOK_TARGET   Target = LocalHookCreateTarget();
+    HOOK_TRACE_INFO     Handle;
+    NTSTATUS            NtStatus = STATUS_SUCCESS;
+    LONG                Cycles = 0;
+
+    TEST_CHECK(Target != NULL);
+
+    // removed fast hooks are kept until unload
+    while(Cycles <= MAX_PINNED_HOOK_COUNT)
+    {
+        Handle.Link = NULL;
+
+        if(!NT_SUCCESS(NtStatus = LhInstallHookEx(Target, LocalHookProc, NULL, EASYHOOK_HOOK_FAST_TRAMPOLINE, &Handle)))
+            break;
+
+        TEST_CHECK(Target(1) == 3);
+
+        LhUninstallHook(&Handle);
+        LhWaitForPendingRemovals();
+
+        Cycles++;
+    }
+
+    TEST_CHECK(Cycles == MAX_PINNED_HOOK_COUNT);
+    TEST_CHECK(NtStatus == STATUS_INSUFFICIENT_RESOURCES);
+    TEST_CHECK(GlobalPinnedHookCount == MAX_PINNED_HOOK_COUNT);
+    TEST_CHECK(Target(1) == 2);
+
+    // regular hooks are released on removal
+    Handle.Link = NULL;
+
+    TEST_CHECK(NT_SUCCESS(LhInstallHookEx(Target, LocalHookProc, NULL, EASYHOOK_HOOK_DEFAULT, &Handle)));
+    TEST_CHECK(NT_SUCCESS(LhUninstallHook(&Handle)));
+    TEST_CHECK(NT_SUCCESS(LhWaitForPendingRemovals()));
+    TEST_CHECK(GlobalPinnedHookCount == MAX_PINNED_HOOK_COUNT);
+}
+
+int main()
+{
+    LhBarrierProcessAttach();
+    LhCriticalInitialize();
+
+    TEST_RUN(Hook_HandlerIsEnteredForAclThreads);
+    TEST_RUN(Hook_BatchRejectsDuplicates);
+    TEST_RUN(Hook_ConcurrentUnlinkKeepsListIntact);
+    // exhausts the limit, so it runs last
+    TEST_RUN(Hook_FastHooksAreLimited);
+
+    return TEST_RESULT();
+}
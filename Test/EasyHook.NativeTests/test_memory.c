@@ -0,0 +1,169 @@
+// EasyHook (File: Test\EasyHook.NativeTests\test_memory.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "test.h"
+#include "sys_memory.h"
+
+/*
+    Tests the memory routines of EasyHookDll\Rtl\memory.c, which is part
+    of the runtime every test links, and those of the driver against the
+    CRT. Each size is checked with all alignments of source and destination,
+    and the bytes around the destination must stay untouched.
+*/
+#define TEST_GUARD_SIZE         32
+#define TEST_MAX_SIZE           (70 * 1024)
+#define TEST_ALIGNMENTS         16
+#define TEST_MAX_SHIFT          65
+
+typedef void TEST_COPY_ROUTINE(PVOID InDest, PVOID InSource, ULONG InByteCount);
+typedef void TEST_ZERO_ROUTINE(PVOID InTarget, ULONG InByteCount);
+
+static UCHAR            Source[TEST_MAX_SIZE + 2 * TEST_GUARD_SIZE];
+static UCHAR            Actual[TEST_MAX_SIZE + 2 * TEST_GUARD_SIZE];
+static UCHAR            Expected[TEST_MAX_SIZE + 2 * TEST_GUARD_SIZE];
+
+static const ULONG      Sizes[] = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129, 255, 4095, 4096, 4097, 65536, TEST_MAX_SIZE };
+
+static void FillPattern(UCHAR* OutBuffer, ULONG InSize, ULONG InSeed)
+{
+    ULONG           Index;
+
+    for(Index = 0; Index < InSize; Index++)
+    {
+        OutBuffer[Index] = (UCHAR)((Index * 31 + InSeed) ^ (Index >> 8));
+    }
+}
+
+static void CheckCopy(TEST_COPY_ROUTINE* InCopy)
+{
+    ULONG           SizeIndex;
+    ULONG           Size;
+    ULONG           SrcAlign;
+    ULONG           DestAlign;
+
+    FillPattern(Source, sizeof(Source), 1);
+
+    for(SizeIndex = 0; SizeIndex < ARRAYSIZE(Sizes); SizeIndex++)
+    {
+        Size = Sizes[SizeIndex];
+
+        for(SrcAlign = 0; SrcAlign < TEST_ALIGNMENTS; SrcAlign++)
+        {
+            for(DestAlign = 0; DestAlign < TEST_ALIGNMENTS; DestAlign++)
+            {
+                FillPattern(Actual, sizeof(Actual), 2);
+                FillPattern(Expected, sizeof(Expected), 2);
+
+                InCopy(Actual + TEST_GUARD_SIZE + DestAlign, Source + SrcAlign, Size);
+                memcpy(Expected + TEST_GUARD_SIZE + DestAlign, Source + SrcAlign, Size);
+
+                TEST_CHECK(memcmp(Actual, Expected, sizeof(Actual)) == 0);
+            }
+        }
+    }
+}
+
+static void CheckZero(TEST_ZERO_ROUTINE* InZero)
+{
+    ULONG           SizeIndex;
+    ULONG           Size;
+    ULONG           Align;
+
+    for(SizeIndex = 0; SizeIndex < ARRAYSIZE(Sizes); SizeIndex++)
+    {
+        Size = Sizes[SizeIndex];
+
+        for(Align = 0; Align < TEST_ALIGNMENTS; Align++)
+        {
+            FillPattern(Actual, sizeof(Actual), 3);
+            FillPattern(Expected, sizeof(Expected), 3);
+
+            InZero(Actual + TEST_GUARD_SIZE + Align, Size);
+            memset(Expected + TEST_GUARD_SIZE + Align, 0, Size);
+
+            TEST_CHECK(memcmp(Actual, Expected, sizeof(Actual)) == 0);
+        }
+    }
+}
+
+static void CheckMove(TEST_COPY_ROUTINE* InMove)
+{
+    static const LONG   Shifts[] = { -TEST_MAX_SHIFT, -17, -16, -9, -8, -1, 0, 1, 8, 9, 16, 17, TEST_MAX_SHIFT };
+    ULONG               SizeIndex;
+    ULONG               ShiftIndex;
+    ULONG               Align;
+    ULONG               Size;
+    ULONG               Offset;
+
+    for(SizeIndex = 0; SizeIndex < ARRAYSIZE(Sizes); SizeIndex++)
+    {
+        // leave room for the largest shift in both directions
+        Size = Sizes[SizeIndex];
+
+        if(Size + 2 * TEST_MAX_SHIFT + TEST_ALIGNMENTS > TEST_MAX_SIZE)
+            Size = TEST_MAX_SIZE - 2 * TEST_MAX_SHIFT - TEST_ALIGNMENTS;
+
+        for(ShiftIndex = 0; ShiftIndex < ARRAYSIZE(Shifts); ShiftIndex++)
+        {
+            for(Align = 0; Align < TEST_ALIGNMENTS; Align++)
+            {
+                Offset = TEST_GUARD_SIZE + TEST_MAX_SHIFT + Align;
+
+                FillPattern(Actual, sizeof(Actual), 4);
+                FillPattern(Expected, sizeof(Expected), 4);
+
+                InMove(Actual + Offset + Shifts[ShiftIndex], Actual + Offset, Size);
+                memmove(Expected + Offset + Shifts[ShiftIndex], Expected + Offset, Size);
+
+                TEST_CHECK(memcmp(Actual, Expected, sizeof(Actual)) == 0);
+            }
+        }
+    }
+}
+
+static void Memory_CopyMatchesCrt() { CheckCopy(RtlCopyMemory); }
+
+static void Memory_ZeroMatchesCrt() { CheckZero(RtlZeroMemory); }
+
+static void Memory_MoveHandlesOverlap() { CheckMove(RtlMoveMemory); }
+
+static void Memory_SysCopyMatchesCrt() { CheckCopy(SysCopyMemory); }
+
+static void Memory_SysZeroMatchesCrt() { CheckZero(SysZeroMemory); }
+
+static void Memory_SysMoveHandlesOverlap() { CheckMove(SysMoveMemory); }
+
+int main()
+{
+    TEST_RUN(Memory_CopyMatchesCrt);
+    TEST_RUN(Memory_ZeroMatchesCrt);
+    TEST_RUN(Memory_MoveHandlesOverlap);
+    TEST_RUN(Memory_SysCopyMatchesCrt);
+    TEST_RUN(Memory_SysZeroMatchesCrt);
+    TEST_RUN(Memory_SysMoveHandlesOverlap);
+
+    return TEST_RESULT();
+}
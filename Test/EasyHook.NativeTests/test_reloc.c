@@ -0,0 +1,456 @@
+// EasyHook (File: Test\EasyHook.NativeTests\test_reloc.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "test.h"
+
+#include "../../DriverShared/LocalHook/reloc.c"
+
+#include <sys/mman.h>
+
+/*
+    Relocates machine code and executes the original and the relocated
+    version side by side. The code is placed in fixed mappings, so a copy
+    is either "near", at the very edge of 32-Bit displacements or "far"
+    beyond them.
+
+    Test functions take one int argument and return an int. The System V
+    calling convention passes it in EDI.
+*/
+#define TEST_NEAR_BASE          ((UCHAR*)0x10000000)
+#define TEST_EDGE_BASE          ((UCHAR*)0x90000000)
+#define TEST_FAR_BASE           ((UCHAR*)0x500000000000)
+#define TEST_MAPPING_SIZE       0x10000
+#define TEST_MAX_CODE_SIZE      64
+
+typedef int (*TEST_FUNCTION)(int);
+
+typedef struct _RELOC_CASE_
+{
+    const char*         Name;
+    ULONG               MinSize;
+    ULONG               Size;
+    UCHAR               Code[TEST_MAX_CODE_SIZE];
+}RELOC_CASE;
+
+static UCHAR*           NearMapping = NULL;
+static UCHAR*           EdgeMapping = NULL;
+static UCHAR*           FarMapping = NULL;
+static const int        TestArgs[] = { 0, 1, 5, 6, 100 };
+
+static UCHAR* MapFixed(UCHAR* InAddress)
+{
+    void*       Result = mmap(InAddress, TEST_MAPPING_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    return (Result == (void*)InAddress)?(UCHAR*)Result:NULL;
+}
+
+static UCHAR* PlaceCode(const RELOC_CASE* InCase)
+{
+    UCHAR*      EntryPoint = NearMapping + 0x100;
+
+    // the first bytes of the mapping are data for backward displacements
+    memset(NearMapping, 0xCC, TEST_MAPPING_SIZE / 2);
+    memset(NearMapping, 0x01, 4);
+    memcpy(EntryPoint, InCase->Code, InCase->Size);
+
+    return EntryPoint;
+}
+
+static NTSTATUS RelocateCase(
+            const RELOC_CASE* InCase,
+            UCHAR* InBuffer,
+            UCHAR** OutEntryPoint)
+{
+/*
+Description:
+
+    Relocates the case into the buffer and appends a jump back behind the
+    entry point, like LhAllocateHook() does.
+*/
+    LH_DECODED_PROLOGUE     Prologue;
+    ULONG                   RelocSize = 0;
+    NTSTATUS                NtStatus;
+    UCHAR*                  EntryPoint = PlaceCode(InCase);
+
+    memset(InBuffer, 0xCC, 0x1000);
+
+    if(!RTL_SUCCESS(NtStatus = LhDecodePrologue(EntryPoint, InCase->MinSize, &Prologue)))
+        return NtStatus;
+
+    if(!RTL_SUCCESS(NtStatus = LhRelocatePrologue(&Prologue, InBuffer, &RelocSize)))
+        return NtStatus;
+
+    // jmp qword ptr [rip+0]
+    InBuffer[RelocSize] = 0xFF;
+    InBuffer[RelocSize + 1] = 0x25;
+    *((LONG*)(InBuffer + RelocSize + 2)) = 0;
+    *((ULONGLONG*)(InBuffer + RelocSize + 6)) = (ULONGLONG)(EntryPoint + Prologue.Size);
+
+    *OutEntryPoint = EntryPoint;
+
+    return STATUS_SUCCESS;
+}
+
+static void CheckRelocatedCase(
+            const RELOC_CASE* InCase,
+            UCHAR* InBuffer)
+{
+    UCHAR*      EntryPoint;
+    NTSTATUS    NtStatus;
+    ULONG       Index;
+    int         Expected;
+    int         Actual;
+
+    if(!RTL_SUCCESS(NtStatus = RelocateCase(InCase, InBuffer, &EntryPoint)))
+    {
+        fprintf(stderr, "%s: relocation failed with 0x%X\n", InCase->Name, NtStatus);
+        TEST_CHECK(RTL_SUCCESS(NtStatus));
+
+        return;
+    }
+
+    for(Index = 0; Index < ARRAYSIZE(TestArgs); Index++)
+    {
+        Expected = ((TEST_FUNCTION)EntryPoint)(TestArgs[Index]);
+        Actual = ((TEST_FUNCTION)InBuffer)(TestArgs[Index]);
+
+        if(Expected != Actual)
+            fprintf(stderr, "%s: %d returned %d instead of %d\n", InCase->Name, TestArgs[Index], Actual, Expected);
+
+        TEST_CHECK(Expected == Actual);
+    }
+}
+
+/*
+    RIP relative operands, the data is part of the code
+*/
+static const RELOC_CASE RipCases[] = {
+    { "mov eax, [rip+disp]", 5, 20, {
+        0x8B, 0x05, 0x0A, 0x00, 0x00, 0x00,         // mov eax, [rip + 10]
+        0x01, 0xF8,                                 // add eax, edi
+        0xC3,                                       // ret
+        0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC,
+        0x28, 0x00, 0x00, 0x00 } },                 // dd 40
+    { "cmp [rip+disp], imm8", 5, 36, {
+        0x83, 0x3D, 0x19, 0x00, 0x00, 0x00, 0x00,   // cmp dword [rip + 25], 0
+        0x74, 0x04,                                 // jz +4
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0xB8, 0x2A, 0x00, 0x00, 0x00,               // mov eax, 42
+        0xC3,                                       // ret
+        0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC,
+        0x00, 0x00, 0x00, 0x00 } },                 // dd 0
+    { "lea rax, [rip+disp]", 5, 36, {
+        0x48, 0x8D, 0x05, 0x19, 0x00, 0x00, 0x00,   // lea rax, [rip + 25]
+        0x8B, 0x00,                                 // mov eax, [rax]
+        0x01, 0xF8,                                 // add eax, edi
+        0xC3,                                       // ret
+        0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC,
+        0x64, 0x00, 0x00, 0x00 } },                 // dd 100
+    { "mov dword [rip+disp], imm32", 5, 36, {
+        0xC7, 0x05, 0x16, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,   // mov dword [rip + 22], 7
+        0x8B, 0x05, 0x10, 0x00, 0x00, 0x00,         // mov eax, [rip + 16]
+        0x01, 0xF8,                                 // add eax, edi
+        0xC3,                                       // ret
+        0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC,
+        0x00, 0x00, 0x00, 0x00 } },                 // dd 0
+    { "mov eax, [rip+0]", 5, 9, {
+        0x8B, 0x05, 0x00, 0x00, 0x00, 0x00,         // mov eax, [rip + 0], the following code
+        0x01, 0xF8,                                 // add eax, edi
+        0xC3 } },                                   // ret
+    { "mov eax, [rip-disp]", 5, 9, {
+        0x8B, 0x05, 0xFA, 0xFE, 0xFF, 0xFF,         // mov eax, [rip - 0x106], the start of the mapping
+        0x01, 0xF8,                                 // add eax, edi
+        0xC3 } },                                   // ret
+};
+
+static void Reloc_RIPRelativeOperandsAreRelocated()
+{
+    ULONG       Index;
+
+    for(Index = 0; Index < ARRAYSIZE(RipCases); Index++)
+    {
+        CheckRelocatedCase(&RipCases[Index], NearMapping + 0x8000);
+    }
+}
+
+static void Reloc_RIPRelativeOutOfReachIsRejected()
+{
+    UCHAR*      EntryPoint;
+
+    /*
+        The edge mapping is 0x7FFFFF00 bytes behind the entry point. Forward
+        displacements are still in reach from there, backward ones are not.
+    */
+    CheckRelocatedCase(&RipCases[0], EdgeMapping);
+
+    TEST_CHECK(RelocateCase(&RipCases[ARRAYSIZE(RipCases) - 1], EdgeMapping, &EntryPoint) == STATUS_NOT_SUPPORTED);
+}
+
+/*
+    Relative branches out of and within the entry point. "Window" cases
+    branch to instructions inside the relocated entry point.
+*/
+static const RELOC_CASE BranchCases[] = {
+    { "jz rel8 out", 5, 14, {
+        0x85, 0xFF,                                 // test edi, edi
+        0x74, 0x04,                                 // jz +4
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0xB8, 0x2A, 0x00, 0x00, 0x00,               // mov eax, 42
+        0xC3 } },                                   // ret
+    { "jz rel32 out", 5, 18, {
+        0x85, 0xFF,                                 // test edi, edi
+        0x0F, 0x84, 0x04, 0x00, 0x00, 0x00,         // jz +4
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0xB8, 0x2A, 0x00, 0x00, 0x00,               // mov eax, 42
+        0xC3 } },                                   // ret
+    { "jg rel8 out", 5, 15, {
+        0x83, 0xFF, 0x05,                           // cmp edi, 5
+        0x7F, 0x04,                                 // jg +4
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0xB8, 0x2A, 0x00, 0x00, 0x00,               // mov eax, 42
+        0xC3 } },                                   // ret
+    { "jrcxz out", 5, 14, {
+        0x89, 0xF9,                                 // mov ecx, edi
+        0xE3, 0x04,                                 // jrcxz +4
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0xB8, 0x2A, 0x00, 0x00, 0x00,               // mov eax, 42
+        0xC3 } },                                   // ret
+    { "jecxz out", 10, 22, {
+        0x48, 0xC7, 0xC1, 0xFF, 0xFF, 0xFF, 0xFF,   // mov rcx, -1
+        0x89, 0xF9,                                 // mov ecx, edi
+        0x67, 0xE3, 0x04,                           // jecxz +4
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0xB8, 0x2A, 0x00, 0x00, 0x00,               // mov eax, 42
+        0xC3 } },                                   // ret
+    { "loope out", 9, 19, {
+        0xB9, 0x02, 0x00, 0x00, 0x00,               // mov ecx, 2
+        0x39, 0xC0,                                 // cmp eax, eax
+        0xE1, 0x04,                                 // loope +4
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0xB8, 0x2A, 0x00, 0x00, 0x00,               // mov eax, 42
+        0xC3 } },                                   // ret
+    { "loop in window", 9, 10, {
+        0x31, 0xC0,                                 // xor eax, eax
+        0x8D, 0x4F, 0x01,                           // lea ecx, [rdi + 1]
+        0xFF, 0xC0,                                 // inc eax
+        0xE2, 0xFC,                                 // loop -4
+        0xC3 } },                                   // ret
+    { "jnz rel8 in window", 7, 10, {
+        0x85, 0xFF,                                 // test edi, edi
+        0x75, 0x02,                                 // jnz +2
+        0xFF, 0xC7,                                 // inc edi
+        0x8D, 0x47, 0x07,                           // lea eax, [rdi + 7]
+        0xC3 } },                                   // ret
+    { "jnz rel32 in window", 15, 16, {
+        0x31, 0xC0,                                 // xor eax, eax
+        0x8D, 0x4F, 0x01,                           // lea ecx, [rdi + 1]
+        0xFF, 0xC0,                                 // inc eax
+        0xFF, 0xC9,                                 // dec ecx
+        0x0F, 0x85, 0xF6, 0xFF, 0xFF, 0xFF,         // jnz -10
+        0xC3 } },                                   // ret
+    { "jmp rel8 in window", 6, 8, {
+        0xEB, 0x02,                                 // jmp +2
+        0xFF, 0xC7,                                 // inc edi
+        0x8D, 0x47, 0x07,                           // lea eax, [rdi + 7]
+        0xC3 } },                                   // ret
+    { "call in window", 9, 12, {
+        0x31, 0xC0,                                 // xor eax, eax
+        0xE8, 0x01, 0x00, 0x00, 0x00,               // call +1
+        0xC3,                                       // ret
+        0x8D, 0x47, 0x03,                           // lea eax, [rdi + 3]
+        0xC3 } },                                   // ret
+    { "2E jz rel8 out", 5, 15, {
+        0x85, 0xFF,                                 // test edi, edi
+        0x2E, 0x74, 0x04,                           // jz +4, not taken hint
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0xB8, 0x2A, 0x00, 0x00, 0x00,               // mov eax, 42
+        0xC3 } },                                   // ret
+    { "3E jz rel32 out", 5, 19, {
+        0x85, 0xFF,                                 // test edi, edi
+        0x3E, 0x0F, 0x84, 0x04, 0x00, 0x00, 0x00,   // jz +4, taken hint
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0xB8, 0x2A, 0x00, 0x00, 0x00,               // mov eax, 42
+        0xC3 } },                                   // ret
+    { "F2 jmp rel32 out", 5, 14, {
+        0xF2, 0xE9, 0x04, 0x00, 0x00, 0x00,         // bnd jmp +4
+        0x8D, 0x47, 0x01,                           // lea eax, [rdi + 1]
+        0xC3,                                       // ret
+        0x8D, 0x47, 0x03,                           // lea eax, [rdi + 3]
+        0xC3 } },                                   // ret
+    { "F2 call in window", 10, 13, {
+        0x31, 0xC0,                                 // xor eax, eax
+        0xF2, 0xE8, 0x01, 0x00, 0x00, 0x00,         // bnd call +1
+        0xC3,                                       // ret
+        0x8D, 0x47, 0x03,                           // lea eax, [rdi + 3]
+        0xC3 } },                                   // ret
+};
+
+static void Reloc_BranchesAreRelocated()
+{
+    ULONG       Index;
+
+    for(Index = 0; Index < ARRAYSIZE(BranchCases); Index++)
+    {
+        CheckRelocatedCase(&BranchCases[Index], NearMapping + 0x8000);
+        CheckRelocatedCase(&BranchCases[Index], FarMapping);
+    }
+}
+
+static void Reloc_BranchIntoInstructionIsRejected()
+{
+    static const RELOC_CASE Case = { "jz into instruction", 5, 6, {
+        0x85, 0xFF,                                 // test edi, edi
+        0x74, 0xFF,                                 // jz -1, into its own displacement
+        0xC0, 0xC3 } };
+    UCHAR*      EntryPoint;
+
+    TEST_CHECK(RelocateCase(&Case, NearMapping + 0x8000, &EntryPoint) == STATUS_NOT_SUPPORTED);
+}
+
+static void Reloc_BranchesAreClassified()
+{
+    static const struct
+    {
+        UCHAR       Code[16];
+        UCHAR       Length;
+        UCHAR       BranchType;
+        UCHAR       BranchDispSize;
+        BOOLEAN     HasAddressPrefix;
+        BOOLEAN     IsCall;
+    }Samples[] = {
+        { { 0x74, 0x10 }, 2, LH_BRANCH_JCC, 1, FALSE, FALSE },                            // jz
+        { { 0x0F, 0x8F, 0x10, 0x00, 0x00, 0x00 }, 6, LH_BRANCH_JCC, 4, FALSE, FALSE },    // jg
+        { { 0x2E, 0x74, 0x10 }, 3, LH_BRANCH_JCC, 1, FALSE, FALSE },                      // jz, not taken hint
+        { { 0x3E, 0x0F, 0x84, 0x10, 0x00, 0x00, 0x00 }, 7, LH_BRANCH_JCC, 4, FALSE, FALSE }, // jz, taken hint
+        { { 0xF2, 0x74, 0x10 }, 3, LH_BRANCH_JCC, 1, FALSE, FALSE },                      // bnd jz
+        { { 0xE8, 0x10, 0x00, 0x00, 0x00 }, 5, LH_BRANCH_CALL, 4, FALSE, TRUE },          // call
+        { { 0xF2, 0xE8, 0x10, 0x00, 0x00, 0x00 }, 6, LH_BRANCH_CALL, 4, FALSE, TRUE },    // bnd call
+        { { 0xF2, 0xE9, 0x10, 0x00, 0x00, 0x00 }, 6, LH_BRANCH_JMP, 4, FALSE, FALSE },    // bnd jmp
+        { { 0xEB, 0x10 }, 2, LH_BRANCH_JMP, 1, FALSE, FALSE },                            // jmp short
+        { { 0xE2, 0xFC }, 2, LH_BRANCH_LOOP, 1, FALSE, FALSE },                           // loop
+        { { 0x67, 0xE3, 0x04 }, 3, LH_BRANCH_LOOP, 1, TRUE, FALSE },                      // jecxz
+        { { 0xFF, 0x25, 0x00, 0x01, 0x00, 0x00 }, 6, LH_BRANCH_NONE, 0, FALSE, FALSE },   // jmp qword [rip+0x100]
+        { { 0xFF, 0x15, 0x00, 0x01, 0x00, 0x00 }, 6, LH_BRANCH_NONE, 0, FALSE, TRUE },    // call qword [rip+0x100]
+        { { 0x48, 0x89, 0x5C, 0x24, 0x08 }, 5, LH_BRANCH_NONE, 0, FALSE, FALSE },         // mov [rsp+8], rbx
+    };
+    LH_PROLOGUE_INSTRUCTION     Instr;
+    ULONG                       Index;
+
+    for(Index = 0; Index < ARRAYSIZE(Samples); Index++)
+    {
+        TEST_CHECK(LhDecodeInstruction((UCHAR*)Samples[Index].Code, &Instr) == STATUS_SUCCESS);
+        TEST_CHECK(Instr.Length == Samples[Index].Length);
+        TEST_CHECK(Instr.BranchType == Samples[Index].BranchType);
+        TEST_CHECK(Instr.BranchDispSize == Samples[Index].BranchDispSize);
+        TEST_CHECK(Instr.HasAddressPrefix == Samples[Index].HasAddressPrefix);
+        TEST_CHECK(Instr.IsCall == Samples[Index].IsCall);
+    }
+}
+
+static void Reloc_DisplacementIsLocated()
+{
+    static const struct
+    {
+        UCHAR       Code[16];
+        UCHAR       Length;
+        BOOLEAN     IsRIPRelative;
+        UCHAR       DispOffset;
+    }Samples[] = {
+        { { 0x83, 0x3D, 0x71, 0x08, 0x06, 0x00, 0x00 }, 7, TRUE, 2 },                    // cmp dword [rip+0x60871], 0
+        { { 0x66, 0x0F, 0x2E, 0x05, 0xDC, 0x25, 0xFC, 0xFF }, 8, TRUE, 4 },              // ucomisd xmm0, [rip-0x3da24]
+        { { 0x48, 0x8B, 0x05, 0x01, 0x02, 0x03, 0x00 }, 7, TRUE, 3 },                    // mov rax, [rip+0x30201]
+        { { 0xC7, 0x05, 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00 }, 10, TRUE, 2 }, // mov dword [rip+0x10], 1
+        { { 0x80, 0x3D, 0x10, 0x00, 0x00, 0x00, 0x01 }, 7, TRUE, 2 },                    // cmp byte [rip+0x10], 1
+        { { 0xFF, 0x25, 0x00, 0x01, 0x00, 0x00 }, 6, TRUE, 2 },                          // jmp qword [rip+0x100]
+        { { 0x8B, 0x05, 0x00, 0x00, 0x00, 0x00 }, 6, TRUE, 2 },                          // mov eax, [rip+0x0]
+        { { 0x8B, 0x04, 0x25, 0x10, 0x00, 0x00, 0x00 }, 7, FALSE, 0 },                   // mov eax, [0x10]
+        { { 0x48, 0x89, 0x5C, 0x24, 0x08 }, 5, FALSE, 0 },                               // mov [rsp+8], rbx
+    };
+    LH_PROLOGUE_INSTRUCTION     Instr;
+    ULONG                       Index;
+
+    for(Index = 0; Index < ARRAYSIZE(Samples); Index++)
+    {
+        TEST_CHECK(LhDecodeInstruction((UCHAR*)Samples[Index].Code, &Instr) == STATUS_SUCCESS);
+        TEST_CHECK(Instr.Length == Samples[Index].Length);
+        TEST_CHECK(Instr.IsRIPRelative == Samples[Index].IsRIPRelative);
+        TEST_CHECK(Instr.DispOffset == Samples[Index].DispOffset);
+    }
+}
+
+static void Reloc_EIPRelativeIsRejected()
+{
+    // an address-size prefix turns [rip+disp32] into [eip+disp32]
+    static const UCHAR      EipRelative[] = { 0x67, 0x8B, 0x05, 0x10, 0x00, 0x00, 0x00, 0x90, 0x90 };
+    static const UCHAR      EipRelativeRexB[] = { 0x67, 0x41, 0x8B, 0x05, 0x10, 0x00, 0x00, 0x00, 0x90 };
+    static const UCHAR      EipRelativeLea[] = { 0x67, 0x48, 0x8D, 0x05, 0x10, 0x00, 0x00, 0x00, 0x90 };
+    // with a SIB byte, the same displacement is absolute
+    static const UCHAR      Absolute[] = { 0x67, 0x8B, 0x04, 0x25, 0x10, 0x00, 0x00, 0x00, 0x90 };
+    LH_PROLOGUE_INSTRUCTION Instr;
+    LH_DECODED_PROLOGUE     Prologue;
+
+    TEST_CHECK(LhDecodeInstruction((UCHAR*)EipRelative, &Instr) == STATUS_NOT_SUPPORTED);
+    TEST_CHECK(LhDecodeInstruction((UCHAR*)EipRelativeRexB, &Instr) == STATUS_NOT_SUPPORTED);
+    TEST_CHECK(LhDecodeInstruction((UCHAR*)EipRelativeLea, &Instr) == STATUS_NOT_SUPPORTED);
+    TEST_CHECK(LhDecodePrologue((void*)EipRelative, 5, &Prologue) == STATUS_NOT_SUPPORTED);
+
+    TEST_CHECK(LhDecodeInstruction((UCHAR*)Absolute, &Instr) == STATUS_SUCCESS);
+    TEST_CHECK((Instr.Length == 8) && !Instr.IsRIPRelative);
+}
+
+int main()
+{
+    NearMapping = MapFixed(TEST_NEAR_BASE);
+    EdgeMapping = MapFixed(TEST_EDGE_BASE);
+    FarMapping = MapFixed(TEST_FAR_BASE);
+
+    if((NearMapping == NULL) || (EdgeMapping == NULL) || (FarMapping == NULL))
+    {
+        fprintf(stderr, "Unable to map test memory.\n");
+
+        return 1;
+    }
+
+    TEST_RUN(Reloc_DisplacementIsLocated);
+    TEST_RUN(Reloc_RIPRelativeOperandsAreRelocated);
+    TEST_RUN(Reloc_RIPRelativeOutOfReachIsRejected);
+    TEST_RUN(Reloc_EIPRelativeIsRejected);
+    TEST_RUN(Reloc_BranchesAreClassified);
+    TEST_RUN(Reloc_BranchesAreRelocated);
+    TEST_RUN(Reloc_BranchIntoInstructionIsRejected);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,546 @@
+// EasyHook (File: Test\EasyHook.NativeTests\test_thread.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "test.h"
+#include "remote_image.h"
+
+/*
+    Tests the export cache, TestFuncHooks() and TestFuncHooksInImage() of
+    RemoteHook\thread.c against the simulated modules of remote_image.h.
+*/
+#define TEST_RESULT_COUNT       5000
+
+static ULONG            TestAllocCount = 0;
+static SIZE_T           TestAllocSize = 0;
+
+LPVOID CoTaskMemAlloc(SIZE_T InSize)
+{
+    TestAllocCount++;
+    TestAllocSize += InSize;
+
+    return malloc(InSize);
+}
+
+static void* RemoteImageResolve(
+            ULONG InImage,
+            const char* InFunction,
+            ULONG InDepth)
+{
+/*
+    Brute force reference for RemoteExportLookup(), working on the
+    simulated images directly.
+*/
+    UCHAR*                      Image = RemoteImages[InImage].Base;
+    IMAGE_EXPORT_DIRECTORY*     Exports = (IMAGE_EXPORT_DIRECTORY*)(Image + REMOTE_IMAGE_EXPORTS);
+    IMAGE_DATA_DIRECTORY*       ExportData = &((IMAGE_NT_HEADERS*)(Image + 0x40))->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+    DWORD*                      Functions = (DWORD*)(Image + Exports->AddressOfFunctions);
+    DWORD*                      Names = (DWORD*)(Image + Exports->AddressOfNames);
+    WORD*                       Ordinals = (WORD*)(Image + Exports->AddressOfNameOrdinals);
+    const char*                 Forwarder;
+    const char*                 Dot;
+    ULONG                       Index;
+    ULONG                       FunctionRva = 0;
+
+    if(InFunction[0] == '#')
+        FunctionRva = Functions[atoi(InFunction + 1) - Exports->Base];
+    else
+    {
+        for(Index = 0; Index < Exports->NumberOfNames; Index++)
+        {
+            if(strcasecmp((char*)Image + Names[Index], InFunction) == 0)
+                FunctionRva = Functions[Ordinals[Index]];
+        }
+    }
+
+    if(FunctionRva == 0)
+        return NULL;
+
+    if((FunctionRva < ExportData->VirtualAddress) || (FunctionRva >= ExportData->VirtualAddress + ExportData->Size))
+        return Image + FunctionRva;
+
+    if(InDepth >= REMOTE_EXPORT_MAX_FORWARDS)
+        return NULL;
+
+    Forwarder = (char*)Image + FunctionRva;
+    Dot = strchr(Forwarder, '.');
+
+    return RemoteImageResolve((strncasecmp(Forwarder, "ntdll", Dot - Forwarder) == 0)?0:1, Dot + 1, InDepth + 1);
+}
+
+static void Exports_LookupMatchesBruteForce()
+{
+    REMOTE_EXPORT_CACHE     Cache;
+    ULONG                   Image;
+    ULONG                   Index;
+    ULONG                   Mismatches = 0;
+    char                    Name[32];
+    char*                   Modules[REMOTE_IMAGE_COUNT] = { "ntdll.dll", "kernel32.dll" };
+
+    RemoteExportCacheInit(&Cache, 1, (HANDLE)1);
+
+    for(Image = 0; Image < REMOTE_IMAGE_COUNT; Image++)
+    {
+        for(Index = 0; Index < RemoteImages[Image].Count; Index++)
+        {
+            RemoteImageName(Image, Index, Name);
+
+            if(RemoteExportLookup(&Cache, Modules[Image], Name, 0) != RemoteImageResolve(Image, Name, 0))
+                Mismatches++;
+
+            sprintf(Name, "#%u", Index + 1);
+
+            if(RemoteExportLookup(&Cache, Modules[Image], Name, 0) != RemoteImageResolve(Image, Name, 0))
+                Mismatches++;
+        }
+    }
+
+    TEST_CHECK(Mismatches == 0);
+
+    // forwarders by name and by ordinal end up in ntdll, names map through the ordinals
+    // and a forwarder loop is cut
+    TEST_CHECK(RemoteExportLookup(&Cache, "kernel32.dll", "#11", 0) == RemoteImages[0].Base + REMOTE_IMAGE_FUNCTIONS + 110 * 16);
+    TEST_CHECK(RemoteExportLookup(&Cache, "kernel32.dll", "#6", 0) == RemoteImages[0].Base + REMOTE_IMAGE_FUNCTIONS + 5 * 16);
+    TEST_CHECK(RemoteExportLookup(&Cache, "kernel32.dll", "#2", 0) == NULL);
+
+    TEST_CHECK(RemoteExportLookup(&Cache, "kernel32.dll", "Missing", 0) == NULL);
+    TEST_CHECK(RemoteExportLookup(&Cache, "kernel32.dll", "#0", 0) == NULL);
+    TEST_CHECK(RemoteExportLookup(&Cache, "kernel32.dll", "#99999", 0) == NULL);
+
+    RemoteExportCacheRelease(&Cache);
+}
+
+static void Exports_TablesAreReadOnce()
+{
+    REMOTE_EXPORT_CACHE     Cache;
+    ULONG                   Index;
+    char                    Name[32];
+
+    RemoteExportCacheInit(&Cache, 1, (HANDLE)1);
+
+    RemoteSnapshotCount = 0;
+    RemoteReadCount = 0;
+
+    for(Index = 0; Index < REMOTE_KERNEL32_EXPORTS; Index++)
+    {
+        RemoteImageName(1, Index, Name);
+
+        RemoteExportLookup(&Cache, "kernel32.dll", Name, 0);
+    }
+
+    /*
+        One snapshot for both modules. Each module needs its DOS header, NT
+        headers and export directory; only ntdll's names are read separately.
+    */
+    TEST_CHECK(RemoteSnapshotCount == 1);
+    TEST_CHECK(RemoteReadCount == 7);
+
+    RemoteExportCacheRelease(&Cache);
+}
+
+static void Exports_MissingModuleIsCached()
+{
+    REMOTE_EXPORT_CACHE     Cache;
+
+    RemoteExportCacheInit(&Cache, 1, (HANDLE)1);
+
+    RemoteSnapshotCount = 0;
+    RemoteReadCount = 0;
+
+    TEST_CHECK(RemoteExportLookup(&Cache, "user32.dll", "MessageBoxW", 0) == NULL);
+    TEST_CHECK(RemoteExportLookup(&Cache, "user32.dll", "MessageBoxA", 0) == NULL);
+
+    TEST_CHECK(RemoteSnapshotCount == 1);
+    TEST_CHECK(RemoteReadCount == 0);
+
+    RemoteExportCacheRelease(&Cache);
+}
+
+static void Exports_GetRemoteFuncAddress()
+{
+    char                    Name[32];
+
+    RemoteImageName(1, 20, Name);
+
+    TEST_CHECK(GetRemoteFuncAddress(1, (HANDLE)1, "kernel32.dll", Name) == RemoteImageResolve(1, Name, 0));
+    TEST_CHECK(GetRemoteFuncAddress(1, (HANDLE)1, "kernel32.dll", "Missing") == NULL);
+}
+
+static void RandomString(
+            ULONG* RefState,
+            CHAR* OutString,
+            ULONG InMaxLength)
+{
+    ULONG               Length;
+    ULONG               Index;
+
+    *RefState ^= *RefState << 13;
+    *RefState ^= *RefState >> 17;
+    *RefState ^= *RefState << 5;
+
+    // every third string is empty
+    Length = ((*RefState % 3) == 0)?0:(*RefState >> 8) % InMaxLength;
+
+    for(Index = 0; Index < Length; Index++)
+    {
+        OutString[Index] = 'a' + (CHAR)((*RefState + Index * 7) % 26);
+    }
+
+    OutString[Length] = 0;
+}
+
+static BOOL StringEquals(
+            LPSTR InActual,
+            LPSTR InExpected)
+{
+    return (InActual != NULL) && (strcmp(InActual, InExpected) == 0);
+}
+
+static void TestFunc_BuilderPacksResults()
+{
+    static TEST_FUNC_RESULT_BUFFER  Expected[TEST_RESULT_COUNT];
+    TEST_FUNC_BUILDER               Builder;
+    TEST_FUNC_HOOKS_RESULT*         Results = NULL;
+    TEST_FUNC_HOOKS_RESULT*         Result;
+    LPSTR                           Strings[6];
+    ULONG                           State = 0x2545F491;
+    ULONG                           Index;
+    ULONG                           Field;
+    ULONG                           StringSize = 1;
+    ULONG                           Mismatches = 0;
+    int                             Count = 0;
+
+    TestFuncBuilderInit(&Builder);
+
+    for(Index = 0; Index < TEST_RESULT_COUNT; Index++)
+    {
+        TestFuncResultReset(&Expected[Index]);
+
+        RandomString(&State, Expected[Index].FnName, 64);
+        RandomString(&State, Expected[Index].ModuleRedirect, 16);
+        RandomString(&State, Expected[Index].FnRedirect, 64);
+        RandomString(&State, Expected[Index].EntryDisasm, 400);
+        RandomString(&State, Expected[Index].RelocDisasm, 400);
+        RandomString(&State, Expected[Index].Error, 64);
+
+        Expected[Index].Result.FnAddress = (void*)(ULONG_PTR)Index;
+
+        Strings[0] = Expected[Index].FnName;
+        Strings[1] = Expected[Index].ModuleRedirect;
+        Strings[2] = Expected[Index].FnRedirect;
+        Strings[3] = Expected[Index].EntryDisasm;
+        Strings[4] = Expected[Index].RelocDisasm;
+        Strings[5] = Expected[Index].Error;
+
+        for(Field = 0; Field < 6; Field++)
+        {
+            if(Strings[Field][0] != 0)
+                StringSize += (ULONG)strlen(Strings[Field]) + 1;
+        }
+
+        TEST_CHECK(TestFuncBuilderAdd(&Builder, &Expected[Index].Result));
+    }
+
+    TestAllocCount = 0;
+    TestAllocSize = 0;
+
+    TEST_CHECK(TestFuncBuilderFinish(&Builder, &Results, &Count) == STATUS_SUCCESS);
+    TEST_CHECK(Count == TEST_RESULT_COUNT);
+
+    // one block, strings are packed at their length and empty ones share a byte
+    TEST_CHECK(TestAllocCount == 1);
+    TEST_CHECK(TestAllocSize == TEST_RESULT_COUNT * sizeof(TEST_FUNC_HOOKS_RESULT) + StringSize);
+
+    for(Index = 0; Index < (ULONG)Count; Index++)
+    {
+        Result = &Results[Index];
+
+        if(!StringEquals(Result->FnName, Expected[Index].FnName) ||
+                !StringEquals(Result->ModuleRedirect, Expected[Index].ModuleRedirect) ||
+                !StringEquals(Result->FnRedirect, Expected[Index].FnRedirect) ||
+                !StringEquals(Result->EntryDisasm, Expected[Index].EntryDisasm) ||
+                !StringEquals(Result->RelocDisasm, Expected[Index].RelocDisasm) ||
+                !StringEquals(Result->Error, Expected[Index].Error) ||
+                (Result->FnAddress != Expected[Index].Result.FnAddress))
+            Mismatches++;
+
+        if((Expected[Index].Error[0] == 0) && (Result->Error != (LPSTR)(Results + Count)))
+            Mismatches++;
+    }
+
+    TEST_CHECK(Mismatches == 0);
+
+    ReleaseTestFuncHookResults(Results, Count);
+}
+
+static void TestFunc_HooksRunInNameOrder()
+{
+    TEST_FUNC_HOOKS_OPTIONS     Options = { NULL, NULL };
+    TEST_FUNC_HOOKS_RESULT*     Results = NULL;
+    TEST_FUNC_HOOKS_RESULT*     Result;
+    ULONG                       Index;
+    ULONG                       Mismatches = 0;
+    ULONG                       Redirects = 0;
+    ULONG                       Errors = 0;
+    int                         Count = 0;
+
+    RemoteSnapshotCount = 0;
+    RemoteReadCount = 0;
+    TestAllocCount = 0;
+
+    TEST_CHECK(TestFuncHooks(1, "kernel32.dll", Options, &Results, &Count) == STATUS_SUCCESS);
+    TEST_CHECK(Count == REMOTE_KERNEL32_EXPORTS);
+
+    // forwarders are resolved through the same cache as the module itself
+    TEST_CHECK(RemoteSnapshotCount == 1);
+    TEST_CHECK(RemoteReadCount == 7);
+    TEST_CHECK(TestAllocCount == 1);
+
+    for(Index = 0; Index < (ULONG)Count; Index++)
+    {
+        Result = &Results[Index];
+
+        if((Index > 0) && (_stricmp(Results[Index - 1].FnName, Result->FnName) >= 0))
+            Mismatches++;
+
+        if(Result->FnAddress != RemoteImageResolve(1, Result->FnName, 0))
+            Mismatches++;
+
+        if(Result->FnRedirect[0] != 0)
+        {
+            if(_stricmp(Result->ModuleRedirect, "ntdll.dll") != 0)
+                Mismatches++;
+
+            Redirects++;
+        }
+
+        if(strcmp(Result->Error, "DLL redirect unreadable") == 0)
+            Errors++;
+    }
+
+    // 200 forwarders by name and 80 by ordinal, 40 of them in the same slot, and one loop
+    TEST_CHECK(Mismatches == 0);
+    TEST_CHECK(Redirects == 240);
+    TEST_CHECK(Errors == 1);
+
+    ReleaseTestFuncHookResults(Results, Count);
+}
+
+static ULONG            TestCallbackCount = 0;
+
+static BOOL __stdcall TestFuncStopAfterThree(
+            TEST_FUNC_HOOKS_RESULT* InResult,
+            void* InContext)
+{
+    return ++TestCallbackCount < 3;
+}
+
+static void TestFunc_CallbackStopsWalk()
+{
+    TEST_FUNC_HOOKS_OPTIONS     Options = { NULL, NULL };
+
+    TestCallbackCount = 0;
+
+    TEST_CHECK(TestFuncHooksEx(1, "kernel32.dll", Options, TestFuncStopAfterThree, NULL) == STATUS_SUCCESS);
+    TEST_CHECK(TestCallbackCount == 3);
+
+    TEST_CHECK(TestFuncHooksEx(1, "user32.dll", Options, TestFuncStopAfterThree, NULL) == STATUS_NOT_FOUND);
+}
+
+static BOOL ResultEquals(
+            TEST_FUNC_HOOKS_RESULT* InActual,
+            TEST_FUNC_HOOKS_RESULT* InExpected)
+{
+/*
+    Relocated jumps target the scratch copy of each worker, so only
+    the presence of the relocated code is compared.
+*/
+    return StringEquals(InActual->FnName, InExpected->FnName) &&
+        StringEquals(InActual->ModuleRedirect, InExpected->ModuleRedirect) &&
+        StringEquals(InActual->FnRedirect, InExpected->FnRedirect) &&
+        StringEquals(InActual->EntryDisasm, InExpected->EntryDisasm) &&
+        ((InActual->RelocDisasm[0] == 0) == (InExpected->RelocDisasm[0] == 0)) &&
+        StringEquals(InActual->Error, InExpected->Error) &&
+        (InActual->FnAddress == InExpected->FnAddress) &&
+        (InActual->RelocAddress == InExpected->RelocAddress);
+}
+
+static void TestFunc_ImageMatchesExports()
+{
+    UCHAR*                      Image = RemoteImages[1].Base;
+    IMAGE_EXPORT_DIRECTORY*     Exports = (IMAGE_EXPORT_DIRECTORY*)(Image + REMOTE_IMAGE_EXPORTS);
+    DWORD*                      Functions = (DWORD*)(Image + Exports->AddressOfFunctions);
+    DWORD*                      Names = (DWORD*)(Image + Exports->AddressOfNames);
+    WORD*                       Ordinals = (WORD*)(Image + Exports->AddressOfNameOrdinals);
+    TEST_FUNC_HOOKS_OPTIONS     Options = { NULL, NULL };
+    TEST_FUNC_HOOKS_RESULT*     Results = NULL;
+    TEST_FUNC_HOOKS_RESULT*     Parallel = NULL;
+    TEST_FUNC_HOOKS_RESULT*     Result;
+    ULONG                       Index;
+    ULONG                       FnRva;
+    ULONG                       Mismatches = 0;
+    ULONG                       Redirects = 0;
+    ULONG                       Errors = 0;
+    ULONG                       ExpectedErrors = 0;
+    int                         Count = 0;
+    int                         ParallelCount = 0;
+    char                        Path[64];
+    WCHAR                       WidePath[64];
+
+    TEST_CHECK(RemoteImageWrite(1, Path));
+
+    mbstowcs(WidePath, Path, 64);
+
+    TEST_CHECK(TestFuncHooksInImage(WidePath, Options, 1, &Results, &Count) == STATUS_SUCCESS);
+    TEST_CHECK(Count == REMOTE_KERNEL32_EXPORTS);
+
+    for(Index = 0; Index < (ULONG)Count; Index++)
+    {
+        Result = &Results[Index];
+        FnRva = Functions[Ordinals[Index]];
+
+        // results keep the order of the name table
+        if(strcmp(Result->FnName, (char*)Image + Names[Index]) != 0)
+            Mismatches++;
+
+        if(FnRva < REMOTE_IMAGE_FUNCTIONS)
+        {
+            if((Result->ModuleRedirect[0] == 0) || (strncmp(Result->Error, "DLL redirect not followed", 25) != 0))
+                Mismatches++;
+
+            Redirects++;
+
+            continue;
+        }
+
+        if(Result->FnAddress != (void*)(ULONG_PTR)(REMOTE_IMAGE_BASE + FnRva))
+            Mismatches++;
+
+        if(Result->EntryDisasm[0] == 0)
+            Mismatches++;
+
+        if(((FnRva - REMOTE_IMAGE_FUNCTIONS) / 16) % 5 == 4)
+            ExpectedErrors++;
+
+        if(Result->Error[0] != 0)
+            Errors++;
+        else if(Result->RelocDisasm[0] == 0)
+            Mismatches++;
+    }
+
+    // all forwarders of kernel32, including the loop, are reported but not followed
+    TEST_CHECK(Mismatches == 0);
+    TEST_CHECK(Redirects == 241);
+    TEST_CHECK(Errors == ExpectedErrors);
+
+    // the workers produce the same results in the same order
+    TEST_CHECK(TestFuncHooksInImage(WidePath, Options, 4, &Parallel, &ParallelCount) == STATUS_SUCCESS);
+    TEST_CHECK(ParallelCount == Count);
+
+    for(Index = 0, Mismatches = 0; (Index < (ULONG)Count) && (Index < (ULONG)ParallelCount); Index++)
+    {
+        if(!ResultEquals(&Parallel[Index], &Results[Index]))
+            Mismatches++;
+    }
+
+    TEST_CHECK(Mismatches == 0);
+
+    ReleaseTestFuncHookResults(Results, Count);
+    ReleaseTestFuncHookResults(Parallel, ParallelCount);
+
+    unlink(Path);
+}
+
+static void TestFunc_ImageFilterAndErrors()
+{
+    IMAGE_NT_HEADERS*           NtHeaders = (IMAGE_NT_HEADERS*)(RemoteImages[0].Base + 0x40);
+    TEST_FUNC_HOOKS_OPTIONS     Options = { NULL, NULL };
+    TEST_FUNC_HOOKS_RESULT*     Results = NULL;
+    int                         Count = 0;
+    char                        Path[64];
+    char                        Name[32];
+    WCHAR                       WidePath[64];
+    FILE*                       File;
+
+    TEST_CHECK(RemoteImageWrite(0, Path));
+
+    mbstowcs(WidePath, Path, 64);
+
+    RemoteImageName(0, 42, Name);
+
+    Options.FilterByName = Name;
+
+    TEST_CHECK(TestFuncHooksInImage(WidePath, Options, 0, &Results, &Count) == STATUS_SUCCESS);
+    TEST_CHECK(Count == 1);
+    TEST_CHECK((Count == 1) && (strcmp(Results[0].FnName, Name) == 0));
+    TEST_CHECK((Count == 1) && (Results[0].FnAddress == (void*)(ULONG_PTR)(REMOTE_IMAGE_BASE + REMOTE_IMAGE_FUNCTIONS +
+        ((42 * 11) % REMOTE_NTDLL_EXPORTS) * 16)));
+
+    ReleaseTestFuncHookResults(Results, Count);
+
+    unlink(Path);
+
+    // the image file is gone
+    TEST_CHECK(TestFuncHooksInImage(WidePath, Options, 0, &Results, &Count) == STATUS_NOT_FOUND);
+    TEST_CHECK((Results == NULL) && (Count == 0));
+
+    // an image of another architecture
+    NtHeaders->FileHeader.Machine = IMAGE_FILE_MACHINE_I386;
+
+    TEST_CHECK(RemoteImageWrite(0, Path));
+
+    NtHeaders->FileHeader.Machine = IMAGE_FILE_MACHINE_AMD64;
+
+    mbstowcs(WidePath, Path, 64);
+
+    TEST_CHECK(TestFuncHooksInImage(WidePath, Options, 0, &Results, &Count) == STATUS_NOT_SUPPORTED);
+
+    // not an image at all
+    TEST_CHECK((File = fopen(Path, "w")) != NULL);
+
+    fprintf(File, "MZ, but nothing else");
+    fclose(File);
+
+    TEST_CHECK(TestFuncHooksInImage(WidePath, Options, 0, &Results, &Count) == STATUS_INVALID_PARAMETER_1);
+
+    unlink(Path);
+}
+
+int main()
+{
+    RemoteImageInit();
+
+    TEST_RUN(Exports_LookupMatchesBruteForce);
+    TEST_RUN(Exports_TablesAreReadOnce);
+    TEST_RUN(Exports_MissingModuleIsCached);
+    TEST_RUN(Exports_GetRemoteFuncAddress);
+    TEST_RUN(TestFunc_BuilderPacksResults);
+    TEST_RUN(TestFunc_HooksRunInNameOrder);
+    TEST_RUN(TestFunc_CallbackStopsWalk);
+    TEST_RUN(TestFunc_ImageMatchesExports);
+    TEST_RUN(TestFunc_ImageFilterAndErrors);
+
+    return TEST_RESULT();
+}
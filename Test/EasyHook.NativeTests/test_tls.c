@@ -0,0 +1,392 @@
+// EasyHook (File: Test\EasyHook.NativeTests\test_tls.c)
+//
+// Copyright (c) 2009 Christoph Husse & Copyright (c) 2015 Justin Stenning
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Please visit https://easyhook.github.io for more information
+// about the project and latest updates.
+
+#include "compat.h"
+#include "test.h"
+
+#include "../../DriverShared/LocalHook/barrier.c"
+#include "../../DriverShared/LocalHook/gate.c"
+
+/*
+    Tests the thread registry of the barrier. Thread IDs are simulated
+    with CompatSetThreadId(), so all "threads" run on the calling one.
+*/
+
+static THREAD_LOCAL_STORAGE     Storage;
+
+static void ResetStorage()
+{
+    THREAD_LOCAL_STORAGE*       Segment;
+
+    while((Segment = Storage.Next) != NULL)
+    {
+        Storage.Next = Segment->Next;
+
+        RtlFreeMemory(Segment);
+    }
+
+    memset(&Storage, 0, sizeof(Storage));
+}
+
+static ULONG CountSegments()
+{
+    THREAD_LOCAL_STORAGE*       Segment;
+    ULONG                       Count = 0;
+
+    for(Segment = &Storage; Segment != NULL; Segment = Segment->Next)
+    {
+        Count++;
+    }
+
+    return Count;
+}
+
+static THREAD_RUNTIME_INFO* Register(ULONG InThreadId)
+{
+    THREAD_RUNTIME_INFO*        Info = NULL;
+
+    CompatSetThreadId(InThreadId);
+
+    if(!TlsAddCurrentThread(&Storage) || !TlsGetCurrentValue(&Storage, &Info))
+        Info = NULL;
+
+    CompatSetThreadId(0);
+
+    return Info;
+}
+
+static THREAD_RUNTIME_INFO* Lookup(ULONG InThreadId)
+{
+    THREAD_RUNTIME_INFO*        Info = NULL;
+
+    CompatSetThreadId(InThreadId);
+
+    if(!TlsGetCurrentValue(&Storage, &Info))
+        Info = NULL;
+
+    CompatSetThreadId(0);
+
+    return Info;
+}
+
+static void Unregister(ULONG InThreadId)
+{
+    CompatSetThreadId(InThreadId);
+
+    TlsRemoveCurrentThread(&Storage);
+
+    CompatSetThreadId(0);
+}
+
+static ULONG FindCollidingId(ULONG InThreadId)
+{
+    ULONG       Id;
+
+    for(Id = InThreadId + 4; TlsHashThreadId(Id) != TlsHashThreadId(InThreadId); Id += 4)
+    {
+    }
+
+    return Id;
+}
+
+static void Tls_RegisteredThreadsFindOwnEntry()
+{
+    ULONG                       Index;
+    THREAD_RUNTIME_INFO*        Entries[MAX_THREAD_COUNT];
+
+    ResetStorage();
+
+    for(Index = 0; Index < MAX_THREAD_COUNT; Index++)
+    {
+        Entries[Index] = Register(4 + Index * 4);
+
+        TEST_CHECK(Entries[Index] != NULL);
+    }
+
+    for(Index = 0; Index < MAX_THREAD_COUNT; Index++)
+    {
+        TEST_CHECK(Lookup(4 + Index * 4) == Entries[Index]);
+    }
+
+    TEST_CHECK(Lookup(4 + MAX_THREAD_COUNT * 4) == NULL);
+}
+
+static void Tls_RemovedSlotIsReused()
+{
+    ULONG                       First = 0x1000;
+    ULONG                       Second = FindCollidingId(First);
+    THREAD_RUNTIME_INFO*        Info;
+
+    ResetStorage();
+
+    Info = Register(First);
+
+    Unregister(First);
+
+    TEST_CHECK(Lookup(First) == NULL);
+    TEST_CHECK(Storage.IdList[Info - Storage.Entries] == TLS_ID_REMOVED);
+
+    // the colliding thread claims the tombstone instead of probing further
+    TEST_CHECK(Register(Second) == Info);
+}
+
+static void Tls_LookupSkipsRemovedSlots()
+{
+    ULONG                       First = 0x2000;
+    ULONG                       Second = FindCollidingId(First);
+    THREAD_RUNTIME_INFO*        Info;
+
+    ResetStorage();
+
+    Register(First);
+
+    Info = Register(Second);
+
+    Unregister(First);
+
+    TEST_CHECK(Lookup(Second) == Info);
+}
+
+static void Tls_LookupStopsAtEmptySlot()
+{
+    ULONG                       Id = 0x3000;
+    THREAD_LOCAL_STORAGE*       Segment;
+
+    ResetStorage();
+
+    /*
+        Place the ID into a second segment although its slot in the first one is
+        empty. This can't happen by registration, so a lookup must not find it.
+    */
+    Segment = (THREAD_LOCAL_STORAGE*)RtlAllocateMemory(TRUE, sizeof(THREAD_LOCAL_STORAGE));
+    Segment->IdList[TlsHashThreadId(Id)] = (LONG)Id;
+
+    Storage.Next = Segment;
+
+    TEST_CHECK(Lookup(Id) == NULL);
+}
+
+static void Tls_FullProbeWindowContinuesInNextSegment()
+{
+    ULONG                       Id = 0x4000;
+    ULONG                       Colliding = Id;
+    ULONG                       Index;
+    THREAD_RUNTIME_INFO*        Info;
+
+    ResetStorage();
+
+    for(Index = 0; Index < TLS_PROBE_LIMIT; Index++)
+    {
+        Colliding = FindCollidingId(Colliding);
+
+        Register(Colliding);
+    }
+
+    Info = Register(Id);
+
+    TEST_CHECK(CountSegments() == 2);
+    TEST_CHECK((Info >= Storage.Next->Entries) && (Info < Storage.Next->Entries + TLS_HASH_SIZE));
+    TEST_CHECK(Lookup(Id) == Info);
+}
+
+static void Tls_ChurnDoesNotGrowStorage()
+{
+    ULONG                       Live[MAX_THREAD_COUNT];
+    ULONG                       NextId = 4;
+    ULONG                       Index;
+    ULONG                       Round;
+    ULONG                       Seed = 1;
+
+    ResetStorage();
+
+    for(Index = 0; Index < MAX_THREAD_COUNT; Index++)
+    {
+        Live[Index] = NextId;
+        NextId += 4;
+
+        Register(Live[Index]);
+    }
+
+    /*
+        Threads keep exiting and new ones with fresh IDs are created, while
+        never more than MAX_THREAD_COUNT are alive. Tombstones are reused, so the
+        storage stays at its first segment (or rarely a second one).
+    */
+    for(Round = 0; Round < 200000; Round++)
+    {
+        Seed = Seed * 1103515245 + 12345;
+        Index = (Seed >> 16) % MAX_THREAD_COUNT;
+
+        Unregister(Live[Index]);
+
+        Live[Index] = NextId;
+        NextId += 4;
+
+        TEST_CHECK(Register(Live[Index]) != NULL);
+    }
+
+    for(Index = 0; Index < MAX_THREAD_COUNT; Index++)
+    {
+        TEST_CHECK(Lookup(Live[Index]) != NULL);
+    }
+
+    TEST_CHECK(CountSegments() <= 2);
+}
+
+/*
+    Replaced ACL tables are only released once no thread scans them,
+    see LhUpdateACL().
+*/
+static void Acl_RetiredTableWaitsForReaders()
+{
+    HOOK_ACL                    Acl = { NULL, 0 };
+    ULONG                       Ids[] = { 3, 1, 2, 3 };
+    ULONG                       Token;
+    ULONG                       Parity;
+
+    RtlInitializeLock(&GlobalHookLock);
+
+    TEST_CHECK(LhUpdateACL(&Acl, FALSE, Ids, 4) == STATUS_SUCCESS);
+    TEST_CHECK(Acl.Table->Count == 3);
+
+    // a thread within IsThreadIntercepted() keeps the replaced table
+    Token = LhEnterReaderGate(&AclReaders);
+    Parity = Token / LH_READER_STRIPE_COUNT;
+
+    TEST_CHECK(LhUpdateACL(&Acl, TRUE, Ids, 2) == STATUS_SUCCESS);
+    TEST_CHECK((AclRetiredList[Parity] != NULL) && (AclRetiredList[Parity]->Count == 3));
+
+    // further updates don't release it either
+    TEST_CHECK(LhUpdateACL(&Acl, TRUE, Ids, 3) == STATUS_SUCCESS);
+    TEST_CHECK((AclRetiredList[Parity] != NULL) && (AclRetiredList[Parity]->Count == 3));
+
+    LhLeaveReaderGate(&AclReaders, Token);
+
+    // intercept all threads not excluded by the hook
+    TEST_CHECK(LhUpdateACL(&Unit.GlobalACL, TRUE, NULL, 0) == STATUS_SUCCESS);
+
+    TEST_CHECK(IsThreadIntercepted(&Acl, 3) == FALSE);
+    TEST_CHECK(IsThreadIntercepted(&Acl, 4) == TRUE);
+
+    // the next update without readers releases all retired tables
+    TEST_CHECK(LhUpdateACL(&Acl, FALSE, Ids, 1) == STATUS_SUCCESS);
+    TEST_CHECK((AclRetiredList[0] == NULL) && (AclRetiredList[1] == NULL));
+
+    LhReleaseACL(&Acl);
+    LhReleaseACL(&Unit.GlobalACL);
+    RtlDeleteLock(&GlobalHookLock);
+}
+
+/*
+    A reader registered before the epoch moved on is still counted after
+    any number of updates, a reader registered after it only delays the
+    release of tables retired after it registered.
+*/
+static void Acl_GateCountsReadersOfBothEpochs()
+{
+    LH_READER_GATE              Gate;
+    ULONG                       First;
+    ULONG                       Second;
+
+    memset(&Gate, 0, sizeof(Gate));
+
+    First = LhEnterReaderGate(&Gate);
+
+    // the other parity is idle, so the epoch moves on once
+    TEST_CHECK(LhAdvanceReaderGate(&Gate) == (1U << ((First / LH_READER_STRIPE_COUNT) ^ 1)));
+    TEST_CHECK(LhAdvanceReaderGate(&Gate) == 0);
+
+    Second = LhEnterReaderGate(&Gate);
+
+    TEST_CHECK(First / LH_READER_STRIPE_COUNT != Second / LH_READER_STRIPE_COUNT);
+    TEST_CHECK(LhAdvanceReaderGate(&Gate) == 0);
+
+    LhLeaveReaderGate(&Gate, First);
+
+    TEST_CHECK(LhAdvanceReaderGate(&Gate) == (1U << (First / LH_READER_STRIPE_COUNT)));
+
+    LhLeaveReaderGate(&Gate, Second);
+
+    TEST_CHECK(LhAdvanceReaderGate(&Gate) == 3);
+}
+
+/*
+    Within the loader lock, a thread calling a hook for the first time
+    is neither registered nor given a runtime entry, both might allocate.
+*/
+static void Barrier_LoaderLockIsCheckedBeforeRegistering()
+{
+    LOCAL_HOOK_INFO             Hook;
+    LPTHREAD_RUNTIME_INFO       Info;
+    void*                       RetAddr = NULL;
+
+    memset(&Hook, 0, sizeof(Hook));
+
+    Hook.HLSIndex = 1;
+    Hook.HLSIdent = 1;
+    Hook.LocalACL.Table = &AclEmptyExclusive;
+
+    TEST_CHECK(LhBarrierProcessAttach() == STATUS_SUCCESS);
+
+    CompatSetThreadId(1000);
+    CompatIsLoaderLockHeld = TRUE;
+
+    // the assembler code passes the handle behind the hook info on x64
+    TEST_CHECK(LhBarrierIntro(&Hook + 1, NULL, &RetAddr) == FALSE);
+    TEST_CHECK(!TlsGetCurrentValue(&Unit.TLS, &Info));
+
+    CompatIsLoaderLockHeld = FALSE;
+
+    TEST_CHECK(LhBarrierIntro(&Hook + 1, NULL, &RetAddr) == TRUE);
+    TEST_CHECK(TlsGetCurrentValue(&Unit.TLS, &Info));
+
+    LhBarrierOutro(&Hook + 1, &RetAddr);
+
+    // a known thread is still only checked for calls that would be intercepted
+    CompatIsLoaderLockHeld = TRUE;
+
+    TEST_CHECK(LhBarrierIntro(&Hook + 1, NULL, &RetAddr) == FALSE);
+    TEST_CHECK(RuntimeLookup(Info, Hook.HLSIndex, FALSE)->IsExecuting == FALSE);
+
+    CompatIsLoaderLockHeld = FALSE;
+    CompatSetThreadId(0);
+
+    LhBarrierProcessDetach();
+}
+
+int main()
+{
+    TEST_RUN(Tls_RegisteredThreadsFindOwnEntry);
+    TEST_RUN(Tls_RemovedSlotIsReused);
+    TEST_RUN(Tls_LookupSkipsRemovedSlots);
+    TEST_RUN(Tls_LookupStopsAtEmptySlot);
+    TEST_RUN(Tls_FullProbeWindowContinuesInNextSegment);
+    TEST_RUN(Tls_ChurnDoesNotGrowStorage);
+    TEST_RUN(Acl_RetiredTableWaitsForReaders);
+    TEST_RUN(Acl_GateCountsReadersOfBothEpochs);
+    TEST_RUN(Barrier_LoaderLockIsCheckedBeforeRegistering);
+
+    return TEST_RESULT();
+}
@@ -26,6 +26,37 @@ namespace EasyHook.Tests
             return false;
         }
 
+        int _beepHookCount = 0;
+
+        [return: MarshalAs(UnmanagedType.Bool)]
+        bool BeepCountingHook(uint dwFreq, uint dwDuration)
+        {
+            Interlocked.Increment(ref _beepHookCount);
+            return false;
+        }
+
+        [DllImport("kernel32.dll", SetLastError = true)]
+        static extern IntPtr VirtualAlloc(IntPtr lpAddress, UIntPtr dwSize, uint flAllocationType, uint flProtect);
+
+        [DllImport("kernel32.dll", SetLastError = true)]
+        [return: MarshalAs(UnmanagedType.Bool)]
+        static extern bool VirtualFree(IntPtr lpAddress, UIntPtr dwSize, uint dwFreeType);
+
+        const uint MEM_COMMIT = 0x1000;
+        const uint MEM_RESERVE = 0x2000;
+        const uint MEM_RELEASE = 0x8000;
+        const uint PAGE_EXECUTE_READWRITE = 0x40;
+
+        [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+        delegate int BranchDelegate(int value);
+
+        BranchDelegate _branchBypass;
+
+        int BranchHook(int value)
+        {
+            return _branchBypass(value) + 1000;
+        }
+
         [TestInitialize]
         public void Initialise()
         {
@@ -100,6 +131,83 @@ namespace EasyHook.Tests
             NativeAPI.LhWaitForPendingRemovals();
         }
 
+        [TestMethod]
+        public void InstallHooksAtRaisedLimit_ThrowsBeyond()
+        {
+            int maxHookCount = 2048;
+
+            List<LocalHook> hooks = new List<LocalHook>();
+
+            NativeAPI.LhSetMaxHookCount(maxHookCount);
+            try
+            {
+                for (var i = 0; i < maxHookCount; i++)
+                {
+                    hooks.Add(LocalHook.Create(
+                        LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                        new BeepDelegate(BeepHook),
+                        this));
+                }
+
+                bool exceptionThrown = false;
+                try
+                {
+                    hooks.Add(LocalHook.Create(
+                        LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                        new BeepDelegate(BeepHook),
+                        this));
+                }
+                catch (System.InsufficientMemoryException)
+                {
+                    exceptionThrown = true;
+                }
+
+                Assert.IsTrue(exceptionThrown, "System.InsufficientMemoryException was not thrown");
+            }
+            finally
+            {
+                foreach (var h in hooks)
+                    h.Dispose();
+                hooks.Clear();
+
+                NativeAPI.LhWaitForPendingRemovals();
+
+                NativeAPI.LhSetMaxHookCount(NativeAPI.MAX_HOOK_COUNT);
+            }
+        }
+
+        [TestMethod]
+        public void UninstallHooksAsync_ReleasesSlots()
+        {
+            List<LocalHook> hooks = new List<LocalHook>();
+
+            for (var round = 0; round < 2; round++)
+            {
+                try
+                {
+                    // the second round only succeeds if installing reclaims the slots of the first round
+                    for (var i = 0; i < NativeAPI.MAX_HOOK_COUNT; i++)
+                    {
+                        hooks.Add(LocalHook.Create(
+                            LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                            new BeepDelegate(BeepHook),
+                            this));
+                    }
+                }
+                finally
+                {
+                    foreach (var h in hooks)
+                        h.Dispose();
+                    hooks.Clear();
+
+                    // restore entry points without waiting for the hooks
+                    NativeAPI.LhUninstallHooksAsync(null);
+                }
+            }
+
+            NativeAPI.LhWaitForPendingRemovals();
+        }
+
         [TestMethod]
         public void HookBypassAddress_DoesNotCallHook()
         {
@@ -122,5 +230,680 @@ namespace EasyHook.Tests
             b(100, 100);
             Assert.IsFalse(_beepHookCalled);
         }
+
+        [TestMethod]
+        public void FastTrampolineHook_InterceptsWithoutACL()
+        {
+            BeepDelegate hook = new BeepDelegate(BeepCountingHook);
+            IntPtr handle = Marshal.AllocCoTaskMem(IntPtr.Size);
+
+            Marshal.WriteIntPtr(handle, IntPtr.Zero);
+
+            try
+            {
+                // no thread barrier, so the hook is active for all threads right away
+                NativeAPI.LhInstallHookEx(
+                    LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                    Marshal.GetFunctionPointerForDelegate(hook),
+                    IntPtr.Zero,
+                    NativeAPI.EASYHOOK_HOOK_FAST_TRAMPOLINE,
+                    handle);
+
+                Assert.IsFalse(Beep(100, 100));
+                Assert.AreEqual(1, _beepHookCount);
+            }
+            finally
+            {
+                NativeAPI.LhUninstallHook(handle);
+                NativeAPI.LhWaitForPendingRemovals();
+
+                Marshal.FreeCoTaskMem(handle);
+                GC.KeepAlive(hook);
+            }
+        }
+
+        [TestMethod]
+        public void FastTrampolineHook_BypassSurvivesUninstall()
+        {
+            IntPtr code = VirtualAlloc(IntPtr.Zero, (UIntPtr)4096, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+
+            Assert.AreNotEqual(IntPtr.Zero, code);
+
+            ManualResetEvent entered = new ManualResetEvent(false);
+            ManualResetEvent release = new ManualResetEvent(false);
+            BranchDelegate bypass = null;
+            BranchDelegate hook = new BranchDelegate(value =>
+            {
+                entered.Set();
+                release.WaitOne();
+
+                return bypass(value) + 1000;
+            });
+            IntPtr handle = Marshal.AllocCoTaskMem(IntPtr.Size);
+            IntPtr bypassAddress;
+            int result = 0;
+
+            Marshal.WriteIntPtr(handle, IntPtr.Zero);
+
+            try
+            {
+                BranchDelegate[] targets = WriteIncrementStubs(code, 1, 16);
+
+                NativeAPI.LhInstallHookEx(
+                    code,
+                    Marshal.GetFunctionPointerForDelegate(hook),
+                    IntPtr.Zero,
+                    NativeAPI.EASYHOOK_HOOK_FAST_TRAMPOLINE,
+                    handle);
+
+                NativeAPI.LhGetHookBypassAddress(handle, out bypassAddress);
+
+                bypass = (BranchDelegate)Marshal.GetDelegateForFunctionPointer(bypassAddress, typeof(BranchDelegate));
+
+                Thread caller = new Thread(() => result = targets[0](5));
+
+                caller.Start();
+
+                Assert.IsTrue(entered.WaitOne(5000));
+
+                // the execution counter was already released by the trampoline
+                NativeAPI.LhUninstallHook(handle);
+                NativeAPI.LhWaitForPendingRemovals();
+
+                // reuse the released memory, unless the hook was kept
+                for (var i = 0; i < 16; i++)
+                {
+                    LocalHook.Create(
+                        LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                        new BeepDelegate(BeepHook),
+                        this).Dispose();
+                }
+
+                NativeAPI.LhWaitForPendingRemovals();
+
+                release.Set();
+
+                Assert.IsTrue(caller.Join(5000));
+                Assert.AreEqual(1006, result);
+            }
+            finally
+            {
+                release.Set();
+
+                if (Marshal.ReadIntPtr(handle) != IntPtr.Zero)
+                    NativeAPI.LhUninstallHook(handle);
+
+                NativeAPI.LhWaitForPendingRemovals();
+
+                Marshal.FreeCoTaskMem(handle);
+                VirtualFree(code, UIntPtr.Zero, MEM_RELEASE);
+                GC.KeepAlive(hook);
+            }
+        }
+
+        [TestMethod]
+        public void HookStatistics_CountCallsAndBypasses()
+        {
+            BeepDelegate hook = new BeepDelegate(BeepCountingHook);
+            IntPtr handle = Marshal.AllocCoTaskMem(IntPtr.Size);
+
+            Marshal.WriteIntPtr(handle, IntPtr.Zero);
+
+            try
+            {
+                NativeAPI.LhInstallHookEx(
+                    LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                    Marshal.GetFunctionPointerForDelegate(hook),
+                    IntPtr.Zero,
+                    NativeAPI.EASYHOOK_HOOK_STATISTICS,
+                    handle);
+
+                // hooks start suspended, so this call is rejected by the ACL
+                Beep(100, 100);
+
+                NativeAPI.LhSetExclusiveACL(new int[0], 0, handle);
+
+                Assert.IsFalse(Beep(100, 100));
+                Assert.IsFalse(Beep(100, 100));
+
+                NativeAPI.HOOK_STATISTICS stats = NativeAPI.LhGetHookStatistics(handle);
+                UInt64 latencyCount = 0;
+
+                foreach (var count in stats.LatencyHistogram)
+                    latencyCount += count;
+
+                Assert.AreEqual(2, _beepHookCount);
+                Assert.AreEqual(2UL, stats.CallCount);
+                Assert.AreEqual(2UL, latencyCount);
+                Assert.AreEqual(1UL, stats.BypassCount[NativeAPI.HOOK_BYPASS_ACL]);
+            }
+            finally
+            {
+                NativeAPI.LhUninstallHook(handle);
+                NativeAPI.LhWaitForPendingRemovals();
+
+                Marshal.FreeCoTaskMem(handle);
+                GC.KeepAlive(hook);
+            }
+        }
+
+        [TestMethod]
+        public void LargeThreadACL_MatchesCurrentThread()
+        {
+            // more entries than the former MAX_ACE_COUNT (i.e. 128)
+            int[] acl = new int[4096];
+
+            for (var i = 0; i < acl.Length; i++)
+                acl[i] = 0x40000 + i * 4;
+
+            // zero is replaced with the current thread ID
+            acl[acl.Length / 2] = 0;
+
+            using (LocalHook lh = LocalHook.Create(
+                LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                new BeepDelegate(BeepCountingHook),
+                this))
+            {
+                lh.ThreadACL.SetInclusiveACL(acl);
+
+                Assert.IsFalse(Beep(100, 100));
+                Assert.AreEqual(1, _beepHookCount);
+                Assert.IsTrue(lh.IsThreadIntercepted(0));
+
+                lh.ThreadACL.SetExclusiveACL(acl);
+
+                Assert.IsFalse(lh.IsThreadIntercepted(0));
+                Assert.IsTrue(lh.IsThreadIntercepted(0x40000 + 4 * 4096));
+            }
+        }
+
+        [TestMethod]
+        public void ThreadACLChangedByOtherThread_SeenOnNextCall()
+        {
+            using (LocalHook lh = LocalHook.Create(
+                LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                new BeepDelegate(BeepCountingHook),
+                this))
+            {
+                AutoResetEvent call = new AutoResetEvent(false);
+                AutoResetEvent done = new AutoResetEvent(false);
+                bool stop = false;
+                int workerId = 0;
+
+                Thread worker = new Thread(() =>
+                {
+                    workerId = NativeAPI.GetCurrentThreadId();
+                    done.Set();
+
+                    while (true)
+                    {
+                        call.WaitOne();
+
+                        if (stop)
+                            break;
+
+                        Beep(100, 1);
+                        done.Set();
+                    }
+                });
+                worker.IsBackground = true;
+                worker.Start();
+                done.WaitOne();
+
+                // the worker keeps its cached verdict between calls, so each
+                // ACL update must invalidate it
+                for (var round = 0; round < 100; round++)
+                {
+                    int expected = _beepHookCount;
+
+                    if (round % 2 == 0)
+                    {
+                        lh.ThreadACL.SetInclusiveACL(new int[] { workerId });
+                        expected++;
+                    }
+                    else
+                        lh.ThreadACL.SetExclusiveACL(new int[] { workerId });
+
+                    call.Set();
+                    done.WaitOne();
+
+                    Assert.AreEqual(expected, _beepHookCount);
+                }
+
+                stop = true;
+                call.Set();
+                worker.Join();
+            }
+        }
+
+        [TestMethod]
+        public void ManyShortLivedThreads_AllCallsIntercepted()
+        {
+            // More threads than MAX_THREAD_COUNT (i.e. 128) are alive at the same time
+            int threadsPerBatch = 512;
+            int batchCount = 8;
+
+            using (LocalHook lh = LocalHook.Create(
+                LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                new BeepDelegate(BeepCountingHook),
+                this))
+            {
+                lh.ThreadACL.SetExclusiveACL(new int[0]);
+
+                for (var batch = 0; batch < batchCount; batch++)
+                {
+                    List<Thread> threads = new List<Thread>();
+                    Barrier allStarted = new Barrier(threadsPerBatch);
+
+                    for (var i = 0; i < threadsPerBatch; i++)
+                    {
+                        Thread t = new Thread(() =>
+                        {
+                            allStarted.SignalAndWait();
+                            Beep(100, 100);
+                        });
+                        t.Start();
+                        threads.Add(t);
+                    }
+
+                    foreach (var t in threads)
+                        t.Join();
+                }
+            }
+
+            Assert.AreEqual(threadsPerBatch * batchCount, _beepHookCount);
+        }
+
+        [TestMethod]
+        public void ConcurrentInstallAndUninstall_ReleasesAllHooks()
+        {
+            // every thread uses its own entry point, hooks sharing an entry point
+            // must not be installed concurrently. None of them is ever called.
+            // Removed hooks keep their slot until LhWaitForPendingRemovals(),
+            // so all rounds together stay below MAX_HOOK_COUNT.
+            string[] entryPoints = { "Beep", "GetTapeStatus", "EraseTape", "PrepareTape" };
+            int rounds = 3;
+            int hooksPerRound = 64;
+            List<Thread> threads = new List<Thread>();
+            Exception failure = null;
+
+            foreach (var name in entryPoints)
+            {
+                IntPtr entryPoint = LocalHook.GetProcAddress("kernel32.dll", name);
+
+                Thread t = new Thread(() =>
+                {
+                    try
+                    {
+                        for (var round = 0; round < rounds; round++)
+                        {
+                            List<LocalHook> hooks = new List<LocalHook>();
+
+                            for (var i = 0; i < hooksPerRound; i++)
+                                hooks.Add(LocalHook.Create(entryPoint, new BeepDelegate(BeepHook), this));
+
+                            foreach (var h in hooks)
+                                h.Dispose();
+                        }
+                    }
+                    catch (Exception e)
+                    {
+                        failure = e;
+                    }
+                });
+                t.Start();
+                threads.Add(t);
+            }
+
+            foreach (var t in threads)
+                t.Join();
+
+            NativeAPI.LhWaitForPendingRemovals();
+
+            Assert.IsNull(failure, "Installing or removing a hook failed: {0}", failure);
+
+            // all slots must have been released
+            List<LocalHook> all = new List<LocalHook>();
+            try
+            {
+                for (var i = 0; i < NativeAPI.MAX_HOOK_COUNT; i++)
+                {
+                    all.Add(LocalHook.Create(
+                        LocalHook.GetProcAddress("kernel32.dll", "Beep"),
+                        new BeepDelegate(BeepHook),
+                        this));
+                }
+            }
+            finally
+            {
+                foreach (var h in all)
+                    h.Dispose();
+
+                NativeAPI.LhWaitForPendingRemovals();
+            }
+        }
+
+        [TestMethod]
+        public void NestedHooksOnOneThread_AllIntercepted()
+        {
+            // far more hooks than a thread keeps inline (i.e. 4), so its table
+            // of runtime entries has to grow, all entered at the same time
+            int hookCount = 40;
+            int stubSize = 16;
+
+            // returns value + 1, padded so any jumper fits
+            byte[] stub = IntPtr.Size == 8
+                ? new byte[] {
+                    0x8D, 0x41, 0x01,               // lea eax, [rcx + 1]
+                    0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90,
+                    0xC3 }                          // ret
+                : new byte[] {
+                    0x8B, 0x44, 0x24, 0x04,         // mov eax, [esp + 4]
+                    0x40,                           // inc eax
+                    0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90,
+                    0xC2, 0x04, 0x00 };             // ret 4
+
+            IntPtr code = VirtualAlloc(IntPtr.Zero, (UIntPtr)4096, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+
+            Assert.AreNotEqual(IntPtr.Zero, code);
+
+            List<LocalHook> hooks = new List<LocalHook>();
+            BranchDelegate[] targets = new BranchDelegate[hookCount];
+            BranchDelegate[] bypasses = new BranchDelegate[hookCount];
+            int hookCalls = 0;
+
+            try
+            {
+                for (var i = 0; i < hookCount; i++)
+                {
+                    IntPtr entryPoint = new IntPtr(code.ToInt64() + i * stubSize);
+
+                    Marshal.Copy(stub, 0, entryPoint, stub.Length);
+
+                    targets[i] = (BranchDelegate)Marshal.GetDelegateForFunctionPointer(entryPoint, typeof(BranchDelegate));
+                }
+
+                for (var i = 0; i < hookCount; i++)
+                {
+                    int index = i;
+
+                    // each hook calls the original and passes the result on to the next hooked stub
+                    LocalHook lh = LocalHook.Create(
+                        new IntPtr(code.ToInt64() + i * stubSize),
+                        new BranchDelegate(value =>
+                        {
+                            hookCalls++;
+
+                            int result = bypasses[index](value);
+
+                            return (index + 1 < hookCount) ? targets[index + 1](result) : result;
+                        }),
+                        this);
+
+                    lh.ThreadACL.SetInclusiveACL(new int[] { 0 });
+
+                    bypasses[i] = (BranchDelegate)Marshal.GetDelegateForFunctionPointer(lh.HookBypassAddress, typeof(BranchDelegate));
+
+                    hooks.Add(lh);
+                }
+
+                for (var round = 0; round < 3; round++)
+                {
+                    hookCalls = 0;
+
+                    Assert.AreEqual(hookCount, targets[0](0));
+                    Assert.AreEqual(hookCount, hookCalls);
+
+                    // the same hooks entered one after another
+                    for (var i = 0; i < hookCount; i++)
+                        Assert.AreEqual(hookCount - i, targets[i](0));
+                }
+            }
+            finally
+            {
+                foreach (var h in hooks)
+                    h.Dispose();
+
+                NativeAPI.LhWaitForPendingRemovals();
+
+                VirtualFree(code, UIntPtr.Zero, MEM_RELEASE);
+            }
+        }
+
+        const int STATUS_CANCELLED = unchecked((int)0xC0000120);
+
+        // writes stubs returning value + 1, padded so any jumper fits
+        static BranchDelegate[] WriteIncrementStubs(IntPtr code, int count, int stubSize)
+        {
+            byte[] stub = IntPtr.Size == 8
+                ? new byte[] {
+                    0x8D, 0x41, 0x01,               // lea eax, [rcx + 1]
+                    0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90,
+                    0xC3 }                          // ret
+                : new byte[] {
+                    0x8B, 0x44, 0x24, 0x04,         // mov eax, [esp + 4]
+                    0x40,                           // inc eax
+                    0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90,
+                    0xC2, 0x04, 0x00 };             // ret 4
+
+            BranchDelegate[] targets = new BranchDelegate[count];
+
+            for (var i = 0; i < count; i++)
+            {
+                IntPtr entryPoint = new IntPtr(code.ToInt64() + i * stubSize);
+
+                Marshal.Copy(stub, 0, entryPoint, stub.Length);
+
+                targets[i] = (BranchDelegate)Marshal.GetDelegateForFunctionPointer(entryPoint, typeof(BranchDelegate));
+            }
+
+            return targets;
+        }
+
+        static void UninstallBatch(NativeAPI.HOOK_INSTALL_ENTRY[] entries)
+        {
+            foreach (var entry in entries)
+            {
+                if (entry.Handle == IntPtr.Zero)
+                    continue;
+
+                if (Marshal.ReadIntPtr(entry.Handle) != IntPtr.Zero)
+                    NativeAPI.LhUninstallHook(entry.Handle);
+            }
+
+            NativeAPI.LhWaitForPendingRemovals();
+
+            foreach (var entry in entries)
+                Marshal.FreeCoTaskMem(entry.Handle);
+        }
+
+        [TestMethod]
+        public void InstallHooks_InstallsBatchWithFlags()
+        {
+            int hookCount = 8;
+            int stubSize = 16;
+
+            IntPtr code = VirtualAlloc(IntPtr.Zero, (UIntPtr)4096, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+
+            Assert.AreNotEqual(IntPtr.Zero, code);
+
+            BranchDelegate hook = new BranchDelegate(value => value + 1000);
+            NativeAPI.HOOK_INSTALL_ENTRY[] entries = new NativeAPI.HOOK_INSTALL_ENTRY[hookCount];
+
+            try
+            {
+                BranchDelegate[] targets = WriteIncrementStubs(code, hookCount, stubSize);
+
+                for (var i = 0; i < hookCount; i++)
+                {
+                    entries[i].EntryPoint = new IntPtr(code.ToInt64() + i * stubSize);
+                    entries[i].HookProc = Marshal.GetFunctionPointerForDelegate(hook);
+                    entries[i].Flags = NativeAPI.EASYHOOK_HOOK_FAST_TRAMPOLINE;
+                    entries[i].Handle = Marshal.AllocCoTaskMem(IntPtr.Size);
+
+                    Marshal.WriteIntPtr(entries[i].Handle, IntPtr.Zero);
+                }
+
+                NativeAPI.LhInstallHooks(entries, true);
+
+                // fast trampolines have no ACL, so all hooks are active right away
+                for (var i = 0; i < hookCount; i++)
+                {
+                    Assert.AreEqual(0, entries[i].Status);
+                    Assert.AreEqual(1005, targets[i](5));
+                }
+            }
+            finally
+            {
+                UninstallBatch(entries);
+
+                VirtualFree(code, UIntPtr.Zero, MEM_RELEASE);
+                GC.KeepAlive(hook);
+            }
+        }
+
+        [TestMethod]
+        public void InstallHooks_FailedBatchReleasesSlots()
+        {
+            int hookCount = 8;
+            int stubSize = 16;
+
+            IntPtr code = VirtualAlloc(IntPtr.Zero, (UIntPtr)4096, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+
+            Assert.AreNotEqual(IntPtr.Zero, code);
+
+            BranchDelegate hook = new BranchDelegate(value => value + 1000);
+            NativeAPI.HOOK_INSTALL_ENTRY[] entries = new NativeAPI.HOOK_INSTALL_ENTRY[hookCount];
+
+            NativeAPI.LhSetMaxHookCount(hookCount - 1);
+            try
+            {
+                BranchDelegate[] targets = WriteIncrementStubs(code, hookCount, stubSize);
+
+                for (var i = 0; i < hookCount; i++)
+                {
+                    entries[i].EntryPoint = new IntPtr(code.ToInt64() + i * stubSize);
+                    entries[i].HookProc = Marshal.GetFunctionPointerForDelegate(hook);
+                    entries[i].Flags = NativeAPI.EASYHOOK_HOOK_FAST_TRAMPOLINE;
+                    entries[i].Handle = Marshal.AllocCoTaskMem(IntPtr.Size);
+
+                    Marshal.WriteIntPtr(entries[i].Handle, IntPtr.Zero);
+                }
+
+                // the last entry exceeds the hook limit, so no slot remains assigned
+                bool exceptionThrown = false;
+                try
+                {
+                    NativeAPI.LhInstallHooks(entries, true);
+                }
+                catch (System.InsufficientMemoryException)
+                {
+                    exceptionThrown = true;
+                }
+
+                Assert.IsTrue(exceptionThrown, "System.InsufficientMemoryException was not thrown");
+
+                for (var i = 0; i < hookCount - 1; i++)
+                    Assert.AreEqual(STATUS_CANCELLED, entries[i].Status);
+
+                // the first entry fails before any slot is assigned
+                IntPtr firstEntryPoint = entries[0].EntryPoint;
+
+                entries[0].EntryPoint = IntPtr.Zero;
+
+                exceptionThrown = false;
+                try
+                {
+                    NativeAPI.LhInstallHooks(entries, true);
+                }
+                catch (Exception)
+                {
+                    exceptionThrown = true;
+                }
+
+                Assert.IsTrue(exceptionThrown, "Invalid entry point was accepted");
+                Assert.AreNotEqual(0, entries[0].Status);
+
+                // both failed batches released their slots, so all but one hook fit
+                entries[0].EntryPoint = firstEntryPoint;
+
+                Marshal.FreeCoTaskMem(entries[hookCount - 1].Handle);
+                Array.Resize(ref entries, hookCount - 1);
+
+                NativeAPI.LhInstallHooks(entries, true);
+
+                for (var i = 0; i < hookCount - 1; i++)
+                {
+                    Assert.AreEqual(0, entries[i].Status);
+                    Assert.AreEqual(1005, targets[i](5));
+                }
+
+                Assert.AreEqual(6, targets[hookCount - 1](5));
+            }
+            finally
+            {
+                UninstallBatch(entries);
+
+                NativeAPI.LhSetMaxHookCount(NativeAPI.MAX_HOOK_COUNT);
+
+                VirtualFree(code, UIntPtr.Zero, MEM_RELEASE);
+                GC.KeepAlive(hook);
+            }
+        }
+
+        [TestMethod]
+        public void ConditionalJumpInEntryPoint_IsRelocated()
+        {
+            // returns 42 for zero, otherwise value + 1. The conditional jump is
+            // located within the first 5 bytes and has to be relocated.
+            byte[] code = IntPtr.Size == 8
+                ? new byte[] {
+                    0x85, 0xC9,                     // test ecx, ecx
+                    0x74, 0x04,                     // jz +4
+                    0x8D, 0x41, 0x01,               // lea eax, [rcx + 1]
+                    0xC3,                           // ret
+                    0xB8, 0x2A, 0x00, 0x00, 0x00,   // mov eax, 42
+                    0xC3 }                          // ret
+                : new byte[] {
+                    0x8B, 0x4C, 0x24, 0x04,         // mov ecx, [esp + 4]
+                    0xE3, 0x06,                     // jecxz +6
+                    0x8D, 0x41, 0x01,               // lea eax, [ecx + 1]
+                    0xC2, 0x04, 0x00,               // ret 4
+                    0xB8, 0x2A, 0x00, 0x00, 0x00,   // mov eax, 42
+                    0xC2, 0x04, 0x00 };             // ret 4
+
+            IntPtr entryPoint = VirtualAlloc(IntPtr.Zero, (UIntPtr)4096, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+
+            Assert.AreNotEqual(IntPtr.Zero, entryPoint);
+
+            try
+            {
+                Marshal.Copy(code, 0, entryPoint, code.Length);
+
+                BranchDelegate target = (BranchDelegate)Marshal.GetDelegateForFunctionPointer(entryPoint, typeof(BranchDelegate));
+
+                using (LocalHook lh = LocalHook.Create(entryPoint, new BranchDelegate(BranchHook), this))
+                {
+                    lh.ThreadACL.SetInclusiveACL(new int[] { 0 });
+
+                    _branchBypass = (BranchDelegate)Marshal.GetDelegateForFunctionPointer(lh.HookBypassAddress, typeof(BranchDelegate));
+
+                    Assert.AreEqual(42, _branchBypass(0));
+                    Assert.AreEqual(6, _branchBypass(5));
+
+                    Assert.AreEqual(1042, target(0));
+                    Assert.AreEqual(1006, target(5));
+                }
+
+                NativeAPI.LhWaitForPendingRemovals();
+
+                Assert.AreEqual(42, target(0));
+                Assert.AreEqual(6, target(5));
+            }
+            finally
+            {
+                VirtualFree(entryPoint, UIntPtr.Zero, MEM_RELEASE);
+            }
+        }
     }
 }